@@ -35,6 +35,7 @@
 //
 #include "emmc.h"
 #include <circle/devicenameservice.h>
+#include <circle/metrics.h>
 #include <circle/util.h>
 #include <circle/stdarg.h>
 #include <assert.h>
@@ -476,6 +477,21 @@ const u32 CEMMCDevice::sd_acommands[] =
 
 #define SD_BLOCK_SIZE		512
 
+static const u64 s_LatencyBounds[] =	// microseconds
+	{100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000};
+
+static CMetricCounter s_ReadBytes ("circle_storage_bytes_total", "Bytes transferred by block devices",
+				   "device=\"emmc\",op=\"read\"");
+static CMetricCounter s_WriteBytes ("circle_storage_bytes_total", "Bytes transferred by block devices",
+				    "device=\"emmc\",op=\"write\"");
+static CMetricCounter s_ReadErrors ("circle_storage_errors_total", "Failed block device operations",
+				    "device=\"emmc\",op=\"read\"");
+static CMetricCounter s_WriteErrors ("circle_storage_errors_total", "Failed block device operations",
+				     "device=\"emmc\",op=\"write\"");
+static CMetricHistogram s_Latency ("circle_storage_latency_us", "Latency of block device operations",
+				   "device=\"emmc\"", s_LatencyBounds,
+				   sizeof s_LatencyBounds / sizeof s_LatencyBounds[0]);
+
 CEMMCDevice::CEMMCDevice (CInterruptSystem *pInterruptSystem, CTimer *pTimer, CActLED *pActLED)
 :	m_pInterruptSystem (pInterruptSystem),
 	m_pTimer (pTimer),
@@ -598,6 +614,8 @@ int CEMMCDevice::Read (void *pBuffer, size_t nCount)
 
 	PeripheralEntry ();
 
+	unsigned nStartTicks = CTimer::GetClockTicks ();
+
 	if (DoRead ((u8 *) pBuffer, nCount, nBlock) != (int) nCount)
 	{
 		PeripheralExit ();
@@ -607,9 +625,14 @@ int CEMMCDevice::Read (void *pBuffer, size_t nCount)
 			m_pActLED->Off ();
 		}
 
+		s_ReadErrors.Add ();
+
 		return -1;
 	}
 
+	s_Latency.Observe (CTimer::GetClockTicks () - nStartTicks);
+	s_ReadBytes.Add (nCount);
+
 	PeripheralExit ();
 
 	if (m_pActLED != 0)
@@ -635,6 +658,8 @@ int CEMMCDevice::Write (const void *pBuffer, size_t nCount)
 
 	PeripheralEntry ();
 
+	unsigned nStartTicks = CTimer::GetClockTicks ();
+
 	if (DoWrite ((u8 *) pBuffer, nCount, nBlock) != (int) nCount)
 	{
 		PeripheralExit ();
@@ -644,9 +669,14 @@ int CEMMCDevice::Write (const void *pBuffer, size_t nCount)
 			m_pActLED->Off ();
 		}
 
+		s_WriteErrors.Add ();
+
 		return -1;
 	}
 
+	s_Latency.Observe (CTimer::GetClockTicks () - nStartTicks);
+	s_WriteBytes.Add (nCount);
+
 	PeripheralExit ();
 
 	if (m_pActLED != 0)
@@ -0,0 +1,248 @@
+//
+// ws2812renderer.cpp
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include "ws2812renderer.h"
+#include "ws2812oversmi.h"
+#include <circle/util.h>
+#include <assert.h>
+
+const u8 CWS2812Renderer::DefaultGammaTable[256] =
+{
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   1,   1,   1,   1,
+	  1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   2,   2,
+	  2,   3,   3,   3,   3,   3,   3,   3,   4,   4,   4,   4,   4,   5,   5,   5,
+	  5,   6,   6,   6,   6,   7,   7,   7,   7,   8,   8,   8,   9,   9,   9,  10,
+	 10,  10,  11,  11,  11,  12,  12,  13,  13,  13,  14,  14,  15,  15,  16,  16,
+	 17,  17,  18,  18,  19,  19,  20,  20,  21,  21,  22,  22,  23,  24,  24,  25,
+	 25,  26,  27,  27,  28,  29,  29,  30,  31,  32,  32,  33,  34,  35,  35,  36,
+	 37,  38,  39,  39,  40,  41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  50,
+	 51,  52,  54,  55,  56,  57,  58,  59,  60,  61,  62,  63,  64,  66,  67,  68,
+	 69,  70,  72,  73,  74,  75,  77,  78,  79,  81,  82,  83,  85,  86,  87,  89,
+	 90,  92,  93,  95,  96,  98,  99, 101, 102, 104, 105, 107, 109, 110, 112, 114,
+	115, 117, 119, 120, 122, 124, 126, 127, 129, 131, 133, 135, 137, 138, 140, 142,
+	144, 146, 148, 150, 152, 154, 156, 158, 160, 162, 164, 167, 169, 171, 173, 175,
+	177, 180, 182, 184, 186, 189, 191, 193, 196, 198, 200, 203, 205, 208, 210, 213,
+	215, 218, 220, 223, 225, 228, 231, 233, 236, 239, 241, 244, 247, 249, 252, 255
+};
+
+CWS2812Renderer::CWS2812Renderer (unsigned nSDLinesMask, unsigned nLEDsPerStrip)
+:	m_SMIMaster (nSDLinesMask, FALSE),
+	m_nLEDCount (nLEDsPerStrip),
+	m_nSDLinesMask (nSDLinesMask),
+	m_nChannels (nSDLinesMask < (1 << 8) ? 8 : 16),
+	m_nWordSize (m_nChannels / 8),
+	m_nBufferWords (TX_BUFF_LEN (nLEDsPerStrip) + WS2812_RESET_CYCLES),
+	m_nBackBuffer (0),
+	m_bDMAActive (FALSE),
+	m_bDirty (TRUE),
+	m_pGammaTable (0),
+	m_nBrightness (255)
+{
+	assert (m_nLEDCount > 0);
+	assert (m_nBufferWords % 4 == 0);	// CS_PXLDAT packs the SMI words into 32 bits
+	assert (m_nSDLinesMask != 0);
+	assert (m_nSDLinesMask < (1 << 16));
+
+	unsigned nPixelSize = m_nLEDCount * 3 * m_nChannels;
+	m_pPixels = new u8[nPixelSize];
+	assert (m_pPixels != 0);
+	memset (m_pPixels, 0, nPixelSize);
+
+	for (unsigned i = 0; i < 2; i++)
+	{
+		// using new makes the buffer cache-aligned, so suitable for DMA
+		m_pBuffer[i] = new u8[m_nBufferWords * m_nWordSize];
+		assert (m_pBuffer[i] != 0);
+		memset (m_pBuffer[i], 0, m_nBufferWords * m_nWordSize);
+
+		// each bit starts with a high pulse on all lines, followed by the data
+		// and a low pulse, only the data is written by Encode() later
+		for (unsigned nBit = 0; nBit < m_nLEDCount * LED_NBITS; nBit++)
+		{
+			unsigned nWord = LED_PREBITS + nBit * BIT_NPULSES;
+
+			if (m_nWordSize == 1)
+			{
+				m_pBuffer[i][nWord] = (u8) m_nSDLinesMask;
+			}
+			else
+			{
+				((u16 *) m_pBuffer[i])[nWord] = (u16) m_nSDLinesMask;
+			}
+		}
+	}
+
+	UpdateLookupTable ();
+
+	m_SMIMaster.SetupTiming (m_nChannels > 8 ? SMI16Bits : SMI8Bits, NEOPIXEL_SMI_NS,
+				 NEOPIXEL_SMI_SETUP, NEOPIXEL_SMI_STROBE, NEOPIXEL_SMI_HOLD,
+				 NEOPIXEL_SMI_PACE);
+}
+
+CWS2812Renderer::~CWS2812Renderer (void)
+{
+	if (m_bDMAActive)
+	{
+		m_SMIMaster.WaitDMA ();
+	}
+
+	for (unsigned i = 0; i < 2; i++)
+	{
+		delete [] m_pBuffer[i];
+		m_pBuffer[i] = 0;
+	}
+
+	delete [] m_pPixels;
+	m_pPixels = 0;
+}
+
+unsigned CWS2812Renderer::GetLEDCount (void) const
+{
+	return m_nLEDCount;
+}
+
+void CWS2812Renderer::SetGammaTable (const u8 *pTable)
+{
+	m_pGammaTable = pTable;
+
+	UpdateLookupTable ();
+}
+
+void CWS2812Renderer::SetBrightness (u8 nBrightness)
+{
+	m_nBrightness = nBrightness;
+
+	UpdateLookupTable ();
+}
+
+void CWS2812Renderer::SetLED (unsigned nSDLine, unsigned nLEDIndexInStrip,
+			      u8 nRed, u8 nGreen, u8 nBlue)
+{
+	assert (nSDLine < m_nChannels);
+	assert (m_nSDLinesMask & (1 << nSDLine));
+	assert (nLEDIndexInStrip < m_nLEDCount);
+
+	assert (m_pPixels != 0);
+	u8 *pPixel = &m_pPixels[nLEDIndexInStrip * 3 * m_nChannels + nSDLine];
+
+	pPixel[0]		= nGreen;
+	pPixel[m_nChannels]	= nRed;
+	pPixel[2*m_nChannels]	= nBlue;
+
+	m_bDirty = TRUE;
+}
+
+void CWS2812Renderer::Update (void)
+{
+	if (!m_bDirty)
+	{
+		return;
+	}
+
+	m_bDirty = FALSE;
+
+	// encode into the buffer, which is not sent at the moment
+	u8 *pBuffer = m_pBuffer[m_nBackBuffer];
+	assert (pBuffer != 0);
+
+	if (m_nWordSize == 1)
+	{
+		Encode (pBuffer);
+	}
+	else
+	{
+		Encode ((u16 *) pBuffer);
+	}
+
+	if (m_bDMAActive)
+	{
+		m_SMIMaster.WaitDMA ();
+	}
+
+	m_SMIMaster.SetupDMA (pBuffer, m_nBufferWords * m_nWordSize);
+	m_SMIMaster.WriteDMA (FALSE);
+
+	m_bDMAActive = TRUE;
+	m_nBackBuffer ^= 1;
+}
+
+void CWS2812Renderer::UpdateLookupTable (void)
+{
+	for (unsigned nValue = 0; nValue < 256; nValue++)
+	{
+		unsigned nCorrected = nValue * m_nBrightness / 255;
+		if (m_pGammaTable != 0)
+		{
+			nCorrected = m_pGammaTable[nCorrected];
+		}
+
+		u64 nExpanded = 0;
+		for (unsigned nBit = 0; nBit < 8; nBit++)
+		{
+			if (nCorrected & (0x80 >> nBit))
+			{
+				nExpanded |= (u64) 1 << (nBit * 8);
+			}
+		}
+
+		m_LookupTable[nValue] = nExpanded;
+	}
+
+	m_bDirty = TRUE;
+}
+
+template <typename T>
+void CWS2812Renderer::Encode (T *pBuffer) const
+{
+	assert (pBuffer != 0);
+	assert (m_pPixels != 0);
+
+	const u8 *pValues = m_pPixels;
+	T *pData = pBuffer + LED_PREBITS + 1;		// the data follows the high pulse
+
+	for (unsigned i = 0; i < m_nLEDCount * 3; i++)
+	{
+		// bit n of the color value for all strips is in byte n
+		u64 nLow = Expand8 (pValues);
+		u64 nHigh = m_nChannels > 8 ? Expand8 (pValues + 8) : 0;
+		pValues += m_nChannels;
+
+		for (unsigned nBit = 0; nBit < 8; nBit++)
+		{
+			*pData = (T) ((nLow & 0xFF) | (nHigh & 0xFF) << 8);
+
+			nLow >>= 8;
+			nHigh >>= 8;
+			pData += BIT_NPULSES;
+		}
+	}
+}
+
+u64 CWS2812Renderer::Expand8 (const u8 *pValues) const
+{
+	return    m_LookupTable[pValues[0]]
+		| m_LookupTable[pValues[1]] << 1
+		| m_LookupTable[pValues[2]] << 2
+		| m_LookupTable[pValues[3]] << 3
+		| m_LookupTable[pValues[4]] << 4
+		| m_LookupTable[pValues[5]] << 5
+		| m_LookupTable[pValues[6]] << 6
+		| m_LookupTable[pValues[7]] << 7;
+}
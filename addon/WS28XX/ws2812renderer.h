@@ -0,0 +1,105 @@
+//
+// ws2812renderer.h
+//
+// Renders multiple WS2812 LED strips in parallel over SMI
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef _ws28xx_ws2812renderer_h
+#define _ws28xx_ws2812renderer_h
+
+#include <circle/smimaster.h>
+#include <circle/types.h>
+
+// Number of SMI cycles of low level after each frame (latch/reset time, 300 us at 400 ns),
+// must be a multiple of 4, so that the buffer consists of whole 32-bit words in 8-bit mode
+#define WS2812_RESET_CYCLES	752
+
+/// \note Up to 8 strips (SD0-SD7) use 8-bit SMI words, otherwise 16-bit words are used\n
+///	  (SD0-SD15). Because of the size of a DMA transfer, up to 890 (8 strips) or 440\n
+///	  (16 strips) LEDs per strip are supported.
+/// \note The color values are mapped through a lookup table, which combines brightness,\n
+///	  gamma correction and the expansion of the bits to the SMI data lines. All strips\n
+///	  are encoded together, eight strips per 64-bit operation.
+/// \note Two DMA buffers are used, so that the next frame is encoded, while the previous\n
+///	  one is still sent.
+
+class CWS2812Renderer		/// Renders multiple WS2812 LED strips in parallel over SMI
+{
+public:
+	/// \param nSDLinesMask Mask of the SMI data lines, to which the strips are connected\n
+	///	   (e.g. (1 << 0) | (1 << 5) for 2 strips on SD0 (GPIO8) and SD5 (GPIO13))
+	/// \param nLEDsPerStrip Number of LEDs on each strip
+	CWS2812Renderer (unsigned nSDLinesMask, unsigned nLEDsPerStrip);
+
+	~CWS2812Renderer (void);
+
+	/// \return Number of LEDs on each strip
+	unsigned GetLEDCount (void) const;
+
+	/// \param pTable Table with 256 entries, which is applied to each color value\n
+	///	   (e.g. DefaultGammaTable, or 0 for linear output)
+	void SetGammaTable (const u8 *pTable);
+
+	/// \param nBrightness Scaling factor for all color values (0-255)
+	void SetBrightness (u8 nBrightness);
+
+	/// \param nSDLine The SMI data line, to which the strip is connected (e.g. 5 for SD5)
+	/// \param nLEDIndexInStrip 0-based index of the LED in the strip
+	/// \param nRed Red value (0-255)
+	/// \param nGreen Green value (0-255)
+	/// \param nBlue Blue value (0-255)
+	void SetLED (unsigned nSDLine, unsigned nLEDIndexInStrip, u8 nRed, u8 nGreen, u8 nBlue);
+
+	/// \brief Encode the frame and start sending it in the background
+	/// \note Waits for the completion of the previous frame only, if it is still sent,\n
+	///	  after the new frame has been encoded.
+	void Update (void);
+
+	/// \brief Gamma 2.8 table for use with SetGammaTable()
+	static const u8 DefaultGammaTable[256];
+
+private:
+	void UpdateLookupTable (void);
+
+	template <typename T>
+	void Encode (T *pBuffer) const;
+
+	u64 Expand8 (const u8 *pValues) const;
+
+private:
+	CSMIMaster m_SMIMaster;
+	unsigned m_nLEDCount;
+	unsigned m_nSDLinesMask;
+	unsigned m_nChannels;		// 8 or 16
+	unsigned m_nWordSize;		// 1 or 2 bytes
+	unsigned m_nBufferWords;
+
+	u8 *m_pPixels;			// [LED][color (GRB)][channel]
+	u8 *m_pBuffer[2];
+	unsigned m_nBackBuffer;
+	boolean m_bDMAActive;
+	boolean m_bDirty;
+
+	const u8 *m_pGammaTable;
+	u8 m_nBrightness;
+
+	// byte n has bit 0 set, if bit 7-n of the corrected color value is set
+	u64 m_LookupTable[256];
+};
+
+#endif
@@ -22,6 +22,8 @@
 //
 #include <display/ili9341display.h>
 #include <circle/timer.h>
+#include <circle/memory.h>
+#include <circle/new.h>
 #include <circle/util.h>
 #include <circle/stdarg.h>
 #include <assert.h>
@@ -125,6 +127,7 @@ CILI9341Display::CILI9341Display (CSPIMaster *pSPIMaster,
 				  unsigned nChipSelect, boolean bSwapColorBytes)
 :	CDisplay (bSwapColorBytes ? RGB565_BE : RGB565),
 	m_pSPIMaster (pSPIMaster),
+	m_pDMA (nullptr),
 	m_nResetPin (nResetPin),
 	m_nBackLightPin (nBackLightPin),
 	m_nWidth (nWidth),
@@ -153,8 +156,23 @@ CILI9341Display::CILI9341Display (CSPIMaster *pSPIMaster,
 	}
 }
 
+CILI9341Display::CILI9341Display (CSPIMasterDMA *pSPIMaster,
+				  unsigned nDCPin, unsigned nResetPin, unsigned nBackLightPin,
+				  unsigned nWidth, unsigned nHeight,
+				  unsigned nCPOL, unsigned nCPHA, unsigned nClockSpeed,
+				  unsigned nChipSelect, boolean bSwapColorBytes)
+:	CILI9341Display (static_cast<CSPIMaster *> (nullptr), nDCPin, nResetPin, nBackLightPin,
+			 nWidth, nHeight, nCPOL, nCPHA, nClockSpeed, nChipSelect, bSwapColorBytes)
+{
+	m_pDMA = new CSPIDisplayDMA (pSPIMaster, nChipSelect, nClockSpeed, nCPOL, nCPHA);
+	assert (m_pDMA);
+}
+
 CILI9341Display::~CILI9341Display (void)
 {
+	delete m_pDMA;
+	m_pDMA = nullptr;
+
 	delete [] m_pBuffer;
 };
 
@@ -167,12 +185,13 @@ void CILI9341Display::SetRotation (unsigned nDegrees)
 
 boolean CILI9341Display::Initialize (void)
 {
-	assert (m_pSPIMaster != 0);
+	assert (m_pSPIMaster != 0 || m_pDMA != 0);
 
-	if (!m_bSwapColorBytes)
+	if (   !m_bSwapColorBytes
+	    || m_pDMA)
 	{
 		assert (!m_pBuffer);
-		m_pBuffer = new u16[m_nWidth * m_nHeight];
+		m_pBuffer = new (HEAP_DMA30) u16[m_nWidth * m_nHeight];
 		assert (m_pBuffer);
 	}
 
@@ -325,6 +344,11 @@ void CILI9341Display::SetArea (const TArea &rArea, const void *pPixels,
 			       TAreaCompletionRoutine *pRoutine,
 			       void *pParam)
 {
+	if (m_pDMA)
+	{
+		m_pDMA->WaitForCompletion ();	// m_pBuffer may be in use
+	}
+
 	SetWindow (rArea.x1, rArea.y1, rArea.x2, rArea.y2);
 
 	size_t ulSize = (rArea.y2 - rArea.y1 + 1) * (rArea.x2 - rArea.x1 + 1) * sizeof (u16);
@@ -344,6 +368,27 @@ void CILI9341Display::SetArea (const TArea &rArea, const void *pPixels,
 
 		pPixels = m_pBuffer;
 	}
+	else if (   m_pDMA
+		 && !CSPIDisplayDMA::IsDMAable (pPixels, ulSize))
+	{
+		memcpy (m_pBuffer, pPixels, ulSize);	// m_pBuffer is from HEAP_DMA30
+
+		pPixels = m_pBuffer;
+	}
+
+	if (m_pDMA)
+	{
+		m_DCPin.Write (HIGH);
+
+		m_pDMA->StartWrite (pPixels, ulSize, pRoutine, pParam);
+
+		if (!pRoutine)
+		{
+			m_pDMA->WaitForCompletion ();
+		}
+
+		return;
+	}
 
 	while (ulSize)
 	{
@@ -388,6 +433,17 @@ void CILI9341Display::SetWindow (unsigned x0, unsigned y0, unsigned x1, unsigned
 
 void CILI9341Display::SendByte (u8 uchByte, boolean bIsData)
 {
+	if (m_pDMA)
+	{
+		m_pDMA->WaitForCompletion ();
+
+		m_DCPin.Write (bIsData ? HIGH : LOW);
+
+		m_pDMA->Write (&uchByte, sizeof uchByte);
+
+		return;
+	}
+
 	assert (m_pSPIMaster != 0);
 
 	m_DCPin.Write (bIsData ? HIGH : LOW);
@@ -406,6 +462,18 @@ void CILI9341Display::SendData (const void *pData, size_t nLength)
 {
 	assert (pData != 0);
 	assert (nLength > 0);
+
+	if (m_pDMA)
+	{
+		m_pDMA->WaitForCompletion ();
+
+		m_DCPin.Write (HIGH);
+
+		m_pDMA->Write (pData, nLength);
+
+		return;
+	}
+
 	assert (m_pSPIMaster != 0);
 
 	m_DCPin.Write (HIGH);
@@ -22,7 +22,9 @@
 
 #include <circle/display.h>
 #include <circle/spimaster.h>
+#include <circle/spimasterdma.h>
 #include <circle/gpiopin.h>
+#include <display/spidisplaydma.h>
 #include <circle/types.h>
 
 class CILI9341Display : public CDisplay /// Driver for ILI9341-based dot-matrix displays
@@ -51,6 +53,15 @@ public:
 			 unsigned nCPOL = 0, unsigned nCPHA = 0, unsigned nClockSpeed = 15000000,
 			 unsigned nChipSelect = 0, boolean bSwapColorBytes = TRUE);
 
+	/// \brief Uses DMA for pixel transfers, SetArea() works asynchronously with a completion routine
+	/// \param pSPIMaster Pointer to SPI master object with DMA support (must be initialized)
+	/// \note The other parameters are the same as above.
+	CILI9341Display (CSPIMasterDMA *pSPIMaster,
+			 unsigned nDCPin, unsigned nResetPin = None, unsigned nBackLightPin = None,
+			 unsigned nWidth = 240, unsigned nHeight = 320,
+			 unsigned nCPOL = 0, unsigned nCPHA = 0, unsigned nClockSpeed = 15000000,
+			 unsigned nChipSelect = 0, boolean bSwapColorBytes = TRUE);
+
 	~CILI9341Display (void);
 
 	/// \brief Set the global rotation of the display
@@ -90,6 +101,10 @@ public:
 	/// \param pPixels Pointer to array with raw color values (RGB565 or RGB565_BE)
 	/// \param pRoutine Routine to be called on completion
 	/// \param pParam User parameter to be handed over to completion routine
+	/// \note With DMA the completion routine is called at IRQ_LEVEL, when the transfer\n
+	///	  has been completed. pPixels must not be modified until then, unless it is\n
+	///	  not 4-byte aligned or not DMA-able (see CSPIDisplayDMA::IsDMAable()), because\n
+	///	  it is copied into an internal buffer then.
 	void SetArea (const TArea &rArea, const void *pPixels,
 		      TAreaCompletionRoutine *pRoutine = nullptr,
 		      void *pParam = nullptr);
@@ -108,6 +123,7 @@ private:
 
 private:
 	CSPIMaster *m_pSPIMaster;
+	CSPIDisplayDMA *m_pDMA;
 	unsigned m_nResetPin;
 	unsigned m_nBackLightPin;
 	unsigned m_nWidth;
@@ -0,0 +1,187 @@
+//
+// spidisplaydma.cpp
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <display/spidisplaydma.h>
+#include <circle/memory.h>
+#include <circle/memorymap.h>
+#include <circle/logger.h>
+#include <circle/synchronize.h>
+#include <circle/new.h>
+#include <assert.h>
+
+// The BCM2835 SPI master has a transfer size limit (DLEN register).
+// The block size must be a multiple of 4 to keep the data aligned.
+#define MAX_BLOCK_SIZE		0xFFFC
+
+LOGMODULE ("spidma");
+
+CSPIDisplayDMA::CSPIDisplayDMA (CSPIMasterDMA *pSPIMaster, unsigned nChipSelect,
+				unsigned nClockSpeed, unsigned CPOL, unsigned CPHA)
+:	m_pSPIMaster (pSPIMaster),
+	m_nChipSelect (nChipSelect),
+	m_nClockSpeed (nClockSpeed),
+	m_CPOL (CPOL),
+	m_CPHA (CPHA),
+	m_pRxBuffer (new (HEAP_DMA30) u8[MAX_BLOCK_SIZE]),
+	m_bBusy (FALSE),
+	m_pData (nullptr),
+	m_nRemaining (0),
+	m_pRoutine (nullptr),
+	m_pParam (nullptr)
+{
+	assert (m_pSPIMaster);
+	assert (m_pRxBuffer);
+}
+
+CSPIDisplayDMA::~CSPIDisplayDMA (void)
+{
+	WaitForCompletion ();
+
+	delete [] m_pRxBuffer;
+	m_pRxBuffer = nullptr;
+}
+
+void CSPIDisplayDMA::Write (const void *pData, size_t nLength)
+{
+	assert (pData);
+	assert (nLength > 0);
+
+	WaitForCompletion ();
+
+	m_pSPIMaster->SetClock (m_nClockSpeed);
+	m_pSPIMaster->SetMode (m_CPOL, m_CPHA);
+
+	const u8 *p = static_cast<const u8 *> (pData);
+	while (nLength)
+	{
+		size_t nBlockSize = nLength < MAX_BLOCK_SIZE ? nLength : MAX_BLOCK_SIZE;
+
+#ifndef NDEBUG
+		int nResult =
+#endif
+			m_pSPIMaster->WriteReadSync (m_nChipSelect, p, nullptr, nBlockSize);
+		assert (nResult == (int) nBlockSize);
+
+		p += nBlockSize;
+		nLength -= nBlockSize;
+	}
+}
+
+void CSPIDisplayDMA::StartWrite (const void *pData, size_t nLength,
+				 CDisplay::TAreaCompletionRoutine *pRoutine, void *pParam)
+{
+	assert (pData);
+	assert (nLength > 0);
+	assert (IsDMAable (pData, nLength));
+
+	WaitForCompletion ();
+
+	m_pSPIMaster->SetClock (m_nClockSpeed);
+	m_pSPIMaster->SetMode (m_CPOL, m_CPHA);
+
+	m_pData = static_cast<const u8 *> (pData);
+	m_nRemaining = nLength;
+	m_pRoutine = pRoutine;
+	m_pParam = pParam;
+
+	m_bBusy = TRUE;
+	DataMemBarrier ();
+
+	StartBlock ();
+}
+
+boolean CSPIDisplayDMA::IsDMAable (const void *pData, size_t nLength)
+{
+	// DMA requires 4-byte alignment
+	if ((uintptr) pData & 3)
+	{
+		return FALSE;
+	}
+
+#if RASPPI >= 4
+	// the DMA channels used by CSPIMasterDMA can access the first GB only
+	if ((uintptr) pData + nLength > MEM_HIGHMEM_START)
+	{
+		return FALSE;
+	}
+#endif
+
+	return TRUE;
+}
+
+void CSPIDisplayDMA::WaitForCompletion (void)
+{
+	while (m_bBusy)
+	{
+		// the completion routine is called from the DMA interrupt
+	}
+
+	DataMemBarrier ();
+}
+
+void CSPIDisplayDMA::StartBlock (void)
+{
+	size_t nBlockSize = m_nRemaining < MAX_BLOCK_SIZE ? m_nRemaining : MAX_BLOCK_SIZE;
+	assert (nBlockSize > 0);
+
+	const u8 *pBlock = m_pData;
+	m_pData += nBlockSize;
+	m_nRemaining -= nBlockSize;
+
+	m_pSPIMaster->SetCompletionRoutine (CompletionStub, this);
+	m_pSPIMaster->StartWriteRead (m_nChipSelect, pBlock, m_pRxBuffer, nBlockSize);
+}
+
+void CSPIDisplayDMA::CompletionRoutine (boolean bStatus)
+{
+	if (!bStatus)
+	{
+		LOGWARN ("Transfer failed");
+
+		m_nRemaining = 0;
+	}
+
+	if (m_nRemaining > 0)
+	{
+		StartBlock ();
+
+		return;
+	}
+
+	// the next transfer may be started from another core, after m_bBusy has been cleared
+	CDisplay::TAreaCompletionRoutine *pRoutine = m_pRoutine;
+	void *pParam = m_pParam;
+	m_pRoutine = nullptr;
+
+	DataMemBarrier ();
+	m_bBusy = FALSE;
+
+	if (pRoutine)
+	{
+		(*pRoutine) (pParam);
+	}
+}
+
+void CSPIDisplayDMA::CompletionStub (boolean bStatus, void *pParam)
+{
+	CSPIDisplayDMA *pThis = static_cast<CSPIDisplayDMA *> (pParam);
+	assert (pThis);
+
+	pThis->CompletionRoutine (bStatus);
+}
@@ -0,0 +1,91 @@
+//
+// spidisplaydma.h
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef _display_spidisplaydma_h
+#define _display_spidisplaydma_h
+
+#include <circle/display.h>
+#include <circle/spimasterdma.h>
+#include <circle/types.h>
+
+class CSPIDisplayDMA	/// Helper for SPI display drivers, sends data via CSPIMasterDMA
+{
+public:
+	/// \param pSPIMaster Pointer to SPI master object (must be initialized)
+	/// \param nChipSelect SPI chip select
+	/// \param nClockSpeed SPI clock frequency in Hz
+	/// \param CPOL SPI clock polarity
+	/// \param CPHA SPI clock phase
+	CSPIDisplayDMA (CSPIMasterDMA *pSPIMaster, unsigned nChipSelect,
+			unsigned nClockSpeed, unsigned CPOL, unsigned CPHA);
+
+	~CSPIDisplayDMA (void);
+
+	/// \brief Write data synchronously (polled), for commands and small amounts of data
+	/// \param pData Pointer to the data
+	/// \param nLength Length of the data in bytes
+	/// \note Waits for the completion of a running asynchronous transfer before.
+	void Write (const void *pData, size_t nLength);
+
+	/// \brief Start an asynchronous transfer using DMA
+	/// \param pData Pointer to the data (must be 4-byte aligned and DMA-able, see IsDMAable())
+	/// \param nLength Length of the data in bytes (can be larger than the SPI limit)
+	/// \param pRoutine Routine to be called on completion (at IRQ_LEVEL, or 0)
+	/// \param pParam User parameter to be handed over to the completion routine
+	/// \note The data must not be modified until the completion routine has been called.
+	void StartWrite (const void *pData, size_t nLength,
+			 CDisplay::TAreaCompletionRoutine *pRoutine, void *pParam);
+
+	/// \param pData Pointer to the data
+	/// \param nLength Length of the data in bytes
+	/// \return Can the data be handed over to StartWrite() directly?
+	/// \note Otherwise the data has to be copied into a buffer from HEAP_DMA30 before.
+	static boolean IsDMAable (const void *pData, size_t nLength);
+
+	/// \return Is an asynchronous transfer running?
+	boolean IsBusy (void) const		{ return m_bBusy; }
+
+	/// \brief Wait for the completion of a running asynchronous transfer
+	/// \note Must not be called from IRQ_LEVEL.
+	void WaitForCompletion (void);
+
+private:
+	void StartBlock (void);
+
+	void CompletionRoutine (boolean bStatus);
+	static void CompletionStub (boolean bStatus, void *pParam);
+
+private:
+	CSPIMasterDMA *m_pSPIMaster;
+	unsigned m_nChipSelect;
+	unsigned m_nClockSpeed;
+	unsigned m_CPOL;
+	unsigned m_CPHA;
+
+	u8 *m_pRxBuffer;		// received data is ignored
+
+	volatile boolean m_bBusy;
+	const u8 *m_pData;
+	size_t m_nRemaining;
+
+	CDisplay::TAreaCompletionRoutine *m_pRoutine;
+	void *m_pParam;
+};
+
+#endif
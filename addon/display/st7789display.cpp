@@ -26,6 +26,8 @@
 //
 #include <display/st7789display.h>
 #include <circle/timer.h>
+#include <circle/memory.h>
+#include <circle/new.h>
 #include <assert.h>
 
 #define ST7789_NOP	0x00
@@ -91,6 +93,7 @@ CST7789Display::CST7789Display (CSPIMaster *pSPIMaster,
 				unsigned nChipSelect, boolean bSwapColorBytes)
 :	CDisplay (bSwapColorBytes ? RGB565_BE : RGB565),
 	m_pSPIMaster (pSPIMaster),
+	m_pDMA (nullptr),
 	m_nResetPin (nResetPin),
 	m_nBackLightPin (nBackLightPin),
 	m_nWidth (nWidth),
@@ -118,18 +121,33 @@ CST7789Display::CST7789Display (CSPIMaster *pSPIMaster,
 		
 	m_nRotation = 0;
 
-	m_pBuffer = new u16[m_nWidth * m_nHeight];
+	m_pBuffer = new (HEAP_DMA30) u16[m_nWidth * m_nHeight];
 	assert (m_pBuffer != 0);
 }
 
+CST7789Display::CST7789Display (CSPIMasterDMA *pSPIMaster,
+				unsigned nDCPin, unsigned nResetPin, unsigned nBackLightPin,
+				unsigned nWidth, unsigned nHeight,
+				unsigned CPOL, unsigned CPHA, unsigned nClockSpeed,
+				unsigned nChipSelect, boolean bSwapColorBytes)
+:	CST7789Display (static_cast<CSPIMaster *> (nullptr), nDCPin, nResetPin, nBackLightPin,
+			nWidth, nHeight, CPOL, CPHA, nClockSpeed, nChipSelect, bSwapColorBytes)
+{
+	m_pDMA = new CSPIDisplayDMA (pSPIMaster, nChipSelect, nClockSpeed, CPOL, CPHA);
+	assert (m_pDMA != 0);
+}
+
 CST7789Display::~CST7789Display (void)
 {
+	delete m_pDMA;
+	m_pDMA = nullptr;
+
 	delete [] m_pBuffer;
 }
 
 boolean CST7789Display::Initialize (void)
 {
-	assert (m_pSPIMaster != 0);
+	assert (m_pSPIMaster != 0 || m_pDMA != 0);
 
 	if (m_nBackLightPin != None)
 	{
@@ -416,6 +434,11 @@ void CST7789Display::SetArea (const TArea &rArea, const void *pPixels,
 	int nWidth = rArea.x2 - rArea.x1 + 1;
 	int nHeight = rArea.y2 - rArea.y1 + 1;
 
+	if (m_pDMA)
+	{
+		m_pDMA->WaitForCompletion ();	// m_pBuffer may be in use
+	}
+
 	if (m_nRotation == 0)
 	{
 		SetWindow (rArea.x1, rArea.y1, rArea.x2, rArea.y2);
@@ -472,6 +495,28 @@ void CST7789Display::SetArea (const TArea &rArea, const void *pPixels,
 	}
 
 	size_t ulSize = nWidth * nHeight * sizeof (u16);
+
+	if (m_pDMA)
+	{
+		if (!CSPIDisplayDMA::IsDMAable (pPixels, ulSize))
+		{
+			memcpy (m_pBuffer, pPixels, ulSize);	// m_pBuffer is from HEAP_DMA30
+
+			pPixels = m_pBuffer;
+		}
+
+		m_DCPin.Write (HIGH);
+
+		m_pDMA->StartWrite (pPixels, ulSize, pRoutine, pParam);
+
+		if (!pRoutine)
+		{
+			m_pDMA->WaitForCompletion ();
+		}
+
+		return;
+	}
+
 	while (ulSize)
 	{
 		// The BCM2835 SPI master has a transfer size limit.
@@ -517,6 +562,17 @@ void CST7789Display::SetWindow (unsigned x0, unsigned y0, unsigned x1, unsigned
 
 void CST7789Display::SendByte (u8 uchByte, boolean bIsData)
 {
+	if (m_pDMA)
+	{
+		m_pDMA->WaitForCompletion ();
+
+		m_DCPin.Write (bIsData ? HIGH : LOW);
+
+		m_pDMA->Write (&uchByte, sizeof uchByte);
+
+		return;
+	}
+
 	assert (m_pSPIMaster != 0);
 
 	m_DCPin.Write (bIsData ? HIGH : LOW);
@@ -535,6 +591,18 @@ void CST7789Display::SendData (const void *pData, size_t nLength)
 {
 	assert (pData != 0);
 	assert (nLength > 0);
+
+	if (m_pDMA)
+	{
+		m_pDMA->WaitForCompletion ();
+
+		m_DCPin.Write (HIGH);
+
+		m_pDMA->Write (pData, nLength);
+
+		return;
+	}
+
 	assert (m_pSPIMaster != 0);
 
 	m_DCPin.Write (HIGH);
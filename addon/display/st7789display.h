@@ -22,7 +22,9 @@
 
 #include <circle/display.h>
 #include <circle/spimaster.h>
+#include <circle/spimasterdma.h>
 #include <circle/gpiopin.h>
+#include <display/spidisplaydma.h>
 #include <circle/chargenerator.h>
 #include <circle/util.h>
 #include <circle/types.h>
@@ -64,6 +66,15 @@ public:
 			unsigned CPOL = 0, unsigned CPHA = 0, unsigned nClockSpeed = 15000000,
 			unsigned nChipSelect = 0, boolean bSwapColorBytes = TRUE);
 
+	/// \brief Uses DMA for pixel transfers, SetArea() works asynchronously with a completion routine
+	/// \param pSPIMaster Pointer to SPI master object with DMA support (must be initialized)
+	/// \note The other parameters are the same as above.
+	CST7789Display (CSPIMasterDMA *pSPIMaster,
+			unsigned nDCPin, unsigned nResetPin = None, unsigned nBackLightPin = None,
+			unsigned nWidth = 240, unsigned nHeight = 240,
+			unsigned CPOL = 0, unsigned CPHA = 0, unsigned nClockSpeed = 15000000,
+			unsigned nChipSelect = 0, boolean bSwapColorBytes = TRUE);
+
 	~CST7789Display (void);
 
 	/// \return Display width in number of pixels
@@ -122,6 +133,10 @@ public:
 	/// \param pPixels Pointer to array with raw color values (RGB565 or RGB565_BE)
 	/// \param pRoutine Routine to be called on completion
 	/// \param pParam User parameter to be handed over to completion routine
+	/// \note With DMA the completion routine is called at IRQ_LEVEL, when the transfer\n
+	///	  has been completed. pPixels must not be modified until then, unless it is\n
+	///	  not 4-byte aligned or not DMA-able (see CSPIDisplayDMA::IsDMAable()), because\n
+	///	  it is copied into an internal buffer then.
 	void SetArea (const TArea &rArea, const void *pPixels,
 		      TAreaCompletionRoutine *pRoutine = nullptr,
 		      void *pParam = nullptr);
@@ -141,6 +156,7 @@ private:
 
 private:
 	CSPIMaster *m_pSPIMaster;
+	CSPIDisplayDMA *m_pDMA;
 	unsigned m_nResetPin;
 	unsigned m_nBackLightPin;
 	unsigned m_nWidth;
@@ -28,7 +28,11 @@ CKernel::CKernel (void)
 	m_Logger (m_Options.GetLogLevel (), &m_Timer),
 	m_USBHCI (&m_Interrupt, &m_Timer, TRUE),
 #ifdef SPI_DISPLAY
+#ifdef SPI_DISPLAY_DMA
+	m_SPIMaster (&m_Interrupt, SPI_CLOCK_SPEED, SPI_CPOL, SPI_CPHA, TRUE, SPI_MASTER_DEVICE),
+#else
 	m_SPIMaster (SPI_CLOCK_SPEED, SPI_CPOL, SPI_CPHA, SPI_MASTER_DEVICE),
+#endif
 	m_SPIDisplay (&m_SPIMaster, DISPLAY_PARAMETERS, FALSE),	// FALSE: use RGB565, not RGB565_BE
 	m_GUI (&m_SPIDisplay)
 #elif defined (I2C_DISPLAY)
@@ -36,6 +36,7 @@
 
 #ifdef SPI_DISPLAY
 	#include <circle/spimaster.h>
+	#include <circle/spimasterdma.h>
 	#include <display/sampleconfig.h>
 #elif defined (I2C_DISPLAY)
 	#include <circle/i2cmaster.h>
@@ -73,7 +74,11 @@ private:
 	CUSBHCIDevice		m_USBHCI;
 
 #ifdef SPI_DISPLAY
+#ifdef SPI_DISPLAY_DMA
+	CSPIMasterDMA		m_SPIMaster;
+#else
 	CSPIMaster		m_SPIMaster;
+#endif
 	DISPLAY_CLASS		m_SPIDisplay;
 #elif defined (I2C_DISPLAY)
 	CI2CMaster		m_I2CMaster;
@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+#
+# pmufold.py
+#
+# Converts the output of CPMUProfiler to folded stacks (for flamegraph.pl)
+#
+# Circle - A C++ bare metal environment for Raspberry Pi
+# Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+import argparse
+import bisect
+import subprocess
+import sys
+
+def load_symbols(nm, elf):
+    out = subprocess.run([nm, '-n', '-C', elf], check=True,
+                         stdout=subprocess.PIPE, universal_newlines=True).stdout
+    addresses = []
+    names = []
+    for line in out.splitlines():
+        fields = line.split(' ', 2)
+        if len(fields) == 3 and fields[1] in 'tTwW':
+            addresses.append(int(fields[0], 16))
+            names.append(fields[2])
+    return addresses, names
+
+def lookup(addresses, names, address):
+    i = bisect.bisect_right(addresses, address) - 1
+    return names[i] if i >= 0 else '0x%x' % address
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert CPMUProfiler samples to folded stacks')
+    parser.add_argument('elf', help='kernel image (kernel*.elf)')
+    parser.add_argument('samples', help='file written by CPMUProfiler')
+    parser.add_argument('--nm', default='aarch64-none-elf-nm',
+                        help='nm of the toolchain (default: %(default)s)')
+    parser.add_argument('--event', type=int, default=0,
+                        help='index of the event to be output (default: %(default)s)')
+    parser.add_argument('--core', type=int, default=None,
+                        help='output only samples of this core (default: all)')
+    parser.add_argument('--per-core', action='store_true',
+                        help='add a root frame with the core number')
+    args = parser.parse_args()
+
+    addresses, names = load_symbols(args.nm, args.elf)
+
+    stacks = {}
+    with open(args.samples) as f:
+        for line in f:
+            if line.startswith('#'):
+                if line.startswith('# event'):
+                    fields = line.split()
+                    if int(fields[2], 16) == args.event:
+                        print('event 0x%s, period %d' % (fields[3], int(fields[4], 16)),
+                              file=sys.stderr)
+                continue
+
+            fields = line.split()
+            if len(fields) < 3:
+                continue
+
+            core = int(fields[0], 16)
+            if int(fields[1], 16) != args.event or (args.core is not None and core != args.core):
+                continue
+
+            # leaf first; return addresses point behind the call instruction
+            frames = [lookup(addresses, names, int(fields[2], 16))]
+            frames += [lookup(addresses, names, int(a, 16) - 4) for a in fields[3:]]
+            frames.reverse()
+            if args.per_core:
+                frames.insert(0, 'core%d' % core)
+
+            stack = ';'.join(frames)
+            stacks[stack] = stacks.get(stack, 0) + 1
+
+    for stack in sorted(stacks):
+        print('%s %d' % (stack, stacks[stack]))
+
+if __name__ == '__main__':
+    main()
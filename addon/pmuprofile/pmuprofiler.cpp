@@ -0,0 +1,520 @@
+//
+// pmuprofiler.cpp
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <pmuprofile/pmuprofiler.h>
+#include <circle/multicore.h>
+#include <circle/synchronize.h>
+#include <circle/sysconfig.h>
+#include <circle/logger.h>
+#include <circle/string.h>
+#include <circle/util.h>
+#include <assert.h>
+
+#define PMCR_E			(1 << 0)	// enable all counters
+#define PMCR_N__SHIFT		11		// number of event counters
+#define PMCR_N__MASK		(0x1F << 11)
+
+#define WRITE_BUFFER_SIZE	4096
+
+#if AARCH == 32
+
+#define DEFINE_PMU_REG(name, crm, op2, reg64)					\
+	static inline u32 Read##name (void)					\
+	{									\
+		u32 nValue;							\
+		asm volatile ("mrc p15, 0, %0, c9, " #crm ", " #op2 : "=r" (nValue)); \
+		return nValue;							\
+	}									\
+	static inline void Write##name (u32 nValue)				\
+	{									\
+		asm volatile ("mcr p15, 0, %0, c9, " #crm ", " #op2 : : "r" (nValue)); \
+	}
+
+#else
+
+#define DEFINE_PMU_REG(name, crm, op2, reg64)					\
+	static inline u32 Read##name (void)					\
+	{									\
+		u64 nValue;							\
+		asm volatile ("mrs %0, " #reg64 : "=r" (nValue));		\
+		return (u32) nValue;						\
+	}									\
+	static inline void Write##name (u32 nValue)				\
+	{									\
+		asm volatile ("msr " #reg64 ", %0" : : "r" ((u64) nValue));	\
+	}
+
+#endif
+
+DEFINE_PMU_REG (PMCR,       c12, 0, pmcr_el0)
+DEFINE_PMU_REG (PMCNTENSET, c12, 1, pmcntenset_el0)
+DEFINE_PMU_REG (PMCNTENCLR, c12, 2, pmcntenclr_el0)
+DEFINE_PMU_REG (PMOVSR,     c12, 3, pmovsclr_el0)
+DEFINE_PMU_REG (PMSELR,     c12, 5, pmselr_el0)
+DEFINE_PMU_REG (PMXEVTYPER, c13, 1, pmxevtyper_el0)
+DEFINE_PMU_REG (PMXEVCNTR,  c13, 2, pmxevcntr_el0)
+DEFINE_PMU_REG (PMINTENSET, c14, 1, pmintenset_el1)
+DEFINE_PMU_REG (PMINTENCLR, c14, 2, pmintenclr_el1)
+
+static inline unsigned ThisCore (void)
+{
+#ifdef ARM_ALLOW_MULTI_CORE
+	return CMultiCoreSupport::ThisCore ();
+#else
+	return 0;
+#endif
+}
+
+static const char From[] = "pmuprof";
+
+CPMUProfiler::CPMUProfiler (CInterruptSystem *pInterrupt, unsigned nMaxSamples)
+:	m_pInterrupt (pInterrupt),
+	m_nMaxSamples (nMaxSamples),
+	m_nEvents (0),
+	m_bIRQConnected (FALSE)
+{
+	for (unsigned nCore = 0; nCore < CORES; nCore++)
+	{
+		m_Core[nCore].pSample = 0;
+		m_Core[nCore].nSamples = 0;
+		m_Core[nCore].nLost = 0;
+	}
+}
+
+CPMUProfiler::~CPMUProfiler (void)
+{
+	Stop ();
+
+	if (m_bIRQConnected)
+	{
+		assert (m_pInterrupt != 0);
+#if RASPPI == 4
+		for (unsigned nCore = 0; nCore < CORES; nCore++)
+		{
+			m_pInterrupt->DisconnectIRQ (GetPMUIRQ (nCore));
+		}
+#else
+		m_pInterrupt->DisconnectIRQ (ARM_IRQLOCAL0_PMU);
+#endif
+
+		m_bIRQConnected = FALSE;
+	}
+
+	for (unsigned nCore = 0; nCore < CORES; nCore++)
+	{
+		delete [] m_Core[nCore].pSample;
+		m_Core[nCore].pSample = 0;
+	}
+
+	m_pInterrupt = 0;
+}
+
+boolean CPMUProfiler::AddEvent (TPMUEvent Event, unsigned nPeriod)
+{
+	assert (!m_bIRQConnected);
+
+	if (   m_nEvents >= PMU_PROFILER_MAX_EVENTS
+	    || nPeriod == 0)
+	{
+		return FALSE;
+	}
+
+	m_Event[m_nEvents].Event = Event;
+	m_Event[m_nEvents].nPeriod = nPeriod;
+	m_nEvents++;
+
+	return TRUE;
+}
+
+boolean CPMUProfiler::Initialize (void)
+{
+	assert (ThisCore () == 0);
+
+	if (m_nEvents == 0)
+	{
+		AddEvent (PMUEventCPUCycles, 1000000);
+	}
+
+	unsigned nCounters = (ReadPMCR () & PMCR_N__MASK) >> PMCR_N__SHIFT;
+	if (nCounters < m_nEvents)
+	{
+		CLogger::Get ()->Write (From, LogError, "%u event counters required (%u available)",
+					m_nEvents, nCounters);
+
+		return FALSE;
+	}
+
+#ifdef ARM_ALLOW_MULTI_CORE
+	for (unsigned nCore = 0; nCore < CORES; nCore++)
+#else
+	unsigned nCore = 0;
+#endif
+	{
+		assert (m_nMaxSamples > 0);
+		m_Core[nCore].pSample = new TSample[m_nMaxSamples];
+		if (m_Core[nCore].pSample == 0)
+		{
+			CLogger::Get ()->Write (From, LogError, "Cannot allocate sample buffer");
+
+			return FALSE;
+		}
+	}
+
+	assert (m_pInterrupt != 0);
+#if RASPPI == 4
+	// the PMU interrupts are shared peripheral interrupts on the BCM2711
+	for (unsigned nCore = 0; nCore < CORES; nCore++)
+	{
+		CInterruptSystem::RouteIRQ (GetPMUIRQ (nCore), nCore);
+		m_pInterrupt->ConnectIRQ (GetPMUIRQ (nCore), InterruptStub, this);
+	}
+#else
+	m_pInterrupt->ConnectIRQ (ARM_IRQLOCAL0_PMU, InterruptStub, this);
+#endif
+	m_bIRQConnected = TRUE;
+
+	return TRUE;
+}
+
+void CPMUProfiler::Start (void)
+{
+	assert (m_bIRQConnected);
+
+	unsigned nCore = ThisCore ();
+	if (m_Core[nCore].pSample == 0)
+	{
+		return;
+	}
+
+	u32 nMask = (1 << m_nEvents) - 1;
+
+	WritePMCNTENCLR (nMask);
+	WritePMINTENCLR (nMask);
+
+	for (unsigned i = 0; i < m_nEvents; i++)
+	{
+		WritePMSELR (i);
+		InstructionSyncBarrier ();
+
+		WritePMXEVTYPER (m_Event[i].Event);	// count at EL0 and EL1
+		WritePMXEVCNTR (-m_Event[i].nPeriod);
+	}
+
+	WritePMOVSR (nMask);
+
+	// the PMU interrupt is private per core on all models except the Raspberry Pi 4
+	CInterruptSystem::EnableIRQ (GetPMUIRQ (nCore));
+
+	WritePMINTENSET (nMask);
+	WritePMCR (ReadPMCR () | PMCR_E);
+	WritePMCNTENSET (nMask);
+
+	InstructionSyncBarrier ();
+}
+
+void CPMUProfiler::Stop (void)
+{
+	if (!m_bIRQConnected)
+	{
+		return;
+	}
+
+	u32 nMask = (1 << m_nEvents) - 1;
+
+	WritePMCNTENCLR (nMask);
+	WritePMINTENCLR (nMask);
+	WritePMOVSR (nMask);
+
+	InstructionSyncBarrier ();
+
+	CInterruptSystem::DisableIRQ (GetPMUIRQ (ThisCore ()));
+}
+
+unsigned CPMUProfiler::GetSampleCount (unsigned nCore) const
+{
+	assert (nCore < CORES);
+	return m_Core[nCore].nSamples;
+}
+
+unsigned CPMUProfiler::GetLostCount (unsigned nCore) const
+{
+	assert (nCore < CORES);
+	return m_Core[nCore].nLost;
+}
+
+boolean CPMUProfiler::WriteSamples (CDevice *pDevice)
+{
+	assert (pDevice != 0);
+
+	return Write (DeviceWrite, pDevice);
+}
+
+boolean CPMUProfiler::SaveSamples (const char *pFileName)
+{
+	assert (pFileName != 0);
+
+	FIL File;
+	if (f_open (&File, pFileName, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK)
+	{
+		CLogger::Get ()->Write (From, LogError, "Cannot create file: %s", pFileName);
+
+		return FALSE;
+	}
+
+	boolean bOK = Write (FileWrite, &File);
+
+	if (f_close (&File) != FR_OK)
+	{
+		bOK = FALSE;
+	}
+
+	return bOK;
+}
+
+// Output format (text, one record per line, all numbers in hex):
+//	# pmuprofile 1
+//	# event INDEX EVENTNUMBER PERIOD
+//	CORE EVENTINDEX PC RETURNADDRESS1 RETURNADDRESS2 ...
+boolean CPMUProfiler::Write (TWriteFunc *pWriteFunc, void *pParam)
+{
+	assert (pWriteFunc != 0);
+
+	char *pBuffer = new char[WRITE_BUFFER_SIZE];
+	if (pBuffer == 0)
+	{
+		return FALSE;
+	}
+
+	size_t nBuffered = 0;
+	boolean bOK = TRUE;
+
+	CString Line ("# pmuprofile 1\n");
+
+	unsigned nEvent = 0;
+	unsigned nCore = 0;
+	unsigned nSample = 0;
+	while (bOK)
+	{
+		if (nBuffered + Line.GetLength () > WRITE_BUFFER_SIZE)
+		{
+			bOK = (*pWriteFunc) (pBuffer, nBuffered, pParam) == (int) nBuffered;
+			nBuffered = 0;
+		}
+
+		assert (Line.GetLength () <= WRITE_BUFFER_SIZE);
+		memcpy (pBuffer + nBuffered, (const char *) Line, Line.GetLength ());
+		nBuffered += Line.GetLength ();
+
+		// next line
+		if (nEvent < m_nEvents)
+		{
+			Line.Format ("# event %X %X %X\n", nEvent, (unsigned) m_Event[nEvent].Event,
+				     m_Event[nEvent].nPeriod);
+			nEvent++;
+
+			continue;
+		}
+
+		while (   nCore < CORES
+		       && nSample >= m_Core[nCore].nSamples)
+		{
+			nCore++;
+			nSample = 0;
+		}
+
+		if (nCore >= CORES)
+		{
+			break;
+		}
+
+		assert (m_Core[nCore].pSample != 0);
+		const TSample *pSample = &m_Core[nCore].pSample[nSample++];
+
+		Line.Format ("%X %X", nCore, (unsigned) pSample->nEvent);
+		for (unsigned i = 0; i < pSample->nDepth; i++)
+		{
+			CString Address;
+			Address.Format (" %lX", (unsigned long) pSample->Address[i]);
+			Line.Append (Address);
+		}
+		Line.Append ("\n");
+	}
+
+	if (   bOK
+	    && nBuffered > 0)
+	{
+		bOK = (*pWriteFunc) (pBuffer, nBuffered, pParam) == (int) nBuffered;
+	}
+
+	delete [] pBuffer;
+
+	if (!bOK)
+	{
+		CLogger::Get ()->Write (From, LogError, "Write failed");
+	}
+
+	return bOK;
+}
+
+void CPMUProfiler::InterruptHandler (void)
+{
+	u32 nMask = (1 << m_nEvents) - 1;
+	u32 nOverflow = ReadPMOVSR () & nMask;
+	if (nOverflow == 0)
+	{
+		return;
+	}
+
+	WritePMOVSR (nOverflow);
+
+	unsigned nCore = ThisCore ();
+	TCoreData *pCore = &m_Core[nCore];
+
+	uintptr Address[PMU_PROFILER_MAX_DEPTH];
+	unsigned nDepth = CaptureStack (Address, PMU_PROFILER_MAX_DEPTH, nCore);
+
+	for (unsigned i = 0; i < m_nEvents; i++)
+	{
+		if (!(nOverflow & (1 << i)))
+		{
+			continue;
+		}
+
+		WritePMSELR (i);
+		InstructionSyncBarrier ();
+		WritePMXEVCNTR (-m_Event[i].nPeriod);
+
+		if (pCore->nSamples >= m_nMaxSamples)
+		{
+			pCore->nLost++;
+
+			continue;
+		}
+
+		TSample *pSample = &pCore->pSample[pCore->nSamples];
+		pSample->nEvent = (u8) i;
+		pSample->nDepth = (u8) nDepth;
+		memcpy (pSample->Address, Address, nDepth * sizeof (uintptr));
+
+		pCore->nSamples++;
+	}
+}
+
+void CPMUProfiler::InterruptStub (void *pParam)
+{
+	CPMUProfiler *pThis = (CPMUProfiler *) pParam;
+	assert (pThis != 0);
+
+	pThis->InterruptHandler ();
+}
+
+// The IRQ stub has saved the state of the interrupted code on top of the exception
+// stack of this core. The IRQ is not nested here, so the location is fixed.
+unsigned CPMUProfiler::CaptureStack (uintptr *pAddress, unsigned nMaxDepth, unsigned nCore)
+{
+	assert (pAddress != 0);
+	assert (nMaxDepth > 0);
+
+#if AARCH == 32
+	const u32 *pStackTop = (const u32 *) (uintptr) (MEM_IRQ_STACK + nCore * EXCEPTION_STACK_SIZE);
+
+	pAddress[0] = pStackTop[-1];		// return address, saved by IRQStub
+
+	// frame records are not standardized in AArch32 state, only the PC is recorded
+
+	return 1;
+#else
+	const u64 *pStackTop = (const u64 *) (uintptr) (MEM_EXCEPTION_STACK + nCore * EXCEPTION_STACK_SIZE);
+
+	u64 nFP   = pStackTop[-2];		// x29, saved by IRQStub
+	u64 nSPSR = pStackTop[-3];
+	pAddress[0] = pStackTop[-4];		// elr_el1
+
+	unsigned nDepth = 1;
+
+	// walk the frame records only, if the interrupted code used sp_el0 (EL1t),
+	// which limits the range, in which a valid frame record can be found
+	if ((nSPSR & 0xF) != 0x4)
+	{
+		return nDepth;
+	}
+
+	u64 nSP;
+	asm volatile ("mrs %0, sp_el0" : "=r" (nSP));
+	u64 nStackEnd = nSP + KERNEL_STACK_SIZE;
+
+	while (   nDepth < nMaxDepth
+	       && nFP >= nSP
+	       && nFP < nStackEnd - 16
+	       && !(nFP & 7))
+	{
+		const u64 *pFrameRecord = (const u64 *) nFP;
+
+		u64 nReturnAddress = pFrameRecord[1];
+		if (nReturnAddress == 0)
+		{
+			break;
+		}
+
+		pAddress[nDepth++] = nReturnAddress;
+
+		u64 nNextFP = pFrameRecord[0];
+		if (nNextFP <= nFP)		// stack grows down, records must go up
+		{
+			break;
+		}
+
+		nFP = nNextFP;
+	}
+
+	return nDepth;
+#endif
+}
+
+unsigned CPMUProfiler::GetPMUIRQ (unsigned nCore)
+{
+#if RASPPI == 4
+	assert (nCore < CORES);
+	return ARM_IRQ_PMU0 + nCore;
+#else
+	return ARM_IRQLOCAL0_PMU;
+#endif
+}
+
+int CPMUProfiler::DeviceWrite (const void *pBuffer, size_t nCount, void *pParam)
+{
+	CDevice *pDevice = (CDevice *) pParam;
+	assert (pDevice != 0);
+
+	return pDevice->Write (pBuffer, nCount);
+}
+
+int CPMUProfiler::FileWrite (const void *pBuffer, size_t nCount, void *pParam)
+{
+	FIL *pFile = (FIL *) pParam;
+	assert (pFile != 0);
+
+	unsigned nBytesWritten;
+	if (f_write (pFile, pBuffer, nCount, &nBytesWritten) != FR_OK)
+	{
+		return -1;
+	}
+
+	return (int) nBytesWritten;
+}
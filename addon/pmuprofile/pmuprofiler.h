@@ -0,0 +1,144 @@
+//
+// pmuprofiler.h
+//
+// Statistical profiler driven by the ARM Performance Monitors Unit (PMU)
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef _pmuprofile_pmuprofiler_h
+#define _pmuprofile_pmuprofiler_h
+
+#include <circle/interrupt.h>
+#include <circle/device.h>
+#include <circle/memorymap.h>
+#include <circle/types.h>
+#include <fatfs/ff.h>
+
+#if RASPPI == 1
+	#error The PMU profiler is not supported on the Raspberry Pi 1 and Zero!
+#endif
+
+#define PMU_PROFILER_MAX_EVENTS		2	// number of events sampled in parallel
+#define PMU_PROFILER_MAX_DEPTH		16	// max. number of addresses per sample
+
+enum TPMUEvent		/// architected common events (ARMv7 and ARMv8)
+{
+	PMUEventL1ICacheRefill		= 0x01,
+	PMUEventL1DCacheRefill		= 0x03,
+	PMUEventL1DCacheAccess		= 0x04,
+	PMUEventInstructionsRetired	= 0x08,
+	PMUEventBranchMispredicted	= 0x10,
+	PMUEventCPUCycles		= 0x11,
+	PMUEventMemoryAccess		= 0x13,
+	PMUEventL2DCacheRefill		= 0x17,
+	PMUEventBusAccess		= 0x19
+};
+
+class CPMUProfiler	/// Samples the PC and call stack on PMU counter overflow on all cores
+{
+public:
+	/// \param pInterrupt Pointer to the interrupt system object
+	/// \param nMaxSamples Maximum number of samples recorded per core
+	CPMUProfiler (CInterruptSystem *pInterrupt, unsigned nMaxSamples = 65536);
+
+	~CPMUProfiler (void);
+
+	/// \brief Add an event to be sampled (up to PMU_PROFILER_MAX_EVENTS)
+	/// \param Event Event to be counted
+	/// \param nPeriod A sample is taken each time this number of events occurred
+	/// \return Operation successful?
+	/// \note Must be called before Initialize(). Default is PMUEventCPUCycles/1000000.
+	boolean AddEvent (TPMUEvent Event, unsigned nPeriod);
+
+	/// \brief Allocate the sample buffers and connect the PMU interrupt(s)
+	/// \return Operation successful?
+	/// \note Must be called on core 0.
+	boolean Initialize (void);
+
+	/// \brief Start profiling on the calling core
+	/// \note Has to be called on each core, which should be profiled.
+	void Start (void);
+
+	/// \brief Stop profiling on the calling core
+	void Stop (void);
+
+	/// \return Number of samples recorded on the given core
+	unsigned GetSampleCount (unsigned nCore) const;
+	/// \return Number of samples, which have been dropped on the given core,
+	///	    because the sample buffer was full
+	unsigned GetLostCount (unsigned nCore) const;
+
+	/// \brief Write the collected samples as text to a device (e.g. CQEMUHostFile)
+	/// \param pDevice Device to be written
+	/// \return Operation successful?
+	/// \note Profiling must have been stopped on all cores before.\n
+	///	  Use the tool pmufold.py to convert the output to folded stacks.
+	boolean WriteSamples (CDevice *pDevice);
+
+	/// \brief Write the collected samples as text to a file using FatFs
+	/// \param pFileName Path of the file to be created (e.g. "SD:/pmuprof.txt")
+	/// \return Operation successful?
+	/// \note The file system must already be mounted before.
+	boolean SaveSamples (const char *pFileName);
+
+private:
+	struct TSample
+	{
+		u8	nEvent;				// index into m_Event[]
+		u8	nDepth;				// number of valid entries in Address[]
+		uintptr	Address[PMU_PROFILER_MAX_DEPTH];	// [0] is the interrupted PC
+	};
+
+	struct TCoreData
+	{
+		TSample		*pSample;
+		volatile unsigned nSamples;
+		volatile unsigned nLost;
+	};
+
+	typedef int TWriteFunc (const void *pBuffer, size_t nCount, void *pParam);
+
+	boolean Write (TWriteFunc *pWriteFunc, void *pParam);
+
+	void InterruptHandler (void);
+	static void InterruptStub (void *pParam);
+
+	static unsigned CaptureStack (uintptr *pAddress, unsigned nMaxDepth, unsigned nCore);
+
+	static unsigned GetPMUIRQ (unsigned nCore);
+
+	static int DeviceWrite (const void *pBuffer, size_t nCount, void *pParam);
+	static int FileWrite (const void *pBuffer, size_t nCount, void *pParam);
+
+private:
+	CInterruptSystem *m_pInterrupt;
+	unsigned m_nMaxSamples;
+
+	unsigned m_nEvents;
+	struct
+	{
+		TPMUEvent	Event;
+		unsigned	nPeriod;
+	}
+	m_Event[PMU_PROFILER_MAX_EVENTS];
+
+	boolean m_bIRQConnected;
+
+	TCoreData m_Core[CORES];
+};
+
+#endif
@@ -0,0 +1,178 @@
+//
+// kernel.cpp
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include "kernel.h"
+#include <circle/util.h>
+
+#define DRIVE		"SD:"
+#define FILENAME	"/pmuprof.txt"
+
+#define BUFFER_SIZE	(8 * MEGABYTE)
+
+static const char FromKernel[] = "kernel";
+
+CKernel::CKernel (void)
+:	m_Screen (m_Options.GetWidth (), m_Options.GetHeight ()),
+	m_Timer (&m_Interrupt),
+	m_Logger (m_Options.GetLogLevel (), &m_Timer),
+	m_EMMC (&m_Interrupt, &m_Timer, &m_ActLED),
+	m_Profiler (&m_Interrupt),
+	m_pBuffer (0)
+{
+	m_ActLED.Blink (5);	// show we are alive
+}
+
+CKernel::~CKernel (void)
+{
+	delete [] m_pBuffer;
+}
+
+boolean CKernel::Initialize (void)
+{
+	boolean bOK = TRUE;
+
+	if (bOK)
+	{
+		bOK = m_Screen.Initialize ();
+	}
+
+	if (bOK)
+	{
+		bOK = m_Serial.Initialize (115200);
+	}
+
+	if (bOK)
+	{
+		CDevice *pTarget = m_DeviceNameService.GetDevice (m_Options.GetLogDevice (), FALSE);
+		if (pTarget == 0)
+		{
+			pTarget = &m_Screen;
+		}
+
+		bOK = m_Logger.Initialize (pTarget);
+	}
+
+	if (bOK)
+	{
+		bOK = m_Interrupt.Initialize ();
+	}
+
+	if (bOK)
+	{
+		bOK = m_Timer.Initialize ();
+	}
+
+	if (bOK)
+	{
+		bOK = m_EMMC.Initialize ();
+	}
+
+	if (bOK)
+	{
+		// take a sample every 100000 CPU cycles and every 1000 L1 data cache misses
+		m_Profiler.AddEvent (PMUEventCPUCycles, 100000);
+		m_Profiler.AddEvent (PMUEventL1DCacheRefill, 1000);
+
+		bOK = m_Profiler.Initialize ();
+	}
+
+	return bOK;
+}
+
+TShutdownMode CKernel::Run (void)
+{
+	m_Logger.Write (FromKernel, LogNotice, "Compile time: " __DATE__ " " __TIME__);
+
+	if (f_mount (&m_FileSystem, DRIVE, 1) != FR_OK)
+	{
+		m_Logger.Write (FromKernel, LogPanic, "Cannot mount drive: %s", DRIVE);
+	}
+
+	m_pBuffer = new u8[BUFFER_SIZE];
+	if (m_pBuffer == 0)
+	{
+		m_Logger.Write (FromKernel, LogPanic, "Cannot allocate buffer");
+	}
+	memset (m_pBuffer, 1, BUFFER_SIZE);
+
+	m_Profiler.Start ();
+
+	for (unsigned nRun = 1; nRun <= 10; nRun++)
+	{
+		unsigned nPrimes = SievePrimes (BUFFER_SIZE);
+		unsigned nSum = SumColumns (4096);
+
+		m_Logger.Write (FromKernel, LogNotice, "Run %u: %u primes, sum %u", nRun, nPrimes, nSum);
+	}
+
+	m_Profiler.Stop ();
+
+	m_Logger.Write (FromKernel, LogNotice, "%u samples recorded (%u lost)",
+			m_Profiler.GetSampleCount (0), m_Profiler.GetLostCount (0));
+
+	if (m_Profiler.SaveSamples (DRIVE FILENAME))
+	{
+		m_Logger.Write (FromKernel, LogNotice, "Profiling results saved to %s", FILENAME);
+	}
+
+	f_mount (0, DRIVE, 0);
+
+	return ShutdownHalt;
+}
+
+// CPU bound
+unsigned CKernel::SievePrimes (unsigned nMax)
+{
+	memset (m_pBuffer, 1, nMax);
+
+	for (unsigned i = 2; i*i < nMax; i++)
+	{
+		if (m_pBuffer[i])
+		{
+			for (unsigned j = i*i; j < nMax; j += i)
+			{
+				m_pBuffer[j] = 0;
+			}
+		}
+	}
+
+	unsigned nCount = 0;
+	for (unsigned i = 2; i < nMax; i++)
+	{
+		nCount += m_pBuffer[i];
+	}
+
+	return nCount;
+}
+
+// cache miss bound
+unsigned CKernel::SumColumns (unsigned nStride)
+{
+	unsigned nSum = 0;
+
+	for (unsigned nColumn = 0; nColumn < nStride; nColumn++)
+	{
+		for (unsigned i = nColumn; i < BUFFER_SIZE; i += nStride)
+		{
+			nSum += m_pBuffer[i];
+		}
+	}
+
+	return nSum;
+}
@@ -26,10 +26,23 @@
 #include <circle/display.h>
 #include <circle/bcmframebuffer.h>
 #include <circle/chargenerator.h>
+#include <circle/glyphatlas.h>
 #include <circle/types.h>
 
 #define COLOR2D(red, green, blue)	DISPLAY_COLOR (red, green, blue)
 
+/// Color with alpha channel (ARGB8888, alpha 0 is transparent, 255 is opaque)
+#define COLOR2D_ALPHA(red, green, blue, alpha)	(  (u32) DISPLAY_COLOR (red, green, blue)	\
+						 | ((u32) (alpha) & 0xFF) << 24)
+
+#define C2DGRAPHICS_MAX_DIRTY_AREAS	8	// areas are merged, when more are modified
+#define C2DGRAPHICS_FULL_UPDATE_PERCENT	60	// update whole screen, if more is modified
+
+#define C2DGRAPHICS_MAX_POLYGON_POINTS	64
+
+#define C2DGRAPHICS_GLYPH_ATLASES	4	// cached fonts, the oldest is replaced
+#define C2DGRAPHICS_MAX_CHAR_WIDTH	64	// for anti-aliased text
+
 typedef CDisplay::TColor T2DColor;
 
 class C2DGraphics;
@@ -75,6 +88,11 @@ public:
 		AlignCenter
 	};
 
+	struct TPoint		/// Vertex of a polygon
+	{
+		unsigned x, y;
+	};
+
 public:
 	/// \param pDisplay Pointer to display driver
 	/// \note There is no VSync support with this constructor.
@@ -117,6 +135,18 @@ public:
 	/// \param nHeight Rectangle height
 	/// \param Color Rectangle color
 	void DrawRect (unsigned nX, unsigned nY, unsigned nWidth, unsigned nHeight, T2DColor Color);
+
+	/// \brief Draws a filled rectangle, which is blended with the background
+	/// \param nX Start X coordinate
+	/// \param nY Start Y coordinate
+	/// \param nWidth Rectangle width
+	/// \param nHeight Rectangle height
+	/// \param Color Rectangle color
+	/// \param uchAlpha Opacity of the rectangle (0 is transparent, 255 is opaque)
+	/// \note Blending is supported with the color models RGB565(_BE) and ARGB8888 only.\n
+	///	  With other color models a pixel is drawn, if uchAlpha is at least 128.
+	void DrawRectBlended (unsigned nX, unsigned nY, unsigned nWidth, unsigned nHeight,
+			      T2DColor Color, u8 uchAlpha);
 	
 	/// \brief Draws an unfilled rectangle (inner outline)
 	/// \param nX Start X coordinate
@@ -147,6 +177,19 @@ public:
 	/// \param nRadius Circle radius
 	/// \param Color Circle color
 	void DrawCircleOutline (unsigned nX, unsigned nY, unsigned nRadius, T2DColor Color);
+
+	/// \brief Draws a filled polygon (even-odd rule)
+	/// \param pPoints Pointer to the vertices (the polygon is closed automatically)
+	/// \param nPoints Number of vertices (max. C2DGRAPHICS_MAX_POLYGON_POINTS)
+	/// \param Color Polygon color
+	/// \note A pixel is drawn, if its center is inside the polygon.
+	void DrawPolygon (const TPoint *pPoints, unsigned nPoints, T2DColor Color);
+
+	/// \brief Draws an unfilled polygon
+	/// \param pPoints Pointer to the vertices (the polygon is closed automatically)
+	/// \param nPoints Number of vertices
+	/// \param Color Polygon color
+	void DrawPolygonOutline (const TPoint *pPoints, unsigned nPoints, T2DColor Color);
 	
 	/// \brief Draws an image from a pixel buffer
 	/// \param nX Image X coordinate
@@ -187,6 +230,16 @@ public:
 	/// \param PixelBuffer Pointer to the pixels
 	/// \param TransparentColor Color to use for transparency
 	void DrawImageRectTransparent (unsigned nX, unsigned nY, unsigned nWidth, unsigned nHeight, unsigned nSourceX, unsigned nSourceY, unsigned nSourceWidth, unsigned nSourceHeight, const void *PixelBuffer, T2DColor TransparentColor);
+
+	/// \brief Draws an image with alpha channel, which is blended with the background
+	/// \param nX Image X coordinate
+	/// \param nY Image Y coordinate
+	/// \param nWidth Image width
+	/// \param nHeight Image height
+	/// \param pPixels Pointer to the pixels in logical format with alpha (see COLOR2D_ALPHA())
+	/// \note Blending is supported with the color models RGB565(_BE) and ARGB8888 only.\n
+	///	  With other color models a pixel is drawn, if its alpha is at least 128.
+	void DrawImageBlended (unsigned nX, unsigned nY, unsigned nWidth, unsigned nHeight, const u32 *pPixels);
 	
 	/// \brief Draws a single pixel. If you need to draw a lot of pixels, consider using GetBuffer() for better speed
 	/// \param nX Pixel X coordinate
@@ -201,15 +254,29 @@ public:
 	/// \param pText 0-terminated C-string
 	/// \param Align Horizontal text alignment
 	/// \param rFont Font to be used
-	/// \param FontFlags Font flags
+	/// \param FontFlags Font flags (with FontFlagsAntiAlias the edges are smoothed)
 	/// \note Background is transparent
+	/// \note The glyphs are pre-rendered on the first use of a font with these flags.
 	void DrawText (unsigned nX, unsigned nY, T2DColor Color, const char *pText,
 		       TTextAlign Align = AlignLeft, const TFont &rFont = DEFAULT_FONT,
 		       CCharGenerator::TFontFlags FontFlags = CCharGenerator::FontFlagsNone);
 
 	/// \brief Gets raw access to the drawing buffer
+	/// \param bMarkDirty Mark the whole screen as modified (see MarkDirty())
 	/// \return Pointer to the buffer
-	void *GetBuffer (void);
+	/// \note The screen is marked as modified for the next UpdateDisplay() only. Direct\n
+	///	  writes after it are not sent to the display, unless GetBuffer() is called\n
+	///	  again or MarkDirty() is called for the written areas before each UpdateDisplay().
+	void *GetBuffer (boolean bMarkDirty = TRUE);
+
+	/// \brief Marks an area as modified, which has been written using GetBuffer()
+	/// \param nX Start X coordinate
+	/// \param nY Start Y coordinate
+	/// \param nWidth Area width
+	/// \param nHeight Area height
+	/// \note Only the areas modified since the last UpdateDisplay() are sent to the display.\n
+	///	  All Draw*() methods mark the area, they have drawn to, automatically.
+	void MarkDirty (unsigned nX, unsigned nY, unsigned nWidth, unsigned nHeight);
 
 	/// \return Pointer to display, we are working on
 	CDisplay *GetDisplay (void);
@@ -218,7 +285,27 @@ public:
 	/// \brief If VSync is enabled, this method is blocking until the screen refresh signal is received (every 16ms for 60FPS refresh rate)
 	void UpdateDisplay (void);
 
+	/// \return Number of bytes sent to the display by the last UpdateDisplay()
+	size_t GetUpdateSize (void) const;
+
 private:
+	// coordinates are inclusive and will be clipped to the screen
+	void AddDirtyArea (int nX1, int nY1, int nX2, int nY2);
+	void AddDirtyArea (const CDisplay::TArea &rArea);
+
+	// sends an area from m_pBuffer8 to the display at vertical offset nBaseY
+	void UpdateArea (CDisplay *pDisplay, const CDisplay::TArea &rArea, unsigned nBaseY);
+
+	// returns the cached atlas for this font or builds it
+	CGlyphAtlas *GetGlyphAtlas (const TFont &rFont, CCharGenerator::TFontFlags Flags);
+
+	// horizontal span operations on m_pBuffer8, coordinates must be valid
+	void FillSpan (unsigned nX, unsigned nY, unsigned nCount, CDisplay::TRawColor nColor);
+	void CopySpan (unsigned nX, unsigned nY, unsigned nCount, const void *pPixels);
+	void CopySpanTransparent (unsigned nX, unsigned nY, unsigned nCount, const void *pPixels,
+				  CDisplay::TRawColor nTransparentColor);
+	void BlendSpan (unsigned nX, unsigned nY, unsigned nCount, const u32 *pPixels);
+
 	void SetPixel (unsigned nX, unsigned nY, CDisplay::TRawColor nColor)
 	{
 		switch (m_nDepth)
@@ -294,6 +381,22 @@ private:
 
 	boolean m_bVSync;
 	boolean m_bBufferSwapped;
+
+	// modified areas since the last UpdateDisplay(), do not overlap
+	CDisplay::TArea m_DirtyArea[C2DGRAPHICS_MAX_DIRTY_AREAS];
+	unsigned m_nDirtyAreas;
+	boolean m_bDirtyAll;
+
+	// modified areas of the previous frame (for the hidden page with VSync)
+	CDisplay::TArea m_PrevDirtyArea[C2DGRAPHICS_MAX_DIRTY_AREAS];
+	unsigned m_nPrevDirtyAreas;
+	boolean m_bPrevDirtyAll;
+
+	u8 *m_pUpdateBuffer;		// pixels of a partial area in display format
+	size_t m_nUpdateSize;
+
+	CGlyphAtlas *m_pGlyphAtlas[C2DGRAPHICS_GLYPH_ATLASES];
+	unsigned m_nNextGlyphAtlas;	// to be replaced next
 };
 
 #endif
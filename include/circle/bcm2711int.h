@@ -31,6 +31,10 @@
 
 #if RASPPI == 4
 
+#define ARM_IRQ_PMU0		GIC_SPI (16)	// one per core
+#define ARM_IRQ_PMU1		GIC_SPI (17)
+#define ARM_IRQ_PMU2		GIC_SPI (18)
+#define ARM_IRQ_PMU3		GIC_SPI (19)
 #define ARM_IRQ_ARM_DOORBELL_0	GIC_SPI (34)
 #define ARM_IRQ_TIMER1		GIC_SPI (65)
 #define ARM_IRQ_USB		GIC_SPI (73)
@@ -51,6 +55,7 @@
 #define ARM_IRQ_DMA14		GIC_SPI (92)
 #define ARM_IRQ_CAM0		GIC_SPI (102)
 #define ARM_IRQ_CAM1		GIC_SPI (103)
+#define ARM_IRQ_I2CSPISLV	GIC_SPI (107)
 #define ARM_IRQ_GPIO0		GIC_SPI (113)
 #define ARM_IRQ_GPIO1		GIC_SPI (114)
 #define ARM_IRQ_GPIO2		GIC_SPI (115)
@@ -68,6 +73,8 @@
 
 #else
 
+#define ARM_IRQLOCAL0_PMU	GIC_PPI (7)
+
 #define ARM_IRQ_DMA0		GIC_SPI (80)
 #define ARM_IRQ_DMA1		GIC_SPI (81)
 #define ARM_IRQ_DMA2		GIC_SPI (82)
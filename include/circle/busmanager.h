@@ -0,0 +1,123 @@
+//
+// busmanager.h
+//
+// Queues transactions for a serial bus controller and executes them back to back
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef _circle_busmanager_h
+#define _circle_busmanager_h
+
+#include <circle/spinlock.h>
+#include <circle/types.h>
+
+#define BUS_STATUS_PENDING	1	///< Transaction is queued or running
+#define BUS_STATUS_SUCCESS	0	///< Transaction completed successfully
+					///< (error codes are < 0 and depend on the bus)
+
+struct TBusTransaction;
+
+/// \param pTransaction	The completed transaction (nStatus is valid)
+/// \param pParam	User parameter from the transaction
+/// \note Is called at IRQ_LEVEL and may submit further transactions.
+typedef void TBusCompletionRoutine (TBusTransaction *pTransaction, void *pParam);
+
+/// \brief Common header of the I2C and SPI transactions
+/// \note The transaction is owned by the caller and must not be modified or freed,\n
+///	  while nStatus is BUS_STATUS_PENDING.
+struct TBusTransaction
+{
+	TBusTransaction		*pNext;			///< Used by the bus manager
+	TBusCompletionRoutine	*pCompletionRoutine;	///< Called on completion (or 0 to poll nStatus)
+	void			*pParam;		///< User parameter
+	volatile int		 nStatus;		///< BUS_STATUS_*
+	int			 nResult;		///< Used by the bus manager
+};
+
+class CBusManager	/// Base class of the I2C and SPI bus managers
+{
+public:
+	struct TStatistics
+	{
+		unsigned Transactions;	///< Completed transactions (including failed ones)
+		unsigned Errors;	///< Failed transactions
+		unsigned MaxQueued;	///< Maximum number of waiting transactions
+		u64 BytesWritten;	///< Bytes sent by successful transactions
+		u64 BytesRead;		///< Bytes received by successful transactions
+		u64 BusyTime;		///< Time, while a transaction was running (in microseconds)
+		u64 TotalTime;		///< Time since the statistics have been reset (in microseconds)
+	};
+
+public:
+	CBusManager (void);
+	virtual ~CBusManager (void);
+
+	/// \return Are no transactions queued or running?
+	boolean IsIdle (void);
+
+	/// \param pStatistics Statistics are returned here
+	void GetStatistics (TStatistics *pStatistics);
+
+	/// \return Bus utilization since the statistics have been reset (in percent)
+	unsigned GetUtilization (void);
+
+	/// \brief Reset statistics and restart the time measurement
+	void ResetStatistics (void);
+
+protected:
+	/// \brief Queue a transaction and start it, if the bus is idle
+	/// \param pTransaction The transaction (nStatus is set to BUS_STATUS_PENDING)
+	/// \note Can be called from TASK_LEVEL and IRQ_LEVEL.
+	void SubmitTransaction (TBusTransaction *pTransaction);
+
+	/// \brief Start the transaction on the bus
+	/// \param pTransaction The transaction to be started
+	/// \param pBytesWritten Number of bytes, which will be sent, has to be returned here
+	/// \param pBytesRead Number of bytes, which will be received, has to be returned here
+	/// \return BUS_STATUS_SUCCESS if started, or error code < 0 (transaction is completed then)
+	/// \note Is called with a spin lock acquired and must not wait for the completion.
+	virtual int StartTransaction (TBusTransaction *pTransaction,
+				      unsigned *pBytesWritten, unsigned *pBytesRead) = 0;
+
+	/// \brief Has to be called by the derived class, when the running transaction completed
+	/// \param nStatus BUS_STATUS_SUCCESS or error code < 0
+	void TransactionCompleted (int nStatus);
+
+private:
+	// called with m_SpinLock acquired, returns the list of failed transactions
+	TBusTransaction *StartNext (void);
+
+	// called with m_SpinLock released
+	static void CallCompletionRoutines (TBusTransaction *pList);
+
+private:
+	TBusTransaction *m_pFirst;
+	TBusTransaction *m_pLast;
+	unsigned m_nQueued;
+
+	TBusTransaction *m_pCurrent;
+	unsigned m_nCurrentBytesWritten;
+	unsigned m_nCurrentBytesRead;
+	u64 m_nCurrentStartTicks;
+
+	TStatistics m_Statistics;
+	u64 m_nResetTicks;
+
+	CSpinLock m_SpinLock;
+};
+
+#endif
@@ -32,7 +32,8 @@ public:
 		FontFlagsNone		= 0,
 		FontFlagsDoubleWidth	= BIT (0),
 		FontFlagsDoubleHeight	= BIT (1),
-		FontFlagsDoubleBoth	= FontFlagsDoubleWidth | FontFlagsDoubleHeight
+		FontFlagsDoubleBoth	= FontFlagsDoubleWidth | FontFlagsDoubleHeight,
+		FontFlagsAntiAlias	= BIT (2)	///< Smoothed output (C2DGraphics only)
 	};
 
 	typedef u32 TPixelLine;
@@ -42,10 +43,12 @@ public:
 	/// \param Flags Font flags (can build with MakeFlags)
 	CCharGenerator (const TFont &rFont = DEFAULT_FONT, TFontFlags Flags = FontFlagsNone);
 
-	static TFontFlags MakeFlags (boolean bDoubleWidth, boolean bDoubleHeight)
+	static TFontFlags MakeFlags (boolean bDoubleWidth, boolean bDoubleHeight,
+				     boolean bAntiAlias = FALSE)
 	{
 		return (TFontFlags) (  (bDoubleWidth ? FontFlagsDoubleWidth : 0)
-				     | (bDoubleHeight ? FontFlagsDoubleHeight : 0));
+				     | (bDoubleHeight ? FontFlagsDoubleHeight : 0)
+				     | (bAntiAlias ? FontFlagsAntiAlias : 0));
 	}
 
 	/// \return Horizontal number of pixel per character
@@ -0,0 +1,111 @@
+//
+// checksum.h
+//
+// CRC-32, CRC-32C, Adler-32 and Fletcher-32 checksums
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef _circle_checksum_h
+#define _circle_checksum_h
+
+#include <circle/types.h>
+
+enum TCRC32Polynomial
+{
+	CRC32PolynomialIEEE8023,	///< Ethernet, zlib, PNG (0x04C11DB7)
+	CRC32PolynomialCastagnoli,	///< CRC-32C, iSCSI, SCTP, ext4 (0x1EDC6F41)
+	CRC32PolynomialUnknown
+};
+
+class CCRC32	/// Calculates a CRC-32 with the ARMv8 CRC instructions or table-driven
+{
+public:
+	CCRC32 (TCRC32Polynomial Polynomial = CRC32PolynomialIEEE8023);
+
+	/// \brief Start a new calculation
+	void Reset (void);
+
+	/// \brief Add a block of data to the calculation
+	/// \param pBuffer Pointer to the data (no alignment required)
+	/// \param nLength Length of the data in bytes
+	void Update (const void *pBuffer, size_t nLength);
+
+	/// \return CRC of the data given to Update() since the last Reset()
+	u32 GetResult (void) const		{ return ~m_nCRC; }
+
+	/// \brief Calculate the CRC of a single block of data
+	/// \param pBuffer Pointer to the data (no alignment required)
+	/// \param nLength Length of the data in bytes
+	/// \param Polynomial CRC polynomial to be used
+	/// \return CRC of the data (e.g. 0xCBF43926 for "123456789" with the IEEE polynomial)
+	static u32 Calculate (const void *pBuffer, size_t nLength,
+			      TCRC32Polynomial Polynomial = CRC32PolynomialIEEE8023);
+
+private:
+	// processes data on the raw (inverted) CRC register value
+	static u32 UpdateCRC (u32 nCRC, const u8 *pBuffer, size_t nLength,
+			      TCRC32Polynomial Polynomial);
+
+private:
+	TCRC32Polynomial m_Polynomial;
+	u32 m_nCRC;
+};
+
+class CAdler32	/// Calculates an Adler-32 checksum (RFC 1950)
+{
+public:
+	CAdler32 (void);
+
+	void Reset (void);
+
+	/// \param pBuffer Pointer to the data (no alignment required)
+	/// \param nLength Length of the data in bytes
+	void Update (const void *pBuffer, size_t nLength);
+
+	u32 GetResult (void) const		{ return m_nChecksum; }
+
+	/// \return Checksum of the data (e.g. 0x091E01DE for "123456789")
+	static u32 Calculate (const void *pBuffer, size_t nLength);
+
+private:
+	u32 m_nChecksum;
+};
+
+class CFletcher32	/// Calculates a Fletcher-32 checksum over little endian 16-bit words
+{
+public:
+	CFletcher32 (void);
+
+	void Reset (void);
+
+	/// \param pBuffer Pointer to the data (no alignment required)
+	/// \param nLength Length of the data in bytes
+	/// \note An odd length is only allowed for the last block of data,\n
+	///	  which is padded with a zero byte then.
+	void Update (const void *pBuffer, size_t nLength);
+
+	u32 GetResult (void) const		{ return m_nSum2 << 16 | m_nSum1; }
+
+	/// \return Checksum of the data (e.g. 0xF04FC729 for "abcde")
+	static u32 Calculate (const void *pBuffer, size_t nLength);
+
+private:
+	u32 m_nSum1;
+	u32 m_nSum2;
+};
+
+#endif
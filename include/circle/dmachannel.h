@@ -93,6 +93,26 @@ public:
 	void SetupCyclicIOWrite (uintptr ulIOAddress, const void *ppSources[], unsigned nBuffers,
 				 size_t ulLength, TDREQ DREQ);
 
+	/// \brief Prepare a cyclic I/O read transfer into a ring buffer
+	/// \param pDestination Pointer to the ring buffer
+	/// \param ulIOAddress	I/O address to be read from (ARM-side or bus address)
+	/// \param nLength	Size of the ring buffer in bytes (multiple of 4 * nBuffers)
+	/// \param DREQ		DREQ line for pacing the transfer (see dmacommon.h)
+	/// \param nBuffers	Number of equal parts of the ring buffer (1 to 4)
+	/// \note Transfer starts from the beginning of the buffer again, when its end has been\n
+	///	  reached. The completion routine is called each time, the end of a part is reached,\n
+	///	  with the number of this part in nBuffer.
+	/// \note The data cache is not maintained for the destination buffer, except for the\n
+	///	  part, which has been completed, before the completion routine is called. Otherwise\n
+	///	  the caller has to invalidate the range, which has been written, before reading it.
+	/// \note This method is not supported with DMA_CHANNEL_EXTENDED.
+	void SetupCyclicIORead (void *pDestination, uintptr ulIOAddress, size_t nLength,
+				TDREQ DREQ, unsigned nBuffers = 1);
+
+	/// \return Offset in the ring buffer, which will be written next by a cyclic I/O read
+	/// \note After Cancel() the offset, at which the transfer has been stopped, is returned.
+	size_t GetCyclicReadPosition (void) const;
+
 	/// \brief Prepare a 2D memory copy transfer (copy a number of blocks with optional stride)
 	/// \param pDestination Pointer to the destination buffer
 	/// \param pSource	Pointer to the (continuous) source buffer
@@ -116,6 +136,13 @@ public:
 	/// \brief Start the DMA transfer
 	void Start (void);
 
+	/// \brief Restart a cyclic I/O read with one part at an offset in the ring buffer
+	/// \param nOffset Offset in bytes (multiple of 4), where the next word will be written
+	/// \note Must be called after Cancel() and SetCompletionRoutine() (if required).\n
+	///	  The completion routine is called, when the end of the ring buffer is reached.
+	/// \note This method is not supported with DMA_CHANNEL_EXTENDED.
+	void StartCyclicRead (size_t nOffset);
+
 	/// \brief Wait for the completion of the DMA transfer
 	/// \return Has the transfer been successful?
 	/// \note This is for synchronous calls without completion routine (non-cyclic only).
@@ -126,6 +153,7 @@ public:
 	boolean GetStatus (void);
 
 	/// \brief Cancel running DMA transfer and wait for termination
+	/// \note The channel is reset, so that a following start never resumes the cancelled transfer.
 	void Cancel (void);
 
 private:
@@ -151,6 +179,9 @@ private:
 
 	boolean m_bStatus;
 
+	boolean m_bCyclicRead;
+	u32 m_nCancelAddress;		// destination address at Cancel(), 0 while running
+
 	uintptr m_nDestinationAddress;
 	size_t m_nBufferLength;
 
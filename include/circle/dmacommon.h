@@ -67,6 +67,7 @@ typedef void TDMACompletionRoutine (unsigned nChannel, unsigned nBuffer,
 	#define CS_PRIORITY_SHIFT		16
 		#define DEFAULT_PRIORITY		1
 	#define CS_ERROR			(1 << 8)
+	#define CS_WAITING_FOR_WRITES		(1 << 6)
 	#define CS_INT				(1 << 2)
 	#define CS_END				(1 << 1)
 	#define CS_ACTIVE			(1 << 0)
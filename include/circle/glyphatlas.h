@@ -0,0 +1,99 @@
+//
+// glyphatlas.h
+//
+// Pre-rendered glyphs of a font for fast text output
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef _circle_glyphatlas_h
+#define _circle_glyphatlas_h
+
+#include <circle/chargenerator.h>
+#include <circle/font.h>
+#include <circle/types.h>
+
+/// \note The atlas holds the set pixels of each glyph line as horizontal runs, so that\n
+///	  text can be drawn with one span fill per run, independent of the color.\n
+///	  With CCharGenerator::FontFlagsAntiAlias it holds an alpha mask per glyph too,\n
+///	  which is derived from the bitmap font by smoothing diagonal edges (EPX\n
+///	  upscaling to four times the size and box filtering down to the glyph size).
+
+class CGlyphAtlas	/// Pre-rendered glyphs of a font for fast text output
+{
+public:
+	struct TRun		/// Horizontal run of set pixels in a glyph line
+	{
+		u8 Start;	///< X-position inside the glyph (Left is 0)
+		u8 Length;	///< Number of pixels
+	};
+
+public:
+	/// \param rFont Font to be used
+	/// \param Flags Font flags (can build with CCharGenerator::MakeFlags)
+	CGlyphAtlas (const TFont &rFont,
+		     CCharGenerator::TFontFlags Flags = CCharGenerator::FontFlagsNone);
+
+	~CGlyphAtlas (void);
+
+	/// \return Operation successful?
+	boolean Initialize (void);
+
+	/// \return Has the atlas been built for this font and these flags?
+	boolean IsFor (const TFont &rFont, CCharGenerator::TFontFlags Flags) const;
+
+	/// \return Does the atlas contain alpha masks?
+	boolean IsAntiAliased (void) const;
+
+	/// \return Horizontal number of pixel per character
+	unsigned GetCharWidth (void) const;
+	/// \return Vertical number of pixel lines of a glyph (without underline space)
+	unsigned GetGlyphHeight (void) const;
+
+	/// \param chAscii Character code (normally Latin1)
+	/// \param nPosY Number of pixel line inside the glyph (0-based)
+	/// \param pnRuns Number of runs is returned here
+	/// \return Pointer to the runs of set pixels in this line (from left to right)
+	const TRun *GetRuns (char chAscii, unsigned nPosY, unsigned *pnRuns) const;
+
+	/// \param chAscii Character code (normally Latin1)
+	/// \param nPosY Number of pixel line inside the glyph (0-based)
+	/// \return Pointer to GetCharWidth() alpha values (0 .. 255) of this line
+	/// \note Can be used, if the atlas is anti-aliased only.
+	const u8 *GetAlphaLine (char chAscii, unsigned nPosY) const;
+
+private:
+	// returns index of the glyph line, or m_nGlyphs * m_nGlyphHeight if out of range
+	unsigned GetLineIndex (char chAscii, unsigned nPosY) const;
+
+	boolean BuildAlphaMasks (void);
+
+private:
+	const TFont &m_rFont;
+	CCharGenerator::TFontFlags m_Flags;
+
+	unsigned m_nCharWidth;
+	unsigned m_nGlyphHeight;
+	unsigned m_nGlyphs;
+
+	unsigned *m_pLineStart;		// index of first run per glyph line, one more entry at the end
+	TRun *m_pRuns;
+
+	u8 *m_pAlphaMask;		// m_nCharWidth * m_nGlyphHeight bytes per glyph
+	u8 *m_pEmptyLine;		// zeroed alpha line for characters out of range
+};
+
+#endif
@@ -0,0 +1,125 @@
+//
+// gpiowaveform.h
+//
+// DMA-driven GPIO waveform output and logic capture
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef _circle_gpiowaveform_h
+#define _circle_gpiowaveform_h
+
+#include <circle/dmachannel.h>
+#include <circle/gpioclock.h>
+#include <circle/interrupt.h>
+#include <circle/types.h>
+
+// start flags (can be combined)
+#define GPIO_WAVEFORM_OUTPUT	(1 << 0)	///< Write the pin states set with SetSample()
+#define GPIO_WAVEFORM_CAPTURE	(1 << 1)	///< Sample the levels of GPIO0-31
+#define GPIO_WAVEFORM_CYCLIC	(1 << 2)	///< Restart with sample 0 after the last sample
+
+/// \note The samples are paced by the FIFO of the PWM device, which cannot be used for\n
+///	  other purposes (e.g. PWM sound) at the same time. Each sample is processed by a\n
+///	  chain of DMA control blocks: wait for the PWM FIFO, write the GPSET0/GPCLR0\n
+///	  registers, read the GPLEV0 register into the capture buffer. Sample rates up to\n
+///	  about 1 MHz are possible, depending on the model and on the bus load.
+/// \note Only GPIO0-31 are supported. The pins have to be configured using CGPIOPin.
+/// \note Not available on the Raspberry Pi 5.
+
+class CGPIOWaveform	/// DMA-driven GPIO waveform output and logic capture
+{
+public:
+	/// \param bStatus	Has the transfer been successful?
+	/// \param pParam	User parameter
+	/// \note Is called at IRQ_LEVEL, for cyclic operation each time sample 0 is reached again.
+	typedef void TCompletionRoutine (boolean bStatus, void *pParam);
+
+public:
+	/// \param nSampleRate	Samples per second
+	/// \param nMaxSamples	Maximum number of samples (size of the waveform and capture buffers)
+	/// \param pInterruptSystem Pointer to the interrupt system object\n
+	///	   (or 0, if SetCompletionRoutine() is not used)
+	CGPIOWaveform (unsigned nSampleRate, unsigned nMaxSamples,
+		       CInterruptSystem *pInterruptSystem = 0);
+
+	~CGPIOWaveform (void);
+
+	/// \return Operation successful?
+	boolean Initialize (void);
+
+	/// \brief Define the pin states, which are written with a sample
+	/// \param nSample	Sample number (0-based)
+	/// \param nSetMask	Bit mask of the pins to be set to high level (bit 0 is GPIO0)
+	/// \param nClearMask	Bit mask of the pins to be set to low level
+	/// \note Pins, which are not in one of the masks, are not modified.
+	/// \note Can be called, while a cyclic waveform is running.
+	void SetSample (unsigned nSample, u32 nSetMask, u32 nClearMask);
+
+	/// \param pRoutine	Routine to be called on completion (or 0 to remove it)
+	/// \param pParam	User parameter
+	void SetCompletionRoutine (TCompletionRoutine *pRoutine, void *pParam = 0);
+
+	/// \brief Start waveform output and/or capture
+	/// \param nSamples	Number of samples to be processed (<= nMaxSamples)
+	/// \param nFlags	GPIO_WAVEFORM_* flags (output and/or capture must be set)
+	/// \return Operation successful?
+	boolean Start (unsigned nSamples, unsigned nFlags);
+
+	/// \brief Stop a running waveform output or capture immediately
+	void Stop (void);
+
+	/// \return Is the waveform output or capture running?
+	boolean IsActive (void) const;
+
+	/// \return Number of the sample, which is currently processed (nSamples, if finished)
+	unsigned GetPosition (void) const;
+
+	/// \brief Get levels from the capture buffer
+	/// \param nStart	Number of the first sample (wraps around at nSamples)
+	/// \param nCount	Number of samples to be read
+	/// \param pBuffer	Levels of GPIO0-31 are returned here (bit 0 is GPIO0)
+	void ReadCapture (unsigned nStart, unsigned nCount, u32 *pBuffer) const;
+
+private:
+	void RunPWM (void);
+	void StopPWM (void);
+
+	void InterruptHandler (void);
+	static void InterruptStub (void *pParam);
+
+private:
+	unsigned m_nMaxSamples;
+	CInterruptSystem *m_pInterruptSystem;
+
+	unsigned m_nRange;
+
+	CGPIOClock m_Clock;
+
+	unsigned m_nDMAChannel;
+	boolean m_bIRQConnected;
+
+	// three control blocks per sample: pacing, output, capture
+	TDMAControlBlock *m_pControlBlock;
+	u32 *m_pCaptureBuffer;
+
+	unsigned m_nSamples;
+
+	TCompletionRoutine *m_pCompletionRoutine;
+	void *m_pCompletionParam;
+};
+
+#endif
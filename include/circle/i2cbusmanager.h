@@ -0,0 +1,70 @@
+//
+// i2cbusmanager.h
+//
+// Queued asynchronous transactions for an I2C master
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef _circle_i2cbusmanager_h
+#define _circle_i2cbusmanager_h
+
+#include <circle/busmanager.h>
+#include <circle/i2cmasterirq.h>
+#include <circle/types.h>
+
+/// \brief I2C transaction (write, read or write followed by read with repeated start)
+/// \note nStatus is one of the CI2CMasterIRQ::TStatus codes < 0 on failure.
+struct TI2CTransaction : public TBusTransaction
+{
+	u8		 ucAddress;		///< I2C slave address
+	const void	*pWriteBuffer;		///< Data to be sent (or 0 for read only)
+	unsigned	 nWriteCount;		///< Number of bytes to be sent (max. 16)
+	void		*pReadBuffer;		///< Received data (or 0 for write only)
+	unsigned	 nReadCount;		///< Number of bytes to be received (max. 16)
+};
+
+/// \note Transactions submitted from multiple tasks or from completion routines are\n
+///	  executed back to back in the order of submission, interrupt-driven using\n
+///	  CI2CMasterIRQ. Not available on the Raspberry Pi 5.
+
+class CI2CBusManager : public CBusManager	/// Queued asynchronous transactions for an I2C master
+{
+public:
+	/// \param pI2CMaster Initialized I2C master, which is used by this bus manager only
+	/// \note The completion routine of the I2C master is set here.
+	CI2CBusManager (CI2CMasterIRQ *pI2CMaster);
+
+	~CI2CBusManager (void);
+
+	/// \brief Queue a transaction for execution
+	/// \param pTransaction The transaction (all fields except pNext, nStatus, nResult set)
+	void Submit (TI2CTransaction *pTransaction)
+	{
+		SubmitTransaction (pTransaction);
+	}
+
+private:
+	int StartTransaction (TBusTransaction *pTransaction,
+			      unsigned *pBytesWritten, unsigned *pBytesRead) override;
+
+	static void CompletionStub (int nStatus, void *pParam);
+
+private:
+	CI2CMasterIRQ *m_pI2CMaster;
+};
+
+#endif
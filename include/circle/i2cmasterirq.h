@@ -78,6 +78,7 @@ public:
 	void SetClock (unsigned nClockSpeed);
 
 	/// \brief Sets the completion routine called when the Read/Write/StartWriteRead functions complete
+	/// \note The completion routine is called at IRQ_LEVEL and may start the next transfer.
 	void SetCompletionRoutine (TI2CCompletionRoutine *pRoutine, void *pParam = 0);
 
 	/// \return one of the TStatus integer above
@@ -101,10 +102,13 @@ public:
 	/// \param nWriteCount  Number of bytes to be written (max. 16)
 	/// \param pReadBuffer  Read data will be stored here
 	/// \param nReadCount   Number of bytes to be read
+	/// \param bRepeatedStart Use a repeated start condition instead of a stop between
+	///			 write and read (required by many register-based devices)
 	/// \return 0 if success or < 0 on failure
 	int StartWriteRead (u8 ucAddress,
 			    const void *pWriteBuffer, unsigned nWriteCount,
-			    void *pReadBuffer, unsigned nReadCount);
+			    void *pReadBuffer, unsigned nReadCount,
+			    boolean bRepeatedStart = FALSE);
 
 private:
 	void InterruptHandler (void);
@@ -113,7 +117,8 @@ private:
 	int StartTransfer (u8 ucAddress,
 			   const void *pWriteBuffer, unsigned nWriteCount,
 			   void *pReadBuffer, unsigned nReadCount,
-			   bool bValidateReadBuffer, bool bValidateWriteBuffer);
+			   bool bValidateReadBuffer, bool bValidateWriteBuffer,
+			   boolean bRepeatedStart = FALSE);
 	void CallCompletionRoutine();
 
 private:
@@ -0,0 +1,168 @@
+//
+// i2cslaveirq.h
+//
+// Interrupt-driven I2C slave with register map and ring buffers
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef _circle_i2cslaveirq_h
+#define _circle_i2cslaveirq_h
+
+#include <circle/gpiopin.h>
+#include <circle/interrupt.h>
+#include <circle/timer.h>
+#include <circle/spinlock.h>
+#include <circle/types.h>
+
+#ifndef I2C_SLAVE_BUF_SIZE
+#define I2C_SLAVE_BUF_SIZE	256			// must be a power of 2
+#endif
+#define I2C_SLAVE_BUF_MASK	(I2C_SLAVE_BUF_SIZE-1)
+
+/// \note In register map mode the first byte of each write transfer from the master sets\n
+///	  the register pointer, following bytes are written to the registers. Read transfers\n
+///	  return the registers from the pointer on. The pointer is incremented with each byte\n
+///	  and wraps at the end of the map. Without register map, the received bytes are put\n
+///	  into a receive ring buffer and read transfers are served from a transmit ring buffer.
+/// \note The BSC slave does not stretch the clock. Read transfers are served from the\n
+///	  transmit FIFO, which is refilled from the interrupt handler. After the master has\n
+///	  set a new register pointer, the FIFO is reloaded from there. The receive interrupt\n
+///	  is raised by the hardware at a FIFO level of 2 bytes, a single byte write transfer\n
+///	  (register pointer only) is detected within one kernel timer tick or at the start\n
+///	  of the next read transfer, which raises the transmit interrupt with its first byte.\n
+///	  The master should wait one tick, before it reads from a register pointer set this\n
+///	  way. Otherwise the read returns data from the previous read position.\n
+///	  The handlers do not wait for the end of a write transfer for longer than two byte\n
+///	  times at the given bus clock, the end is detected with the next interrupt or poll.
+/// \note Not available on the Raspberry Pi 5.
+
+class CI2CSlaveIRQ	/// Interrupt-driven I2C slave with register map and ring buffers
+{
+public:
+	struct TStatistics
+	{
+		unsigned Interrupts;	///< Handled interrupts and polls with activity
+		unsigned BytesReceived;	///< Bytes written by the master
+		unsigned BytesSent;	///< Bytes read by the master
+		unsigned RxOverruns;	///< Bytes lost, because the FIFO or ring buffer was full
+		unsigned TxUnderruns;	///< Master read from the empty transmit FIFO
+	};
+
+	/// \param nRegister	First register, which has been written by the master
+	/// \param nCount	Number of written registers (may wrap at the end of the map)
+	/// \param pParam	User parameter
+	/// \note Is called at IRQ_LEVEL or from WriteRegisters().
+	typedef void TRegisterWriteHandler (unsigned nRegister, unsigned nCount, void *pParam);
+
+public:
+	/// \param pInterruptSystem Pointer to the interrupt system object
+	/// \param ucAddress 7-bit device address
+	/// \param nClockSpeed Bus clock of the master in Hz
+	CI2CSlaveIRQ (CInterruptSystem *pInterruptSystem, u8 ucAddress,
+		      unsigned nClockSpeed = 100000);
+
+	~CI2CSlaveIRQ (void);
+
+	/// \brief Enable register map mode (must be called before Initialize())
+	/// \param pRegisters	Memory window, which is accessed by the master
+	/// \param nSize	Size of the window in bytes (1-256)
+	/// \param pHandler	Called, when the master has written registers (or 0)
+	/// \param pParam	User parameter for the handler
+	void SetRegisterMap (void *pRegisters, unsigned nSize,
+			     TRegisterWriteHandler *pHandler = 0, void *pParam = 0);
+
+	/// \return Operation successful?
+	boolean Initialize (void);
+
+	/// \brief Update registers in the register map
+	/// \param nRegister	First register to be written
+	/// \param pData	Data to be written
+	/// \param nCount	Number of bytes to be written
+	/// \note Pending data from the master is processed first. Prefetched data in the\n
+	///	  transmit FIFO is reloaded then, if no transfer is active.
+	void WriteRegisters (unsigned nRegister, const void *pData, unsigned nCount);
+
+	/// \brief Get registers from the register map
+	/// \param nRegister	First register to be read
+	/// \param pBuffer	Data is returned here
+	/// \param nCount	Number of bytes to be read
+	void ReadRegisters (unsigned nRegister, void *pBuffer, unsigned nCount);
+
+	/// \brief Get received bytes from the receive ring buffer (without register map only)
+	/// \param pBuffer	Data is returned here
+	/// \param nCount	Maximum number of bytes to be returned
+	/// \return Number of returned bytes (does not block)
+	int Read (void *pBuffer, unsigned nCount);
+
+	/// \brief Put bytes into the transmit ring buffer (without register map only)
+	/// \param pBuffer	Data to be sent
+	/// \param nCount	Number of bytes to be sent
+	/// \return Number of bytes, which fitted into the ring buffer (does not block)
+	int Write (const void *pBuffer, unsigned nCount);
+
+	/// \param pStatistics Statistics are returned here
+	void GetStatistics (TStatistics *pStatistics);
+
+private:
+	// the following are called with m_SpinLock acquired
+	boolean Service (unsigned *pFirstRegister, unsigned *pRegisterCount);
+	boolean ReceiveData (unsigned *pFirstRegister, unsigned *pRegisterCount);
+	void ReloadTxFIFO (unsigned nRegister);
+	void FillTxFIFO (void);
+	unsigned GetReadPosition (void);
+
+	void InterruptHandler (void);
+	static void InterruptStub (void *pParam);
+
+	void PollHandler (TKernelTimerHandle hTimer);
+	static void PollStub (TKernelTimerHandle hTimer, void *pParam, void *pContext);
+
+private:
+	CInterruptSystem *m_pInterruptSystem;
+	u8 m_ucAddress;
+	unsigned m_nByteTicks;		// duration of one byte on the bus
+
+	CGPIOPin m_SDA;
+	CGPIOPin m_SCL;
+
+	boolean m_bIRQConnected;
+	TKernelTimerHandle m_hPollTimer;
+
+	u8 *m_pRegisters;
+	unsigned m_nRegisterCount;
+	TRegisterWriteHandler *m_pRegisterWriteHandler;
+	void *m_pRegisterWriteParam;
+
+	boolean m_bExpectAddress;	// next received byte sets the register pointer
+	unsigned m_nRegister;		// register pointer for writes
+	unsigned m_nTxRegister;		// next register to be put into the transmit FIFO
+	boolean m_bReloadPending;	// reload from m_nRegister, when the bus is idle
+
+	u8 m_RxBuffer[I2C_SLAVE_BUF_SIZE];
+	unsigned m_nRxInPtr;
+	unsigned m_nRxOutPtr;
+
+	u8 m_TxBuffer[I2C_SLAVE_BUF_SIZE];
+	unsigned m_nTxInPtr;
+	unsigned m_nTxOutPtr;
+
+	TStatistics m_Statistics;
+
+	CSpinLock m_SpinLock;
+};
+
+#endif
@@ -22,10 +22,43 @@
 
 #include <circle/bcm2835int.h>
 #include <circle/exceptionstub.h>
+#include <circle/sysconfig.h>
 #include <circle/types.h>
 
 typedef void TIRQHandler (void *pParam);
 
+#ifdef IRQ_STATISTICS
+
+#include <circle/device.h>
+
+// number of per-core histograms (CORES is not defined on the Raspberry Pi 1 and Zero)
+#if RASPPI == 1 || !defined (ARM_ALLOW_MULTI_CORE)
+	#define IRQ_STAT_CORES	1
+#else
+	#include <circle/memorymap.h>
+	#define IRQ_STAT_CORES	CORES
+#endif
+
+#define IRQ_STAT_BUCKETS	24	// bucket n counts values from 2^n to 2^(n+1)-1 ns
+
+enum TIRQStatType
+{
+	IRQStatEntryLatency,		// from IRQ entry (CNTPNS: timer expiry) to handler call
+	IRQStatExecutionTime,		// execution time of the handler
+	IRQStatUnknown
+};
+
+struct TIRQHistogram
+{
+	unsigned	nCount;
+	unsigned	nMin;		// ns
+	unsigned	nMax;		// ns
+	u64		nSum;		// ns
+	unsigned	nBucket[IRQ_STAT_BUCKETS];	// last bucket counts all greater values
+};
+
+#endif
+
 class CInterruptSystem
 {
 public:
@@ -55,19 +88,57 @@ public:
 #if RASPPI >= 4
 	static void InitializeSecondary (void);
 
+	// routes a shared peripheral interrupt (SPI) to another core (default: core 0)
+	static void RouteIRQ (unsigned nIRQ, unsigned nCore);
+
 	static void SendIPI (unsigned nCore, unsigned nIPI);
 
 	static void CallSecureMonitor (u32 nFunction, u32 nParam);
 	static void SecureMonitorHandler (u32 nFunction, u32 nParam);
 #endif
 
+#ifdef IRQ_STATISTICS
+	/// \brief Get the IRQ statistics of a connected IRQ line
+	/// \param nIRQ IRQ number
+	/// \param nCore Core, which handled the IRQ
+	/// \param Type Requested histogram
+	/// \param pResult Histogram will be copied here
+	/// \return FALSE, if the IRQ line has never been connected
+	boolean GetIRQStatistics (unsigned nIRQ, unsigned nCore, TIRQStatType Type,
+				  TIRQHistogram *pResult) const;
+
+	/// \brief Clear the statistics of all IRQ lines
+	void ResetIRQStatistics (void);
+
+	/// \brief Write the statistics of all IRQ lines, which occurred, as text
+	/// \param pTarget Device to be written to (e.g. CScreenDevice)
+	void DumpIRQStatistics (CDevice *pTarget) const;
+#endif
+
 private:
 	boolean CallIRQHandler (unsigned nIRQ);
 
+#ifdef IRQ_STATISTICS
+	void AllocateIRQStatistics (unsigned nIRQ);
+	void FreeIRQStatistics (void);
+	void RecordIRQStatistics (unsigned nIRQ, u64 nStart, u64 nEnd);
+
+	static void InitIRQTimestamp (void);
+	static u64 GetIRQTimestamp (void);
+	static void MarkIRQEntry (void);
+#endif
+
 private:
 	TIRQHandler	*m_apIRQHandler[IRQ_LINES];
 	void		*m_pParam[IRQ_LINES];
 
+#ifdef IRQ_STATISTICS
+	TIRQHistogram	*m_pIRQStatistics[IRQ_LINES];	// [IRQ_STAT_CORES][IRQStatUnknown] each
+
+	static u64 s_nIRQEntry[IRQ_STAT_CORES];
+	static u64 s_nNsPerTickQ16;
+#endif
+
 	static CInterruptSystem *s_pThis;
 };
 
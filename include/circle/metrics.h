@@ -0,0 +1,250 @@
+//
+// metrics.h
+//
+// Registry of system-wide performance counters, gauges and histograms
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef _circle_metrics_h
+#define _circle_metrics_h
+
+#include <circle/string.h>
+#include <circle/spinlock.h>
+#include <circle/synchronize.h>
+#include <circle/sysconfig.h>
+#include <circle/types.h>
+
+#ifdef ARM_ALLOW_MULTI_CORE
+	#include <circle/multicore.h>
+#endif
+
+// number of per-core slots (CORES is not defined on the Raspberry Pi 1 and Zero)
+#if RASPPI == 1 || !defined (ARM_ALLOW_MULTI_CORE)
+	#define METRICS_CORES	1
+#else
+	#include <circle/memorymap.h>
+	#define METRICS_CORES	CORES
+#endif
+
+#define METRIC_HISTOGRAM_MAX_BUCKETS	16	// without the implicit +Inf bucket
+
+enum TMetricType
+{
+	MetricTypeCounter,
+	MetricTypeGauge,
+	MetricTypeHistogram,
+	MetricTypeUnknown
+};
+
+class CMetric		/// Base class of all metrics, registers itself in CMetricsRegistry
+{
+public:
+	/// \param pName Metric name (e.g. "circle_net_rx_frames_total")
+	/// \param pHelp Short description of the metric
+	/// \param pLabels Labels without braces (e.g. "device=\"emmc\"", 0 for none)
+	/// \note The strings are not copied and must be persistent (e.g. string literals).\n
+	///	  Metrics with the same name must have different labels.
+	CMetric (const char *pName, const char *pHelp, const char *pLabels, TMetricType Type);
+
+	virtual ~CMetric (void);
+
+	const char *GetName (void) const	{ return m_pName; }
+	const char *GetHelp (void) const	{ return m_pHelp; }
+	const char *GetLabels (void) const	{ return m_pLabels; }
+	TMetricType GetType (void) const	{ return m_Type; }
+
+	/// \brief Append the sample line(s) of this metric in Prometheus text format
+	/// \param pResult Pointer to the string to be appended
+	virtual void Format (CString *pResult) const = 0;
+
+protected:
+	// appends "name[suffix]{labels[,extralabel]} value\n"
+	void FormatSample (CString *pResult, const char *pSuffix, const char *pExtraLabel,
+			   u64 nValue, boolean bNegative = FALSE) const;
+
+	static unsigned ThisCore (void)
+	{
+#ifdef ARM_ALLOW_MULTI_CORE
+		return CMultiCoreSupport::ThisCore ();
+#else
+		return 0;
+#endif
+	}
+
+	// relaxed atomic operations on 64-bit values
+	static void AtomicAdd (volatile u64 *pValue, u64 nValue)
+	{
+#if RASPPI == 1
+		// the ARM1176 has no 64-bit exclusive access, only IRQs can interfere here
+		EnterCritical (IRQ_LEVEL);
+		*pValue += nValue;
+		LeaveCritical ();
+#else
+		__atomic_fetch_add (pValue, nValue, __ATOMIC_RELAXED);
+#endif
+	}
+
+	static u64 AtomicLoad (const volatile u64 *pValue)
+	{
+#if RASPPI == 1
+		EnterCritical (IRQ_LEVEL);
+		u64 nValue = *pValue;
+		LeaveCritical ();
+
+		return nValue;
+#else
+		return __atomic_load_n (pValue, __ATOMIC_RELAXED);
+#endif
+	}
+
+	static void AtomicStore (volatile u64 *pValue, u64 nValue)
+	{
+#if RASPPI == 1
+		EnterCritical (IRQ_LEVEL);
+		*pValue = nValue;
+		LeaveCritical ();
+#else
+		__atomic_store_n (pValue, nValue, __ATOMIC_RELAXED);
+#endif
+	}
+
+private:
+	const char *m_pName;
+	const char *m_pHelp;
+	const char *m_pLabels;
+	TMetricType m_Type;
+
+	CMetric *m_pNext;
+
+	friend class CMetricsRegistry;
+};
+
+class CMetricCounter : public CMetric	/// Monotonic counter with one slot per core
+{
+public:
+	CMetricCounter (const char *pName, const char *pHelp, const char *pLabels = 0);
+
+	/// \brief Increment the counter of the calling core
+	/// \param nValue Value to be added
+	/// \note Can be called from any core and from IRQ_LEVEL.
+	void Add (u64 nValue = 1)
+	{
+		AtomicAdd (&m_Slot[ThisCore ()].nValue, nValue);
+	}
+
+	/// \return Sum of all per-core counters
+	u64 Get (void) const;
+
+	void Format (CString *pResult) const override;
+
+private:
+	struct TSlot
+	{
+		volatile u64 nValue;
+	}
+	CACHE_ALIGN;
+
+	TSlot m_Slot[METRICS_CORES];
+};
+
+typedef s64 TMetricGaugeCallback (void *pParam);
+
+class CMetricGauge : public CMetric	/// Value, which can go up and down
+{
+public:
+	CMetricGauge (const char *pName, const char *pHelp, const char *pLabels = 0);
+
+	/// \param pCallback The value is requested from this function, when it is scraped
+	/// \param pParam User parameter handed over to the callback
+	CMetricGauge (const char *pName, const char *pHelp, const char *pLabels,
+		      TMetricGaugeCallback *pCallback, void *pParam = 0);
+
+	void Set (s64 nValue)	{ AtomicStore (&m_nValue, (u64) nValue); }
+	void Add (s64 nValue)	{ AtomicAdd (&m_nValue, (u64) nValue); }
+	void Sub (s64 nValue)	{ AtomicAdd (&m_nValue, (u64) -nValue); }
+
+	s64 Get (void) const;
+
+	void Format (CString *pResult) const override;
+
+private:
+	volatile u64 m_nValue;
+
+	TMetricGaugeCallback *m_pCallback;
+	void *m_pParam;
+};
+
+class CMetricHistogram : public CMetric	/// Distribution of values over fixed buckets
+{
+public:
+	/// \param pBounds Ascending upper bounds of the buckets (inclusive, must be persistent)
+	/// \param nBuckets Number of entries in pBounds (max. METRIC_HISTOGRAM_MAX_BUCKETS)
+	CMetricHistogram (const char *pName, const char *pHelp, const char *pLabels,
+			  const u64 *pBounds, unsigned nBuckets);
+
+	/// \brief Account a value to its bucket (on the calling core)
+	/// \note Can be called from any core and from IRQ_LEVEL.
+	void Observe (u64 nValue)
+	{
+		unsigned nBucket = 0;
+		while (   nBucket < m_nBuckets
+		       && nValue > m_pBounds[nBucket])
+		{
+			nBucket++;
+		}
+
+		TCoreData *pCore = &m_Core[ThisCore ()];
+		AtomicAdd (&pCore->nCount[nBucket], 1);
+		AtomicAdd (&pCore->nSum, nValue);
+	}
+
+	void Format (CString *pResult) const override;
+
+private:
+	const u64 *m_pBounds;
+	unsigned m_nBuckets;
+
+	struct TCoreData
+	{
+		volatile u64 nCount[METRIC_HISTOGRAM_MAX_BUCKETS+1];	// last is +Inf
+		volatile u64 nSum;
+	}
+	CACHE_ALIGN;
+
+	TCoreData m_Core[METRICS_CORES];
+};
+
+class CMetricsRegistry	/// List of all metrics in the system
+{
+public:
+	/// \brief Append all registered metrics in Prometheus text exposition format
+	/// \param pResult Pointer to the string to be appended
+	static void Format (CString *pResult);
+
+private:
+	static void Register (CMetric *pMetric);
+	static void Unregister (CMetric *pMetric);
+
+private:
+	static CMetric *s_pFirst;
+
+	static CSpinLock s_SpinLock;
+
+	friend class CMetric;
+};
+
+#endif
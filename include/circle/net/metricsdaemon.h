@@ -0,0 +1,66 @@
+//
+// metricsdaemon.h
+//
+// Serves the metrics of CMetricsRegistry in Prometheus text format
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef _circle_net_metricsdaemon_h
+#define _circle_net_metricsdaemon_h
+
+#include <circle/net/httpdaemon.h>
+#include <circle/net/netsubsystem.h>
+#include <circle/net/socket.h>
+#include <circle/types.h>
+
+#define METRICS_PORT		9100
+#define METRICS_MAX_CONTENT	0x10000
+
+class CMetricsDaemon : public CHTTPDaemon	/// HTTP server for the path "/metrics"
+{
+public:
+	/// \param pNetSubSystem Pointer to the network subsystem
+	/// \param nPort TCP port to listen on
+	/// \param bAccessLog Write an access log entry for each scrape?
+	/// \param pSocket Is 0 for 1st created instance (listener)
+	CMetricsDaemon (CNetSubSystem *pNetSubSystem,
+			u16	       nPort	  = METRICS_PORT,
+			boolean	       bAccessLog = FALSE,
+			CSocket	      *pSocket	  = 0);
+	~CMetricsDaemon (void);
+
+	CHTTPDaemon *CreateWorker (CNetSubSystem *pNetSubSystem, CSocket *pSocket) override;
+
+	THTTPStatus GetContent (const char  *pPath,
+				const char  *pParams,
+				const char  *pFormData,
+				u8	    *pBuffer,
+				unsigned    *pLength,
+				const char **ppContentType) override;
+
+	void WriteAccessLog (const CIPAddress	&rRemoteIP,
+			     THTTPRequestMethod	 RequestMethod,
+			     const char		*pRequestURI,
+			     THTTPStatus	 Status,
+			     unsigned		 nContentLength) override;
+
+private:
+	u16 m_nPort;
+	boolean m_bAccessLog;
+};
+
+#endif
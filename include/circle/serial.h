@@ -23,6 +23,8 @@
 #include <circle/device.h>
 #include <circle/interrupt.h>
 #include <circle/gpiopin.h>
+#include <circle/dmachannel.h>
+#include <circle/timer.h>
 #include <circle/spinlock.h>
 #include <circle/sysconfig.h>
 #include <circle/types.h>
@@ -43,7 +45,8 @@
 /// 5       | GPIO12 | GPIO13 | Raspberry Pi 4 only
 /// GPIO32/33 and GPIO36/37 can be selected with system option SERIAL_GPIO_SELECT.\n
 /// GPIO0/1 are normally reserved for ID EEPROM.\n
-/// Handshake lines CTS and RTS are not supported.
+/// Handshake lines CTS and RTS are not supported.\n
+/// DMA mode (see EnableDMA()) is supported for device 0 on Raspberry Pi 1-4 only.
 ///
 /// nDevice | TXD    | RXD    | Support
 /// :-----: | :----: | :----: | :------
@@ -81,6 +84,10 @@
 #endif
 #define SERIAL_BUF_MASK		(SERIAL_BUF_SIZE-1)
 
+#ifndef SERIAL_DMA_BUF_SIZE
+#define SERIAL_DMA_BUF_SIZE	16384			// characters, must be a power of 2
+#endif
+
 // serial options
 #define SERIAL_OPTION_ONLCR	(1 << 0)	///< Translate NL to NL+CR on output (default)
 
@@ -168,6 +175,29 @@ public:
 	/// \note Does only work with interrupt driver.
 	void RegisterMagicReceivedHandler (const char *pMagic, TMagicReceivedHandler *pHandler);
 
+	/// \brief Transmit and receive using DMA, must be called before Initialize()
+	/// \param nRxBufferSize Size of the receive ring buffer in characters (power of 2)
+	/// \return Operation successful? (FALSE, if DMA is not supported for this device)
+	/// \note Does only work with interrupt driver.
+	/// \note The ring buffer is filled by a cyclic DMA transfer. Read() returns the data\n
+	///	  from there. Received characters are lost with SERIAL_ERROR_OVERRUN, if Read()\n
+	///	  is not called, before the ring buffer has been filled up.
+	boolean EnableDMA (unsigned nRxBufferSize = SERIAL_DMA_BUF_SIZE);
+
+	/// \param nBytesAvailable Number of bytes available for Read()
+	/// \param pParam User parameter
+	typedef void TIdleHandler (unsigned nBytesAvailable, void *pParam);
+	/// \param pHandler Handler which is called, when the receive line becomes idle,\n
+	///		    after characters have been received
+	/// \param pParam User parameter, which is handed over to the handler
+	/// \note Does only work in DMA mode, after the system timer has been initialized.
+	/// \note The handler is called at IRQ_LEVEL.
+	void RegisterIdleHandler (TIdleHandler *pHandler, void *pParam);
+
+	/// \brief Connect the transmitter to the receiver internally (for testing)
+	/// \param bEnable Enable the loopback?
+	void SetLoopback (boolean bEnable);
+
 protected:
 	/// \return Number of bytes buffer space available for Write()
 	/// \note Does only work with interrupt driver.
@@ -190,6 +220,24 @@ private:
 	void InterruptHandler (void);
 	static void InterruptStub (void *pParam);
 
+	// the following are called with m_SpinLock acquired
+	unsigned GetRxDMAAvailable (void);	// also detects overruns of the ring buffer
+	void InvalidateRxDMA (unsigned nCount);
+	void DrainRxFIFO (void);
+	void StartTxDMA (void);
+	boolean CheckRxIdle (boolean bTimeout, unsigned *pBytesAvailable);
+
+	void RxDMACompletionRoutine (boolean bStatus);
+	static void RxDMACompletionStub (unsigned nChannel, unsigned nBuffer,
+					 boolean bStatus, void *pParam);
+
+	void TxDMACompletionRoutine (boolean bStatus);
+	static void TxDMACompletionStub (unsigned nChannel, unsigned nBuffer,
+					 boolean bStatus, void *pParam);
+
+	void IdleTimerHandler (TKernelTimerHandle hTimer);
+	static void IdleTimerStub (TKernelTimerHandle hTimer, void *pParam, void *pContext);
+
 private:
 	CInterruptSystem *m_pInterruptSystem;
 	boolean m_bUseFIQ;
@@ -222,6 +270,25 @@ private:
 	const char *m_pMagicPtr;
 	TMagicReceivedHandler *m_pMagicReceivedHandler;
 
+	boolean m_bUseDMA;
+	CDMAChannel *m_pRxDMA;
+	CDMAChannel *m_pTxDMA;
+
+	u32 *m_pRxDMABuffer;			// one word (DR register value) per character
+	unsigned m_nRxDMASize;			// in characters
+	unsigned m_nRxDMAIn;			// counters of characters, not masked
+	unsigned m_nRxDMAOut;
+	unsigned m_nRxDMALapBase;		// counter value at start of the current lap
+
+	u32 *m_pTxDMABuffer;			// one word per character
+	unsigned m_nTxDMACount;			// characters in flight (0 if idle)
+
+	TIdleHandler *m_pIdleHandler;
+	void *m_pIdleParam;
+	TKernelTimerHandle m_hIdleTimer;
+	unsigned m_nRxIdleIn;			// m_nRxDMAIn at last idle check
+	boolean m_bRxActive;			// characters received since the line became idle
+
 	CSpinLock m_SpinLock;
 	CSpinLock m_LineSpinLock;
 
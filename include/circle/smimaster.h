@@ -25,6 +25,8 @@
 
 #include <circle/dmachannel.h>
 #include <circle/gpiopin.h>
+#include <circle/interrupt.h>
+#include <circle/types.h>
 
 #define SMI_NUM_ADDRESS_LINES		6
 #define SMI_NUM_DATA_LINES			18
@@ -49,20 +51,36 @@ enum TSMIDataWidth
 /// - May also drive SMI Address lines (GPIO0 to GPIO5)
 /// - Does not use SOE/SWE on GPIO6/GPIO7
 /// - Read/Write operation in Direct mode or Write in DMA mode
+/// - Continuous Read/Write streaming in DMA mode using 2 to 4 chained buffers
 ///
 /// \details Operations
 /// One must first call SetupTiming() with suitable timing information.
 /// The Device bank to use and the address to assert on the SAx lines may then optionally be set with SetDeviceAndAddress()
 /// Then Direct mode may then be used with Read() / Write().
 /// Or for DMA mode, one must first call SetupDMA() with a suitable internal buffer, then WriteDMA() to flush the buffer into SMI.
+/// Or for streaming, StartWriteStream() or StartReadStream() run until StopStream() is called. The buffers are used in turn
+/// without gaps, the stream handler is called, each time a buffer has been sent or received. The SMI transfer counter
+/// is re-armed at a buffer boundary after nearly 2^32 SMI cycles (about 170 seconds at 25 MHz), which causes a short gap.
+/// If this fails, the handler is called with bStatus FALSE and the stream has to be restarted.
 
 
 class CSMIMaster
 {
+public:
+	/// \param nBuffer		the number of the buffer, which has been sent (and can be refilled) or received
+	/// \param bStatus		FALSE on DMA error (the stream has been stopped then)
+	/// \param pParam		user parameter
+	/// \note Is called at IRQ_LEVEL. The buffer must be refilled or processed, before the stream reaches it again.
+	typedef void TStreamHandler (unsigned nBuffer, boolean bStatus, void *pParam);
+
+	static const unsigned MaxStreamBuffers = 4;
+
 public:
 	/// \param nSDLinesMask		mask determining which SDx lines should be driven. For example (1 << 0) | (1 << 5) for SD0 (GPIO8) and SD5 (GPIO13)
 	/// \param bUseAddressPins	enable use of address pins GPIO0 to GPIO5
-	CSMIMaster (unsigned nSDLinesMask = SMI_ALL_DATA_LINES_MASK, boolean bUseAddressPins = TRUE);
+	/// \param pInterruptSystem	the interrupt system object (required for streaming only)
+	CSMIMaster (unsigned nSDLinesMask = SMI_ALL_DATA_LINES_MASK, boolean bUseAddressPins = TRUE,
+		    CInterruptSystem *pInterruptSystem = 0);
 
 	~CSMIMaster (void);
 
@@ -100,14 +118,56 @@ public:
 	/// \param bWaitForCompletion	Whether to wait for DMA completion
 	void WriteDMA (boolean bWaitForCompletion);
 
+	/// \brief Waits for the completion of a DMA transfer, which has been triggered with WriteDMA(FALSE)
+	void WaitDMA (void);
+
+	/// \brief Starts continuous DMA output from a chain of buffers, which are sent in turn
+	/// \param ppBuffers		array of nBuffers pointers to the buffers (make sure they are DMA-aligned)
+	/// \param nBuffers		the number of buffers (2 to MaxStreamBuffers)
+	/// \param nBufferLength	the length of each buffer in bytes (multiple of 4, max. 65532)
+	/// \param pHandler		called each time a buffer has been sent
+	/// \param pParam		user parameter for the handler
+	/// \note The buffers must be filled before. SetupTiming() must have been called before.
+	void StartWriteStream (const void *ppBuffers[], unsigned nBuffers, unsigned nBufferLength,
+			       TStreamHandler *pHandler, void *pParam = 0);
+
+	/// \brief Starts continuous DMA input into a ring buffer, which is divided into nBuffers parts
+	/// \param pBuffer		the ring buffer (make sure it's DMA-aligned)
+	/// \param nBuffers		the number of parts of the ring buffer (2 to MaxStreamBuffers)
+	/// \param nBufferLength	the length of each part in bytes (multiple of 4, max. 65532)
+	/// \param pHandler		called each time a part has been received (data cache has been invalidated)
+	/// \param pParam		user parameter for the handler
+	/// \note SetupTiming() must have been called before.
+	void StartReadStream (void *pBuffer, unsigned nBuffers, unsigned nBufferLength,
+			      TStreamHandler *pHandler, void *pParam = 0);
+
+	/// \brief Stops a running stream
+	void StopStream (void);
+
+private:
+	void StartStream (boolean bWrite, unsigned nBufferLength,
+			  TStreamHandler *pHandler, void *pParam);
+	boolean RearmStream (void);
+
+	void DMACompletionRoutine (unsigned nBuffer, boolean bStatus);
+	static void DMACompletionStub (unsigned nChannel, unsigned nBuffer, boolean bStatus, void *pParam);
+
 protected:
 	unsigned m_nSDLinesMask;
 	boolean m_bUseAddressPins;
-	CDMAChannel m_txDMA;
+	CDMAChannel m_txDMA;		// also used for read streams
 	CGPIOPin m_dataGpios[SMI_NUM_DATA_LINES];
 	CGPIOPin m_addressGpios[SMI_NUM_ADDRESS_LINES];
 	void *m_pDMABuffer;
 	unsigned m_nLength;
+	TSMIDataWidth m_nWidth;
+
+	TStreamHandler *m_pStreamHandler;
+	void *m_pStreamParam;
+	volatile boolean m_bStreamActive;
+	unsigned m_nStreamTransfers;	// value of the SMI transfer counter
+	unsigned m_nStreamBuffers;	// number of buffers until the counter expires
+	unsigned m_nStreamBuffersLeft;
 };
 
 #endif
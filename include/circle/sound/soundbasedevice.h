@@ -52,9 +52,31 @@ enum TSoundFormat			/// All supported formats are interleaved little endian
 
 typedef void TSoundDataCallback (void *pParam);
 
-/// \note There are two methods to provide the sound samples:\n
+/// \param pBuffer Buffer, which has to be filled with nFrames frames in the hardware format
+/// \param nFrames Number of frames to be rendered (each with GetHWTXChannels() samples)
+/// \param pParam  User parameter given to RegisterRenderCallback()
+/// \note Samples have to be given as SoundFormatSigned24_32 for SoundFormatIEC958.
+typedef void TSoundRenderCallback (void *pBuffer, unsigned nFrames, void *pParam);
+
+struct TSoundStatistics		/// Output statistics, to be used for tuning chunk and queue sizes
+{
+	unsigned nChunks;		/// Number of chunks requested by the hardware
+	unsigned nChunkFrames;		/// Size of the last chunk in frames
+	unsigned nUnderruns;		/// Number of chunks, which could not be filled completely
+	unsigned nUnderrunFrames;	/// Number of frames, which have been filled with silence
+	unsigned nQueueFramesMin;	/// Lowest number of frames in the queue before a chunk
+	unsigned nChunkTimeLast;	/// Time spent for providing the last chunk in microseconds
+	unsigned nChunkTimeMax;		/// Longest time spent for providing a chunk in microseconds
+	unsigned nLatencyFrames;	/// Estimated latency of Write() (queue + 2 chunks) in frames
+};
+
+class CSoundMixer;
+
+/// \note There are four methods to provide the sound samples:\n
 ///	  1. By overloading GetChunk()\n
-///	  2. By using Write()
+///	  2. By registering a render callback (pull mode, lowest latency)\n
+///	  3. By using Write()\n
+///	  4. By attaching a CSoundMixer, which mixes multiple streams
 
 /// \note There are two methods to retrieve the sound samples:\n
 ///	  1. By overloading PutChunk()\n
@@ -91,6 +113,10 @@ public:
 		    unsigned nHWTXChannels, unsigned nHWRXChannels,
 		    boolean bSwapChannels);
 
+	/// \return Sound format used by the hardware
+	/// \note Can be called on any core.
+	TSoundFormat GetHWFormat (void) const;
+
 	/// \return Number of hardware output channels
 	/// \note Can be called on any core.
 	unsigned GetHWTXChannels (void) const;
@@ -142,7 +168,8 @@ public:
 	/// \param nCount  Size of the buffer in bytes (multiple of frame size)
 	/// \return Number of bytes consumed
 	/// \note Not used, if GetChunk() is overloaded.
-	/// \note Can be called on any core.
+	/// \note Can be called on any core, but only from one core or task at a time.\n
+	///	  The queue is a lock-free single producer / single consumer ring buffer.
 	int Write (const void *pBuffer, size_t nCount);
 
 	/// \return Queue size in number of frames
@@ -164,6 +191,19 @@ public:
 	/// \return TRUE: Have to write right channel first into buffer in GetChunk()
 	boolean AreChannelsSwapped (void) const;
 
+	/// \brief Select pull mode, the callback renders each chunk directly into the DMA buffer
+	/// \param pCallback Callback, which is called from the interrupt, which requests a chunk
+	/// \param pParam User parameter to be handed over to the callback
+	/// \note The queue (Write()) is not used in pull mode. The latency is two chunks.\n
+	///	  Channels are not swapped by the driver in pull mode (see AreChannelsSwapped()).
+	void RegisterRenderCallback (TSoundRenderCallback *pCallback, void *pParam);
+
+	/// \param pStatistics Receives the output statistics
+	/// \note Can be called on any core.
+	void GetStatistics (TSoundStatistics *pStatistics);
+	/// \brief Reset the output statistics
+	void ResetStatistics (void);
+
 	// Input //////////////////////////////////////////////////////////////
 
 	/// \brief Allocate the queue used for Read()
@@ -187,7 +227,7 @@ public:
 	/// \param nCount  Size of the buffer in bytes (multiple of frame size)
 	/// \return Number of bytes returned
 	/// \note Not used, if PutChunk() is overloaded.
-	/// \note Can be called on any core.
+	/// \note Can be called on any core, but only from one core or task at a time.
 	int Read (void *pBuffer, size_t nCount);
 
 	/// \return Read queue size in number of frames
@@ -274,14 +314,19 @@ private:
 	unsigned m_nWriteSampleSize;
 	unsigned m_nWriteFrameSize;
 
-	u8 *m_pQueue;			// Ring buffer
-	unsigned m_nInPtr;
-	unsigned m_nOutPtr;
+	u8 *m_pQueue;			// Ring buffer (single producer, single consumer)
+	volatile unsigned m_nInPtr;	// written by producer only
+	volatile unsigned m_nOutPtr;	// written by consumer only
 
 	TSoundDataCallback *m_pCallback;
 	void *m_pCallbackParam;
 
-	CSpinLock m_SpinLock;
+	TSoundRenderCallback *m_pRenderCallback;	// replaces the queue, if set
+	void *m_pRenderCallbackParam;
+
+	CSoundMixer *m_pMixer;		// replaces the queue, if set
+
+	TSoundStatistics m_Statistics;
 
 	u8 m_uchIEC958Status[IEC958_STATUS_BYTES];
 
@@ -296,14 +341,14 @@ private:
 	unsigned m_nReadSampleSize;
 	unsigned m_nReadFrameSize;
 
-	u8 *m_pReadQueue;		// Ring buffer
-	unsigned m_nReadInPtr;
-	unsigned m_nReadOutPtr;
+	u8 *m_pReadQueue;		// Ring buffer (single producer, single consumer)
+	volatile unsigned m_nReadInPtr;
+	volatile unsigned m_nReadOutPtr;
 
 	TSoundDataCallback *m_pReadCallback;
 	void *m_pReadCallbackParam;
 
-	CSpinLock m_ReadSpinLock;
+	friend class CSoundMixer;
 };
 
 #endif
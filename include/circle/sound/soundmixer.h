@@ -0,0 +1,183 @@
+//
+// soundmixer.h
+//
+// Mixes multiple logical output streams into one sound device
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef _circle_sound_soundmixer_h
+#define _circle_sound_soundmixer_h
+
+#include <circle/sound/soundbasedevice.h>
+#include <circle/sound/soundresampler.h>
+#include <circle/spinlock.h>
+#include <circle/macros.h>
+#include <circle/types.h>
+
+#define SOUND_MIXER_MAX_STREAMS		16
+#define SOUND_MIXER_BLOCK_FRAMES	256		// frames mixed at once (multiple of 4)
+#define SOUND_MIXER_VOLUME_MAX		100		// percent
+
+class CSoundMixer;
+
+class CSoundMixerStream		/// Logical output stream, which is mixed by CSoundMixer
+{
+public:
+	/// \param pMixer    The mixer, which plays this stream
+	/// \param Format    Format of sound data used for Write()\n
+	///		     (SoundFormatUnsigned8, SoundFormatSigned16, SoundFormatSigned24\n
+	///		     or SoundFormatSigned24_32)
+	/// \param nChannels 1 or 2 channels
+	/// \param nQueueSizeMsecs Size of the queue in milliseconds duration of the stream
+	/// \note The stream is created with full volume and centered.
+	CSoundMixerStream (CSoundMixer *pMixer, TSoundFormat Format, unsigned nChannels = 2,
+			   unsigned nQueueSizeMsecs = 100);
+
+	~CSoundMixerStream (void);
+
+	/// \param pBuffer Contains the samples
+	/// \param nCount  Size of the buffer in bytes (multiple of frame size)
+	/// \return Number of bytes consumed
+	/// \note Can be called on any core.
+	int Write (const void *pBuffer, size_t nCount);
+
+	/// \return Queue size in number of frames
+	/// \note Can be called on any core.
+	unsigned GetQueueSizeFrames (void) const;
+
+	/// \return Number of frames available in the queue waiting to be mixed
+	/// \note Can be called on any core.
+	unsigned GetQueueFramesAvail (void);
+
+	/// \param pCallback Callback which is called, when more sound data is needed
+	/// \param pParam User parameter to be handed over to the callback
+	/// \note Is called from the sound device interrupt, when at least half of the queue\n
+	///	  is empty
+	void RegisterNeedDataCallback (TSoundDataCallback *pCallback, void *pParam);
+
+	/// \brief Set the sample rate of this stream, if it differs from the sound device
+	/// \param nSampleRate Sample rate in Hz of the data given to Write()
+	/// \param Quality Quality of the sample rate conversion
+	/// \param bDriftCompensation Slave the stream to the clock of the sound device?
+	/// \return Operation successful?
+	/// \note Must be called before the first Write(). With drift compensation, the ratio\n
+	///	  is fine-tuned to keep the queue half full. This should be used, when the\n
+	///	  data comes from a source with an independent clock (e.g. network, USB).\n
+	///	  nSampleRate may equal the sample rate of the sound device then.
+	boolean SetSampleRate (unsigned nSampleRate,
+			       TSoundResamplerQuality Quality = SoundResamplerQualityMedium,
+			       boolean bDriftCompensation = FALSE);
+
+	/// \param nVolume Volume of this stream (0 .. SOUND_MIXER_VOLUME_MAX)
+	/// \note Can be called on any core.
+	void SetVolume (unsigned nVolume);
+
+	/// \param nPan Balance of this stream (-100 (left only) .. 0 (center) .. 100 (right only))
+	/// \note Can be called on any core.
+	void SetPan (int nPan);
+
+private:
+	// reads up to nFrames frames from the queue into pBuffer, returns number of frames,
+	// sets *pNeedData, if the need data callback has to be called
+	unsigned Dequeue (void *pBuffer, unsigned nFrames, boolean *pNeedData);
+
+	void UpdateGain (void);
+
+private:
+	CSoundMixer *m_pMixer;
+
+	TSoundFormat m_Format;
+	unsigned m_nChannels;
+	unsigned m_nFrameSize;
+
+	unsigned m_nVolume;
+	int m_nPan;
+	volatile s32 m_nGainLeft;	// Q15
+	volatile s32 m_nGainRight;
+
+	u8 *m_pQueue;			// Ring buffer
+	unsigned m_nQueueSize;
+	unsigned m_nInPtr;
+	unsigned m_nOutPtr;
+	unsigned m_nNeedDataThreshold;
+
+	TSoundDataCallback *m_pCallback;
+	void *m_pCallbackParam;
+
+	CSoundResampler *m_pResampler;		// nullptr, if not required
+	boolean m_bDriftCompensation;
+
+	CSpinLock m_SpinLock;
+
+	friend class CSoundMixer;
+};
+
+class CSoundMixer		/// Mixes multiple output streams into a sound device
+{
+public:
+	/// \param pDevice Sound device (PWM, I2S, HDMI or USB) to be used for output
+	/// \note Write() and GetChunk() of the sound device must not be used with the mixer.
+	CSoundMixer (CSoundBaseDevice *pDevice);
+
+	~CSoundMixer (void);
+
+	/// \return Operation successful?
+	/// \note Must be called before the sound device is started and streams are created.
+	boolean Initialize (void);
+
+	/// \return Sound device used for output
+	CSoundBaseDevice *GetDevice (void) const;
+
+	/// \param nVolume Master volume (0 .. SOUND_MIXER_VOLUME_MAX)
+	/// \note Can be called on any core.
+	void SetVolume (unsigned nVolume);
+
+private:
+	void AddStream (CSoundMixerStream *pStream);
+	void RemoveStream (CSoundMixerStream *pStream);
+
+	// called from CSoundBaseDevice::GetChunkInternal()
+	void Mix (void *pBuffer, unsigned nChunkSize);
+
+	// sets *pNeedData, if the stream needs more data
+	void MixStream (CSoundMixerStream *pStream, unsigned nFrames, boolean *pNeedData);
+
+	// adds nFrames frames in the given format to pTo (24-bit stereo)
+	static void Accumulate (const void *pBuffer, TSoundFormat Format, unsigned nChannels,
+				unsigned nFrames, s32 *pTo, s32 nGainLeft, s32 nGainRight);
+	void ConvertOutput (void *pBuffer, unsigned nFrames);
+
+private:
+	CSoundBaseDevice *m_pDevice;
+	unsigned m_nSampleRate;
+
+	volatile s32 m_nMasterGain;	// Q15
+
+	CSoundMixerStream *m_pStream[SOUND_MIXER_MAX_STREAMS];
+	unsigned m_nStreams;
+
+	s32 m_Accumulator[SOUND_MIXER_BLOCK_FRAMES * 2] ALIGN (16);	// 24-bit stereo
+	u8 m_StreamBuffer[SOUND_MIXER_BLOCK_FRAMES * 2 * sizeof (u32)] ALIGN (16);
+	s32 m_ResampleBuffer[SOUND_MIXER_BLOCK_FRAMES * 2 * 2] ALIGN (16);	// input, output
+
+	CSpinLock m_SpinLock;
+
+	friend class CSoundMixerStream;
+	friend class CSoundBaseDevice;
+};
+
+#endif
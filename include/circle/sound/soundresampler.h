@@ -0,0 +1,126 @@
+//
+// soundresampler.h
+//
+// Streaming polyphase sample rate converter with drift compensation
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef _circle_sound_soundresampler_h
+#define _circle_sound_soundresampler_h
+
+#include <circle/types.h>
+
+#define SOUND_RESAMPLER_MAX_CHANNELS	8
+#define SOUND_RESAMPLER_MAX_TAPS	128		// limits the filter on downsampling
+#define SOUND_RESAMPLER_MAX_DRIFT_PPM	2000
+
+enum TSoundResamplerQuality		/// Selects the filter length and the number of phases
+{
+	SoundResamplerQualityLow,	/// 8 taps, 64 phases
+	SoundResamplerQualityMedium,	/// 16 taps, 128 phases
+	SoundResamplerQualityHigh,	/// 32 taps, 256 phases
+	SoundResamplerQualityUnknown
+};
+
+/// \note Samples are interleaved. s32 samples are 24-bit signed values (-0x7FFFFF..0x7FFFFF).
+/// \note The filter coefficients are interpolated between adjacent phases, so that any\n
+///	  (even a non-rational or slowly changing) ratio can be converted.
+
+class CSoundResampler		/// Streaming polyphase sample rate converter
+{
+public:
+	/// \param nInputRate  Sample rate of the input stream in Hz
+	/// \param nOutputRate Sample rate of the output stream in Hz
+	/// \param nChannels   Number of interleaved channels (1 .. SOUND_RESAMPLER_MAX_CHANNELS)
+	/// \param Quality     Selects the quality / CPU load trade-off
+	CSoundResampler (unsigned nInputRate, unsigned nOutputRate, unsigned nChannels = 2,
+			 TSoundResamplerQuality Quality = SoundResamplerQualityMedium);
+
+	~CSoundResampler (void);
+
+	/// \return Operation successful?
+	boolean Initialize (void);
+
+	/// \param nOutputFrames Number of frames to be produced by the next call to Process()
+	/// \return Number of input frames required to produce nOutputFrames frames
+	unsigned GetInputFramesNeeded (unsigned nOutputFrames) const;
+
+	/// \param pInput  Input samples
+	/// \param nInputFrames Number of input frames (must not exceed GetInputFramesNeeded())
+	/// \param pOutput Buffer for output samples
+	/// \param nOutputFrames Size of the output buffer in frames
+	/// \return Number of frames written to pOutput (less than nOutputFrames,\n
+	///	    if there was not enough input)
+	/// \note All input frames are consumed.
+	unsigned Process (const s16 *pInput, unsigned nInputFrames,
+			  s16 *pOutput, unsigned nOutputFrames);
+	unsigned Process (const s32 *pInput, unsigned nInputFrames,
+			  s32 *pOutput, unsigned nOutputFrames);
+
+	/// \brief Discard the filter history and reset the phase
+	void Reset (void);
+
+	/// \brief Fine-tune the conversion ratio
+	/// \param nPPM Deviation of the input clock in ppm (positive: input is too fast)
+	void SetDrift (int nPPM);
+	/// \return Current deviation of the input clock in ppm
+	int GetDrift (void) const;
+
+	/// \brief Slave the input to the output clock by keeping a queue at a target fill level
+	/// \param nFramesQueued Number of frames currently in the input queue of the resampler\n
+	///	   (or the output queue, with nTargetFrames and nFramesQueued swapped)
+	/// \param nTargetFrames Fill level to be maintained
+	/// \note Should be called once per Process(). Controls the drift with a PI regulator.
+	void TrackFillLevel (unsigned nFramesQueued, unsigned nTargetFrames);
+
+private:
+	// pushes one interleaved input frame into the filter history
+	void PushFrame (const s32 *pFrame);
+
+	// calculates one output sample of nChannel at the current phase
+	s32 Filter (unsigned nChannel);
+
+	template <typename TSample>
+	unsigned ProcessInternal (const TSample *pInput, unsigned nInputFrames,
+				  TSample *pOutput, unsigned nOutputFrames);
+
+	void UpdateStep (void);
+
+private:
+	unsigned m_nInputRate;
+	unsigned m_nOutputRate;
+	unsigned m_nChannels;
+	TSoundResamplerQuality m_Quality;
+
+	unsigned m_nTaps;			// multiple of 8
+	unsigned m_nPhaseShift;			// log2 (number of phases)
+	s16 *m_pCoeffs;				// [phase][tap], phases + 1 rows, Q15
+
+	s32 *m_pHistory[SOUND_RESAMPLER_MAX_CHANNELS];	// 2 * m_nTaps each
+	unsigned m_nHistoryPtr;
+	s32 *m_pPhaseCoeffs;			// interpolated coefficients of the current phase
+
+	u64 m_ullPhase;				// 32.32 position between input frames
+	u64 m_ullNominalStep;			// 32.32 input frames per output frame
+	u64 m_ullStep;				// with drift applied
+
+	int m_nDriftPPM;
+	int m_nFilteredError;			// Q8 frames
+	int m_nIntegral;
+};
+
+#endif
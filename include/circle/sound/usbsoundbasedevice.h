@@ -25,6 +25,7 @@
 #include <circle/usb/usbaudiostreaming.h>
 #include <circle/device.h>
 #include <circle/spinlock.h>
+#include <circle/sysconfig.h>
 #include <circle/types.h>
 
 class CUSBSoundBaseDevice : public CSoundBaseDevice	/// High-level driver for USB audio streaming devices
@@ -61,6 +62,13 @@ public:
 	/// \return Pointer to sound controller object
 	CSoundController *GetController (void) override;
 
+	/// \param bTX Get counters of the output (TRUE) or input (FALSE) stream
+	/// \param pStatistics Counters of the USB audio stream are returned here
+	/// \return Is the stream available?
+	/// \note USB_AUDIO_URBS_IN_FLIGHT in sysconfig.h sets the depth of the pipeline.
+	boolean GetStreamStatistics (boolean bTX,
+				     CUSBAudioStreamingDevice::TStatistics *pStatistics) const;
+
 protected:
 	/// \brief May override this to provide the sound samples
 	/// \param pBuffer    Buffer where the samples have to be placed
@@ -84,6 +92,8 @@ private:
 	boolean SendChunk (void);
 	boolean ReceiveChunk (void);
 
+	void FreeBuffers (void);
+
 	void TXCompletionRoutine (unsigned nBytesTransferred);
 	static void TXCompletionStub (unsigned nBytesTransferred, void *pParam);
 
@@ -119,13 +129,15 @@ private:
 	CUSBAudioStreamingDevice *m_pTXUSBDevice;
 	CUSBAudioStreamingDevice *m_pRXUSBDevice;
 
+	// one buffer per transfer in flight, used in a round-robin manner
 	unsigned m_nTXChunkSizeBytes;
-	u8 *m_pTXBuffer[2];
+	u8 *m_pTXBuffer[USB_AUDIO_URBS_IN_FLIGHT];
 	unsigned m_nTXCurrentBuffer;
 
 	unsigned m_nRXChunkSizeBytes;
-	u8 *m_pRXBuffer[2];
-	unsigned m_nRXCurrentBuffer;
+	u8 *m_pRXBuffer[USB_AUDIO_URBS_IN_FLIGHT];
+	unsigned m_nRXCurrentBuffer;		// next to be submitted
+	unsigned m_nRXCompletedBuffer;		// next to be completed
 
 	int m_nOutstanding;
 
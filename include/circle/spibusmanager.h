@@ -0,0 +1,78 @@
+//
+// spibusmanager.h
+//
+// Queued asynchronous DMA transactions for an SPI master
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef _circle_spibusmanager_h
+#define _circle_spibusmanager_h
+
+#include <circle/busmanager.h>
+#include <circle/spimasterdma.h>
+#include <circle/types.h>
+
+#define SPI_BUS_ERROR		-1	///< Transfer failed
+
+/// \brief SPI transaction (full-duplex transfer)
+/// \note nStatus is SPI_BUS_ERROR on failure.
+struct TSPITransaction : public TBusTransaction
+{
+	unsigned	 nChipSelect;		///< Chip select (or CSPIMasterDMA::ChipSelectNone)
+	const void	*pWriteBuffer;		///< Data to be sent (4-byte aligned)
+	void		*pReadBuffer;		///< Received data (4-byte aligned)
+	unsigned	 nCount;		///< Number of bytes to be transferred
+	unsigned	 nClockSpeed;		///< SPI clock in Hz (or 0 to keep the clock and mode)
+	unsigned	 CPOL;			///< Clock polarity (if nClockSpeed != 0)
+	unsigned	 CPHA;			///< Clock phase (if nClockSpeed != 0)
+};
+
+/// \note Transactions submitted from multiple tasks or from completion routines are\n
+///	  executed back to back in the order of submission, using CSPIMasterDMA. Devices\n
+///	  with different clock or mode requirements can share the bus, the settings are\n
+///	  only re-programmed, when they change.
+
+class CSPIBusManager : public CBusManager	/// Queued asynchronous DMA transactions for an SPI master
+{
+public:
+	/// \param pSPIMaster Initialized SPI master, which is used by this bus manager only
+	CSPIBusManager (CSPIMasterDMA *pSPIMaster);
+
+	~CSPIBusManager (void);
+
+	/// \brief Queue a transaction for execution
+	/// \param pTransaction The transaction (all fields except pNext, nStatus, nResult set)
+	void Submit (TSPITransaction *pTransaction)
+	{
+		SubmitTransaction (pTransaction);
+	}
+
+private:
+	int StartTransaction (TBusTransaction *pTransaction,
+			      unsigned *pBytesWritten, unsigned *pBytesRead) override;
+
+	static void CompletionStub (boolean bStatus, void *pParam);
+
+private:
+	CSPIMasterDMA *m_pSPIMaster;
+
+	unsigned m_nClockSpeed;
+	unsigned m_CPOL;
+	unsigned m_CPHA;
+};
+
+#endif
@@ -215,11 +215,22 @@
 
 //#define REALTIME
 
+// IRQ_STATISTICS enables recording the execution time and the entry
+// latency of each connected IRQ handler per core into log-scale
+// histograms, which can be queried from CInterruptSystem. This costs
+// two counter reads and a histogram update per handled IRQ and about
+// 1 KByte heap per connected IRQ line.
+
+//#define IRQ_STATISTICS
+
 // USE_USB_SOF_INTR improves the compatibility with low-/full-speed
 // USB devices. If your application uses such devices, this option
 // should normally be set. Unfortunately this causes a heavily changed
-// system timing, because it triggers up to 8000 IRQs per second. For
-// USB plug-and-play operation this option must be set in any case.
+// system timing, because it triggers up to 8000 IRQs per second, while
+// USB transactions are waiting to be started (e.g. periodic polling of
+// low-/full-speed devices). The SOF interrupt is disabled, while no
+// transaction is waiting. For USB plug-and-play operation this option
+// must be set in any case.
 // This option has no influence on the Raspberry Pi 4 and 5.
 
 #ifndef NO_USB_SOF_INTR
@@ -242,6 +253,48 @@
 #define USE_USB_SOF_INTR
 #endif
 
+// USB_AUDIO_URBS_IN_FLIGHT is the number of isochronous transfers
+// (each covering about one millisecond), which are queued ahead per
+// USB audio stream. A deeper pipeline increases the latency, but
+// prevents clicks, when the completion interrupts are delayed by
+// other CPU or USB load. Allowed values are 1 to 6. The Raspberry
+// Pi 1-3 and Zero support only one queued transfer.
+
+#ifndef USB_AUDIO_URBS_IN_FLIGHT
+#if RASPPI >= 4
+#define USB_AUDIO_URBS_IN_FLIGHT	4
+#else
+#define USB_AUDIO_URBS_IN_FLIGHT	1
+#endif
+#endif
+
+// USB_NET_URBS_IN_FLIGHT is the number of bulk transfers, which are
+// queued per direction by the drivers for USB Ethernet adapters
+// (SMSC951x, LAN7800 and CDC Ethernet). The receive endpoint is
+// re-armed from the completion interrupt, so that the adapter can
+// deliver further frames, while the net task is processing the
+// previous ones (from the net task only for CDC Ethernet on the
+// Raspberry Pi 1-3 and Zero, where its transfers complete on NAK).
+// Allowed values are 1 to 8. The Raspberry Pi 1-3 and Zero support
+// only one queued transfer per endpoint.
+
+#ifndef USB_NET_URBS_IN_FLIGHT
+#if RASPPI >= 4
+#define USB_NET_URBS_IN_FLIGHT	4
+#else
+#define USB_NET_URBS_IN_FLIGHT	1
+#endif
+#endif
+
+// USB_NET_BUFFERS is the number of receive and transmit buffers per
+// direction of an USB Ethernet adapter. Received data waits in these
+// buffers, until it is processed by the net task. Must not be smaller
+// than USB_NET_URBS_IN_FLIGHT.
+
+#ifndef USB_NET_BUFFERS
+#define USB_NET_BUFFERS		8
+#endif
+
 // SCREEN_DMA_BURST_LENGTH enables using DMA for scrolling the screen
 // contents and set the burst length parameter for the DMA controller.
 // Using DMA speeds up the scrolling, especially with a burst length
@@ -255,6 +308,14 @@
 #endif
 #endif
 
+// SCREEN_HW_SCROLL enables scrolling of the screen by moving the virtual
+// offset of a frame buffer with twice the screen height. The time needed
+// for scrolling does not depend on the screen resolution then. The frame
+// buffer of CScreenDevice must not be used for other purposes (e.g. LVGL)
+// with this option. This is not supported on the Raspberry Pi 5.
+
+//#define SCREEN_HW_SCROLL
+
 // CALIBRATE_DELAY activates the calibration of the delay loop. Because
 // this loop is normally not used any more in Circle, the only use of
 // this option is that the "SpeedFactor" of your system is displayed.
@@ -484,6 +545,19 @@
 
 #endif
 
+// USE_NEON_UTIL selects the NEON implementations of memcpy(), memset(),
+// memcmp() and strlen() in util_fast.S. NEON registers may only be used
+// in IRQ and FIQ handlers, if they are saved there. Define NO_NEON_UTIL
+// to use the non-NEON implementations instead.
+
+#if RASPPI >= 2 && defined (SAVE_VFP_REGS_ON_IRQ) && defined (SAVE_VFP_REGS_ON_FIQ)
+
+#ifndef NO_NEON_UTIL
+#define USE_NEON_UTIL
+#endif
+
+#endif
+
 
 // Sets the name of the "main()" entry point function that will be
 // called by circle after system initialization has completed.
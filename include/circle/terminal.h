@@ -31,6 +31,8 @@
 
 typedef CDisplay::TColor TTerminalColor;
 
+class CBcmFrameBuffer;
+
 class CTerminalDevice : public CDevice	/// Terminal support for dot-matrix displays
 {
 public:
@@ -47,6 +49,13 @@ public:
 	/// \return Operation successful?
 	boolean Initialize (void);
 
+	/// \brief Scroll by moving the virtual offset of the frame buffer
+	/// \param pFrameBuffer Frame buffer, which is the display of this terminal
+	/// \note Must be called before Initialize(). Is ignored, if the virtual height\n
+	///	  of the frame buffer is less than twice its height. The frame buffer\n
+	///	  cannot be used for anything else than this terminal then.
+	void EnableHardwareScroll (CBcmFrameBuffer *pFrameBuffer);
+
 	/// \return Screen width in pixels
 	unsigned GetWidth (void) const;
 	/// \return Screen height in pixels
@@ -175,11 +184,17 @@ private:
 	void Tabulator (void);
 
 	void Scroll (void);
+	void HardwareScroll (unsigned nLines);
+
+	void ClearLines (unsigned nPosY, unsigned nLines);
 
 	void DisplayChar (char chChar, unsigned nPosX, unsigned nPosY, CDisplay::TRawColor nColor);
 	void EraseChar (unsigned nPosX, unsigned nPosY);
 	void InvertCursor (void);
 
+	// sends the update area to the display and moves the virtual offset
+	void UpdateDisplay (void);
+
 private:
 	// We always update entire pixel lines.
 	void SetUpdateArea (unsigned nPosY1, unsigned nPosY2)
@@ -214,12 +229,21 @@ private:
 	unsigned	     m_nDeviceIndex;
 	CCharGenerator	     m_CharGen;
 	CDisplay::TRawColor *m_pCursorPixels;
-	union
+	union			// visible window in m_pBufferBase
 	{
 		u8	    *m_pBuffer8;
 		u16	    *m_pBuffer16;
 		u32	    *m_pBuffer32;
 	};
+	u8		    *m_pBufferBase;
+	unsigned	     m_nBufferLines;	// twice m_nHeight with hardware scroll
+	unsigned	     m_nBaseY;		// first line of the window in the buffer
+	unsigned	     m_nDisplayBaseY;	// current virtual offset of the frame buffer
+	CBcmFrameBuffer	    *m_pFrameBuffer;	// != nullptr for hardware scroll
+	u8		    *m_pGlyphCache;	// glyphs rendered in display format
+	u32		     m_GlyphCacheValid[256 / 32];
+	CDisplay::TRawColor  m_GlyphCacheColor;
+	CDisplay::TRawColor  m_GlyphCacheBackground;
 	unsigned	     m_nSize;
 	unsigned	     m_nPitch;
 	unsigned	     m_nWidth;
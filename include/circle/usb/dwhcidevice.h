@@ -90,6 +90,9 @@ private:
 	void QueueTransaction (CDWHCITransferStageData *pStageData);
 
 	void QueueDelayedTransaction (CDWHCITransferStageData *pStageData);
+
+	// enqueues the transaction and enables the SOF interrupt
+	void EnqueueTransaction (CDWHCITransferStageData *pStageData, u16 usFrameNumber);
 #endif
 
 	void StartTransaction (CDWHCITransferStageData *pStageData);
@@ -49,6 +49,8 @@ public:
 	// dequeue next transaction to be processed at usFrameNumber (or earlier)
 	CDWHCITransferStageData *Dequeue (u16 usFrameNumber);
 
+	boolean IsEmpty (void);
+
 private:
 	CPtrListFIQ m_List;
 
@@ -33,6 +33,8 @@
 
 #define BLOCK_SIZE 512
 
+#define MSD_CHUNK_BLOCKS 64	// max. blocks per data transfer (two buffers of this size)
+
 struct TUSBMSDCBW   //31 bytes
 {
 	u32 dCBWSignature;
@@ -138,6 +140,15 @@ PACKED;
 
 class CUSBMSDGadget : public CDWUSBGadget	/// USB mass storage device gadget
 {
+public:
+	struct TStatistics		/// Counters for throughput measurement
+	{
+		u64 BytesRead;		///< Bytes read from the block device and sent to the host
+		u64 BytesWritten;	///< Bytes received from the host and written to the device
+		unsigned ReadCommands;	///< Number of READ(10) commands
+		unsigned WriteCommands;	///< Number of WRITE(10) commands
+	};
+
 public:
 	/// \param pInterruptSystem Pointer to the interrupt system object
 	/// \param pDevice Pointer to the block device, to be controlled by this gadget
@@ -160,6 +171,9 @@ public:
 	/// \return Capacity of the block device in number of blocks (a 512 bytes)
 	u64 GetBlocks (void) const;
 
+	/// \param pStatistics Pointer to buffer, which receives the current counters
+	void GetStatistics (TStatistics *pStatistics) const;
+
 protected:
 	/// \brief Get device-specific descriptor
 	/// \param wValue Parameter from setup packet (descriptor type (MSB) and index (LSB))
@@ -198,6 +212,19 @@ private:
 
 	void InitDeviceSize(u64 blocks);
 
+	// data transfers of READ(10) and WRITE(10) with two ping-pong buffers
+	void BeginDataTransfer (void);
+	void StartDataIn (void);	// IRQ disabled
+	void StartDataOut (void);	// IRQ disabled
+	void UpdateRead (void);
+	void UpdateWrite (void);
+	void IOError (void);
+
+	u8 *GetDataBuffer (unsigned nIndex)
+	{
+		return m_DataBuffer + nIndex * DataBufferSize;
+	}
+
 private:
 	CDevice *m_pDevice;
 
@@ -234,11 +261,10 @@ private:
 		ReceiveCBW,
 		InvalidCBW,
 		DataIn,
-		DataOut,
 		SentCSW,
 		SendReqSenseReply,
-		DataInRead,
-		DataOutWrite
+		DataInRead,		// READ(10) in progress
+		DataOutWrite		// WRITE(10) in progress
 	};
 
 	TMSDState m_nState=Init;
@@ -260,6 +286,25 @@ private:
 	DMA_BUFFER (u8, m_OutBuffer, MaxOutMessageSize);
 	DMA_BUFFER (u8, m_InBuffer, MaxInMessageSize);
 
+	enum TBufferState
+	{
+		BufferFree,
+		BufferFilled,		// contains data, which has to be sent or written
+		BufferBusy		// USB transfer active
+	};
+
+	static const size_t DataBufferSize = MSD_CHUNK_BLOCKS * BLOCK_SIZE;
+	DMA_BUFFER (u8, m_DataBuffer, 2 * DataBufferSize);
+
+	volatile TBufferState m_BufferState[2];
+	u32 m_nBufferBlocks[2];
+	unsigned m_nIOBuffer;		// next buffer to be read from / written to the device
+	unsigned m_nUSBBuffer;		// next buffer to be transferred via USB
+	u32 m_nTransferBlocks;		// blocks not yet requested from the host (write)
+	boolean m_bIOError;
+
+	TStatistics m_Statistics;
+
 	u32 m_nblock_address;
 	u32 m_nnumber_blocks;
 	u64 m_nDeviceBlocks=0;
@@ -24,6 +24,7 @@
 #include <circle/usb/usbfunction.h>
 #include <circle/usb/usbendpoint.h>
 #include <circle/usb/usbrequest.h>
+#include <circle/usb/usbnetpipeline.h>
 #include <circle/macaddress.h>
 #include <circle/timer.h>
 #include <circle/types.h>
@@ -38,6 +39,8 @@ public:
 
 	const CMACAddress *GetMACAddress (void) const;
 
+	boolean IsSendFrameAdvisable (void);
+
 	boolean SendFrame (const void *pBuffer, unsigned nLength);
 	
 	// pBuffer must have size FRAME_BUFFER_SIZE
@@ -50,6 +53,8 @@ public:
 
 	boolean SetMulticastFilter (const u8 Groups[][MAC_ADDRESS_SIZE]);
 
+	void GetStatistics (CUSBNetPipeline::TStatistics *pStatistics) const;
+
 private:
 	void SetAddressFilter (int index, const u8 addr[MAC_ADDRESS_SIZE]);
 
@@ -72,6 +77,8 @@ private:
 	CUSBEndpoint *m_pEndpointBulkIn;
 	CUSBEndpoint *m_pEndpointBulkOut;
 
+	CUSBNetPipeline *m_pPipeline;
+
 	CMACAddress m_MACAddress;
 
 	u32 m_FilterTable[33][2];
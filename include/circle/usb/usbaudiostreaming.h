@@ -68,6 +68,18 @@ public:
 		Terminal[MaxTerminals];
 	};
 
+	struct TStatistics		/// Counters of one audio stream
+	{
+		unsigned URBsSubmitted;		///< Number of isochronous transfers submitted
+		unsigned URBsFailed;		///< Transfers completed with error (data lost)
+		unsigned Underruns;		///< Output pipeline has run empty (output only)
+		unsigned Overruns;		///< Input pipeline has run empty (input only)
+		unsigned MaxURBsInFlight;	///< Maximum number of queued transfers seen
+		unsigned FeedbackErrors;	///< Invalid feedback values, which were ignored
+		unsigned FeedbackRate;		///< Sample rate in mHz requested via feedback EP\n
+						///< (0 if there is no feedback EP or no valid value yet)
+	};
+
 	typedef void TCompletionRoutine (unsigned nBytesTransferred, void *pParam);
 
 public:
@@ -108,6 +120,16 @@ public:
 	boolean ReceiveChunk (void *pBuffer, unsigned nChunkSizeBytes,
 			      TCompletionRoutine *pCompletionRoutine = 0, void *pParam = 0);
 
+	/// \return Number of transfers currently queued at the host controller
+	unsigned GetURBsInFlight (void) const;
+
+	/// \return Counters of this stream
+	/// \note Underruns and overruns are detected with USB_AUDIO_URBS_IN_FLIGHT > 1 only.
+	TStatistics GetStatistics (void) const;
+
+	/// \brief Clear all counters of this stream
+	void ResetStatistics (void);
+
 	/// \brief Select Input Terminal to be used for input
 	/// \param nIndex Index of the Input Terminal (0 .. NumTerminals-1)
 	/// \return Operation successful?
@@ -128,11 +150,24 @@ public:
 private:
 	boolean InitTerminalControlInfo (CUSBAudioControlDevice *pControlDevice);
 
+	// adds the packets of the current chunk to pURB, the last one clipped to nChunkSizeBytes
+	void AddIsoPackets (CUSBRequest *pURB, unsigned nChunkSizeBytes);
+
 	static void CompletionHandler (CUSBRequest *pURB, void *pParam, void *pContext);
 	static void SyncCompletionHandler (CUSBRequest *pURB, void *pParam, void *pContext);
 
 	void UpdateChunkSize (void);
 
+	// validates a raw value from the feedback EP, returns Q16.16 frames per data packet or 0
+	u32 ConvertFeedback (u32 nRawValue, boolean bFormat10_14) const;
+
+private:
+	struct TCompletionInfo
+	{
+		TCompletionRoutine *pRoutine;
+		void *pParam;
+	};
+
 private:
 	unsigned m_nBitResolution;
 	unsigned m_nSubframeSize;
@@ -143,6 +178,7 @@ private:
 	CUSBEndpoint *m_pEndpointSync;		// feedback EP
 
 	unsigned m_nDataIntervalFactor;
+	unsigned m_nPacketRate;			// data packets per second
 
 	boolean m_bIsOutput;
 	unsigned m_nChannels;
@@ -162,6 +198,13 @@ private:
 	DMA_BUFFER (u32, m_SyncEPBuffer, 1);
 	unsigned m_nSyncAccu;
 
+	u32 m_nFeedbackNominal;			// Q16.16 frames per data packet
+	volatile u32 m_nFeedbackValue;		// same format, 0 if not valid
+	u32 m_nFeedbackAccu;
+
+	volatile int m_nURBsInFlight;
+	TStatistics m_Statistics;
+
 	u8 m_uchClockSourceID;
 	u8 m_uchSelectorUnitID;
 	u8 m_uchFeatureUnitID[MaxTerminals];
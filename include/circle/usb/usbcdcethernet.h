@@ -24,6 +24,7 @@
 #include <circle/usb/usbfunction.h>
 #include <circle/usb/usbendpoint.h>
 #include <circle/usb/usbrequest.h>
+#include <circle/usb/usbnetpipeline.h>
 #include <circle/macaddress.h>
 #include <circle/types.h>
 
@@ -37,6 +38,8 @@ public:
 
 	const CMACAddress *GetMACAddress (void) const;
 
+	boolean IsSendFrameAdvisable (void);
+
 	boolean SendFrame (const void *pBuffer, unsigned nLength);
 
 	// pBuffer must have size FRAME_BUFFER_SIZE
@@ -44,6 +47,8 @@ public:
 
 	boolean SetMulticastFilter (const u8 Groups[][MAC_ADDRESS_SIZE]);
 
+	void GetStatistics (CUSBNetPipeline::TStatistics *pStatistics) const;
+
 private:
 	u8 GetMACAddressStringIndex (void);	// returns 0 on error
 
@@ -57,6 +62,8 @@ private:
 	CUSBEndpoint *m_pEndpointBulkIn;
 	CUSBEndpoint *m_pEndpointBulkOut;
 
+	CUSBNetPipeline *m_pPipeline;
+
 	CMACAddress m_MACAddress;
 };
 
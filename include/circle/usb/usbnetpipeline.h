@@ -0,0 +1,136 @@
+//
+// usbnetpipeline.h
+//
+// Keeps multiple bulk transfers in flight for USB Ethernet adapters
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef _circle_usb_usbnetpipeline_h
+#define _circle_usb_usbnetpipeline_h
+
+#include <circle/usb/usbhostcontroller.h>
+#include <circle/usb/usbendpoint.h>
+#include <circle/usb/usbrequest.h>
+#include <circle/spinlock.h>
+#include <circle/sysconfig.h>
+#include <circle/types.h>
+
+/// \note The receive and transmit buffers are used as rings. A completed bulk-in transfer\n
+///	  stays in its buffer, until the driver has consumed all frames from it. The\n
+///	  bulk-in endpoint is re-armed from the completion routine, while free buffers\n
+///	  are available, and from GetRxData() otherwise.
+/// \note With bCompleteOnNAK the bulk-in transfers complete without data, when the\n
+///	  device answers with NAK (Raspberry Pi 1-3 and Zero only). The endpoint is\n
+///	  re-armed from GetRxData() only then, so that it is not polled from the\n
+///	  completion routine continuously.
+
+class CUSBNetPipeline	/// Keeps multiple bulk transfers in flight for USB Ethernet adapters
+{
+public:
+	struct TStatistics
+	{
+		unsigned RxTransfers;	///< Completed bulk-in transfers with data
+		unsigned RxFrames;	///< Valid frames returned by the driver
+		unsigned RxFrameErrors;	///< Frames dropped by the driver (error status, invalid header)
+		unsigned RxOverruns;	///< Bulk-in was idle, because all buffers were full
+		unsigned RxErrors;	///< Failed bulk-in transfers
+		unsigned TxFrames;	///< Completed bulk-out transfers
+		unsigned TxDropped;	///< Frames dropped, because all transmit buffers were busy
+		unsigned TxErrors;	///< Failed bulk-out transfers
+	};
+
+public:
+	/// \param pHost Host controller, the adapter is connected to
+	/// \param pEndpointIn Bulk-in endpoint of the adapter
+	/// \param pEndpointOut Bulk-out endpoint of the adapter
+	/// \param nRxBufferSize Size of a receive buffer (multiple of the max. packet size)
+	/// \param nTxBufferSize Size of a transmit buffer
+	/// \param bCompleteOnNAK Do not retry bulk-in transfers, which the device answers with NAK
+	CUSBNetPipeline (CUSBHostController *pHost,
+			 CUSBEndpoint *pEndpointIn, CUSBEndpoint *pEndpointOut,
+			 unsigned nRxBufferSize, unsigned nTxBufferSize,
+			 boolean bCompleteOnNAK = FALSE);
+
+	~CUSBNetPipeline (void);
+
+	/// \brief Allocate the buffers and start receiving
+	/// \return Operation successful?
+	boolean Initialize (void);
+
+	/// \param pLength Number of available bytes is returned here
+	/// \return Pointer to the not consumed data of the oldest bulk-in transfer (or nullptr)
+	const u8 *GetRxData (unsigned *pLength);
+	/// \param nBytes Number of bytes consumed from the data returned by GetRxData()
+	/// \note The buffer is released, when all its data has been consumed.
+	void ConsumeRxData (unsigned nBytes);
+
+	/// \param bError Has the frame been dropped because of an error?
+	void CountRxFrame (boolean bError = FALSE);
+
+	/// \return Is a transmit buffer available?
+	boolean IsTxBufferAvailable (void);
+	/// \return Free transmit buffer to be filled by the driver (or nullptr, if all are busy)
+	/// \note A dropped frame is counted, if no buffer is available.
+	u8 *GetTxBuffer (void);
+	/// \brief Queue the buffer returned by GetTxBuffer() for sending
+	/// \param nLength Number of valid bytes in the buffer
+	void SendTxBuffer (unsigned nLength);
+
+	/// \param pStatistics Statistics are returned here
+	void GetStatistics (TStatistics *pStatistics) const;
+
+private:
+	// the following are called with m_SpinLock acquired
+	void StartRx (void);
+	void ReleaseRxBuffer (void);
+	void StartTx (void);
+
+	void RxCompletionRoutine (CUSBRequest *pURB, unsigned nBuffer);
+	static void RxCompletionStub (CUSBRequest *pURB, void *pParam, void *pContext);
+
+	void TxCompletionRoutine (CUSBRequest *pURB, unsigned nBuffer);
+	static void TxCompletionStub (CUSBRequest *pURB, void *pParam, void *pContext);
+
+private:
+	CUSBHostController *m_pHost;
+	CUSBEndpoint *m_pEndpointIn;
+	CUSBEndpoint *m_pEndpointOut;
+	unsigned m_nRxBufferSize;
+	unsigned m_nTxBufferSize;
+	boolean m_bCompleteOnNAK;
+
+	u8 *m_pRxBuffer[USB_NET_BUFFERS];
+	unsigned m_nRxLength[USB_NET_BUFFERS];
+	unsigned m_nRxSubmit;		// next buffer to be submitted
+	unsigned m_nRxConsume;		// buffer, which is consumed by the driver
+	unsigned m_nRxOffset;		// number of consumed bytes in this buffer
+	unsigned m_nRxFilled;		// completed buffers, which are not released yet
+	unsigned m_nRxInFlight;
+
+	u8 *m_pTxBuffer[USB_NET_BUFFERS];
+	unsigned m_nTxLength[USB_NET_BUFFERS];
+	unsigned m_nTxFill;		// next buffer to be filled by the driver
+	unsigned m_nTxSubmit;		// next buffer to be submitted
+	unsigned m_nTxQueued;		// filled buffers, which are not submitted yet
+	unsigned m_nTxInFlight;
+
+	TStatistics m_Statistics;
+
+	CSpinLock m_SpinLock;
+};
+
+#endif
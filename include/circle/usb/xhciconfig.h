@@ -60,11 +60,15 @@
 
 #define XHCI_CONFIG_EVENT_RING_SIZE	256
 #define XHCI_CONFIG_CMD_RING_SIZE	64
-#define XHCI_CONFIG_TRANSFER_RING_SIZE	64
+#define XHCI_CONFIG_TRANSFER_RING_SIZE	64		// initial size for bulk and isochronous EPs
+#define XHCI_CONFIG_TRANSFER_RING_SIZE_SMALL 16		// initial size for control and interrupt EPs
+#define XHCI_CONFIG_MAX_RING_SEGMENTS	8		// transfer rings grow up to this
 
-#define XHCI_CONFIG_IMODI		500		// defines maximum interrupt rate
+#define XHCI_CONFIG_MAX_PENDING_URBS	8		// per endpoint (e.g. for isochronous streaming)
 
-#define XHCI_CONFIG_MAX_EVENTS_PER_INTR	16		// max. events to be handled per interrupt
+#define XHCI_CONFIG_IMODI		500		// defines maximum interrupt rate (default)
+
+#define XHCI_CONFIG_ERDP_UPDATE_EVENTS	32		// update dequeue pointer after these events
 
 #define XHCI_PAGE_SHIFT			12
 #define XHCI_PAGE_SIZE			(1 << XHCI_PAGE_SHIFT)
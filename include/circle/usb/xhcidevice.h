@@ -37,6 +37,17 @@
 
 class CXHCIDevice : public CUSBHostController	/// USB host controller interface (xHCI) driver
 {
+public:
+	struct TStatistics		/// USB throughput counters
+	{
+		u64 BytesTransferred;		///< Data of successful transfers (both directions)
+		unsigned Transfers;		///< Number of successful transfers
+		unsigned TransferErrors;	///< Number of failed transfers
+		unsigned Interrupts;		///< Number of handled interrupts
+		unsigned Events;		///< Number of handled events
+		unsigned MaxEventsPerInterrupt;	///< Maximum events handled in one interrupt
+	};
+
 public:
 	CXHCIDevice (CInterruptSystem *pInterruptSystem, CTimer *pTimer,
 		     boolean bPlugAndPlay = FALSE, unsigned nDevice = 0,
@@ -50,6 +61,15 @@ public:
 	boolean SubmitBlockingRequest (CUSBRequest *pURB, unsigned nTimeoutMs = USB_TIMEOUT_NONE);
 	boolean SubmitAsyncRequest (CUSBRequest *pURB, unsigned nTimeoutMs = USB_TIMEOUT_NONE);
 
+	/// \param nIntervalNs Minimum interval between two interrupts in nanoseconds\n
+	///	  (0 to disable interrupt moderation, default is 125000)
+	/// \note The driver uses one interrupter (0) only. Longer intervals reduce the\n
+	///	  interrupt load with high-rate bulk devices, but increase the latency.
+	void SetInterruptModeration (unsigned nIntervalNs);
+
+	/// \param pStatistics Pointer to buffer, which receives the current counters
+	void GetStatistics (TStatistics *pStatistics) const;
+
 public:
 	CXHCIMMIOSpace *GetMMIOSpace (void);
 	CXHCISlotManager *GetSlotManager (void);
@@ -61,6 +81,9 @@ public:
 				 size_t nBoundary = XHCI_PAGE_SIZE);
 	void FreeSharedMem (void *pBlock);
 
+	// called on completion of a transfer at IRQ_LEVEL
+	void CountTransfer (u32 nBytes, boolean bOK);
+
 #ifndef NDEBUG
 	void DumpStatus (void);
 #endif
@@ -95,6 +118,8 @@ private:
 
 	CXHCIRootHub *m_pRootHub;
 
+	TStatistics m_Statistics;
+
 	boolean m_bShutdown;
 };
 
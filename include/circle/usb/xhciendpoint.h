@@ -59,7 +59,15 @@ public:
 private:
 	static void CompletionRoutine (CUSBRequest *pURB, void *pParam, void *pContext);
 
-	// Cycle bit and Interrupter Target are set automatically
+	// removes the oldest pending URB and releases its TRBs,
+	// must be called with m_SpinLock acquired
+	void RemoveFirstURB (void);
+
+	// returns the number of TRBs required for the URB
+	unsigned GetTRBCount (CUSBRequest *pURB) const;
+
+	// Cycle bit and Interrupter Target are set automatically,
+	// the TRBs of the current TD are recorded in m_pEnqueuedTRB[]
 	boolean EnqueueTRB (u32 nControl, u32 nStatus = 0,
 			    u32 nParameter1 = 0, u32 nParameter2 = 0);
 
@@ -86,9 +94,17 @@ private:
 	u8		 m_uchEndpointID;
 	u8		 m_uchEndpointType;
 
-	CUSBRequest	*m_pURB[2];
+	CUSBRequest	*m_pURB[XHCI_CONFIG_MAX_PENDING_URBS];	// in order of submission
+	unsigned	 m_nURBTRBs[XHCI_CONFIG_MAX_PENDING_URBS];
+	unsigned	 m_nURBs;
 	volatile boolean m_bTransferCompleted;
 
+	static const unsigned MaxTRBsPerTD = 32;	// CUSBRequest::MaxIsoPackets
+	TXHCITRB	*m_pEnqueuedTRB[MaxTRBsPerTD];	// of the current TD
+	unsigned	 m_nEnqueuedTRBs;
+	u32		 m_nFirstTRBControl;	// written last, when the TD is complete
+	unsigned	 m_nSkippedTRBs;	// of failed TDs, released with the next TD
+
 	u8		*m_pInputContextBuffer;
 
 	CSpinLock	 m_SpinLock;
@@ -38,6 +38,9 @@ public:
 	// returns next event dequeue TRB or 0 if event ring is empty
 	TXHCITRB *HandleEvents (void);
 
+	// nInterval is the minimum interval between interrupts in 250ns units (0 to disable)
+	void SetModerationInterval (u16 nInterval);
+
 #ifndef NDEBUG
 	void DumpStatus (void);
 #endif
@@ -33,6 +33,10 @@ enum TXHCIRingType
 
 class CXHCIDevice;
 
+/// \note Transfer rings initially consist of one segment of nTRBCount TRBs. They are\n
+///	  expanded by further segments of the same size (up to XHCI_CONFIG_MAX_RING_SEGMENTS),\n
+///	  when ReserveTRBs() is called and there is not enough space left on the ring.
+
 class CXHCIRing		/// Encapsulates a transfer, command or event ring
 {
 public:
@@ -41,14 +45,25 @@ public:
 
 	boolean IsValid (void) const;
 
-	unsigned GetTRBCount (void) const;
+	unsigned GetTRBCount (void) const;		// of one segment
+	unsigned GetSegmentCount (void) const;
+
+	// transfer rings only: reserve nTRBs for a TD (expands the ring, if required),
+	// returns FALSE if no space is available
+	boolean ReserveTRBs (unsigned nTRBs);
+	// free the TRBs of the oldest TD(s), which have been processed by the xHC
+	void ReleaseTRBs (unsigned nTRBs);
+	// return reserved TRBs, which have not been enqueued
+	void UnreserveTRBs (unsigned nTRBs);
+	// free all TRBs, after the xHC dequeue pointer has been set to the enqueue TRB
+	void ReleaseAllTRBs (void);
 
 	TXHCITRB *GetFirstTRB (void);
 	TXHCITRB *GetDequeueTRB (void);		// returns 0 if empty
 	TXHCITRB *GetEnqueueTRB (void);		// returns 0 if full
 
 	TXHCITRB *IncrementDequeue (void);	// returns next dequeue TRB
-	void IncrementEnqueue (void);
+	void IncrementEnqueue (boolean bCycleSetLater = FALSE);	// cycle bit of TRB may be inverted
 
 	u32 GetCycleState (void) const;
 
@@ -56,6 +71,12 @@ public:
 	void DumpStatus (const char *pFrom = 0);
 #endif
 
+private:
+	TXHCITRB *AllocateSegment (void);
+
+	// insert a new segment after the enqueue segment
+	boolean Expand (void);
+
 private:
 	TXHCIRingType	 m_Type;
 	unsigned	 m_nTRBCount;
@@ -65,6 +86,14 @@ private:
 	unsigned	 m_nEnqueueIndex;
 	unsigned	 m_nDequeueIndex;
 	u32		 m_nCycleState;
+
+	TXHCITRB	*m_pSegment[XHCI_CONFIG_MAX_RING_SEGMENTS];	// in link order
+	unsigned	 m_nSegments;
+	unsigned	 m_nEnqueueSegment;
+
+	// transfer rings only: position of the oldest TRB not processed by the xHC yet
+	unsigned	 m_nDequeueSegment;
+	unsigned	 m_nUsedTRBs;
 };
 
 #endif
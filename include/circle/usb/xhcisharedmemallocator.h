@@ -20,6 +20,7 @@
 #ifndef _circle_usb_xhcisharedmemallocator_h
 #define _circle_usb_xhcisharedmemallocator_h
 
+#include <circle/spinlock.h>
 #include <circle/types.h>
 
 // Shared memory requirements of this xHCI driver:
@@ -29,7 +30,8 @@
 // 16	64	none	 1		ERST
 // 248	64	4K	 1		Scatchpad Buffer Array
 // 264	64	4K	 1		DCBAA
-// 1024	64	64K	 <=2+64*EPs	TRB Ring (EPs = number of endpoints per device)
+// 256	64	64K	 <=2+64*EPs	TRB Ring segment (EPs = number of endpoints per device)
+// 1024	64	64K			(rings of bulk/isochronous EPs may grow by more segments)
 // 2048	64	4K	 <=64		Device Context
 // 124K	4K	4K	 1		Scatchpad Buffers
 
@@ -63,11 +65,16 @@ public:
 
 	void Free (void *pBlock);
 
+private:
+	void *AllocateBlock (size_t nSize, size_t nAlign, size_t nBoundary);
+
 private:
 	uintptr m_nMemStart;
 	uintptr m_nMemEnd;
 
 	TXHCIBlockHeader *m_pFreeList;
+
+	CSpinLock m_SpinLock;		// transfer rings may grow at IRQ_LEVEL
 };
 
 #endif
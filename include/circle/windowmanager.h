@@ -0,0 +1,175 @@
+//
+// windowmanager.h
+//
+// Compositing window manager with off-screen window buffers
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef _circle_windowmanager_h
+#define _circle_windowmanager_h
+
+#include <circle/display.h>
+#include <circle/bcmframebuffer.h>
+#include <circle/spinlock.h>
+#include <circle/types.h>
+
+#define WINDOW_MANAGER_MAX_WINDOWS	16
+#define WINDOW_MANAGER_MAX_DAMAGE	16	// damaged areas are merged, if more
+
+class CWindowManager;
+
+class CManagedWindow : public CDisplay	/// Window with off-screen buffer, composited by CWindowManager
+{
+public:
+	/// \param pManager The window manager, which displays this window
+	/// \param rArea Initial area on the screen, which is covered by this window
+	/// \note The window is created on top of all other windows and is visible.
+	CManagedWindow (CWindowManager *pManager, const TArea &rArea);
+
+	~CManagedWindow (void);
+
+	/// \return Number of horizontal pixels
+	unsigned GetWidth (void) const override;
+	/// \return Number of vertical pixels
+	unsigned GetHeight (void) const override;
+	/// \return Number of bits per pixel
+	unsigned GetDepth (void) const override;
+
+	/// \brief Set one pixel to physical color in the window buffer
+	/// \param nPosX X-position of pixel (0-based)
+	/// \param nPosY Y-position of pixel (0-based)
+	/// \param nColor Raw color value (must match the color model)
+	void SetPixel (unsigned nPosX, unsigned nPosY, TRawColor nColor) override;
+
+	/// \brief Set area (rectangle) in the window buffer to the raw colors in pPixels
+	/// \param rArea Coordinates of the area (0-based)
+	/// \param pPixels Pointer to array with raw color values
+	/// \param pRoutine Routine to be called on completion (or nullptr for synchronous call)
+	/// \param pParam User parameter to be handed over to completion routine
+	/// \note The completion routine is called, before this method returns. The area\n
+	///	  appears on the screen with the next CWindowManager::Update().
+	void SetArea (const TArea &rArea, const void *pPixels,
+		      TAreaCompletionRoutine *pRoutine = nullptr,
+		      void *pParam = nullptr) override;
+
+	/// \return Parent display of the window manager
+	CDisplay *GetParent (void) const override;
+	/// \return X-offset in pixels of this window in the parent display
+	unsigned GetOffsetX (void) const override;
+	/// \return Y-offset in pixels of this window in the parent display
+	unsigned GetOffsetY (void) const override;
+
+	/// \brief Move the window to a new position on the screen
+	/// \param nPosX New X-offset in the parent display
+	/// \param nPosY New Y-offset in the parent display
+	/// \note The window must remain completely on the screen.
+	void Move (unsigned nPosX, unsigned nPosY);
+
+	/// \brief Put the window on top of all other windows
+	void Raise (void);
+	/// \brief Put the window below all other windows
+	void Lower (void);
+
+	/// \param bVisible Show (TRUE) or hide (FALSE) the window
+	void Show (boolean bVisible);
+	/// \return Is the window visible?
+	boolean IsVisible (void) const;
+
+private:
+	// copies an area of the window buffer (window coordinates) to pTo
+	void Read (const TArea &rArea, u8 *pTo, size_t nPitch);
+
+	// returns the damaged area of the window (window coordinates) and clears it
+	boolean GetDamage (TArea *pDamage);
+
+private:
+	CWindowManager *m_pManager;
+	TArea m_Area;				// on the screen
+	boolean m_bVisible;
+
+	unsigned m_nBytesPerPixel;
+	size_t m_nPitch;
+	u8 *m_pBuffer;
+
+	TArea m_Damage;				// in window coordinates
+	boolean m_bDamaged;
+
+	CSpinLock m_SpinLock;
+
+	friend class CWindowManager;
+};
+
+class CWindowManager	/// Composites overlapping windows onto a display
+{
+public:
+	/// \param pDisplay Display, which shows the windows
+	/// \note There is no VSync support with this constructor.
+	CWindowManager (CDisplay *pDisplay);
+
+	/// \param pFrameBuffer Frame buffer, which shows the windows
+	/// \param bVSync Wait for the vertical sync before writing to the frame buffer?
+	CWindowManager (CBcmFrameBuffer *pFrameBuffer, boolean bVSync = TRUE);
+
+	~CWindowManager (void);
+
+	/// \return Operation successful?
+	boolean Initialize (void);
+
+	/// \return Display, which shows the windows
+	CDisplay *GetDisplay (void) const;
+
+	/// \param Color Color of the screen areas, which are not covered by a window
+	void SetBackground (CDisplay::TColor Color);
+
+	/// \brief Composite the damaged areas of all windows and send them to the display
+	/// \return Number of bytes sent to the display
+	/// \note Should be called periodically from one task or core only.\n
+	///	  With VSync, waits for the next vertical sync, if something has to be updated.
+	size_t Update (void);
+
+private:
+	void AddWindow (CManagedWindow *pWindow);
+	void RemoveWindow (CManagedWindow *pWindow);
+	void Restack (CManagedWindow *pWindow, boolean bTop);
+
+	// area in screen coordinates, is called with m_SpinLock acquired
+	void AddDamage (const CDisplay::TArea &rArea);
+
+	// composites an area of the screen into m_pComposeBuffer (packed lines)
+	void Compose (const CDisplay::TArea &rArea);
+
+private:
+	CDisplay *m_pDisplay;
+	CBcmFrameBuffer *m_pFrameBuffer;	// != 0 for VSync
+	unsigned m_nBytesPerPixel;
+
+	CDisplay::TRawColor m_nBackground;
+
+	CManagedWindow *m_pWindow[WINDOW_MANAGER_MAX_WINDOWS];	// from bottom to top
+	unsigned m_nWindows;
+
+	CDisplay::TArea m_Damage[WINDOW_MANAGER_MAX_DAMAGE];	// screen coordinates
+	unsigned m_nDamages;
+
+	u8 *m_pComposeBuffer;
+
+	CSpinLock m_SpinLock;
+
+	friend class CManagedWindow;
+};
+
+#endif
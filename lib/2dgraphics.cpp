@@ -27,6 +27,205 @@
 
 #define PTR_ADD(type, ptr, bytes)	((type) ((uintptr) (ptr) + (bytes)))
 
+// The span operations use GCC vector extensions instead of NEON intrinsics, because
+// they must also build with STDLIB_SUPPORT=0. The compiler emits NEON code, where it
+// is available.
+typedef u16 TVector16 __attribute__ ((vector_size (16), aligned (1), may_alias));
+typedef u32 TVector32 __attribute__ ((vector_size (16), aligned (1), may_alias));
+typedef u16 TVector16x4 __attribute__ ((vector_size (8), aligned (1), may_alias));
+
+// blends ARGB8888 source over ARGB8888 destination, alpha of destination is kept
+template <typename T>
+static inline T Blend8888 (T Src, T Dst)
+{
+	T Alpha = Src >> 24;
+	Alpha += Alpha >> 7;				// 0..256
+
+	T RB = ((Src & 0xFF00FF) * Alpha + (Dst & 0xFF00FF) * (256 - Alpha)) >> 8;
+	T G  = ((Src & 0x00FF00) * Alpha + (Dst & 0x00FF00) * (256 - Alpha)) >> 8;
+
+	return (Dst & 0xFF000000) | (RB & 0xFF00FF) | (G & 0x00FF00);
+}
+
+// blends ARGB8888 source over RGB565 destination (in the low 16 bits)
+template <typename T>
+static inline T Blend565 (T Src, T Dst)
+{
+	T Alpha = ((Src >> 24) + 4) >> 3;		// 0..32
+
+	T S = ((Src >> 8) & 0xF800) | ((Src >> 5) & 0x07E0) | ((Src >> 3) & 0x001F);
+
+	// spread the components (0bGGGGGG00'000RRRRR'000000BB'BBB), so that they
+	// can be multiplied at once without overflowing into each other
+	S = (S | S << 16) & 0x07E0F81F;
+	T D = (Dst | Dst << 16) & 0x07E0F81F;
+
+	T R = (D + (((S - D) * Alpha) >> 5)) & 0x07E0F81F;
+
+	return (R | R >> 16) & 0xFFFF;
+}
+
+template <typename T>
+static inline T Swap16 (T Value)
+{
+	return ((Value >> 8) | (Value << 8)) & 0xFFFF;
+}
+
+// draws the set pixels of a string, pTo points to the top left pixel, runs are short
+template <typename T>
+static void DrawRuns (T *pTo, unsigned nPitch, const CGlyphAtlas *pAtlas, const char *pText,
+		      T Color)
+{
+	unsigned nCharWidth = pAtlas->GetCharWidth ();
+	unsigned nHeight = pAtlas->GetGlyphHeight ();
+
+	for (unsigned y = 0; y < nHeight; y++, pTo += nPitch)
+	{
+		T *pChar = pTo;
+		for (const char *p = pText; *p != '\0'; p++, pChar += nCharWidth)
+		{
+			unsigned nRuns;
+			const CGlyphAtlas::TRun *pRun = pAtlas->GetRuns (*p, y, &nRuns);
+			for (; nRuns > 0; nRuns--, pRun++)
+			{
+				T *pPixel = pChar + pRun->Start;
+				for (unsigned i = pRun->Length; i > 0; i--)
+				{
+					*pPixel++ = Color;
+				}
+			}
+		}
+	}
+}
+
+static void Fill16 (u16 *pTo, u16 usColor, unsigned nCount)
+{
+	for (; nCount > 0 && ((uintptr) pTo & 15); nCount--)
+	{
+		*pTo++ = usColor;
+	}
+
+	TVector16 Color = (TVector16) {} + usColor;
+	for (; nCount >= 16; nCount -= 16, pTo += 16)
+	{
+		*(TVector16 *) pTo = Color;
+		*(TVector16 *) (pTo + 8) = Color;
+	}
+
+	for (; nCount >= 8; nCount -= 8, pTo += 8)
+	{
+		*(TVector16 *) pTo = Color;
+	}
+
+	while (nCount--)
+	{
+		*pTo++ = usColor;
+	}
+}
+
+static void Fill32 (u32 *pTo, u32 nColor, unsigned nCount)
+{
+	for (; nCount > 0 && ((uintptr) pTo & 15); nCount--)
+	{
+		*pTo++ = nColor;
+	}
+
+	TVector32 Color = (TVector32) {} + nColor;
+	for (; nCount >= 8; nCount -= 8, pTo += 8)
+	{
+		*(TVector32 *) pTo = Color;
+		*(TVector32 *) (pTo + 4) = Color;
+	}
+
+	for (; nCount >= 4; nCount -= 4, pTo += 4)
+	{
+		*(TVector32 *) pTo = Color;
+	}
+
+	while (nCount--)
+	{
+		*pTo++ = nColor;
+	}
+}
+
+static void CopyTransparent16 (u16 *pTo, const u16 *pFrom, unsigned nCount, u16 usKey)
+{
+	for (; nCount >= 8; nCount -= 8, pTo += 8, pFrom += 8)
+	{
+		TVector16 Src = *(const TVector16 *) pFrom;
+		TVector16 Mask = (TVector16) (Src == usKey);
+		*(TVector16 *) pTo = (*(TVector16 *) pTo & Mask) | (Src & ~Mask);
+	}
+
+	for (; nCount > 0; nCount--, pTo++)
+	{
+		u16 usPixel = *pFrom++;
+		if (usPixel != usKey)
+		{
+			*pTo = usPixel;
+		}
+	}
+}
+
+static void CopyTransparent32 (u32 *pTo, const u32 *pFrom, unsigned nCount, u32 nKey)
+{
+	for (; nCount >= 4; nCount -= 4, pTo += 4, pFrom += 4)
+	{
+		TVector32 Src = *(const TVector32 *) pFrom;
+		TVector32 Mask = (TVector32) (Src == nKey);
+		*(TVector32 *) pTo = (*(TVector32 *) pTo & Mask) | (Src & ~Mask);
+	}
+
+	for (; nCount > 0; nCount--, pTo++)
+	{
+		u32 nPixel = *pFrom++;
+		if (nPixel != nKey)
+		{
+			*pTo = nPixel;
+		}
+	}
+}
+
+static void Blend16 (u16 *pTo, const u32 *pFrom, unsigned nCount, boolean bBigEndian)
+{
+	for (; nCount >= 4; nCount -= 4, pTo += 4, pFrom += 4)
+	{
+		TVector32 Dst = __builtin_convertvector (*(TVector16x4 *) pTo, TVector32);
+		if (bBigEndian)
+		{
+			Dst = Swap16 (Dst);
+		}
+
+		TVector32 Result = Blend565 (*(const TVector32 *) pFrom, Dst);
+		if (bBigEndian)
+		{
+			Result = Swap16 (Result);
+		}
+
+		*(TVector16x4 *) pTo = __builtin_convertvector (Result, TVector16x4);
+	}
+
+	for (; nCount > 0; nCount--, pTo++)
+	{
+		u32 nDst = bBigEndian ? Swap16 ((u32) *pTo) : *pTo;
+		u32 nResult = Blend565 (*pFrom++, nDst);
+		*pTo = bBigEndian ? Swap16 (nResult) : nResult;
+	}
+}
+
+static void Blend32 (u32 *pTo, const u32 *pFrom, unsigned nCount)
+{
+	for (; nCount >= 4; nCount -= 4, pTo += 4, pFrom += 4)
+	{
+		*(TVector32 *) pTo = Blend8888 (*(const TVector32 *) pFrom, *(TVector32 *) pTo);
+	}
+
+	for (; nCount > 0; nCount--, pTo++)
+	{
+		*pTo = Blend8888 (*pFrom++, *pTo);
+	}
+}
+
 //// C2DImage //////////////////////////////////////////////////////////////////
 
 C2DImage::C2DImage (C2DGraphics *p2DGraphics)
@@ -137,7 +336,15 @@ C2DGraphics::C2DGraphics (CDisplay *pDisplay)
 	m_pFrameBuffer(0),
 	m_bIsFrameBuffer(FALSE),
 	m_pBuffer8(0),
-	m_bVSync(FALSE)
+	m_bVSync(FALSE),
+	m_nDirtyAreas (0),
+	m_bDirtyAll (TRUE),
+	m_nPrevDirtyAreas (0),
+	m_bPrevDirtyAll (TRUE),
+	m_pUpdateBuffer (0),
+	m_nUpdateSize (0),
+	m_pGlyphAtlas {0},
+	m_nNextGlyphAtlas (0)
 {
 }
 
@@ -151,13 +358,27 @@ C2DGraphics::C2DGraphics (unsigned nWidth, unsigned nHeight, boolean bVSync, uns
 	m_bIsFrameBuffer(TRUE),
 	m_pBuffer8(0),
 	m_bVSync(bVSync),
-	m_bBufferSwapped(TRUE)
+	m_bBufferSwapped(TRUE),
+	m_nDirtyAreas (0),
+	m_bDirtyAll (TRUE),
+	m_nPrevDirtyAreas (0),
+	m_bPrevDirtyAll (TRUE),
+	m_pUpdateBuffer (0),
+	m_nUpdateSize (0),
+	m_pGlyphAtlas {0},
+	m_nNextGlyphAtlas (0)
 {
 
 }
 
 C2DGraphics::~C2DGraphics (void)
 {
+	for (unsigned i = 0; i < C2DGRAPHICS_GLYPH_ATLASES; i++)
+	{
+		delete m_pGlyphAtlas[i];
+	}
+
+	delete [] m_pUpdateBuffer;
 	delete [] m_pBuffer8;
 
 	if(m_pFrameBuffer)
@@ -220,6 +441,18 @@ boolean C2DGraphics::Initialize (void)
 		return FALSE;
 	}
 
+	m_pUpdateBuffer = new u8[m_nWidth * m_nHeight * m_nDepth/8];
+	if (!m_pUpdateBuffer)
+	{
+		return FALSE;
+	}
+
+	// the display content is undefined yet
+	m_nDirtyAreas = 0;
+	m_bDirtyAll = TRUE;
+	m_nPrevDirtyAreas = 0;
+	m_bPrevDirtyAll = TRUE;
+
 	return TRUE;
 }
 
@@ -235,6 +468,8 @@ boolean C2DGraphics::Resize (unsigned nWidth, unsigned nHeight)
 
 	delete [] m_pBuffer8;
 	m_pBuffer8 = 0;
+	delete [] m_pUpdateBuffer;
+	m_pUpdateBuffer = 0;
 	m_bBufferSwapped = TRUE;
 
 	return Initialize ();
@@ -262,13 +497,65 @@ void C2DGraphics::DrawRect (unsigned nX, unsigned nY, unsigned nWidth, unsigned
 		return;
 	}
 
+	AddDirtyArea (nX, nY, nX + nWidth - 1, nY + nHeight - 1);
+
 	CDisplay::TRawColor nColor = m_pDisplay->GetColor (Color);
-	
+
+	if (   nWidth == m_nWidth
+	    && m_nDepth != 1)
+	{
+		// full lines are consecutive in the buffer
+		FillSpan (0, nY, nWidth * nHeight, nColor);
+
+		return;
+	}
+
+	for(unsigned i = nY; i < nY + nHeight; i++)
+	{
+		FillSpan (nX, i, nWidth, nColor);
+	}
+}
+
+void C2DGraphics::DrawRectBlended (unsigned nX, unsigned nY, unsigned nWidth, unsigned nHeight,
+				   T2DColor Color, u8 uchAlpha)
+{
+	if(nX + nWidth > m_nWidth || nY + nHeight > m_nHeight)
+	{
+		return;
+	}
+
+	if (uchAlpha == 0xFF)
+	{
+		DrawRect (nX, nY, nWidth, nHeight, Color);
+
+		return;
+	}
+
+	if (   uchAlpha == 0
+	    || nWidth == 0)
+	{
+		return;
+	}
+
+	AddDirtyArea (nX, nY, nX + nWidth - 1, nY + nHeight - 1);
+
+	u32 Line[64];
+	for (unsigned i = 0; i < sizeof Line / sizeof Line[0]; i++)
+	{
+		Line[i] = ((u32) Color & 0xFFFFFF) | (u32) uchAlpha << 24;
+	}
+
 	for(unsigned i = nY; i < nY + nHeight; i++)
 	{
-		for(unsigned j = nX; j < nX + nWidth; j++)
+		for (unsigned j = 0; j < nWidth; j += sizeof Line / sizeof Line[0])
 		{
-			SetPixel (j, i, nColor);
+			unsigned nCount = nWidth - j;
+			if (nCount > sizeof Line / sizeof Line[0])
+			{
+				nCount = sizeof Line / sizeof Line[0];
+			}
+
+			BlendSpan (nX + j, i, nCount, Line);
 		}
 	}
 }
@@ -293,6 +580,9 @@ void C2DGraphics::DrawLine (unsigned nX1, unsigned nY1, unsigned nX2, unsigned n
 		return;
 	}
 	
+	AddDirtyArea (nX1 < nX2 ? nX1 : nX2, nY1 < nY2 ? nY1 : nY2,
+		      nX1 > nX2 ? nX1 : nX2, nY1 > nY2 ? nY1 : nY2);
+
 	CDisplay::TRawColor nColor = m_pDisplay->GetColor (Color);
 
 	int dx = nX2 - nX1;
@@ -343,20 +633,24 @@ void C2DGraphics::DrawCircle (unsigned nX, unsigned nY, unsigned nRadius, T2DCol
 		return;
 	}
 	
+	AddDirtyArea (nX - nRadius, nY - nRadius, nX + nRadius, nY + nRadius);
+
 	CDisplay::TRawColor nColor = m_pDisplay->GetColor (Color);
 
+	// fill one span per line, its half width shrinks from the center outwards
 	int r2 = nRadius * nRadius;
-	unsigned area = r2 << 2;
-	unsigned rr = nRadius << 1;
-
-	for (unsigned i = 0; i < area; i++)
+	int tx = nRadius;
+	for (int ty = 0; ty < (int) nRadius; ty++)
 	{
-		int tx = (int) (i % rr) - nRadius;
-		int ty = (int) (i / rr) - nRadius;
+		while (tx > 0 && tx * tx + ty * ty >= r2)
+		{
+			tx--;
+		}
 
-		if (tx * tx + ty * ty < r2)
+		FillSpan (nX - tx, nY + ty, 2*tx + 1, nColor);
+		if (ty > 0)
 		{
-			SetPixel (nX + tx, nY + ty, nColor);
+			FillSpan (nX - tx, nY - ty, 2*tx + 1, nColor);
 		}
 	}
 }
@@ -368,6 +662,8 @@ void C2DGraphics::DrawCircleOutline (unsigned nX, unsigned nY, unsigned nRadius,
 		return;
 	}
 
+	AddDirtyArea (nX - nRadius, nY - nRadius, nX + nRadius, nY + nRadius);
+
 	CDisplay::TRawColor nColor = m_pDisplay->GetColor (Color);
 
 	SetPixel (nRadius + nX, nY, nColor);
@@ -416,6 +712,99 @@ void C2DGraphics::DrawCircleOutline (unsigned nX, unsigned nY, unsigned nRadius,
 	}
 }
 
+void C2DGraphics::DrawPolygon (const TPoint *pPoints, unsigned nPoints, T2DColor Color)
+{
+	assert (pPoints);
+	if (   nPoints < 3
+	    || nPoints > C2DGRAPHICS_MAX_POLYGON_POINTS)
+	{
+		return;
+	}
+
+	unsigned nMinY = m_nHeight;
+	unsigned nMaxY = 0;
+	unsigned nMinX = m_nWidth;
+	unsigned nMaxX = 0;
+	for (unsigned i = 0; i < nPoints; i++)
+	{
+		if (pPoints[i].x >= m_nWidth || pPoints[i].y >= m_nHeight)
+		{
+			return;
+		}
+
+		if (pPoints[i].y < nMinY)	nMinY = pPoints[i].y;
+		if (pPoints[i].y > nMaxY)	nMaxY = pPoints[i].y;
+		if (pPoints[i].x < nMinX)	nMinX = pPoints[i].x;
+		if (pPoints[i].x > nMaxX)	nMaxX = pPoints[i].x;
+	}
+
+	AddDirtyArea (nMinX, nMinY, nMaxX, nMaxY);
+
+	CDisplay::TRawColor nColor = m_pDisplay->GetColor (Color);
+
+	for (unsigned y = nMinY; y < nMaxY; y++)
+	{
+		// X coordinates (16.16 fixed point), where the edges cross the pixel centers
+		int nCrossings = 0;
+		s64 CrossX[C2DGRAPHICS_MAX_POLYGON_POINTS];
+
+		int nCenterY2 = 2*y + 1;			// doubled to stay integral
+		for (unsigned i = 0; i < nPoints; i++)
+		{
+			const TPoint &rP0 = pPoints[i];
+			const TPoint &rP1 = pPoints[i+1 < nPoints ? i+1 : 0];
+
+			int nY0 = 2*rP0.y;
+			int nY1 = 2*rP1.y;
+			if (   (nCenterY2 < nY0) == (nCenterY2 < nY1)
+			    || nY0 == nY1)
+			{
+				continue;
+			}
+
+			s64 nX = ((s64) rP0.x << 16)
+				 + (s64) (nCenterY2 - nY0) * ((int) rP1.x - (int) rP0.x) * 0x10000
+				   / (nY1 - nY0);
+
+			// insertion sort, there are only a few crossings
+			int j = nCrossings++;
+			for (; j > 0 && CrossX[j-1] > nX; j--)
+			{
+				CrossX[j] = CrossX[j-1];
+			}
+			CrossX[j] = nX;
+		}
+
+		for (int i = 0; i+1 < nCrossings; i += 2)
+		{
+			// pixels with the center in [CrossX[i], CrossX[i+1])
+			int nX1 = (int) ((CrossX[i] + 0x7FFF) >> 16);
+			int nX2 = (int) ((CrossX[i+1] + 0x7FFF) >> 16);
+			if (nX2 > (int) m_nWidth)
+			{
+				nX2 = m_nWidth;
+			}
+
+			if (nX1 < nX2)
+			{
+				FillSpan (nX1, y, nX2 - nX1, nColor);
+			}
+		}
+	}
+}
+
+void C2DGraphics::DrawPolygonOutline (const TPoint *pPoints, unsigned nPoints, T2DColor Color)
+{
+	assert (pPoints);
+
+	for (unsigned i = 0; i < nPoints; i++)
+	{
+		const TPoint &rP1 = pPoints[i+1 < nPoints ? i+1 : 0];
+
+		DrawLine (pPoints[i].x, pPoints[i].y, rP1.x, rP1.y, Color);
+	}
+}
+
 void C2DGraphics::DrawImage (unsigned nX, unsigned nY, unsigned nWidth, unsigned nHeight, const void *PixelBuffer)
 {
 	DrawImageRect(nX, nY, nWidth, nHeight, 0, 0, PixelBuffer);
@@ -433,15 +822,29 @@ void C2DGraphics::DrawImageRect (unsigned nX, unsigned nY, unsigned nWidth, unsi
 		return;
 	}
 	
+	AddDirtyArea (nX, nY, nX + nWidth - 1, nY + nHeight - 1);
+
 	PixelBuffer = PTR_ADD (const void *, PixelBuffer,
 			       (nSourceY * nWidth + nSourceX) * m_nDepth/8);
 
-	for(unsigned i=0; i<nHeight; i++)
+	if (m_nDepth == 1)
 	{
-		for(unsigned j=0; j<nWidth; j++)
+		for(unsigned i=0; i<nHeight; i++)
 		{
-			SetPixel (nX + j, nY + i, GetPixel (&PixelBuffer, j));
+			for(unsigned j=0; j<nWidth; j++)
+			{
+				SetPixel (nX + j, nY + i, GetPixel (&PixelBuffer, j));
+			}
 		}
+
+		return;
+	}
+
+	for(unsigned i=0; i<nHeight; i++)
+	{
+		CopySpan (nX, nY + i, nWidth, PixelBuffer);
+
+		PixelBuffer = PTR_ADD (const void *, PixelBuffer, nWidth * m_nDepth/8);
 	}
 }
 
@@ -451,17 +854,28 @@ void C2DGraphics::DrawImageRectTransparent (unsigned nX, unsigned nY, unsigned n
 	{
 		return;
 	}
-	
+
+	AddDirtyArea (nX, nY, nX + nWidth - 1, nY + nHeight - 1);
+
+	CDisplay::TRawColor nTransparentColor = m_pDisplay->GetColor (TransparentColor);
+
 	for(unsigned i=0; i<nHeight; i++)
 	{
 		const void *pPixels =
 			PTR_ADD (const void *, PixelBuffer,
 				 ((nSourceY + i) * nSourceWidth + nSourceX) * m_nDepth/8);
 
+		if (m_nDepth != 1)
+		{
+			CopySpanTransparent (nX, nY + i, nWidth, pPixels, nTransparentColor);
+
+			continue;
+		}
+
 		for(unsigned j=0; j<nWidth; j++)
 		{
 			CDisplay::TRawColor sourcePixel = GetPixel (&pPixels, j);
-			if(sourcePixel != TransparentColor)
+			if(sourcePixel != nTransparentColor)
 			{
 				SetPixel (nX + j, nY + i, sourcePixel);
 			}
@@ -469,6 +883,25 @@ void C2DGraphics::DrawImageRectTransparent (unsigned nX, unsigned nY, unsigned n
 	}
 }
 
+void C2DGraphics::DrawImageBlended (unsigned nX, unsigned nY, unsigned nWidth, unsigned nHeight, const u32 *pPixels)
+{
+	if(nX + nWidth > m_nWidth || nY + nHeight > m_nHeight || nWidth == 0)
+	{
+		return;
+	}
+
+	assert (pPixels);
+
+	AddDirtyArea (nX, nY, nX + nWidth - 1, nY + nHeight - 1);
+
+	for(unsigned i=0; i<nHeight; i++)
+	{
+		BlendSpan (nX, nY + i, nWidth, pPixels);
+
+		pPixels += nWidth;
+	}
+}
+
 void C2DGraphics::DrawPixel (unsigned nX, unsigned nY, T2DColor Color)
 {
 	if(nX >= m_nWidth || nY >= m_nHeight)
@@ -476,6 +909,8 @@ void C2DGraphics::DrawPixel (unsigned nX, unsigned nY, T2DColor Color)
 		return;
 	}
 
+	AddDirtyArea (nX, nY, nX, nY);
+
 	CDisplay::TRawColor nColor = m_pDisplay->GetColor (Color);
 
 	SetPixel (nX, nY, nColor);
@@ -485,9 +920,16 @@ void C2DGraphics::DrawText (unsigned nX, unsigned nY, T2DColor Color, const char
 			    TTextAlign Align, const TFont &rFont,
 			    CCharGenerator::TFontFlags FontFlags)
 {
-	CCharGenerator Font (rFont, FontFlags);
+	CGlyphAtlas *pAtlas = GetGlyphAtlas (rFont, FontFlags);
+	if (!pAtlas)
+	{
+		return;
+	}
 
-	unsigned nWidth = strlen (pText) * Font.GetCharWidth ();
+	unsigned nCharWidth = pAtlas->GetCharWidth ();
+	unsigned nHeight = pAtlas->GetGlyphHeight ();
+
+	unsigned nWidth = strlen (pText) * nCharWidth;
 	if (Align == AlignRight)
 	{
 		nX -= nWidth;
@@ -499,35 +941,116 @@ void C2DGraphics::DrawText (unsigned nX, unsigned nY, T2DColor Color, const char
 
 	if (   nX > m_nWidth
 	    || nX + nWidth > m_nWidth
-	    || nY + Font.GetUnderline () > m_nHeight)
+	    || nY + nHeight > m_nHeight)
 	{
 		return;
 	}
 
-	CDisplay::TRawColor nColor = m_pDisplay->GetColor (Color);
+	AddDirtyArea (nX, nY, nX + nWidth - 1, nY + nHeight - 1);
 
-	for (; *pText != '\0'; pText++, nX += Font.GetCharWidth ())
+	// The string is drawn line by line, so that the buffer is written sequentially.
+	if (!pAtlas->IsAntiAliased ())
 	{
-		for (unsigned y = 0; y < Font.GetUnderline (); y++)
+		CDisplay::TRawColor nColor = m_pDisplay->GetColor (Color);
+		unsigned nOffset = m_nWidth * nY + nX;
+
+		switch (m_nDepth)
 		{
-			CCharGenerator::TPixelLine Line = Font.GetPixelLine (*pText, y);
+		case 8:
+			DrawRuns<u8> (&m_pBuffer8[nOffset], m_nWidth, pAtlas, pText, nColor);
+			break;
 
-			for (unsigned x = 0; x < Font.GetCharWidth (); x++)
+		case 16:
+			DrawRuns<u16> (&m_pBuffer16[nOffset], m_nWidth, pAtlas, pText, nColor);
+			break;
+
+		case 32:
+			DrawRuns<u32> (&m_pBuffer32[nOffset], m_nWidth, pAtlas, pText, nColor);
+			break;
+
+		default:
+			for (unsigned y = 0; y < nHeight; y++)
 			{
-				if (Font.GetPixel (x, Line))
+				unsigned nPosX = nX;
+				for (const char *p = pText; *p != '\0'; p++, nPosX += nCharWidth)
 				{
-					SetPixel (nX + x, nY + y, nColor);
+					unsigned nRuns;
+					const CGlyphAtlas::TRun *pRun = pAtlas->GetRuns (*p, y, &nRuns);
+					for (; nRuns > 0; nRuns--, pRun++)
+					{
+						FillSpan (nPosX + pRun->Start, nY + y, pRun->Length,
+							  nColor);
+					}
 				}
 			}
+			break;
+		}
+
+		return;
+	}
+
+	assert (nCharWidth <= C2DGRAPHICS_MAX_CHAR_WIDTH);
+	u32 Pixels[C2DGRAPHICS_MAX_CHAR_WIDTH];
+	u32 nColor = (u32) Color & 0xFFFFFF;
+
+	for (unsigned y = 0; y < nHeight; y++)
+	{
+		unsigned nPosX = nX;
+		for (const char *p = pText; *p != '\0'; p++, nPosX += nCharWidth)
+		{
+			const u8 *pAlpha = pAtlas->GetAlphaLine (*p, y);
+
+			// blend the covered part of the glyph line only
+			unsigned nStart = 0;
+			while (   nStart < nCharWidth
+			       && !pAlpha[nStart])
+			{
+				nStart++;
+			}
+
+			unsigned nEnd = nCharWidth;
+			while (   nEnd > nStart
+			       && !pAlpha[nEnd-1])
+			{
+				nEnd--;
+			}
+
+			if (nStart == nEnd)
+			{
+				continue;
+			}
+
+			for (unsigned x = nStart; x < nEnd; x++)
+			{
+				Pixels[x] = nColor | (u32) pAlpha[x] << 24;
+			}
+
+			BlendSpan (nPosX + nStart, nY + y, nEnd - nStart, &Pixels[nStart]);
 		}
 	}
 }
 
-void *C2DGraphics::GetBuffer (void)
+void *C2DGraphics::GetBuffer (boolean bMarkDirty)
 {
+	if (bMarkDirty)
+	{
+		m_bDirtyAll = TRUE;
+	}
+
 	return m_pBuffer8;
 }
 
+void C2DGraphics::MarkDirty (unsigned nX, unsigned nY, unsigned nWidth, unsigned nHeight)
+{
+	if (   nWidth == 0
+	    || nHeight == 0)
+	{
+		return;
+	}
+
+	AddDirtyArea (nX, nY, nX + nWidth - 1, nY + nHeight - 1);
+}
+
 CDisplay *C2DGraphics::GetDisplay (void)
 {
 	return m_pDisplay;
@@ -535,29 +1058,329 @@ CDisplay *C2DGraphics::GetDisplay (void)
 
 void C2DGraphics::UpdateDisplay (void)
 {
+	m_nUpdateSize = 0;
+
+	CDisplay::TArea FullArea {0, m_nWidth-1, 0, m_nHeight-1};
+
 #if RASPPI <= 4
 	if(m_bVSync)
 	{
 		unsigned nBaseHeight = m_bBufferSwapped ? m_nHeight : 0;
-		CDisplay::TArea Area {0, m_nWidth-1, nBaseHeight, nBaseHeight + m_nHeight-1};
+
+		// The hidden page has been updated two frames before. It has to be
+		// updated with the areas, which have been modified in the last frame too.
+		boolean bDirtyAll = m_bDirtyAll;
+		unsigned nDirtyAreas = m_nDirtyAreas;
+		CDisplay::TArea DirtyArea[C2DGRAPHICS_MAX_DIRTY_AREAS];
+		memcpy (DirtyArea, m_DirtyArea, sizeof DirtyArea);
+
+		if (m_bPrevDirtyAll)
+		{
+			m_bDirtyAll = TRUE;
+		}
+
+		for (unsigned i = 0; i < m_nPrevDirtyAreas; i++)
+		{
+			AddDirtyArea (m_PrevDirtyArea[i]);
+		}
 
 		m_pFrameBuffer->WaitForVerticalSync();
-		m_pFrameBuffer->SetArea (Area, m_pBuffer8);
+
+		if (m_bDirtyAll)
+		{
+			UpdateArea (m_pFrameBuffer, FullArea, nBaseHeight);
+		}
+		else
+		{
+			for (unsigned i = 0; i < m_nDirtyAreas; i++)
+			{
+				UpdateArea (m_pFrameBuffer, m_DirtyArea[i], nBaseHeight);
+			}
+		}
+
 		m_pFrameBuffer->SetVirtualOffset(0, m_bBufferSwapped ? m_nHeight : 0);
 		m_bBufferSwapped = !m_bBufferSwapped;
+
+		m_bPrevDirtyAll = bDirtyAll;
+		m_nPrevDirtyAreas = nDirtyAreas;
+		memcpy (m_PrevDirtyArea, DirtyArea, sizeof m_PrevDirtyArea);
 	}
 	else
 #endif
 	{
-		CDisplay::TArea Area {0, m_nWidth-1, 0, m_nHeight-1};
+		CDisplay *pDisplay = m_pDisplay ? m_pDisplay : m_pFrameBuffer;
 
-		if (!m_pDisplay)
+		if (m_bDirtyAll)
 		{
-			m_pFrameBuffer->SetArea (Area, m_pBuffer8);
+			UpdateArea (pDisplay, FullArea, 0);
 		}
 		else
 		{
-			m_pDisplay->SetArea (Area, m_pBuffer8);
+			for (unsigned i = 0; i < m_nDirtyAreas; i++)
+			{
+				UpdateArea (pDisplay, m_DirtyArea[i], 0);
+			}
+		}
+	}
+
+	m_nDirtyAreas = 0;
+	m_bDirtyAll = FALSE;
+}
+
+size_t C2DGraphics::GetUpdateSize (void) const
+{
+	return m_nUpdateSize;
+}
+
+void C2DGraphics::AddDirtyArea (int nX1, int nY1, int nX2, int nY2)
+{
+	if (nX1 < 0)			nX1 = 0;
+	if (nY1 < 0)			nY1 = 0;
+	if (nX2 >= (int) m_nWidth)	nX2 = m_nWidth-1;
+	if (nY2 >= (int) m_nHeight)	nY2 = m_nHeight-1;
+
+	if (   nX1 > nX2
+	    || nY1 > nY2)
+	{
+		return;
+	}
+
+	CDisplay::TArea Area {(unsigned) nX1, (unsigned) nX2, (unsigned) nY1, (unsigned) nY2};
+	AddDirtyArea (Area);
+}
+
+void C2DGraphics::AddDirtyArea (const CDisplay::TArea &rArea)
+{
+	if (m_bDirtyAll)
+	{
+		return;
+	}
+
+	CDisplay::TArea Area = rArea;
+
+	// merge with overlapping and adjacent areas, so that the areas never overlap
+	while (1)
+	{
+		unsigned i;
+		for (i = 0; i < m_nDirtyAreas; i++)
+		{
+			const CDisplay::TArea &rDirty = m_DirtyArea[i];
+			if (   Area.x1 <= rDirty.x2+1 && rDirty.x1 <= Area.x2+1
+			    && Area.y1 <= rDirty.y2+1 && rDirty.y1 <= Area.y2+1)
+			{
+				break;
+			}
+		}
+
+		if (i == m_nDirtyAreas)
+		{
+			if (m_nDirtyAreas < C2DGRAPHICS_MAX_DIRTY_AREAS)
+			{
+				break;
+			}
+
+			// no free slot, merge with the area, which grows the least
+			unsigned nMinGrowth = (unsigned) -1;
+			for (unsigned j = 0; j < m_nDirtyAreas; j++)
+			{
+				const CDisplay::TArea &rDirty = m_DirtyArea[j];
+				unsigned nWidth =   (Area.x2 > rDirty.x2 ? Area.x2 : rDirty.x2)
+						  - (Area.x1 < rDirty.x1 ? Area.x1 : rDirty.x1) + 1;
+				unsigned nHeight =   (Area.y2 > rDirty.y2 ? Area.y2 : rDirty.y2)
+						   - (Area.y1 < rDirty.y1 ? Area.y1 : rDirty.y1) + 1;
+				unsigned nGrowth =   nWidth * nHeight
+						   - (rDirty.x2-rDirty.x1+1) * (rDirty.y2-rDirty.y1+1);
+				if (nGrowth < nMinGrowth)
+				{
+					nMinGrowth = nGrowth;
+					i = j;
+				}
+			}
+		}
+
+		const CDisplay::TArea &rDirty = m_DirtyArea[i];
+		if (rDirty.x1 < Area.x1)	Area.x1 = rDirty.x1;
+		if (rDirty.x2 > Area.x2)	Area.x2 = rDirty.x2;
+		if (rDirty.y1 < Area.y1)	Area.y1 = rDirty.y1;
+		if (rDirty.y2 > Area.y2)	Area.y2 = rDirty.y2;
+
+		m_DirtyArea[i] = m_DirtyArea[--m_nDirtyAreas];
+	}
+
+	m_DirtyArea[m_nDirtyAreas++] = Area;
+
+	// fall back to a full update, if the most of the screen is modified
+	unsigned nPixels = 0;
+	for (unsigned i = 0; i < m_nDirtyAreas; i++)
+	{
+		const CDisplay::TArea &rDirty = m_DirtyArea[i];
+		nPixels += (rDirty.x2-rDirty.x1+1) * (rDirty.y2-rDirty.y1+1);
+	}
+
+	if (nPixels * 100 > m_nWidth * m_nHeight * C2DGRAPHICS_FULL_UPDATE_PERCENT)
+	{
+		m_bDirtyAll = TRUE;
+		m_nDirtyAreas = 0;
+	}
+}
+
+void C2DGraphics::UpdateArea (CDisplay *pDisplay, const CDisplay::TArea &rArea, unsigned nBaseY)
+{
+	assert (pDisplay);
+
+	CDisplay::TArea Area = rArea;
+	if (m_nDepth == 1)
+	{
+		// pixel lines of an area must start and end at a byte boundary
+		Area.x1 &= ~7U;
+		Area.x2 |= 7U;
+	}
+
+	size_t nPitch = m_nWidth * m_nDepth/8;
+	size_t nLineSize = (Area.x2 - Area.x1 + 1) * m_nDepth/8;
+	unsigned nLines = Area.y2 - Area.y1 + 1;
+
+	const u8 *pPixels = m_pBuffer8 + Area.y1 * nPitch + Area.x1 * m_nDepth/8;
+	if (nLineSize < nPitch)
+	{
+		// gather the pixel lines, because SetArea() requires them consecutive
+		u8 *pTo = m_pUpdateBuffer;
+		for (unsigned y = 0; y < nLines; y++)
+		{
+			memcpy (pTo, pPixels, nLineSize);
+
+			pTo += nLineSize;
+			pPixels += nPitch;
+		}
+
+		pPixels = m_pUpdateBuffer;
+	}
+
+	Area.y1 += nBaseY;
+	Area.y2 += nBaseY;
+
+	pDisplay->SetArea (Area, pPixels);
+
+	m_nUpdateSize += nLineSize * nLines;
+}
+
+CGlyphAtlas *C2DGraphics::GetGlyphAtlas (const TFont &rFont, CCharGenerator::TFontFlags Flags)
+{
+	for (unsigned i = 0; i < C2DGRAPHICS_GLYPH_ATLASES; i++)
+	{
+		if (   m_pGlyphAtlas[i]
+		    && m_pGlyphAtlas[i]->IsFor (rFont, Flags))
+		{
+			return m_pGlyphAtlas[i];
+		}
+	}
+
+	CGlyphAtlas *pAtlas = new CGlyphAtlas (rFont, Flags);
+	if (   !pAtlas
+	    || !pAtlas->Initialize ())
+	{
+		delete pAtlas;
+
+		return 0;
+	}
+
+	assert (m_nNextGlyphAtlas < C2DGRAPHICS_GLYPH_ATLASES);
+	delete m_pGlyphAtlas[m_nNextGlyphAtlas];
+	m_pGlyphAtlas[m_nNextGlyphAtlas] = pAtlas;
+
+	if (++m_nNextGlyphAtlas == C2DGRAPHICS_GLYPH_ATLASES)
+	{
+		m_nNextGlyphAtlas = 0;
+	}
+
+	return pAtlas;
+}
+
+void C2DGraphics::FillSpan (unsigned nX, unsigned nY, unsigned nCount, CDisplay::TRawColor nColor)
+{
+	unsigned nOffset = m_nWidth * nY + nX;
+
+	switch (m_nDepth)
+	{
+	case 8:		memset (&m_pBuffer8[nOffset], nColor, nCount);		break;
+	case 16:	Fill16 (&m_pBuffer16[nOffset], nColor, nCount);		break;
+	case 32:	Fill32 (&m_pBuffer32[nOffset], nColor, nCount);		break;
+
+	default:
+		while (nCount--)
+		{
+			SetPixel (nX++, nY, nColor);
+		}
+		break;
+	}
+}
+
+void C2DGraphics::CopySpan (unsigned nX, unsigned nY, unsigned nCount, const void *pPixels)
+{
+	assert (m_nDepth != 1);
+
+	memcpy (&m_pBuffer8[(m_nWidth * nY + nX) * m_nDepth/8], pPixels, nCount * m_nDepth/8);
+}
+
+void C2DGraphics::CopySpanTransparent (unsigned nX, unsigned nY, unsigned nCount, const void *pPixels,
+				       CDisplay::TRawColor nTransparentColor)
+{
+	unsigned nOffset = m_nWidth * nY + nX;
+
+	switch (m_nDepth)
+	{
+	case 16:
+		CopyTransparent16 (&m_pBuffer16[nOffset], (const u16 *) pPixels, nCount,
+				   nTransparentColor);
+		break;
+
+	case 32:
+		CopyTransparent32 (&m_pBuffer32[nOffset], (const u32 *) pPixels, nCount,
+				   nTransparentColor);
+		break;
+
+	default: {
+			assert (m_nDepth == 8);
+			const u8 *pFrom = (const u8 *) pPixels;
+			for (u8 *pTo = &m_pBuffer8[nOffset]; nCount > 0; nCount--, pTo++, pFrom++)
+			{
+				if (*pFrom != nTransparentColor)
+				{
+					*pTo = *pFrom;
+				}
+			}
+		}
+		break;
+	}
+}
+
+void C2DGraphics::BlendSpan (unsigned nX, unsigned nY, unsigned nCount, const u32 *pPixels)
+{
+	unsigned nOffset = m_nWidth * nY + nX;
+
+	switch (m_pDisplay->GetColorModel ())
+	{
+	case CDisplay::RGB565:
+	case CDisplay::RGB565_BE:
+		assert (m_nDepth == 16);
+		Blend16 (&m_pBuffer16[nOffset], pPixels, nCount,
+			 m_pDisplay->GetColorModel () == CDisplay::RGB565_BE);
+		break;
+
+	case CDisplay::ARGB8888:
+		assert (m_nDepth == 32);
+		Blend32 (&m_pBuffer32[nOffset], pPixels, nCount);
+		break;
+
+	default:
+		// no blending with indexed colors
+		for (; nCount > 0; nCount--, nX++, pPixels++)
+		{
+			if (*pPixels >= 0x80000000U)
+			{
+				SetPixel (nX, nY, m_pDisplay->GetColor ((T2DColor) (*pPixels & 0xFFFFFF)));
+			}
 		}
+		break;
 	}
 }
@@ -0,0 +1,250 @@
+//
+// busmanager.cpp
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <circle/busmanager.h>
+#include <circle/synchronize.h>
+#include <circle/timer.h>
+#include <circle/util.h>
+#include <assert.h>
+
+CBusManager::CBusManager (void)
+:	m_pFirst (0),
+	m_pLast (0),
+	m_nQueued (0),
+	m_pCurrent (0),
+	m_nCurrentBytesWritten (0),
+	m_nCurrentBytesRead (0),
+	m_nCurrentStartTicks (0),
+	m_nResetTicks (CTimer::GetClockTicks64 ()),
+	m_SpinLock (IRQ_LEVEL)
+{
+	memset (&m_Statistics, 0, sizeof m_Statistics);
+}
+
+CBusManager::~CBusManager (void)
+{
+	assert (m_pCurrent == 0);
+	assert (m_pFirst == 0);
+}
+
+boolean CBusManager::IsIdle (void)
+{
+	m_SpinLock.Acquire ();
+
+	boolean bResult = m_pCurrent == 0 && m_pFirst == 0;
+
+	m_SpinLock.Release ();
+
+	return bResult;
+}
+
+void CBusManager::GetStatistics (TStatistics *pStatistics)
+{
+	assert (pStatistics != 0);
+
+	m_SpinLock.Acquire ();
+
+	*pStatistics = m_Statistics;
+
+	u64 nTicks = CTimer::GetClockTicks64 ();
+	pStatistics->TotalTime = nTicks - m_nResetTicks;
+
+	// include the running transaction
+	if (m_pCurrent != 0)
+	{
+		pStatistics->BusyTime += nTicks - m_nCurrentStartTicks;
+	}
+
+	m_SpinLock.Release ();
+}
+
+unsigned CBusManager::GetUtilization (void)
+{
+	TStatistics Statistics;
+	GetStatistics (&Statistics);
+
+	if (Statistics.TotalTime == 0)
+	{
+		return 0;
+	}
+
+	return (unsigned) (Statistics.BusyTime * 100 / Statistics.TotalTime);
+}
+
+void CBusManager::ResetStatistics (void)
+{
+	m_SpinLock.Acquire ();
+
+	memset (&m_Statistics, 0, sizeof m_Statistics);
+
+	m_nResetTicks = CTimer::GetClockTicks64 ();
+	if (m_pCurrent != 0)
+	{
+		m_nCurrentStartTicks = m_nResetTicks;
+	}
+
+	m_SpinLock.Release ();
+}
+
+void CBusManager::SubmitTransaction (TBusTransaction *pTransaction)
+{
+	assert (pTransaction != 0);
+	pTransaction->pNext = 0;
+	pTransaction->nStatus = BUS_STATUS_PENDING;
+
+	m_SpinLock.Acquire ();
+
+	if (m_pLast != 0)
+	{
+		assert (m_pFirst != 0);
+		m_pLast->pNext = pTransaction;
+	}
+	else
+	{
+		assert (m_pFirst == 0);
+		m_pFirst = pTransaction;
+	}
+
+	m_pLast = pTransaction;
+
+	if (++m_nQueued > m_Statistics.MaxQueued)
+	{
+		m_Statistics.MaxQueued = m_nQueued;
+	}
+
+	TBusTransaction *pFailed = 0;
+	if (m_pCurrent == 0)
+	{
+		pFailed = StartNext ();
+	}
+
+	m_SpinLock.Release ();
+
+	CallCompletionRoutines (pFailed);
+}
+
+void CBusManager::TransactionCompleted (int nStatus)
+{
+	assert (nStatus <= BUS_STATUS_SUCCESS);
+
+	m_SpinLock.Acquire ();
+
+	TBusTransaction *pTransaction = m_pCurrent;
+	assert (pTransaction != 0);
+	m_pCurrent = 0;
+
+	m_Statistics.BusyTime += CTimer::GetClockTicks64 () - m_nCurrentStartTicks;
+	m_Statistics.Transactions++;
+
+	if (nStatus == BUS_STATUS_SUCCESS)
+	{
+		m_Statistics.BytesWritten += m_nCurrentBytesWritten;
+		m_Statistics.BytesRead += m_nCurrentBytesRead;
+	}
+	else
+	{
+		m_Statistics.Errors++;
+	}
+
+	// the next transaction is started, before the completion routine is called,
+	// to keep the bus busy
+	pTransaction->pNext = StartNext ();
+	pTransaction->nResult = nStatus;
+
+	m_SpinLock.Release ();
+
+	CallCompletionRoutines (pTransaction);
+}
+
+TBusTransaction *CBusManager::StartNext (void)
+{
+	assert (m_pCurrent == 0);
+
+	TBusTransaction *pFailedFirst = 0;
+	TBusTransaction *pFailedLast = 0;
+
+	while (m_pFirst != 0)
+	{
+		TBusTransaction *pTransaction = m_pFirst;
+		m_pFirst = pTransaction->pNext;
+		if (m_pFirst == 0)
+		{
+			m_pLast = 0;
+		}
+
+		assert (m_nQueued > 0);
+		m_nQueued--;
+
+		pTransaction->pNext = 0;
+
+		m_pCurrent = pTransaction;
+		m_nCurrentStartTicks = CTimer::GetClockTicks64 ();
+
+		int nStatus = StartTransaction (pTransaction, &m_nCurrentBytesWritten,
+						&m_nCurrentBytesRead);
+		if (nStatus == BUS_STATUS_SUCCESS)
+		{
+			break;
+		}
+
+		assert (nStatus < BUS_STATUS_SUCCESS);
+		m_pCurrent = 0;
+
+		m_Statistics.Transactions++;
+		m_Statistics.Errors++;
+
+		pTransaction->nResult = nStatus;
+
+		if (pFailedLast != 0)
+		{
+			pFailedLast->pNext = pTransaction;
+		}
+		else
+		{
+			pFailedFirst = pTransaction;
+		}
+
+		pFailedLast = pTransaction;
+	}
+
+	return pFailedFirst;
+}
+
+void CBusManager::CallCompletionRoutines (TBusTransaction *pList)
+{
+	while (pList != 0)
+	{
+		// the transaction may be re-used, when nStatus has been set,
+		// so fetch the fields in advance
+		TBusTransaction *pNext = pList->pNext;
+		TBusCompletionRoutine *pRoutine = pList->pCompletionRoutine;
+		void *pParam = pList->pParam;
+
+		DataMemBarrier ();
+
+		pList->nStatus = pList->nResult;
+
+		if (pRoutine != 0)
+		{
+			(*pRoutine) (pList, pParam);
+		}
+
+		pList = pNext;
+	}
+}
@@ -0,0 +1,327 @@
+//
+// checksum.cpp
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <circle/checksum.h>
+#include <assert.h>
+
+#if RASPPI >= 3
+	#define CRC32_HARDWARE		// all ARMv8 cores of the Raspberry Pi implement CRC32
+#endif
+
+#define ADLER32_BASE		65521
+#define ADLER32_NMAX		5552	// max. bytes before b overflows 32 bits
+
+#define FLETCHER32_BASE		65535
+#define FLETCHER32_NMAX		359	// max. words before sum2 overflows 32 bits
+
+#ifdef CRC32_HARDWARE
+
+#if AARCH == 32
+	typedef u32 TCRC32Word;
+	#define CRC32_WORD	"crc32w %0, %0, %1"
+	#define CRC32C_WORD	"crc32cw %0, %0, %1"
+	#define CRC32_BYTE	"crc32b %0, %0, %1"
+	#define CRC32C_BYTE	"crc32cb %0, %0, %1"
+#else
+	typedef u64 TCRC32Word;
+	#define CRC32_WORD	"crc32x %w0, %w0, %x1"
+	#define CRC32C_WORD	"crc32cx %w0, %w0, %x1"
+	#define CRC32_BYTE	"crc32b %w0, %w0, %w1"
+	#define CRC32C_BYTE	"crc32cb %w0, %w0, %w1"
+#endif
+
+static inline u32 CRC32Byte (u32 nCRC, u32 nData, boolean bCastagnoli)
+{
+	if (bCastagnoli)
+	{
+		asm (".arch_extension crc\n\t" CRC32C_BYTE : "+r" (nCRC) : "r" (nData));
+	}
+	else
+	{
+		asm (".arch_extension crc\n\t" CRC32_BYTE : "+r" (nCRC) : "r" (nData));
+	}
+
+	return nCRC;
+}
+
+static inline u32 CRC32Word (u32 nCRC, TCRC32Word nData, boolean bCastagnoli)
+{
+	if (bCastagnoli)
+	{
+		asm (".arch_extension crc\n\t" CRC32C_WORD : "+r" (nCRC) : "r" (nData));
+	}
+	else
+	{
+		asm (".arch_extension crc\n\t" CRC32_WORD : "+r" (nCRC) : "r" (nData));
+	}
+
+	return nCRC;
+}
+
+static inline __attribute__ ((always_inline))
+u32 UpdateHardware (u32 nCRC, const u8 *pBuffer, size_t nLength, boolean bCastagnoli)
+{
+	while (   nLength > 0
+	       && ((uintptr) pBuffer & (sizeof (TCRC32Word)-1)))
+	{
+		nCRC = CRC32Byte (nCRC, *pBuffer++, bCastagnoli);
+		nLength--;
+	}
+
+	const TCRC32Word *pWord = (const TCRC32Word *) pBuffer;
+	for (; nLength >= 4*sizeof (TCRC32Word); nLength -= 4*sizeof (TCRC32Word))
+	{
+		nCRC = CRC32Word (nCRC, *pWord++, bCastagnoli);
+		nCRC = CRC32Word (nCRC, *pWord++, bCastagnoli);
+		nCRC = CRC32Word (nCRC, *pWord++, bCastagnoli);
+		nCRC = CRC32Word (nCRC, *pWord++, bCastagnoli);
+	}
+
+	for (; nLength >= sizeof (TCRC32Word); nLength -= sizeof (TCRC32Word))
+	{
+		nCRC = CRC32Word (nCRC, *pWord++, bCastagnoli);
+	}
+
+	pBuffer = (const u8 *) pWord;
+	while (nLength--)
+	{
+		nCRC = CRC32Byte (nCRC, *pBuffer++, bCastagnoli);
+	}
+
+	return nCRC;
+}
+
+#else
+
+// slicing-by-8 tables, generated at compile time
+struct TCRC32Table
+{
+	constexpr TCRC32Table (u32 nPolynomial)		// reflected polynomial
+	:	Entry {}
+	{
+		for (unsigned i = 0; i < 256; i++)
+		{
+			u32 nCRC = i;
+			for (unsigned j = 0; j < 8; j++)
+			{
+				nCRC = (nCRC >> 1) ^ (nCRC & 1 ? nPolynomial : 0);
+			}
+
+			Entry[0][i] = nCRC;
+		}
+
+		for (unsigned i = 0; i < 256; i++)
+		{
+			for (unsigned k = 1; k < 8; k++)
+			{
+				Entry[k][i] = (Entry[k-1][i] >> 8) ^ Entry[0][Entry[k-1][i] & 0xFF];
+			}
+		}
+	}
+
+	u32 Entry[8][256];
+};
+
+static constexpr TCRC32Table s_CRC32Table[CRC32PolynomialUnknown] =
+{
+	TCRC32Table (0xEDB88320),
+	TCRC32Table (0x82F63B78)
+};
+
+static u32 UpdateSoftware (u32 nCRC, const u8 *pBuffer, size_t nLength, const TCRC32Table *pTable)
+{
+	const u32 (*T)[256] = pTable->Entry;
+
+	while (   nLength > 0
+	       && ((uintptr) pBuffer & 3))
+	{
+		nCRC = T[0][(nCRC ^ *pBuffer++) & 0xFF] ^ (nCRC >> 8);
+		nLength--;
+	}
+
+	const u32 *pWord = (const u32 *) pBuffer;
+	for (; nLength >= 8; nLength -= 8)
+	{
+		u32 nLow = *pWord++ ^ nCRC;
+		u32 nHigh = *pWord++;
+
+		nCRC =   T[7][nLow & 0xFF]  ^ T[6][(nLow >> 8) & 0xFF]
+		       ^ T[5][(nLow >> 16) & 0xFF] ^ T[4][nLow >> 24]
+		       ^ T[3][nHigh & 0xFF] ^ T[2][(nHigh >> 8) & 0xFF]
+		       ^ T[1][(nHigh >> 16) & 0xFF] ^ T[0][nHigh >> 24];
+	}
+
+	pBuffer = (const u8 *) pWord;
+	while (nLength--)
+	{
+		nCRC = T[0][(nCRC ^ *pBuffer++) & 0xFF] ^ (nCRC >> 8);
+	}
+
+	return nCRC;
+}
+
+#endif
+
+CCRC32::CCRC32 (TCRC32Polynomial Polynomial)
+:	m_Polynomial (Polynomial),
+	m_nCRC (~0U)
+{
+	assert (m_Polynomial < CRC32PolynomialUnknown);
+}
+
+void CCRC32::Reset (void)
+{
+	m_nCRC = ~0U;
+}
+
+void CCRC32::Update (const void *pBuffer, size_t nLength)
+{
+	assert (pBuffer != 0 || nLength == 0);
+
+	m_nCRC = UpdateCRC (m_nCRC, (const u8 *) pBuffer, nLength, m_Polynomial);
+}
+
+u32 CCRC32::Calculate (const void *pBuffer, size_t nLength, TCRC32Polynomial Polynomial)
+{
+	assert (pBuffer != 0 || nLength == 0);
+	assert (Polynomial < CRC32PolynomialUnknown);
+
+	return ~UpdateCRC (~0U, (const u8 *) pBuffer, nLength, Polynomial);
+}
+
+u32 CCRC32::UpdateCRC (u32 nCRC, const u8 *pBuffer, size_t nLength, TCRC32Polynomial Polynomial)
+{
+#ifdef CRC32_HARDWARE
+	if (Polynomial == CRC32PolynomialCastagnoli)
+	{
+		return UpdateHardware (nCRC, pBuffer, nLength, TRUE);
+	}
+
+	return UpdateHardware (nCRC, pBuffer, nLength, FALSE);
+#else
+	return UpdateSoftware (nCRC, pBuffer, nLength, &s_CRC32Table[Polynomial]);
+#endif
+}
+
+CAdler32::CAdler32 (void)
+:	m_nChecksum (1)
+{
+}
+
+void CAdler32::Reset (void)
+{
+	m_nChecksum = 1;
+}
+
+void CAdler32::Update (const void *pBuffer, size_t nLength)
+{
+	assert (pBuffer != 0 || nLength == 0);
+	const u8 *p = (const u8 *) pBuffer;
+
+	u32 a = m_nChecksum & 0xFFFF;
+	u32 b = m_nChecksum >> 16;
+
+	while (nLength > 0)
+	{
+		size_t nBlock = nLength < ADLER32_NMAX ? nLength : ADLER32_NMAX;
+		nLength -= nBlock;
+
+		// the modulo operation is required only once per block
+		for (; nBlock >= 4; nBlock -= 4)
+		{
+			a += *p++; b += a;
+			a += *p++; b += a;
+			a += *p++; b += a;
+			a += *p++; b += a;
+		}
+
+		while (nBlock--)
+		{
+			a += *p++; b += a;
+		}
+
+		a %= ADLER32_BASE;
+		b %= ADLER32_BASE;
+	}
+
+	m_nChecksum = b << 16 | a;
+}
+
+u32 CAdler32::Calculate (const void *pBuffer, size_t nLength)
+{
+	CAdler32 Adler32;
+	Adler32.Update (pBuffer, nLength);
+
+	return Adler32.GetResult ();
+}
+
+CFletcher32::CFletcher32 (void)
+:	m_nSum1 (0),
+	m_nSum2 (0)
+{
+}
+
+void CFletcher32::Reset (void)
+{
+	m_nSum1 = 0;
+	m_nSum2 = 0;
+}
+
+void CFletcher32::Update (const void *pBuffer, size_t nLength)
+{
+	assert (pBuffer != 0 || nLength == 0);
+	const u8 *p = (const u8 *) pBuffer;
+
+	u32 nSum1 = m_nSum1;
+	u32 nSum2 = m_nSum2;
+
+	size_t nWords = nLength / 2;
+	while (nWords > 0)
+	{
+		size_t nBlock = nWords < FLETCHER32_NMAX ? nWords : FLETCHER32_NMAX;
+		nWords -= nBlock;
+
+		while (nBlock--)
+		{
+			nSum1 += p[0] | p[1] << 8;
+			nSum2 += nSum1;
+			p += 2;
+		}
+
+		nSum1 %= FLETCHER32_BASE;
+		nSum2 %= FLETCHER32_BASE;
+	}
+
+	if (nLength & 1)
+	{
+		nSum1 = (nSum1 + *p) % FLETCHER32_BASE;
+		nSum2 = (nSum2 + nSum1) % FLETCHER32_BASE;
+	}
+
+	m_nSum1 = nSum1;
+	m_nSum2 = nSum2;
+}
+
+u32 CFletcher32::Calculate (const void *pBuffer, size_t nLength)
+{
+	CFletcher32 Fletcher32;
+	Fletcher32.Update (pBuffer, nLength);
+
+	return Fletcher32.GetResult ();
+}
@@ -508,6 +508,12 @@ void CDMA4Channel::Cancel (void)
 	assert (m_nChannel <= DMA4_CHANNEL_MAX);
 	write32 (ARM_DMA4CHAN_CS (m_nChannel), 0);
 
+	// acknowledge a pending interrupt, which must not call the routine any more
+	write32 (ARM_DMA4CHAN_CS (m_nChannel), CS4_INT);
+#if RASPPI == 4
+	write32 (ARM_DMA_INT_STATUS, 1 << m_nChannel);
+#endif
+
 	m_pCompletionRoutine = 0;
 
 	PeripheralExit ();
@@ -524,18 +530,20 @@ void CDMA4Channel::InterruptHandler (void)
 	assert (m_nChannel <= DMA4_CHANNEL_MAX);
 
 #if RASPPI == 4
-#ifndef NDEBUG
-	u32 nIntStatus = read32 (ARM_DMA_INT_STATUS);
-#endif
 	u32 nIntMask = 1 << m_nChannel;
-	assert (nIntStatus & nIntMask);
 	write32 (ARM_DMA_INT_STATUS, nIntMask);
 #endif
 
 	u32 nCS = read32 (ARM_DMA4CHAN_CS (m_nChannel));
-	assert (nCS & CS4_INT);
 	write32 (ARM_DMA4CHAN_CS (m_nChannel), nCS);
 
+	// the transfer may have been cancelled, while the interrupt was pending
+	if (   !(nCS & CS4_INT)
+	    || m_pCompletionRoutine == 0)
+	{
+		return;
+	}
+
 	m_bStatus = nCS & CS4_ERROR ? FALSE : TRUE;
 
 	assert (m_pCompletionRoutine != 0);
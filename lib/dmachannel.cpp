@@ -35,7 +35,9 @@ CDMAChannel::CDMAChannel (unsigned nChannel, CInterruptSystem *pInterruptSystem)
 	m_bIRQConnected (FALSE),
 	m_pCompletionRoutine (0),
 	m_pCompletionParam (0),
-	m_bStatus (FALSE)
+	m_bStatus (FALSE),
+	m_bCyclicRead (FALSE),
+	m_nCancelAddress (0)
 {
 #if RASPPI >= 4
 	m_pDMA4Channel = 0;
@@ -177,6 +179,7 @@ void CDMAChannel::SetupMemCopy (void *pDestination, const void *pSource, size_t
 	}
 
 	m_nBuffers = 1;
+	m_bCyclicRead = FALSE;
 }
 
 void CDMAChannel::SetupIORead (void *pDestination, uintptr ulIOAddress, size_t nLength, TDREQ DREQ)
@@ -219,6 +222,7 @@ void CDMAChannel::SetupIORead (void *pDestination, uintptr ulIOAddress, size_t n
 	CleanAndInvalidateDataCacheRange ((uintptr) pDestination, nLength);
 
 	m_nBuffers = 1;
+	m_bCyclicRead = FALSE;
 }
 
 void CDMAChannel::SetupIOWrite (uintptr ulIOAddress, const void *pSource, size_t nLength, TDREQ DREQ)
@@ -260,6 +264,7 @@ void CDMAChannel::SetupIOWrite (uintptr ulIOAddress, const void *pSource, size_t
 	CleanAndInvalidateDataCacheRange ((uintptr) pSource, nLength);
 
 	m_nBuffers = 1;
+	m_bCyclicRead = FALSE;
 }
 
 void CDMAChannel::SetupCyclicIOWrite (uintptr ulIOAddress, const void *ppSources[],
@@ -318,9 +323,87 @@ void CDMAChannel::SetupCyclicIOWrite (uintptr ulIOAddress, const void *ppSources
 	}
 
 	m_nBuffers = nBuffers;
+	m_bCyclicRead = FALSE;
 	m_nBufferLength = ulLength;
 }
 
+void CDMAChannel::SetupCyclicIORead (void *pDestination, uintptr ulIOAddress, size_t nLength,
+				     TDREQ DREQ, unsigned nBuffers)
+{
+#if RASPPI >= 4
+	assert (m_pDMA4Channel == 0);
+#endif
+
+	assert (pDestination != 0);
+	assert (1 <= nBuffers && nBuffers <= MaxCyclicBuffers);
+	assert (nLength > 0);
+	assert (nLength % (4 * nBuffers) == 0);
+
+	size_t nBufferLength = nLength / nBuffers;
+	assert (nBufferLength <= TXFR_LEN_MAX);
+	assert (   !(read32 (ARM_DMACHAN_DEBUG (m_nChannel)) & DEBUG_LITE)
+		|| nBufferLength <= TXFR_LEN_MAX_LITE);
+
+	ulIOAddress &= 0xFFFFFF;
+	assert (ulIOAddress != 0);
+	ulIOAddress += GPU_IO_BASE;
+
+	for (unsigned i = 0; i < nBuffers; i++)
+	{
+		u8 *pBuffer = (u8 *) pDestination + i * nBufferLength;
+
+		// single transfers, because the DREQ may be asserted for one word only
+		assert (m_pControlBlock[i] != 0);
+		m_pControlBlock[i]->nTransferInformation     =   (DREQ << TI_PERMAP_SHIFT)
+							       | TI_SRC_DREQ
+							       | TI_DEST_INC
+							       | TI_WAIT_RESP;
+		m_pControlBlock[i]->nSourceAddress           = ulIOAddress;
+		m_pControlBlock[i]->nDestinationAddress      = BUS_ADDRESS ((uintptr) pBuffer);
+		m_pControlBlock[i]->nTransferLength          = nBufferLength;
+		m_pControlBlock[i]->n2DModeStride            = 0;
+		m_pControlBlock[i]->nNextControlBlockAddress =
+			BUS_ADDRESS ((uintptr) m_pControlBlock[i == nBuffers-1 ? 0 : i+1]);
+
+		m_pBuffer[i] = pBuffer;
+	}
+
+	// the cache is maintained by the caller
+	m_nDestinationAddress = 0;
+
+	CleanAndInvalidateDataCacheRange ((uintptr) pDestination, nLength);
+
+	m_nBufferLength = nBufferLength;
+
+	m_nBuffers = nBuffers;
+	m_bCyclicRead = TRUE;
+}
+
+size_t CDMAChannel::GetCyclicReadPosition (void) const
+{
+#if RASPPI >= 4
+	assert (m_pDMA4Channel == 0);
+#endif
+
+	assert (m_bCyclicRead);
+	assert (m_nChannel < DMA_CHANNELS);
+
+	PeripheralEntry ();
+
+	u32 nAddress = m_nCancelAddress;
+	if (nAddress == 0)
+	{
+		nAddress = read32 (ARM_DMACHAN_DEST_AD (m_nChannel));
+	}
+
+	PeripheralExit ();
+
+	size_t nPosition = nAddress - BUS_ADDRESS ((uintptr) m_pBuffer[0]);
+
+	// the address is at the end of the buffer, before the control block is reloaded
+	return nPosition < m_nBuffers * m_nBufferLength ? nPosition : 0;
+}
+
 void CDMAChannel::SetupMemCopy2D (void *pDestination, const void *pSource,
 				  size_t nBlockLength, unsigned nBlockCount, size_t nBlockStride,
 				  unsigned nBurstLength)
@@ -366,6 +449,7 @@ void CDMAChannel::SetupMemCopy2D (void *pDestination, const void *pSource,
 	CleanAndInvalidateDataCacheRange ((uintptr) pSource, nBlockLength*nBlockCount);
 
 	m_nBuffers = 1;
+	m_bCyclicRead = FALSE;
 }
 
 void CDMAChannel::SetCompletionRoutine (TDMACompletionRoutine *pRoutine, void *pParam)
@@ -428,6 +512,7 @@ void CDMAChannel::Start (void)
 	assert (!(read32 (ARM_DMA_INT_STATUS) & (1 << m_nChannel)));
 
 	m_nCurrentBuffer = 0;
+	m_nCancelAddress = 0;
 	write32 (ARM_DMACHAN_CONBLK_AD (m_nChannel), BUS_ADDRESS ((uintptr) m_pControlBlock[0]));
 
 	write32 (ARM_DMACHAN_CS (m_nChannel),   CS_WAIT_FOR_OUTSTANDING_WRITES
@@ -438,6 +523,63 @@ void CDMAChannel::Start (void)
 	PeripheralExit ();
 }
 
+void CDMAChannel::StartCyclicRead (size_t nOffset)
+{
+#if RASPPI >= 4
+	assert (m_pDMA4Channel == 0);
+#endif
+
+	assert (m_bCyclicRead);
+	assert (m_nBuffers == 1);
+	assert (nOffset < m_nBufferLength);
+	assert (nOffset % 4 == 0);
+
+	if (nOffset == 0)
+	{
+		Start ();
+
+		return;
+	}
+
+	// a spare control block transfers the rest of the first pass,
+	// the control block for the whole ring buffer follows then
+	TDMAControlBlock *pFirst = m_pControlBlock[1];
+	assert (pFirst != 0);
+	assert (m_pControlBlock[0] != 0);
+	*pFirst = *m_pControlBlock[0];
+
+	pFirst->nDestinationAddress      += nOffset;
+	pFirst->nTransferLength          -= nOffset;
+	pFirst->nNextControlBlockAddress  = BUS_ADDRESS ((uintptr) m_pControlBlock[0]);
+
+	if (m_pCompletionRoutine != 0)
+	{
+		assert (m_pInterruptSystem != 0);
+		assert (m_bIRQConnected);
+		m_pControlBlock[0]->nTransferInformation |= TI_INTEN;
+		pFirst->nTransferInformation |= TI_INTEN;
+	}
+
+	CleanAndInvalidateDataCacheRange ((uintptr) m_pControlBlock[0], sizeof *m_pControlBlock[0]);
+	CleanAndInvalidateDataCacheRange ((uintptr) pFirst, sizeof *pFirst);
+
+	PeripheralEntry ();
+
+	assert (m_nChannel < DMA_CHANNELS);
+	assert (!(read32 (ARM_DMACHAN_CS (m_nChannel)) & (CS_INT | CS_ACTIVE)));
+
+	m_nCurrentBuffer = 0;
+	m_nCancelAddress = 0;
+	write32 (ARM_DMACHAN_CONBLK_AD (m_nChannel), BUS_ADDRESS ((uintptr) pFirst));
+
+	write32 (ARM_DMACHAN_CS (m_nChannel),   CS_WAIT_FOR_OUTSTANDING_WRITES
+					      | (DEFAULT_PANIC_PRIORITY << CS_PANIC_PRIORITY_SHIFT)
+					      | (DEFAULT_PRIORITY << CS_PRIORITY_SHIFT)
+					      | CS_ACTIVE);
+
+	PeripheralExit ();
+}
+
 boolean CDMAChannel::Wait (void)
 {
 #if RASPPI >= 4
@@ -499,7 +641,30 @@ void CDMAChannel::Cancel (void)
 	PeripheralEntry ();
 
 	assert (m_nChannel < DMA_CHANNELS);
+
+	// pause the channel and let it complete the current write
 	write32 (ARM_DMACHAN_CS (m_nChannel), 0);
+	for (unsigned nTimeout = 10000; nTimeout > 0; nTimeout--)
+	{
+		if (!(read32 (ARM_DMACHAN_CS (m_nChannel)) & CS_WAITING_FOR_WRITES))
+		{
+			break;
+		}
+	}
+
+	// the position is needed to continue a cyclic read, but may be lost on reset
+	m_nCancelAddress = read32 (ARM_DMACHAN_DEST_AD (m_nChannel));
+
+	// a paused channel would resume its old control block, when it is activated again
+	write32 (ARM_DMACHAN_CS (m_nChannel), CS_RESET);
+	while (read32 (ARM_DMACHAN_CS (m_nChannel)) & CS_RESET)
+	{
+		// do nothing
+	}
+
+	// acknowledge a pending interrupt, which must not call the routine any more
+	write32 (ARM_DMACHAN_CS (m_nChannel), CS_INT);
+	write32 (ARM_DMA_INT_STATUS, 1 << m_nChannel);
 
 	m_pCompletionRoutine = 0;
 
@@ -517,29 +682,41 @@ void CDMAChannel::InterruptHandler (void)
 
 	assert (m_nChannel < DMA_CHANNELS);
 
-#ifndef NDEBUG
-	u32 nIntStatus = read32 (ARM_DMA_INT_STATUS);
-#endif
 	u32 nIntMask = 1 << m_nChannel;
-	assert (nIntStatus & nIntMask);
 	write32 (ARM_DMA_INT_STATUS, nIntMask);
 
 	u32 nCS = read32 (ARM_DMACHAN_CS (m_nChannel));
-	assert (nCS & CS_INT);
 	write32 (ARM_DMACHAN_CS (m_nChannel), nCS);
 
 	PeripheralExit ();
 
+	// the transfer may have been cancelled, while the interrupt was pending
+	if (   !(nCS & CS_INT)
+	    || m_pCompletionRoutine == 0)
+	{
+		return;
+	}
+
 	m_bStatus = nCS & CS_ERROR ? FALSE : TRUE;
 
 	assert (m_pCompletionRoutine != 0);
 	TDMACompletionRoutine *pCompletionRoutine = m_pCompletionRoutine;
-	if (m_nBuffers == 1)
+	if (   m_nBuffers == 1
+	    && !m_bCyclicRead)
 	{
 		m_pCompletionRoutine = 0;
 	}
 
 	assert (m_nCurrentBuffer < MaxCyclicBuffers);
+
+	// discard stale cache lines of the part, which has just been filled
+	if (   m_bStatus
+	    && m_bCyclicRead)
+	{
+		CleanAndInvalidateDataCacheRange ((uintptr) m_pBuffer[m_nCurrentBuffer],
+						  m_nBufferLength);
+	}
+
 	(*pCompletionRoutine) (m_nChannel, m_nCurrentBuffer, m_bStatus, m_pCompletionParam);
 
 	if (   m_bStatus
@@ -547,8 +724,11 @@ void CDMAChannel::InterruptHandler (void)
 	{
 		assert (m_nCurrentBuffer < m_nBuffers);
 
-		CleanAndInvalidateDataCacheRange ((uintptr) m_pBuffer[m_nCurrentBuffer],
-						  m_nBufferLength);
+		if (!m_bCyclicRead)
+		{
+			CleanAndInvalidateDataCacheRange ((uintptr) m_pBuffer[m_nCurrentBuffer],
+							  m_nBufferLength);
+		}
 
 		if (++m_nCurrentBuffer == m_nBuffers)
 		{
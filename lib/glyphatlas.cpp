@@ -0,0 +1,330 @@
+//
+// glyphatlas.cpp
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <circle/glyphatlas.h>
+#include <circle/util.h>
+#include <assert.h>
+
+#define SUPERSAMPLE	4		// two EPX passes
+
+CGlyphAtlas::CGlyphAtlas (const TFont &rFont, CCharGenerator::TFontFlags Flags)
+:	m_rFont (rFont),
+	m_Flags (Flags),
+	m_nCharWidth (0),
+	m_nGlyphHeight (0),
+	m_nGlyphs (0),
+	m_pLineStart (nullptr),
+	m_pRuns (nullptr),
+	m_pAlphaMask (nullptr),
+	m_pEmptyLine (nullptr)
+{
+}
+
+CGlyphAtlas::~CGlyphAtlas (void)
+{
+	delete [] m_pEmptyLine;
+	m_pEmptyLine = nullptr;
+
+	delete [] m_pAlphaMask;
+	m_pAlphaMask = nullptr;
+
+	delete [] m_pRuns;
+	m_pRuns = nullptr;
+
+	delete [] m_pLineStart;
+	m_pLineStart = nullptr;
+}
+
+boolean CGlyphAtlas::Initialize (void)
+{
+	CCharGenerator CharGen (m_rFont, m_Flags);
+
+	m_nCharWidth = CharGen.GetCharWidth ();
+	m_nGlyphHeight = CharGen.GetUnderline ();
+	assert (m_nCharWidth <= 255);
+
+	assert (m_rFont.last_char >= m_rFont.first_char);
+	m_nGlyphs = m_rFont.last_char - m_rFont.first_char + 1;
+
+	unsigned nLines = m_nGlyphs * m_nGlyphHeight;
+	assert (!m_pLineStart);
+	m_pLineStart = new unsigned[nLines + 1];
+	if (!m_pLineStart)
+	{
+		return FALSE;
+	}
+
+	// first pass: count the runs
+	unsigned nRuns = 0;
+	for (unsigned nGlyph = 0; nGlyph < m_nGlyphs; nGlyph++)
+	{
+		char chAscii = (char) (m_rFont.first_char + nGlyph);
+
+		for (unsigned y = 0; y < m_nGlyphHeight; y++)
+		{
+			m_pLineStart[nGlyph * m_nGlyphHeight + y] = nRuns;
+
+			CCharGenerator::TPixelLine Line = CharGen.GetPixelLine (chAscii, y);
+
+			boolean bPrevious = FALSE;
+			for (unsigned x = 0; x < m_nCharWidth; x++)
+			{
+				boolean bPixel = CharGen.GetPixel (x, Line);
+				if (   bPixel
+				    && !bPrevious)
+				{
+					nRuns++;
+				}
+
+				bPrevious = bPixel;
+			}
+		}
+	}
+
+	m_pLineStart[nLines] = nRuns;
+
+	// second pass: fill in the runs
+	assert (!m_pRuns);
+	m_pRuns = new TRun[nRuns ? nRuns : 1];
+	if (!m_pRuns)
+	{
+		return FALSE;
+	}
+
+	TRun *pRun = m_pRuns;
+	for (unsigned nGlyph = 0; nGlyph < m_nGlyphs; nGlyph++)
+	{
+		char chAscii = (char) (m_rFont.first_char + nGlyph);
+
+		for (unsigned y = 0; y < m_nGlyphHeight; y++)
+		{
+			CCharGenerator::TPixelLine Line = CharGen.GetPixelLine (chAscii, y);
+
+			for (unsigned x = 0; x < m_nCharWidth;)
+			{
+				if (!CharGen.GetPixel (x, Line))
+				{
+					x++;
+
+					continue;
+				}
+
+				unsigned nStart = x;
+				while (   x < m_nCharWidth
+				       && CharGen.GetPixel (x, Line))
+				{
+					x++;
+				}
+
+				pRun->Start = nStart;
+				pRun->Length = x - nStart;
+				pRun++;
+			}
+		}
+	}
+
+	assert (pRun == m_pRuns + nRuns);
+
+	if (m_Flags & CCharGenerator::FontFlagsAntiAlias)
+	{
+		return BuildAlphaMasks ();
+	}
+
+	return TRUE;
+}
+
+boolean CGlyphAtlas::IsFor (const TFont &rFont, CCharGenerator::TFontFlags Flags) const
+{
+	return &m_rFont == &rFont && m_Flags == Flags;
+}
+
+boolean CGlyphAtlas::IsAntiAliased (void) const
+{
+	return !!m_pAlphaMask;
+}
+
+unsigned CGlyphAtlas::GetCharWidth (void) const
+{
+	return m_nCharWidth;
+}
+
+unsigned CGlyphAtlas::GetGlyphHeight (void) const
+{
+	return m_nGlyphHeight;
+}
+
+const CGlyphAtlas::TRun *CGlyphAtlas::GetRuns (char chAscii, unsigned nPosY, unsigned *pnRuns) const
+{
+	assert (pnRuns);
+	assert (m_pLineStart);
+	assert (m_pRuns);
+
+	unsigned nIndex = GetLineIndex (chAscii, nPosY);
+	if (nIndex >= m_nGlyphs * m_nGlyphHeight)
+	{
+		*pnRuns = 0;
+
+		return m_pRuns;
+	}
+
+	*pnRuns = m_pLineStart[nIndex+1] - m_pLineStart[nIndex];
+
+	return &m_pRuns[m_pLineStart[nIndex]];
+}
+
+const u8 *CGlyphAtlas::GetAlphaLine (char chAscii, unsigned nPosY) const
+{
+	assert (m_pAlphaMask);
+	assert (m_pEmptyLine);
+
+	unsigned nIndex = GetLineIndex (chAscii, nPosY);
+	if (nIndex >= m_nGlyphs * m_nGlyphHeight)
+	{
+		return m_pEmptyLine;
+	}
+
+	return &m_pAlphaMask[nIndex * m_nCharWidth];
+}
+
+unsigned CGlyphAtlas::GetLineIndex (char chAscii, unsigned nPosY) const
+{
+	unsigned nAscii = (u8) chAscii;
+	if (   nAscii < m_rFont.first_char
+	    || nAscii > m_rFont.last_char
+	    || nPosY >= m_nGlyphHeight)
+	{
+		return m_nGlyphs * m_nGlyphHeight;
+	}
+
+	return (nAscii - m_rFont.first_char) * m_nGlyphHeight + nPosY;
+}
+
+// EPX (Scale2x) upscaling of a binary image to twice the size
+static void ScaleEPX (const u8 *pFrom, unsigned nWidth, unsigned nHeight, u8 *pTo)
+{
+	unsigned nPitch = nWidth * 2;
+
+	for (unsigned y = 0; y < nHeight; y++)
+	{
+		for (unsigned x = 0; x < nWidth; x++)
+		{
+			const u8 *p = &pFrom[y * nWidth + x];
+
+			u8 P = *p;
+			u8 A = y > 0         ? p[-(int) nWidth] : 0;	// above
+			u8 B = x < nWidth-1  ? p[1]             : 0;	// right
+			u8 C = x > 0         ? p[-1]            : 0;	// left
+			u8 D = y < nHeight-1 ? p[nWidth]        : 0;	// below
+
+			u8 *q = &pTo[y*2 * nPitch + x*2];
+			q[0]          = C == A && C != D && A != B ? A : P;
+			q[1]          = A == B && A != C && B != D ? B : P;
+			q[nPitch]     = D == C && D != B && C != A ? C : P;
+			q[nPitch + 1] = B == D && B != A && D != C ? D : P;
+		}
+	}
+}
+
+boolean CGlyphAtlas::BuildAlphaMasks (void)
+{
+	// the smoothing is done on the original bitmap
+	CCharGenerator CharGen (m_rFont);
+
+	unsigned nWidth = CharGen.GetCharWidth ();
+	unsigned nHeight = CharGen.GetUnderline ();
+	assert (m_nCharWidth % nWidth == 0);
+	assert (m_nGlyphHeight % nHeight == 0);
+
+	// size of a destination pixel in the supersampled image
+	unsigned nBlockX = SUPERSAMPLE / (m_nCharWidth / nWidth);
+	unsigned nBlockY = SUPERSAMPLE / (m_nGlyphHeight / nHeight);
+	unsigned nBlockArea = nBlockX * nBlockY;
+
+	unsigned nPitch = nWidth * SUPERSAMPLE;
+
+	u8 *pBitmap = new u8[nWidth * nHeight];
+	u8 *pScaled2 = new u8[nWidth * nHeight * 4];
+	u8 *pScaled4 = new u8[nWidth * nHeight * SUPERSAMPLE * SUPERSAMPLE];
+
+	assert (!m_pAlphaMask);
+	m_pAlphaMask = new u8[m_nGlyphs * m_nGlyphHeight * m_nCharWidth];
+
+	assert (!m_pEmptyLine);
+	m_pEmptyLine = new u8[m_nCharWidth];
+
+	if (   !pBitmap
+	    || !pScaled2
+	    || !pScaled4
+	    || !m_pAlphaMask
+	    || !m_pEmptyLine)
+	{
+		delete [] pScaled4;
+		delete [] pScaled2;
+		delete [] pBitmap;
+
+		return FALSE;
+	}
+
+	memset (m_pEmptyLine, 0, m_nCharWidth);
+
+	u8 *pMask = m_pAlphaMask;
+	for (unsigned nGlyph = 0; nGlyph < m_nGlyphs; nGlyph++)
+	{
+		char chAscii = (char) (m_rFont.first_char + nGlyph);
+
+		for (unsigned y = 0; y < nHeight; y++)
+		{
+			CCharGenerator::TPixelLine Line = CharGen.GetPixelLine (chAscii, y);
+
+			for (unsigned x = 0; x < nWidth; x++)
+			{
+				pBitmap[y * nWidth + x] = CharGen.GetPixel (x, Line);
+			}
+		}
+
+		ScaleEPX (pBitmap, nWidth, nHeight, pScaled2);
+		ScaleEPX (pScaled2, nWidth * 2, nHeight * 2, pScaled4);
+
+		// box filter down to the glyph size
+		for (unsigned y = 0; y < m_nGlyphHeight; y++)
+		{
+			for (unsigned x = 0; x < m_nCharWidth; x++)
+			{
+				const u8 *pBlock = &pScaled4[y * nBlockY * nPitch + x * nBlockX];
+
+				unsigned nSum = 0;
+				for (unsigned i = 0; i < nBlockY; i++, pBlock += nPitch)
+				{
+					for (unsigned j = 0; j < nBlockX; j++)
+					{
+						nSum += pBlock[j];
+					}
+				}
+
+				*pMask++ = nSum * 255 / nBlockArea;
+			}
+		}
+	}
+
+	delete [] pScaled4;
+	delete [] pScaled2;
+	delete [] pBitmap;
+
+	return TRUE;
+}
@@ -0,0 +1,492 @@
+//
+// gpiowaveform.cpp
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <circle/gpiowaveform.h>
+#include <circle/bcm2835.h>
+#include <circle/bcm2835int.h>
+#include <circle/memio.h>
+#include <circle/timer.h>
+#include <circle/synchronize.h>
+#include <circle/machineinfo.h>
+#include <circle/new.h>
+#include <assert.h>
+
+//
+// PWM device selection
+//
+#if RASPPI <= 3
+	#define CLOCK_RATE	250000000
+	#define PWM_BASE	ARM_PWM_BASE
+	#define DREQ_SOURCE	DREQSourcePWM
+#else
+	#define CLOCK_RATE	125000000
+	#define PWM_BASE	ARM_PWM1_BASE
+	#define DREQ_SOURCE	DREQSourcePWM1
+#endif
+
+//
+// PWM registers
+//
+#define PWM_CTL			(PWM_BASE + 0x00)
+#define PWM_STA			(PWM_BASE + 0x04)
+#define PWM_DMAC		(PWM_BASE + 0x08)
+#define PWM_RNG1		(PWM_BASE + 0x10)
+#define PWM_FIF1		(PWM_BASE + 0x18)
+
+#define ARM_PWM_CTL_PWEN1	(1 << 0)
+#define ARM_PWM_CTL_USEF1	(1 << 5)
+#define ARM_PWM_CTL_CLRF1	(1 << 6)
+
+#define ARM_PWM_STA_FULL1	(1 << 0)
+
+#define ARM_PWM_DMAC_DREQ__SHIFT	0
+#define ARM_PWM_DMAC_PANIC__SHIFT	8
+#define ARM_PWM_DMAC_ENAB		(1 << 31)
+
+#define PWM_DREQ_THRESHOLD	7
+
+//
+// Control blocks per sample
+//
+#define CB_PACE			0
+#define CB_OUTPUT		1
+#define CB_CAPTURE		2
+#define CB_PER_SAMPLE		3
+
+#define CB(sample, type)	(&m_pControlBlock[(sample)*CB_PER_SAMPLE + (type)])
+
+#define IO_BUS_ADDRESS(addr)	(((addr) & 0xFFFFFF) + GPU_IO_BASE)
+
+CGPIOWaveform::CGPIOWaveform (unsigned nSampleRate, unsigned nMaxSamples,
+			      CInterruptSystem *pInterruptSystem)
+:	m_nMaxSamples (nMaxSamples),
+	m_pInterruptSystem (pInterruptSystem),
+	m_nRange ((CLOCK_RATE + nSampleRate/2) / nSampleRate),
+	m_Clock (GPIOClockPWM),
+	m_nDMAChannel (CMachineInfo::Get ()->AllocateDMAChannel (DMA_CHANNEL_NORMAL)),
+	m_bIRQConnected (FALSE),
+	m_pControlBlock (0),
+	m_pCaptureBuffer (0),
+	m_nSamples (0),
+	m_pCompletionRoutine (0),
+	m_pCompletionParam (0)
+{
+}
+
+CGPIOWaveform::~CGPIOWaveform (void)
+{
+	if (m_nDMAChannel == DMA_CHANNEL_NONE)
+	{
+		return;
+	}
+
+	// reset and disable DMA channel
+	PeripheralEntry ();
+
+	assert (m_nDMAChannel <= DMA_CHANNEL_MAX);
+
+	write32 (ARM_DMACHAN_CS (m_nDMAChannel), CS_RESET);
+	while (read32 (ARM_DMACHAN_CS (m_nDMAChannel)) & CS_RESET)
+	{
+		// do nothing
+	}
+
+	write32 (ARM_DMA_ENABLE, read32 (ARM_DMA_ENABLE) & ~(1 << m_nDMAChannel));
+
+	PeripheralExit ();
+
+	if (m_pControlBlock != 0)
+	{
+		StopPWM ();
+	}
+
+	if (m_bIRQConnected)
+	{
+		assert (m_pInterruptSystem != 0);
+		m_pInterruptSystem->DisconnectIRQ (ARM_IRQ_DMA0+m_nDMAChannel);
+	}
+
+	m_pInterruptSystem = 0;
+
+	CMachineInfo::Get ()->FreeDMAChannel (m_nDMAChannel);
+
+	delete [] m_pCaptureBuffer;
+	m_pCaptureBuffer = 0;
+
+	delete [] m_pControlBlock;
+	m_pControlBlock = 0;
+}
+
+boolean CGPIOWaveform::Initialize (void)
+{
+	if (m_nDMAChannel == DMA_CHANNEL_NONE)
+	{
+		return FALSE;
+	}
+
+	assert (m_nMaxSamples > 0);
+	assert (2 <= m_nRange);
+
+	// control blocks are 32-byte aligned, because heap blocks are cache-line aligned
+	assert (m_pControlBlock == 0);
+	m_pControlBlock = new (HEAP_DMA30) TDMAControlBlock[m_nMaxSamples * CB_PER_SAMPLE];
+
+	assert (m_pCaptureBuffer == 0);
+	m_pCaptureBuffer = new (HEAP_DMA30) u32[m_nMaxSamples];
+
+	if (   m_pControlBlock == 0
+	    || m_pCaptureBuffer == 0)
+	{
+		return FALSE;
+	}
+
+	assert (((uintptr) m_pControlBlock & 31) == 0);
+
+	for (unsigned i = 0; i < m_nMaxSamples; i++)
+	{
+		// wait until the PWM FIFO accepts a (dummy) word
+		TDMAControlBlock *pCB = CB (i, CB_PACE);
+		pCB->nTransferInformation     =   (DREQ_SOURCE << TI_PERMAP_SHIFT)
+						| TI_DEST_DREQ
+						| TI_WAIT_RESP;
+		pCB->nSourceAddress           = BUS_ADDRESS ((uintptr) &pCB->nReserved[0]);
+		pCB->nDestinationAddress      = IO_BUS_ADDRESS (PWM_FIF1);
+		pCB->nTransferLength          = sizeof (u32);
+		pCB->n2DModeStride            = 0;
+		pCB->nNextControlBlockAddress = 0;
+		pCB->nReserved[0]             = 0;
+		pCB->nReserved[1]             = 0;
+
+		// write the set and clear masks from the reserved words to GPSET0 and GPCLR0
+		pCB = CB (i, CB_OUTPUT);
+		pCB->nTransferInformation     =   TI_SRC_INC
+						| TI_DEST_INC
+						| TI_TDMODE
+						| TI_WAIT_RESP;
+		pCB->nSourceAddress           = BUS_ADDRESS ((uintptr) &pCB->nReserved[0]);
+		pCB->nDestinationAddress      = IO_BUS_ADDRESS (ARM_GPIO_GPSET0);
+		pCB->nTransferLength          =   (1 << TXFR_LEN_YLENGTH_SHIFT)
+						| (sizeof (u32) << TXFR_LEN_XLENGTH_SHIFT);
+		pCB->n2DModeStride            =   (ARM_GPIO_GPCLR0 - ARM_GPIO_GPSET0 - sizeof (u32))
+						<< STRIDE_DEST_SHIFT;
+		pCB->nNextControlBlockAddress = 0;
+		pCB->nReserved[0]             = 0;
+		pCB->nReserved[1]             = 0;
+
+		// read GPLEV0 into the capture buffer
+		pCB = CB (i, CB_CAPTURE);
+		pCB->nTransferInformation     =   TI_DEST_INC
+						| TI_WAIT_RESP;
+		pCB->nSourceAddress           = IO_BUS_ADDRESS (ARM_GPIO_GPLEV0);
+		pCB->nDestinationAddress      = BUS_ADDRESS ((uintptr) &m_pCaptureBuffer[i]);
+		pCB->nTransferLength          = sizeof (u32);
+		pCB->n2DModeStride            = 0;
+		pCB->nNextControlBlockAddress = 0;
+		pCB->nReserved[0]             = 0;
+		pCB->nReserved[1]             = 0;
+	}
+
+	// enable and reset DMA channel
+	PeripheralEntry ();
+
+	assert (m_nDMAChannel <= DMA_CHANNEL_MAX);
+	write32 (ARM_DMA_ENABLE, read32 (ARM_DMA_ENABLE) | (1 << m_nDMAChannel));
+	CTimer::SimpleusDelay (1000);
+
+	write32 (ARM_DMACHAN_CS (m_nDMAChannel), CS_RESET);
+	while (read32 (ARM_DMACHAN_CS (m_nDMAChannel)) & CS_RESET)
+	{
+		// do nothing
+	}
+
+	PeripheralExit ();
+
+	RunPWM ();
+
+	return TRUE;
+}
+
+void CGPIOWaveform::SetSample (unsigned nSample, u32 nSetMask, u32 nClearMask)
+{
+	assert (m_pControlBlock != 0);
+	assert (nSample < m_nMaxSamples);
+
+	TDMAControlBlock *pCB = CB (nSample, CB_OUTPUT);
+	pCB->nReserved[0] = nSetMask;
+	pCB->nReserved[1] = nClearMask;
+
+	CleanAndInvalidateDataCacheRange ((uintptr) pCB, sizeof *pCB);
+}
+
+void CGPIOWaveform::SetCompletionRoutine (TCompletionRoutine *pRoutine, void *pParam)
+{
+	assert (!IsActive ());
+
+	if (   pRoutine != 0
+	    && !m_bIRQConnected)
+	{
+		assert (m_pInterruptSystem != 0);
+		assert (m_nDMAChannel <= DMA_CHANNEL_MAX);
+		m_pInterruptSystem->ConnectIRQ (ARM_IRQ_DMA0+m_nDMAChannel, InterruptStub, this);
+
+		m_bIRQConnected = TRUE;
+	}
+
+	m_pCompletionParam = pParam;
+	m_pCompletionRoutine = pRoutine;
+}
+
+boolean CGPIOWaveform::Start (unsigned nSamples, unsigned nFlags)
+{
+	assert (m_pControlBlock != 0);
+	assert (!IsActive ());
+
+	if (   nSamples == 0
+	    || nSamples > m_nMaxSamples
+	    || !(nFlags & (GPIO_WAVEFORM_OUTPUT | GPIO_WAVEFORM_CAPTURE)))
+	{
+		return FALSE;
+	}
+
+	m_nSamples = nSamples;
+
+	// chain the control blocks of the used sample types
+	for (unsigned i = 0; i < nSamples; i++)
+	{
+		CB (i, CB_PACE)->nTransferInformation &= ~TI_INTEN;
+		CB (i, CB_OUTPUT)->nTransferInformation &= ~TI_INTEN;
+		CB (i, CB_CAPTURE)->nTransferInformation &= ~TI_INTEN;
+
+		TDMAControlBlock *pLast = CB (i, CB_PACE);
+
+		if (nFlags & GPIO_WAVEFORM_OUTPUT)
+		{
+			pLast->nNextControlBlockAddress = BUS_ADDRESS ((uintptr) CB (i, CB_OUTPUT));
+			pLast = CB (i, CB_OUTPUT);
+		}
+
+		if (nFlags & GPIO_WAVEFORM_CAPTURE)
+		{
+			pLast->nNextControlBlockAddress = BUS_ADDRESS ((uintptr) CB (i, CB_CAPTURE));
+			pLast = CB (i, CB_CAPTURE);
+		}
+
+		if (i < nSamples-1)
+		{
+			pLast->nNextControlBlockAddress = BUS_ADDRESS ((uintptr) CB (i+1, CB_PACE));
+		}
+		else
+		{
+			pLast->nNextControlBlockAddress =   nFlags & GPIO_WAVEFORM_CYCLIC
+							  ? BUS_ADDRESS ((uintptr) CB (0, CB_PACE)) : 0;
+
+			if (m_pCompletionRoutine != 0)
+			{
+				pLast->nTransferInformation |= TI_INTEN;
+			}
+		}
+	}
+
+	CleanAndInvalidateDataCacheRange ((uintptr) m_pControlBlock,
+					  nSamples * CB_PER_SAMPLE * sizeof (TDMAControlBlock));
+	CleanAndInvalidateDataCacheRange ((uintptr) m_pCaptureBuffer, nSamples * sizeof (u32));
+
+	PeripheralEntry ();
+
+	// Fill the PWM FIFO, so that the first samples are not sent at once,
+	// but with the same distance as the following samples.
+	write32 (PWM_CTL, read32 (PWM_CTL) | ARM_PWM_CTL_CLRF1);
+	while (!(read32 (PWM_STA) & ARM_PWM_STA_FULL1))
+	{
+		write32 (PWM_FIF1, 0);
+	}
+
+	assert (!(read32 (ARM_DMACHAN_CS (m_nDMAChannel)) & CS_INT));
+	assert (!(read32 (ARM_DMA_INT_STATUS) & (1 << m_nDMAChannel)));
+
+	write32 (ARM_DMACHAN_CONBLK_AD (m_nDMAChannel), BUS_ADDRESS ((uintptr) CB (0, CB_PACE)));
+
+	write32 (ARM_DMACHAN_CS (m_nDMAChannel),   CS_WAIT_FOR_OUTSTANDING_WRITES
+					         | (DEFAULT_PANIC_PRIORITY << CS_PANIC_PRIORITY_SHIFT)
+					         | (DEFAULT_PRIORITY << CS_PRIORITY_SHIFT)
+					         | CS_ACTIVE);
+
+	PeripheralExit ();
+
+	return TRUE;
+}
+
+void CGPIOWaveform::Stop (void)
+{
+	PeripheralEntry ();
+
+	assert (m_nDMAChannel <= DMA_CHANNEL_MAX);
+	write32 (ARM_DMACHAN_CS (m_nDMAChannel), CS_RESET);
+	while (read32 (ARM_DMACHAN_CS (m_nDMAChannel)) & CS_RESET)
+	{
+		// do nothing
+	}
+
+	// the interrupt may have been triggered before
+	write32 (ARM_DMA_INT_STATUS, 1 << m_nDMAChannel);
+
+	PeripheralExit ();
+}
+
+boolean CGPIOWaveform::IsActive (void) const
+{
+	if (m_nDMAChannel == DMA_CHANNEL_NONE)
+	{
+		return FALSE;
+	}
+
+	PeripheralEntry ();
+
+	assert (m_nDMAChannel <= DMA_CHANNEL_MAX);
+	u32 nCS = read32 (ARM_DMACHAN_CS (m_nDMAChannel));
+
+	PeripheralExit ();
+
+	return !!(nCS & CS_ACTIVE);
+}
+
+unsigned CGPIOWaveform::GetPosition (void) const
+{
+	assert (m_pControlBlock != 0);
+
+	PeripheralEntry ();
+
+	assert (m_nDMAChannel <= DMA_CHANNEL_MAX);
+	u32 nAddress = read32 (ARM_DMACHAN_CONBLK_AD (m_nDMAChannel));
+
+	PeripheralExit ();
+
+	if (nAddress == 0)
+	{
+		return m_nSamples;
+	}
+
+	unsigned nPosition =   (nAddress - BUS_ADDRESS ((uintptr) m_pControlBlock))
+			     / (CB_PER_SAMPLE * sizeof (TDMAControlBlock));
+
+	return nPosition < m_nSamples ? nPosition : m_nSamples;
+}
+
+void CGPIOWaveform::ReadCapture (unsigned nStart, unsigned nCount, u32 *pBuffer) const
+{
+	assert (m_pCaptureBuffer != 0);
+	assert (m_nSamples > 0);
+	assert (nStart < m_nSamples);
+	assert (nCount <= m_nSamples);
+	assert (pBuffer != 0);
+
+	while (nCount > 0)
+	{
+		unsigned nChunk = m_nSamples - nStart;
+		if (nChunk > nCount)
+		{
+			nChunk = nCount;
+		}
+
+		// the capture buffer is never written by the CPU, so the clean does nothing
+		CleanAndInvalidateDataCacheRange ((uintptr) &m_pCaptureBuffer[nStart],
+						  nChunk * sizeof (u32));
+
+		for (unsigned i = 0; i < nChunk; i++)
+		{
+			*pBuffer++ = m_pCaptureBuffer[nStart + i];
+		}
+
+		nStart = 0;
+		nCount -= nChunk;
+	}
+}
+
+void CGPIOWaveform::RunPWM (void)
+{
+	PeripheralEntry ();
+
+#ifndef NDEBUG
+	boolean bOK =
+#endif
+		m_Clock.StartRate (CLOCK_RATE);
+	assert (bOK);
+	CTimer::SimpleusDelay (2000);
+
+	// the PWM output is not connected to a pin, one FIFO word is consumed per range
+	write32 (PWM_RNG1, m_nRange);
+
+	write32 (PWM_CTL, ARM_PWM_CTL_PWEN1 | ARM_PWM_CTL_USEF1 | ARM_PWM_CTL_CLRF1);
+	CTimer::SimpleusDelay (2000);
+
+	write32 (PWM_DMAC,   ARM_PWM_DMAC_ENAB
+			   | (PWM_DREQ_THRESHOLD << ARM_PWM_DMAC_PANIC__SHIFT)
+			   | (PWM_DREQ_THRESHOLD << ARM_PWM_DMAC_DREQ__SHIFT));
+
+	PeripheralExit ();
+}
+
+void CGPIOWaveform::StopPWM (void)
+{
+	PeripheralEntry ();
+
+	write32 (PWM_DMAC, 0);
+	write32 (PWM_CTL, 0);
+	CTimer::SimpleusDelay (2000);
+
+	m_Clock.Stop ();
+	CTimer::SimpleusDelay (2000);
+
+	PeripheralExit ();
+}
+
+void CGPIOWaveform::InterruptHandler (void)
+{
+	assert (m_nDMAChannel <= DMA_CHANNEL_MAX);
+
+	PeripheralEntry ();
+
+	u32 nIntMask = 1 << m_nDMAChannel;
+	if (!(read32 (ARM_DMA_INT_STATUS) & nIntMask))
+	{
+		PeripheralExit ();
+
+		return;			// has been cleared by Stop()
+	}
+	write32 (ARM_DMA_INT_STATUS, nIntMask);
+
+	u32 nCS = read32 (ARM_DMACHAN_CS (m_nDMAChannel));
+	write32 (ARM_DMACHAN_CS (m_nDMAChannel), nCS);	// reset CS_INT
+
+	PeripheralExit ();
+
+	TCompletionRoutine *pRoutine = m_pCompletionRoutine;
+	if (pRoutine != 0)
+	{
+		(*pRoutine) (!(nCS & CS_ERROR), m_pCompletionParam);
+	}
+}
+
+void CGPIOWaveform::InterruptStub (void *pParam)
+{
+	CGPIOWaveform *pThis = (CGPIOWaveform *) pParam;
+	assert (pThis != 0);
+
+	pThis->InterruptHandler ();
+}
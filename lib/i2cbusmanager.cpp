@@ -0,0 +1,74 @@
+//
+// i2cbusmanager.cpp
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <circle/i2cbusmanager.h>
+#include <assert.h>
+
+CI2CBusManager::CI2CBusManager (CI2CMasterIRQ *pI2CMaster)
+:	m_pI2CMaster (pI2CMaster)
+{
+	assert (m_pI2CMaster != 0);
+	m_pI2CMaster->SetCompletionRoutine (CompletionStub, this);
+}
+
+CI2CBusManager::~CI2CBusManager (void)
+{
+	m_pI2CMaster = 0;
+}
+
+int CI2CBusManager::StartTransaction (TBusTransaction *pTransaction,
+				      unsigned *pBytesWritten, unsigned *pBytesRead)
+{
+	TI2CTransaction *pI2C = static_cast<TI2CTransaction *> (pTransaction);
+	assert (pI2C != 0);
+	assert (pBytesWritten != 0);
+	assert (pBytesRead != 0);
+
+	unsigned nWriteCount = pI2C->pWriteBuffer != 0 ? pI2C->nWriteCount : 0;
+	unsigned nReadCount = pI2C->pReadBuffer != 0 ? pI2C->nReadCount : 0;
+
+	*pBytesWritten = nWriteCount;
+	*pBytesRead = nReadCount;
+
+	assert (m_pI2CMaster != 0);
+	if (nWriteCount != 0 && nReadCount != 0)
+	{
+		return m_pI2CMaster->StartWriteRead (pI2C->ucAddress,
+						     pI2C->pWriteBuffer, nWriteCount,
+						     pI2C->pReadBuffer, nReadCount, TRUE);
+	}
+	else if (nWriteCount != 0)
+	{
+		return m_pI2CMaster->Write (pI2C->ucAddress, pI2C->pWriteBuffer, nWriteCount);
+	}
+	else if (nReadCount != 0)
+	{
+		return m_pI2CMaster->Read (pI2C->ucAddress, pI2C->pReadBuffer, nReadCount);
+	}
+
+	return CI2CMasterIRQ::StatusInvalidParam;
+}
+
+void CI2CBusManager::CompletionStub (int nStatus, void *pParam)
+{
+	CI2CBusManager *pThis = (CI2CBusManager *) pParam;
+	assert (pThis != 0);
+
+	pThis->TransactionCompleted (nStatus);
+}
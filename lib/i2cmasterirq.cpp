@@ -222,15 +222,18 @@ int CI2CMasterIRQ::Write (u8 ucAddress, const void *pBuffer, unsigned nCount)
 
 int CI2CMasterIRQ::StartWriteRead (u8 ucAddress,
 				   const void *pWriteBuffer, unsigned nWriteCount,
-				   void *pReadBuffer, unsigned nReadCount)
+				   void *pReadBuffer, unsigned nReadCount,
+				   boolean bRepeatedStart)
 {
-	return StartTransfer(ucAddress, pWriteBuffer, nWriteCount, pReadBuffer, nReadCount, TRUE, TRUE);
+	return StartTransfer(ucAddress, pWriteBuffer, nWriteCount, pReadBuffer, nReadCount, TRUE, TRUE,
+			     bRepeatedStart);
 }
 
 int CI2CMasterIRQ::StartTransfer (u8 ucAddress,
 				  const void *pWriteBuffer, unsigned nWriteCount,
 				  void *pReadBuffer, unsigned nReadCount,
-				  bool bValidateReadBuffer, bool bValidateWriteBuffer)
+				  bool bValidateReadBuffer, bool bValidateWriteBuffer,
+				  boolean bRepeatedStart)
 {
 	assert (m_bValid);
 
@@ -269,8 +272,41 @@ int CI2CMasterIRQ::StartTransfer (u8 ucAddress,
 	write32 (m_nBaseAddress + ARM_BSC_C__OFFSET, C_CLEAR);
 	write32 (m_nBaseAddress + ARM_BSC_S__OFFSET, S_CLKT | S_ERR | S_DONE);
 
+	// write request, directly followed by read request without stop condition
+	if (nWriteCount != 0 && nReadCount != 0 && bRepeatedStart)
+	{
+		write32 (m_nBaseAddress + ARM_BSC_DLEN__OFFSET, nWriteCount);
+
+		u8 *pWriteData = (u8 *) pWriteBuffer;
+		for (unsigned i = 0; i < nWriteCount; i++)
+		{
+			write32 (m_nBaseAddress + ARM_BSC_FIFO__OFFSET, *pWriteData++);
+		}
+
+		// start write transfer without interrupt
+		write32 (m_nBaseAddress + ARM_BSC_C__OFFSET, C_I2CEN | C_ST);
+
+		// poll for transfer has started
+		while (!(read32 (m_nBaseAddress + ARM_BSC_S__OFFSET) & S_TA))
+		{
+			if (read32 (m_nBaseAddress + ARM_BSC_S__OFFSET) & S_DONE)
+			{
+				// too late for a repeated start, read follows after stop
+				write32 (m_nBaseAddress + ARM_BSC_S__OFFSET, S_DONE);
+
+				break;
+			}
+		}
+
+		m_nStatus = StatusReading;
+
+		// queue read transfer with DONE interrupt, starts after the write has finished
+		write32 (m_nBaseAddress + ARM_BSC_DLEN__OFFSET, nReadCount);
+		write32 (m_nBaseAddress + ARM_BSC_C__OFFSET, C_I2CEN | C_ST | C_READ | C_INTD);
+	}
+
 	// write request, possibly followed by read request
-	if (nWriteCount != 0)
+	else if (nWriteCount != 0)
 	{
 		m_nStatus = StatusWriting;
 		write32 (m_nBaseAddress + ARM_BSC_DLEN__OFFSET, nWriteCount);
@@ -307,6 +343,8 @@ void CI2CMasterIRQ::InterruptHandler (void)
 {
 	m_SpinLock.Acquire ();
 
+	boolean bCompleted = FALSE;
+
 	PeripheralEntry ();
 
 	u32 nStatus = read32 (m_nBaseAddress + ARM_BSC_S__OFFSET);
@@ -315,13 +353,13 @@ void CI2CMasterIRQ::InterruptHandler (void)
 	if (nStatus & S_ERR)
 	{
 		m_nStatus = StatusAckError;
-		CallCompletionRoutine();
+		bCompleted = TRUE;
 	}
 	else if (nStatus & S_CLKT)
 	{
 		write32 (m_nBaseAddress + ARM_BSC_S__OFFSET, S_CLKT);
 		m_nStatus = StatusClockStretchTimeout;
-		CallCompletionRoutine();
+		bCompleted = TRUE;
 	}
 	else if (nStatus & S_DONE)
 	{
@@ -330,7 +368,7 @@ void CI2CMasterIRQ::InterruptHandler (void)
 			if (m_nReadCount == 0)
 			{
 				m_nStatus = StatusSuccess;
-				CallCompletionRoutine();
+				bCompleted = TRUE;
 			}
 			else
 			{
@@ -354,7 +392,7 @@ void CI2CMasterIRQ::InterruptHandler (void)
 			}
 
 			m_nStatus = nReadCount > 0 ? StatusDataLeftToReadError : StatusSuccess;
-			CallCompletionRoutine();
+			bCompleted = TRUE;
 		}
 		else
 		{
@@ -369,6 +407,12 @@ void CI2CMasterIRQ::InterruptHandler (void)
 	PeripheralExit ();
 
 	m_SpinLock.Release ();
+
+	// called without spin lock held, so that the next transfer can be started from there
+	if (bCompleted)
+	{
+		CallCompletionRoutine();
+	}
 }
 
 void CI2CMasterIRQ::InterruptStub (void *pParam)
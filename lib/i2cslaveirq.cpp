@@ -0,0 +1,629 @@
+//
+// i2cslaveirq.cpp
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <circle/i2cslaveirq.h>
+#include <circle/memio.h>
+#include <circle/bcm2835.h>
+#include <circle/synchronize.h>
+#include <circle/util.h>
+#include <assert.h>
+
+#define DR_DATA__MASK		0xFF
+
+#define RSR_UE			(1 << 1)
+#define RSR_OE			(1 << 0)
+
+#define CR_RXE			(1 << 9)
+#define CR_TXE			(1 << 8)
+#define CR_BRK			(1 << 7)
+#define CR_I2C			(1 << 2)
+#define CR_EN			(1 << 0)
+
+#define FR_RXFLEVEL(reg)	(((reg) >> 11) & 0x1F)
+#define FR_TXFLEVEL(reg)	(((reg) >> 6)  & 0x1F)
+#define FR_RXBUSY		(1 << 5)
+#define FR_TXFE			(1 << 4)
+#define FR_RXFF			(1 << 3)
+#define FR_TXFF			(1 << 2)
+#define FR_RXFE			(1 << 1)
+#define FR_TXBUSY		(1 << 0)
+
+#define IFLS_RXIFLSEL__SHIFT	3
+#define IFLS_TXIFLSEL__SHIFT	0
+#define IFLS_1_8		0
+#define IFLS_1_2		2
+#define IFLS_7_8		4
+
+#define IMSC_OEIM		(1 << 3)
+#define IMSC_BEIM		(1 << 2)
+#define IMSC_TXIM		(1 << 1)
+#define IMSC_RXIM		(1 << 0)
+
+#define ICR_OEIC		(1 << 3)
+#define ICR_BEIC		(1 << 2)
+#define ICR_TXIC		(1 << 1)
+#define ICR_RXIC		(1 << 0)
+
+#define TX_FIFO_SIZE		16
+#define TX_MAP_LEVEL		(TX_FIFO_SIZE-1)	// fill level in register map mode
+
+#define RX_SPIN_BYTES		2		// max. wait for the end of a write transfer
+#define POLL_TICKS		1
+
+CI2CSlaveIRQ::CI2CSlaveIRQ (CInterruptSystem *pInterruptSystem, u8 ucAddress,
+			    unsigned nClockSpeed)
+:	m_pInterruptSystem (pInterruptSystem),
+	m_ucAddress (ucAddress),
+	m_nByteTicks (9 * CLOCKHZ / nClockSpeed + 1),	// 8 data bits and ACK
+#if RASPPI <= 3
+	m_SDA (18, GPIOModeAlternateFunction3),
+	m_SCL (19, GPIOModeAlternateFunction3),
+#else
+	m_SDA (10, GPIOModeAlternateFunction3),
+	m_SCL (11, GPIOModeAlternateFunction3),
+#endif
+	m_bIRQConnected (FALSE),
+	m_hPollTimer (0),
+	m_pRegisters (0),
+	m_nRegisterCount (0),
+	m_pRegisterWriteHandler (0),
+	m_pRegisterWriteParam (0),
+	m_bExpectAddress (TRUE),
+	m_nRegister (0),
+	m_nTxRegister (0),
+	m_bReloadPending (FALSE),
+	m_nRxInPtr (0),
+	m_nRxOutPtr (0),
+	m_nTxInPtr (0),
+	m_nTxOutPtr (0),
+	m_SpinLock (IRQ_LEVEL)
+{
+	memset (&m_Statistics, 0, sizeof m_Statistics);
+}
+
+CI2CSlaveIRQ::~CI2CSlaveIRQ (void)
+{
+	if (m_hPollTimer != 0)
+	{
+		CTimer::Get ()->CancelKernelTimer (m_hPollTimer);
+		m_hPollTimer = 0;
+	}
+
+	PeripheralEntry ();
+
+	write32 (ARM_BSC_SPI_SLAVE_IMSC, 0);
+	write32 (ARM_BSC_SPI_SLAVE_CR, 0);
+
+	PeripheralExit ();
+
+	if (m_bIRQConnected)
+	{
+		assert (m_pInterruptSystem != 0);
+		m_pInterruptSystem->DisconnectIRQ (ARM_IRQ_I2CSPISLV);
+
+		m_bIRQConnected = FALSE;
+	}
+
+	m_pRegisters = 0;
+	m_pInterruptSystem = 0;
+}
+
+void CI2CSlaveIRQ::SetRegisterMap (void *pRegisters, unsigned nSize,
+				   TRegisterWriteHandler *pHandler, void *pParam)
+{
+	assert (!m_bIRQConnected);
+
+	assert (pRegisters != 0);
+	m_pRegisters = (u8 *) pRegisters;
+
+	assert (1 <= nSize && nSize <= 256);
+	m_nRegisterCount = nSize;
+
+	m_pRegisterWriteHandler = pHandler;
+	m_pRegisterWriteParam = pParam;
+}
+
+boolean CI2CSlaveIRQ::Initialize (void)
+{
+	assert (!m_bIRQConnected);
+
+	PeripheralEntry ();
+
+	write32 (ARM_BSC_SPI_SLAVE_SLV, m_ucAddress);
+
+	write32 (ARM_BSC_SPI_SLAVE_IMSC, 0);
+	write32 (ARM_BSC_SPI_SLAVE_ICR, ICR_OEIC | ICR_BEIC | ICR_TXIC | ICR_RXIC);
+
+	// the transmit FIFO is refilled, when it is half empty. In register map mode it is
+	// filled up to TX_MAP_LEVEL, so that the first byte of each read raises the interrupt.
+	write32 (ARM_BSC_SPI_SLAVE_IFLS,   (IFLS_1_8 << IFLS_RXIFLSEL__SHIFT)
+					 | ((m_pRegisters != 0 ? IFLS_7_8 : IFLS_1_2)
+					    << IFLS_TXIFLSEL__SHIFT));
+
+	write32 (ARM_BSC_SPI_SLAVE_CR, CR_I2C | CR_EN | CR_RXE | CR_TXE | CR_BRK);
+	write32 (ARM_BSC_SPI_SLAVE_CR, CR_I2C | CR_EN | CR_RXE | CR_TXE);
+	write32 (ARM_BSC_SPI_SLAVE_RSR, 0);
+
+	PeripheralExit ();
+
+	assert (m_pInterruptSystem != 0);
+	m_pInterruptSystem->ConnectIRQ (ARM_IRQ_I2CSPISLV, InterruptStub, this);
+	m_bIRQConnected = TRUE;
+
+	m_SpinLock.Acquire ();
+
+	PeripheralEntry ();
+
+	FillTxFIFO ();
+
+	write32 (ARM_BSC_SPI_SLAVE_IMSC,   read32 (ARM_BSC_SPI_SLAVE_IMSC)
+					 | IMSC_OEIM | IMSC_RXIM);
+
+	PeripheralExit ();
+
+	m_SpinLock.Release ();
+
+	m_hPollTimer = CTimer::Get ()->StartKernelTimer (POLL_TICKS, PollStub, 0, this);
+
+	return TRUE;
+}
+
+void CI2CSlaveIRQ::WriteRegisters (unsigned nRegister, const void *pData, unsigned nCount)
+{
+	assert (m_pRegisters != 0);
+	assert (nRegister < m_nRegisterCount);
+	assert (nCount <= m_nRegisterCount);
+
+	const u8 *pSource = (const u8 *) pData;
+	assert (pSource != 0);
+
+	m_SpinLock.Acquire ();
+
+	for (unsigned i = 0; i < nCount; i++)
+	{
+		m_pRegisters[nRegister] = *pSource++;
+
+		if (++nRegister == m_nRegisterCount)
+		{
+			nRegister = 0;
+		}
+	}
+
+	PeripheralEntry ();
+
+	// the receive FIFO is cleared on reload, so pending data has to be processed first,
+	// the transmit FIFO has been reloaded from the new register pointer then
+	unsigned nFirstRegister = 0;
+	unsigned nRegisterCount;
+	if (!ReceiveData (&nFirstRegister, &nRegisterCount))
+	{
+		// replace stale data, which has been prefetched into the transmit FIFO
+		if (!(read32 (ARM_BSC_SPI_SLAVE_FR) & (FR_TXBUSY | FR_RXBUSY)))
+		{
+			ReloadTxFIFO (GetReadPosition ());
+		}
+	}
+
+	PeripheralExit ();
+
+	m_SpinLock.Release ();
+
+	if (   nRegisterCount > 0
+	    && m_pRegisterWriteHandler != 0)
+	{
+		(*m_pRegisterWriteHandler) (nFirstRegister, nRegisterCount, m_pRegisterWriteParam);
+	}
+}
+
+void CI2CSlaveIRQ::ReadRegisters (unsigned nRegister, void *pBuffer, unsigned nCount)
+{
+	assert (m_pRegisters != 0);
+	assert (nRegister < m_nRegisterCount);
+	assert (nCount <= m_nRegisterCount);
+
+	u8 *pDest = (u8 *) pBuffer;
+	assert (pDest != 0);
+
+	m_SpinLock.Acquire ();
+
+	for (unsigned i = 0; i < nCount; i++)
+	{
+		*pDest++ = m_pRegisters[nRegister];
+
+		if (++nRegister == m_nRegisterCount)
+		{
+			nRegister = 0;
+		}
+	}
+
+	m_SpinLock.Release ();
+}
+
+int CI2CSlaveIRQ::Read (void *pBuffer, unsigned nCount)
+{
+	assert (m_pRegisters == 0);
+
+	u8 *pDest = (u8 *) pBuffer;
+	assert (pDest != 0);
+
+	int nResult = 0;
+
+	m_SpinLock.Acquire ();
+
+	while (   nCount > 0
+	       && m_nRxOutPtr != m_nRxInPtr)
+	{
+		*pDest++ = m_RxBuffer[m_nRxOutPtr];
+		m_nRxOutPtr = (m_nRxOutPtr + 1) & I2C_SLAVE_BUF_MASK;
+
+		nCount--;
+		nResult++;
+	}
+
+	m_SpinLock.Release ();
+
+	return nResult;
+}
+
+int CI2CSlaveIRQ::Write (const void *pBuffer, unsigned nCount)
+{
+	assert (m_pRegisters == 0);
+
+	const u8 *pSource = (const u8 *) pBuffer;
+	assert (pSource != 0);
+
+	int nResult = 0;
+
+	m_SpinLock.Acquire ();
+
+	while (   nCount > 0
+	       && ((m_nTxInPtr + 1) & I2C_SLAVE_BUF_MASK) != m_nTxOutPtr)
+	{
+		m_TxBuffer[m_nTxInPtr] = *pSource++;
+		m_nTxInPtr = (m_nTxInPtr + 1) & I2C_SLAVE_BUF_MASK;
+
+		nCount--;
+		nResult++;
+	}
+
+	PeripheralEntry ();
+
+	FillTxFIFO ();
+
+	PeripheralExit ();
+
+	m_SpinLock.Release ();
+
+	return nResult;
+}
+
+void CI2CSlaveIRQ::GetStatistics (TStatistics *pStatistics)
+{
+	assert (pStatistics != 0);
+
+	m_SpinLock.Acquire ();
+
+	*pStatistics = m_Statistics;
+
+	m_SpinLock.Release ();
+}
+
+boolean CI2CSlaveIRQ::Service (unsigned *pFirstRegister, unsigned *pRegisterCount)
+{
+	u32 nRSR = read32 (ARM_BSC_SPI_SLAVE_RSR);
+	if (nRSR & RSR_OE)
+	{
+		m_Statistics.RxOverruns++;
+	}
+
+	if (nRSR & RSR_UE)
+	{
+		m_Statistics.TxUnderruns++;
+	}
+
+	if (nRSR & (RSR_OE | RSR_UE))
+	{
+		write32 (ARM_BSC_SPI_SLAVE_RSR, 0);
+	}
+
+	write32 (ARM_BSC_SPI_SLAVE_ICR, ICR_OEIC | ICR_BEIC);
+
+	boolean bActive = ReceiveData (pFirstRegister, pRegisterCount);
+
+	u32 nFR = read32 (ARM_BSC_SPI_SLAVE_FR);
+	if (   m_bReloadPending
+	    && !(nFR & (FR_TXBUSY | FR_RXBUSY)))
+	{
+		ReloadTxFIFO (m_nRegister);
+	}
+
+	nFR = read32 (ARM_BSC_SPI_SLAVE_FR);
+	if (!(nFR & FR_TXFF))
+	{
+		if (nFR & FR_TXBUSY)
+		{
+			bActive = TRUE;
+		}
+
+		FillTxFIFO ();
+	}
+
+	return bActive || (nRSR & (RSR_OE | RSR_UE));
+}
+
+boolean CI2CSlaveIRQ::ReceiveData (unsigned *pFirstRegister, unsigned *pRegisterCount)
+{
+	assert (pFirstRegister != 0);
+	assert (pRegisterCount != 0);
+	*pRegisterCount = 0;
+
+	boolean bReceived = FALSE;
+	boolean bReload = FALSE;
+
+	// In register map mode the first byte of a read transfer raises the transmit interrupt.
+	// The received bytes belong to write transfers before the read then, because the
+	// master cannot start a new write, before the read is complete.
+	boolean bRead =    m_pRegisters != 0
+			&& (read32 (ARM_BSC_SPI_SLAVE_FR) & FR_TXBUSY);
+
+	unsigned nStartTicks = CTimer::GetClockTicks ();
+	while (1)
+	{
+		u32 nFR = read32 (ARM_BSC_SPI_SLAVE_FR);
+		if (nFR & FR_RXFE)
+		{
+			if (!(nFR & FR_RXBUSY))
+			{
+				// the write transfer is complete, next byte sets the register pointer
+				m_bExpectAddress = TRUE;
+
+				break;
+			}
+
+			// wait shortly for the end of the transfer, it is detected
+			// with the next interrupt or poll otherwise
+			if (CTimer::GetClockTicks () - nStartTicks >= RX_SPIN_BYTES * m_nByteTicks)
+			{
+				break;
+			}
+
+			continue;
+		}
+
+		u8 uchData = read32 (ARM_BSC_SPI_SLAVE_DR) & DR_DATA__MASK;
+
+		m_Statistics.BytesReceived++;
+		bReceived = TRUE;
+
+		if (m_pRegisters != 0)
+		{
+			if (m_bExpectAddress)
+			{
+				m_nRegister = uchData % m_nRegisterCount;
+				m_bExpectAddress = FALSE;
+			}
+			else
+			{
+				if (*pRegisterCount == 0)
+				{
+					*pFirstRegister = m_nRegister;
+				}
+
+				m_pRegisters[m_nRegister] = uchData;
+				(*pRegisterCount)++;
+
+				if (++m_nRegister == m_nRegisterCount)
+				{
+					m_nRegister = 0;
+				}
+			}
+
+			bReload = TRUE;
+		}
+		else
+		{
+			if (((m_nRxInPtr + 1) & I2C_SLAVE_BUF_MASK) != m_nRxOutPtr)
+			{
+				m_RxBuffer[m_nRxInPtr] = uchData;
+				m_nRxInPtr = (m_nRxInPtr + 1) & I2C_SLAVE_BUF_MASK;
+			}
+			else
+			{
+				m_Statistics.RxOverruns++;
+			}
+		}
+	}
+
+	if (bRead)
+	{
+		// a write transfer with the register pointer only ends here
+		m_bExpectAddress = TRUE;
+	}
+
+	if (bReload)
+	{
+		ReloadTxFIFO (m_nRegister);
+	}
+
+	return bReceived;
+}
+
+void CI2CSlaveIRQ::ReloadTxFIFO (unsigned nRegister)
+{
+	assert (m_pRegisters != 0);
+
+	// new data from the master would be lost and a running read would continue from
+	// another register, the reload is done with a following interrupt or poll then
+	u32 nFR = read32 (ARM_BSC_SPI_SLAVE_FR);
+	if (   FR_RXFLEVEL (nFR) != 0
+	    || (nFR & FR_TXBUSY))
+	{
+		m_bReloadPending = TRUE;
+
+		return;
+	}
+
+	m_bReloadPending = FALSE;
+
+	// the bytes, which are discarded here, have not been sent
+	unsigned nLevel = FR_TXFLEVEL (nFR);
+	assert (m_Statistics.BytesSent >= nLevel);
+	m_Statistics.BytesSent -= nLevel;
+
+	// clear the FIFOs, the receive FIFO is empty
+	write32 (ARM_BSC_SPI_SLAVE_CR, CR_I2C | CR_EN | CR_RXE | CR_TXE | CR_BRK);
+	write32 (ARM_BSC_SPI_SLAVE_CR, CR_I2C | CR_EN | CR_RXE | CR_TXE);
+
+	assert (nRegister < m_nRegisterCount);
+	m_nTxRegister = nRegister;
+
+	FillTxFIFO ();
+}
+
+void CI2CSlaveIRQ::FillTxFIFO (void)
+{
+	while (1)
+	{
+		u32 nFR = read32 (ARM_BSC_SPI_SLAVE_FR);
+		if (   (nFR & FR_TXFF)
+		    || (   m_pRegisters != 0
+			&& FR_TXFLEVEL (nFR) >= TX_MAP_LEVEL))
+		{
+			break;
+		}
+
+		u8 uchData;
+
+		if (m_pRegisters != 0)
+		{
+			uchData = m_pRegisters[m_nTxRegister];
+
+			if (++m_nTxRegister == m_nRegisterCount)
+			{
+				m_nTxRegister = 0;
+			}
+		}
+		else
+		{
+			if (m_nTxOutPtr == m_nTxInPtr)
+			{
+				break;
+			}
+
+			uchData = m_TxBuffer[m_nTxOutPtr];
+			m_nTxOutPtr = (m_nTxOutPtr + 1) & I2C_SLAVE_BUF_MASK;
+		}
+
+		write32 (ARM_BSC_SPI_SLAVE_DR, uchData);
+
+		m_Statistics.BytesSent++;
+	}
+
+	// the transmit interrupt is level-triggered, so it is enabled only, if data is available
+	u32 nIMSC = read32 (ARM_BSC_SPI_SLAVE_IMSC);
+	if (   m_pRegisters != 0
+	    || m_nTxOutPtr != m_nTxInPtr)
+	{
+		nIMSC |= IMSC_TXIM;
+	}
+	else
+	{
+		nIMSC &= ~IMSC_TXIM;
+	}
+
+	write32 (ARM_BSC_SPI_SLAVE_IMSC, nIMSC);
+}
+
+unsigned CI2CSlaveIRQ::GetReadPosition (void)
+{
+	assert (m_pRegisters != 0);
+	assert (m_nRegisterCount > 0);
+
+	unsigned nLevel = FR_TXFLEVEL (read32 (ARM_BSC_SPI_SLAVE_FR)) % m_nRegisterCount;
+
+	return (m_nTxRegister + m_nRegisterCount - nLevel) % m_nRegisterCount;
+}
+
+void CI2CSlaveIRQ::InterruptHandler (void)
+{
+	unsigned nFirstRegister = 0;
+	unsigned nRegisterCount;
+
+	m_SpinLock.Acquire ();
+
+	PeripheralEntry ();
+
+	Service (&nFirstRegister, &nRegisterCount);
+
+	PeripheralExit ();
+
+	m_Statistics.Interrupts++;
+
+	m_SpinLock.Release ();
+
+	if (   nRegisterCount > 0
+	    && m_pRegisterWriteHandler != 0)
+	{
+		(*m_pRegisterWriteHandler) (nFirstRegister, nRegisterCount, m_pRegisterWriteParam);
+	}
+}
+
+void CI2CSlaveIRQ::InterruptStub (void *pParam)
+{
+	CI2CSlaveIRQ *pThis = (CI2CSlaveIRQ *) pParam;
+	assert (pThis != 0);
+
+	pThis->InterruptHandler ();
+}
+
+void CI2CSlaveIRQ::PollHandler (TKernelTimerHandle hTimer)
+{
+	unsigned nFirstRegister = 0;
+	unsigned nRegisterCount;
+
+	m_SpinLock.Acquire ();
+
+	PeripheralEntry ();
+
+	// catch short write transfers, which did not raise the receive interrupt
+	if (Service (&nFirstRegister, &nRegisterCount))
+	{
+		m_Statistics.Interrupts++;
+	}
+
+	PeripheralExit ();
+
+	m_SpinLock.Release ();
+
+	if (   nRegisterCount > 0
+	    && m_pRegisterWriteHandler != 0)
+	{
+		(*m_pRegisterWriteHandler) (nFirstRegister, nRegisterCount, m_pRegisterWriteParam);
+	}
+
+	m_hPollTimer = CTimer::Get ()->StartKernelTimer (POLL_TICKS, PollStub, 0, this);
+}
+
+void CI2CSlaveIRQ::PollStub (TKernelTimerHandle hTimer, void *pParam, void *pContext)
+{
+	CI2CSlaveIRQ *pThis = (CI2CSlaveIRQ *) pContext;
+	assert (pThis != 0);
+
+	pThis->PollHandler (hTimer);
+}
@@ -45,6 +45,17 @@
 				   ? ARM_IC_DISABLE_IRQS_2	\
 				   : ARM_IC_DISABLE_BASIC_IRQS))
 #define ARM_IRQ_MASK(irq)	(1 << ((irq) & (ARM_IRQS_PER_REG-1)))
+
+#if RASPPI >= 2
+static inline unsigned ThisCore (void)
+{
+#ifdef ARM_ALLOW_MULTI_CORE
+	return CMultiCoreSupport::ThisCore ();
+#else
+	return 0;
+#endif
+}
+#endif
 				   
 CInterruptSystem *CInterruptSystem::s_pThis = 0;
 
@@ -60,6 +71,9 @@ CInterruptSystem::CInterruptSystem (void)
 	{
 		m_apIRQHandler[nIRQ] = 0;
 		m_pParam[nIRQ] = 0;
+#ifdef IRQ_STATISTICS
+		m_pIRQStatistics[nIRQ] = 0;
+#endif
 	}
 }
 
@@ -91,6 +105,10 @@ void CInterruptSystem::Destructor (void)
 
 	PeripheralExit ();
 
+#ifdef IRQ_STATISTICS
+	FreeIRQStatistics ();
+#endif
+
 	s_pThis = 0;
 }
 
@@ -101,6 +119,10 @@ boolean CInterruptSystem::Initialize (void)
 		return TRUE;
 	}
 
+#ifdef IRQ_STATISTICS
+	InitIRQTimestamp ();
+#endif
+
 #if AARCH == 32
 	TExceptionTable * volatile pTable = (TExceptionTable * volatile) ARM_EXCEPTION_TABLE_BASE;
 	pTable->IRQ = ARM_OPCODE_BRANCH (ARM_DISTANCE (pTable->IRQ, IRQStub));
@@ -144,6 +166,10 @@ void CInterruptSystem::ConnectIRQ (unsigned nIRQ, TIRQHandler *pHandler, void *p
 	assert (nIRQ < IRQ_LINES);
 	assert (m_apIRQHandler[nIRQ] == 0);
 
+#ifdef IRQ_STATISTICS
+	AllocateIRQStatistics (nIRQ);
+#endif
+
 	m_apIRQHandler[nIRQ] = pHandler;
 	m_pParam[nIRQ] = pParam;
 
@@ -220,9 +246,17 @@ void CInterruptSystem::EnableIRQ (unsigned nIRQ)
 	else
 	{
 #if RASPPI >= 2
-		assert (nIRQ == ARM_IRQLOCAL0_CNTPNS);	// the only implemented local IRQ so far
-		write32 (ARM_LOCAL_TIMER_INT_CONTROL0,
-			 read32 (ARM_LOCAL_TIMER_INT_CONTROL0) | (1 << 1));
+		if (nIRQ == ARM_IRQLOCAL0_PMU)
+		{
+			// route PMU interrupt of this core to IRQ
+			write32 (ARM_LOCAL_PM_ROUTING_SET, 1 << ThisCore ());
+		}
+		else
+		{
+			assert (nIRQ == ARM_IRQLOCAL0_CNTPNS);
+			write32 (ARM_LOCAL_TIMER_INT_CONTROL0,
+				 read32 (ARM_LOCAL_TIMER_INT_CONTROL0) | (1 << 1));
+		}
 #else
 		assert (0);
 #endif
@@ -244,9 +278,16 @@ void CInterruptSystem::DisableIRQ (unsigned nIRQ)
 	else
 	{
 #if RASPPI >= 2
-		assert (nIRQ == ARM_IRQLOCAL0_CNTPNS);	// the only implemented local IRQ so far
-		write32 (ARM_LOCAL_TIMER_INT_CONTROL0,
-			 read32 (ARM_LOCAL_TIMER_INT_CONTROL0) & ~(1 << 1));
+		if (nIRQ == ARM_IRQLOCAL0_PMU)
+		{
+			write32 (ARM_LOCAL_PM_ROUTING_CLR, 1 << ThisCore ());
+		}
+		else
+		{
+			assert (nIRQ == ARM_IRQLOCAL0_CNTPNS);
+			write32 (ARM_LOCAL_TIMER_INT_CONTROL0,
+				 read32 (ARM_LOCAL_TIMER_INT_CONTROL0) & ~(1 << 1));
+		}
 #else
 		assert (0);
 #endif
@@ -288,8 +329,16 @@ boolean CInterruptSystem::CallIRQHandler (unsigned nIRQ)
 
 	if (pHandler != 0)
 	{
+#ifndef IRQ_STATISTICS
 		(*pHandler) (m_pParam[nIRQ]);
-		
+#else
+		u64 nStart = GetIRQTimestamp ();
+
+		(*pHandler) (m_pParam[nIRQ]);
+
+		RecordIRQStatistics (nIRQ, nStart, GetIRQTimestamp ());
+#endif
+
 		return TRUE;
 	}
 	else
@@ -304,15 +353,26 @@ void CInterruptSystem::InterruptHandler (void)
 {
 	assert (s_pThis != 0);
 
+#ifdef IRQ_STATISTICS
+	MarkIRQEntry ();
+#endif
+
 #if RASPPI >= 2
-	u32 nLocalPending = read32 (ARM_LOCAL_IRQ_PENDING0);
-	assert (!(nLocalPending & ~(1 << 1 | 0xF << 4 | 1 << 8)));
-	if (nLocalPending & (1 << 1))		// the only implemented local IRQ so far
+	u32 nLocalPending = read32 (ARM_LOCAL_IRQ_PENDING0 + 4 * ThisCore ());
+	assert (!(nLocalPending & ~(1 << 1 | 0xF << 4 | 1 << 8 | 1 << 9)));
+	if (nLocalPending & (1 << 1))
 	{
 		s_pThis->CallIRQHandler (ARM_IRQLOCAL0_CNTPNS);
 
 		return;
 	}
+
+	if (nLocalPending & (1 << 9))
+	{
+		s_pThis->CallIRQHandler (ARM_IRQLOCAL0_PMU);
+
+		return;
+	}
 #endif
 
 #ifdef ARM_ALLOW_MULTI_CORE
@@ -100,6 +100,9 @@ CInterruptSystem::CInterruptSystem (void)
 	{
 		m_apIRQHandler[nIRQ] = 0;
 		m_pParam[nIRQ] = 0;
+#ifdef IRQ_STATISTICS
+		m_pIRQStatistics[nIRQ] = 0;
+#endif
 	}
 }
 
@@ -119,6 +122,10 @@ void CInterruptSystem::Destructor (void)
 
 	write32 (GICD_CTLR, GICD_CTLR_DISABLE);
 
+#ifdef IRQ_STATISTICS
+	FreeIRQStatistics ();
+#endif
+
 	s_pThis = 0;
 }
 
@@ -129,6 +136,10 @@ boolean CInterruptSystem::Initialize (void)
 		return TRUE;
 	}
 
+#ifdef IRQ_STATISTICS
+	InitIRQTimestamp ();
+#endif
+
 #if AARCH == 32
 	TExceptionTable * volatile pTable = (TExceptionTable * volatile) ARM_EXCEPTION_TABLE_BASE;
 	pTable->IRQ = ARM_OPCODE_BRANCH (ARM_DISTANCE (pTable->IRQ, IRQStub));
@@ -218,6 +229,10 @@ void CInterruptSystem::ConnectIRQ (unsigned nIRQ, TIRQHandler *pHandler, void *p
 	assert (nIRQ < IRQ_LINES);
 	assert (m_apIRQHandler[nIRQ] == 0);
 
+#ifdef IRQ_STATISTICS
+	AllocateIRQStatistics (nIRQ);
+#endif
+
 	m_apIRQHandler[nIRQ] = pHandler;
 	m_pParam[nIRQ] = pParam;
 
@@ -376,8 +391,16 @@ boolean CInterruptSystem::CallIRQHandler (unsigned nIRQ)
 
 	if (pHandler != 0)
 	{
+#ifndef IRQ_STATISTICS
+		(*pHandler) (m_pParam[nIRQ]);
+#else
+		u64 nStart = GetIRQTimestamp ();
+
 		(*pHandler) (m_pParam[nIRQ]);
-		
+
+		RecordIRQStatistics (nIRQ, nStart, GetIRQTimestamp ());
+#endif
+
 		return TRUE;
 	}
 	else
@@ -390,6 +413,10 @@ boolean CInterruptSystem::CallIRQHandler (unsigned nIRQ)
 
 void CInterruptSystem::InterruptHandler (void)
 {
+#ifdef IRQ_STATISTICS
+	MarkIRQEntry ();
+#endif
+
 	u32 nIAR = read32 (GICC_IAR);
 
 	unsigned nIRQ = nIAR & GICC_IAR_INTERRUPT_ID__MASK;
@@ -433,6 +460,18 @@ void CInterruptSystem::InitializeSecondary (void)
 	write32 (GICC_CTLR, GICC_CTLR_ENABLE);
 }
 
+void CInterruptSystem::RouteIRQ (unsigned nIRQ, unsigned nCore)
+{
+	assert (GIC_SPI (0) <= nIRQ && nIRQ < IRQ_LINES);
+	assert (nCore < CORES);
+
+	u32 nReg = GICD_ITARGETSR0 + (nIRQ / 4) * 4;
+	u32 nShift = (nIRQ % 4) * 8;
+
+	write32 (nReg,   (read32 (nReg) & ~(0xFF << nShift))
+		       | (GICD_ITARGETSR_CORE0 << nCore) << nShift);
+}
+
 void CInterruptSystem::SendIPI (unsigned nCore, unsigned nIPI)
 {
 	assert (nCore <= 7);
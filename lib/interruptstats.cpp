@@ -0,0 +1,317 @@
+//
+// interruptstats.cpp
+//
+// IRQ statistics of CInterruptSystem (common for interrupt.cpp and interruptgic.cpp)
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <circle/interrupt.h>
+
+#ifdef IRQ_STATISTICS
+
+#include <circle/multicore.h>
+#include <circle/bcm2835.h>
+#include <circle/memio.h>
+#include <circle/synchronize.h>
+#include <circle/string.h>
+#include <circle/util.h>
+#include <assert.h>
+
+#if RASPPI == 1
+	#undef USE_PHYSICAL_COUNTER
+#endif
+
+#define MAX_TICKS	0xFFFFFFFFU	// limit to prevent overflow on conversion
+
+u64 CInterruptSystem::s_nIRQEntry[IRQ_STAT_CORES];
+u64 CInterruptSystem::s_nNsPerTickQ16 = 1000 << 16;	// 1 MHz system timer
+
+static inline unsigned ThisCore (void)
+{
+#ifdef ARM_ALLOW_MULTI_CORE
+	return CMultiCoreSupport::ThisCore ();
+#else
+	return 0;
+#endif
+}
+
+void CInterruptSystem::AllocateIRQStatistics (unsigned nIRQ)
+{
+	assert (nIRQ < IRQ_LINES);
+	if (m_pIRQStatistics[nIRQ] != 0)
+	{
+		return;			// keep the statistics on re-connect
+	}
+
+	TIRQHistogram *pStat = new TIRQHistogram[IRQ_STAT_CORES * IRQStatUnknown];
+	assert (pStat != 0);
+
+	for (unsigned i = 0; i < IRQ_STAT_CORES * IRQStatUnknown; i++)
+	{
+		memset (&pStat[i], 0, sizeof pStat[i]);
+		pStat[i].nMin = (unsigned) -1;
+	}
+
+	DataSyncBarrier ();
+
+	m_pIRQStatistics[nIRQ] = pStat;
+}
+
+void CInterruptSystem::FreeIRQStatistics (void)
+{
+	for (unsigned nIRQ = 0; nIRQ < IRQ_LINES; nIRQ++)
+	{
+		delete [] m_pIRQStatistics[nIRQ];
+		m_pIRQStatistics[nIRQ] = 0;
+	}
+}
+
+void CInterruptSystem::RecordIRQStatistics (unsigned nIRQ, u64 nStart, u64 nEnd)
+{
+	assert (nIRQ < IRQ_LINES);
+	TIRQHistogram *pStat = m_pIRQStatistics[nIRQ];
+	if (pStat == 0)
+	{
+		return;
+	}
+
+	unsigned nCore = ThisCore ();
+	pStat += nCore * IRQStatUnknown;
+
+	u64 nEntry = s_nIRQEntry[nCore];
+#if defined (USE_PHYSICAL_COUNTER) && RASPPI >= 2
+	if (nIRQ == ARM_IRQLOCAL0_CNTPNS)
+	{
+		// the compare value is the time, when the timer IRQ has been asserted
+		u64 nCNTP_CVAL;
+#if AARCH == 32
+		u32 nCNTP_CVALLow, nCNTP_CVALHigh;
+		asm volatile ("mrrc p15, 2, %0, %1, c14" : "=r" (nCNTP_CVALLow), "=r" (nCNTP_CVALHigh));
+		nCNTP_CVAL = (u64) nCNTP_CVALHigh << 32 | nCNTP_CVALLow;
+#else
+		asm volatile ("mrs %0, CNTP_CVAL_EL0" : "=r" (nCNTP_CVAL));
+#endif
+		if (nCNTP_CVAL <= nStart)
+		{
+			nEntry = nCNTP_CVAL;
+		}
+	}
+#endif
+
+	u64 Ticks[IRQStatUnknown];
+#ifdef USE_PHYSICAL_COUNTER
+	Ticks[IRQStatEntryLatency] = nStart - nEntry;
+	Ticks[IRQStatExecutionTime] = nEnd - nStart;
+#else
+	Ticks[IRQStatEntryLatency] = (u32) (nStart - nEntry);
+	Ticks[IRQStatExecutionTime] = (u32) (nEnd - nStart);
+#endif
+
+	for (unsigned i = 0; i < IRQStatUnknown; i++, pStat++)
+	{
+		u64 nTicks = Ticks[i] < MAX_TICKS ? Ticks[i] : MAX_TICKS;
+		u64 nNs = (nTicks * s_nNsPerTickQ16) >> 16;
+		unsigned nValue = nNs < 0xFFFFFFFFU ? (unsigned) nNs : 0xFFFFFFFFU;
+
+		pStat->nCount++;
+		pStat->nSum += nValue;
+
+		if (nValue < pStat->nMin)
+		{
+			pStat->nMin = nValue;
+		}
+
+		if (nValue > pStat->nMax)
+		{
+			pStat->nMax = nValue;
+		}
+
+		unsigned nBucket = nValue > 0 ? 31 - __builtin_clz (nValue) : 0;
+		if (nBucket >= IRQ_STAT_BUCKETS)
+		{
+			nBucket = IRQ_STAT_BUCKETS-1;
+		}
+
+		pStat->nBucket[nBucket]++;
+	}
+}
+
+boolean CInterruptSystem::GetIRQStatistics (unsigned nIRQ, unsigned nCore, TIRQStatType Type,
+					    TIRQHistogram *pResult) const
+{
+	if (s_pThis != this)
+	{
+		return s_pThis->GetIRQStatistics (nIRQ, nCore, Type, pResult);
+	}
+
+	assert (nIRQ < IRQ_LINES);
+	assert (nCore < IRQ_STAT_CORES);
+	assert (Type < IRQStatUnknown);
+	assert (pResult != 0);
+
+	const TIRQHistogram *pStat = m_pIRQStatistics[nIRQ];
+	if (pStat == 0)
+	{
+		return FALSE;
+	}
+
+	// prevents a torn copy, if the IRQ is handled on this core,
+	// values from other cores are a snapshot only
+	EnterCritical (IRQ_LEVEL);
+
+	memcpy (pResult, &pStat[nCore * IRQStatUnknown + Type], sizeof *pResult);
+
+	LeaveCritical ();
+
+	return TRUE;
+}
+
+void CInterruptSystem::ResetIRQStatistics (void)
+{
+	if (s_pThis != this)
+	{
+		s_pThis->ResetIRQStatistics ();
+
+		return;
+	}
+
+	for (unsigned nIRQ = 0; nIRQ < IRQ_LINES; nIRQ++)
+	{
+		TIRQHistogram *pStat = m_pIRQStatistics[nIRQ];
+		if (pStat == 0)
+		{
+			continue;
+		}
+
+		EnterCritical (IRQ_LEVEL);
+
+		for (unsigned i = 0; i < IRQ_STAT_CORES * IRQStatUnknown; i++)
+		{
+			memset (&pStat[i], 0, sizeof pStat[i]);
+			pStat[i].nMin = (unsigned) -1;
+		}
+
+		LeaveCritical ();
+	}
+}
+
+void CInterruptSystem::DumpIRQStatistics (CDevice *pTarget) const
+{
+	if (s_pThis != this)
+	{
+		s_pThis->DumpIRQStatistics (pTarget);
+
+		return;
+	}
+
+	assert (pTarget != 0);
+
+	static const char Header[] = "IRQ C TYPE     COUNT      MIN      AVG      MAX (ns)\n";
+	pTarget->Write (Header, sizeof Header-1);
+
+	static const char *TypeNames[] = {"entry", "exec"};
+
+	for (unsigned nIRQ = 0; nIRQ < IRQ_LINES; nIRQ++)
+	{
+		for (unsigned nCore = 0; nCore < IRQ_STAT_CORES; nCore++)
+		{
+			for (unsigned nType = 0; nType < IRQStatUnknown; nType++)
+			{
+				TIRQHistogram Stat;
+				if (   !GetIRQStatistics (nIRQ, nCore, (TIRQStatType) nType, &Stat)
+				    || Stat.nCount == 0)
+				{
+					continue;
+				}
+
+				CString Line;
+				Line.Format ("%3u %u %-5s %8u %8u %8u %8u\n",
+					     nIRQ, nCore, TypeNames[nType], Stat.nCount, Stat.nMin,
+					     (unsigned) (Stat.nSum / Stat.nCount), Stat.nMax);
+
+				// non-empty buckets as "lower bound:count"
+				CString Buckets;
+				for (unsigned i = 0; i < IRQ_STAT_BUCKETS; i++)
+				{
+					if (Stat.nBucket[i] != 0)
+					{
+						CString Bucket;
+						Bucket.Format (" %u:%u", i > 0 ? 1U << i : 0, Stat.nBucket[i]);
+						Buckets.Append (Bucket);
+					}
+				}
+
+				Line.Append ("     ");
+				Line.Append (Buckets);
+				Line.Append ("\n");
+
+				pTarget->Write (Line, Line.GetLength ());
+			}
+		}
+	}
+}
+
+void CInterruptSystem::InitIRQTimestamp (void)
+{
+#ifdef USE_PHYSICAL_COUNTER
+	u64 nCNTFRQ;
+#if AARCH == 32
+	u32 nCNTFRQ32;
+	asm volatile ("mrc p15, 0, %0, c14, c0, 0" : "=r" (nCNTFRQ32));
+	nCNTFRQ = nCNTFRQ32;
+#else
+	asm volatile ("mrs %0, CNTFRQ_EL0" : "=r" (nCNTFRQ));
+#endif
+	assert (nCNTFRQ != 0);
+	s_nNsPerTickQ16 = (1000000000ULL << 16) / nCNTFRQ;
+#endif
+}
+
+u64 CInterruptSystem::GetIRQTimestamp (void)
+{
+#ifdef USE_PHYSICAL_COUNTER
+#if AARCH == 32
+	InstructionSyncBarrier ();
+
+	u32 nCNTPCTLow, nCNTPCTHigh;
+	asm volatile ("mrrc p15, 0, %0, %1, c14" : "=r" (nCNTPCTLow), "=r" (nCNTPCTHigh));
+
+	return (u64) nCNTPCTHigh << 32 | nCNTPCTLow;
+#else
+	InstructionSyncBarrier ();
+
+	u64 nCNTPCT;
+	asm volatile ("mrs %0, CNTPCT_EL0" : "=r" (nCNTPCT));
+
+	return nCNTPCT;
+#endif
+#else
+	// wraps after 71 minutes, but only differences are used
+	PeripheralEntry ();
+	u32 nCLO = read32 (ARM_SYSTIMER_CLO);
+	PeripheralExit ();
+
+	return nCLO;
+#endif
+}
+
+void CInterruptSystem::MarkIRQEntry (void)
+{
+	s_nIRQEntry[ThisCore ()] = GetIRQTimestamp ();
+}
+
+#endif
@@ -0,0 +1,336 @@
+//
+// metrics.cpp
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <circle/metrics.h>
+#include <circle/memory.h>
+#include <circle/util.h>
+#include <assert.h>
+
+// Metrics are usually static objects, which register themselves from their
+// constructor. s_pFirst is in .bss and therefore valid before any constructor
+// has run. The spin lock does not need to be initialized at this time, because
+// it is not enabled before the secondary cores are started.
+CMetric *CMetricsRegistry::s_pFirst = 0;
+CSpinLock CMetricsRegistry::s_SpinLock (TASK_LEVEL);
+
+static s64 GetHeapFreeSpace (void *pParam)
+{
+	CMemorySystem *pMemorySystem = CMemorySystem::Get ();
+	if (pMemorySystem == 0)
+	{
+		return 0;
+	}
+
+	return pMemorySystem->GetHeapFreeSpace (HEAP_ANY);
+}
+
+static CMetricGauge s_HeapFree ("circle_heap_free_bytes", "Free space on the heap",
+				0, GetHeapFreeSpace);
+
+static const char *s_pTypeName[] = {"counter", "gauge", "histogram", "untyped"};
+
+static void AppendNumber (CString *pResult, u64 nValue)
+{
+	char Buffer[24];
+	char *p = &Buffer[sizeof Buffer - 1];
+	*p = '\0';
+
+	do
+	{
+		*--p = '0' + nValue % 10;
+		nValue /= 10;
+	}
+	while (nValue != 0);
+
+	pResult->Append (p);
+}
+
+CMetric::CMetric (const char *pName, const char *pHelp, const char *pLabels, TMetricType Type)
+:	m_pName (pName),
+	m_pHelp (pHelp),
+	m_pLabels (pLabels),
+	m_Type (Type),
+	m_pNext (0)
+{
+	assert (m_pName != 0);
+	assert (m_pHelp != 0);
+
+	CMetricsRegistry::Register (this);
+}
+
+CMetric::~CMetric (void)
+{
+	CMetricsRegistry::Unregister (this);
+
+	m_pName = 0;
+}
+
+void CMetric::FormatSample (CString *pResult, const char *pSuffix, const char *pExtraLabel,
+			    u64 nValue, boolean bNegative) const
+{
+	assert (pResult != 0);
+	pResult->Append (m_pName);
+	if (pSuffix != 0)
+	{
+		pResult->Append (pSuffix);
+	}
+
+	boolean bHasLabels = m_pLabels != 0 && *m_pLabels != '\0';
+	if (bHasLabels || pExtraLabel != 0)
+	{
+		pResult->Append ('{');
+
+		if (bHasLabels)
+		{
+			pResult->Append (m_pLabels);
+		}
+
+		if (pExtraLabel != 0)
+		{
+			if (bHasLabels)
+			{
+				pResult->Append (',');
+			}
+
+			pResult->Append (pExtraLabel);
+		}
+
+		pResult->Append ('}');
+	}
+
+	pResult->Append (' ');
+	if (bNegative)
+	{
+		pResult->Append ('-');
+	}
+	AppendNumber (pResult, nValue);
+	pResult->Append ('\n');
+}
+
+CMetricCounter::CMetricCounter (const char *pName, const char *pHelp, const char *pLabels)
+:	CMetric (pName, pHelp, pLabels, MetricTypeCounter)
+{
+	for (unsigned i = 0; i < METRICS_CORES; i++)
+	{
+		m_Slot[i].nValue = 0;
+	}
+}
+
+u64 CMetricCounter::Get (void) const
+{
+	u64 nSum = 0;
+	for (unsigned i = 0; i < METRICS_CORES; i++)
+	{
+		nSum += AtomicLoad (&m_Slot[i].nValue);
+	}
+
+	return nSum;
+}
+
+void CMetricCounter::Format (CString *pResult) const
+{
+	FormatSample (pResult, 0, 0, Get ());
+}
+
+CMetricGauge::CMetricGauge (const char *pName, const char *pHelp, const char *pLabels)
+:	CMetric (pName, pHelp, pLabels, MetricTypeGauge),
+	m_nValue (0),
+	m_pCallback (0),
+	m_pParam (0)
+{
+}
+
+CMetricGauge::CMetricGauge (const char *pName, const char *pHelp, const char *pLabels,
+			    TMetricGaugeCallback *pCallback, void *pParam)
+:	CMetric (pName, pHelp, pLabels, MetricTypeGauge),
+	m_nValue (0),
+	m_pCallback (pCallback),
+	m_pParam (pParam)
+{
+	assert (m_pCallback != 0);
+}
+
+s64 CMetricGauge::Get (void) const
+{
+	if (m_pCallback != 0)
+	{
+		return (*m_pCallback) (m_pParam);
+	}
+
+	return (s64) AtomicLoad (&m_nValue);
+}
+
+void CMetricGauge::Format (CString *pResult) const
+{
+	s64 nValue = Get ();
+	if (nValue < 0)
+	{
+		FormatSample (pResult, 0, 0, (u64) -nValue, TRUE);
+	}
+	else
+	{
+		FormatSample (pResult, 0, 0, (u64) nValue);
+	}
+}
+
+CMetricHistogram::CMetricHistogram (const char *pName, const char *pHelp, const char *pLabels,
+				    const u64 *pBounds, unsigned nBuckets)
+:	CMetric (pName, pHelp, pLabels, MetricTypeHistogram),
+	m_pBounds (pBounds),
+	m_nBuckets (nBuckets)
+{
+	assert (m_pBounds != 0);
+	assert (m_nBuckets <= METRIC_HISTOGRAM_MAX_BUCKETS);
+
+	for (unsigned i = 0; i < METRICS_CORES; i++)
+	{
+		for (unsigned j = 0; j <= METRIC_HISTOGRAM_MAX_BUCKETS; j++)
+		{
+			m_Core[i].nCount[j] = 0;
+		}
+
+		m_Core[i].nSum = 0;
+	}
+}
+
+void CMetricHistogram::Format (CString *pResult) const
+{
+	u64 nCumulated = 0;
+	for (unsigned nBucket = 0; nBucket <= m_nBuckets; nBucket++)
+	{
+		for (unsigned i = 0; i < METRICS_CORES; i++)
+		{
+			nCumulated += AtomicLoad (&m_Core[i].nCount[nBucket]);
+		}
+
+		CString Label ("le=\"");
+		if (nBucket < m_nBuckets)
+		{
+			AppendNumber (&Label, m_pBounds[nBucket]);
+		}
+		else
+		{
+			Label.Append ("+Inf");
+		}
+		Label.Append ('"');
+
+		FormatSample (pResult, "_bucket", Label, nCumulated);
+	}
+
+	u64 nSum = 0;
+	for (unsigned i = 0; i < METRICS_CORES; i++)
+	{
+		nSum += AtomicLoad (&m_Core[i].nSum);
+	}
+
+	FormatSample (pResult, "_sum", 0, nSum);
+	FormatSample (pResult, "_count", 0, nCumulated);
+}
+
+void CMetricsRegistry::Format (CString *pResult)
+{
+	assert (pResult != 0);
+
+	s_SpinLock.Acquire ();
+
+	const char *pPrevName = 0;
+	for (CMetric *pMetric = s_pFirst; pMetric != 0; pMetric = pMetric->m_pNext)
+	{
+		// metrics with the same name are adjacent, write their header only once
+		if (   pPrevName == 0
+		    || strcmp (pPrevName, pMetric->m_pName) != 0)
+		{
+			pResult->Append ("# HELP ");
+			pResult->Append (pMetric->m_pName);
+			pResult->Append (' ');
+			pResult->Append (pMetric->m_pHelp);
+			pResult->Append ("\n# TYPE ");
+			pResult->Append (pMetric->m_pName);
+			pResult->Append (' ');
+			pResult->Append (s_pTypeName[pMetric->m_Type]);
+			pResult->Append ('\n');
+
+			pPrevName = pMetric->m_pName;
+		}
+
+		pMetric->Format (pResult);
+	}
+
+	s_SpinLock.Release ();
+}
+
+void CMetricsRegistry::Register (CMetric *pMetric)
+{
+	assert (pMetric != 0);
+
+	s_SpinLock.Acquire ();
+
+	// insert behind the last metric with the same name or append to the list
+	CMetric *pPrev = 0;
+	CMetric *pLast = 0;
+	for (CMetric *p = s_pFirst; p != 0; p = p->m_pNext)
+	{
+		if (strcmp (p->m_pName, pMetric->m_pName) == 0)
+		{
+			pPrev = p;
+		}
+
+		pLast = p;
+	}
+
+	if (pPrev == 0)
+	{
+		pPrev = pLast;
+	}
+
+	if (pPrev == 0)
+	{
+		pMetric->m_pNext = s_pFirst;
+		s_pFirst = pMetric;
+	}
+	else
+	{
+		pMetric->m_pNext = pPrev->m_pNext;
+		pPrev->m_pNext = pMetric;
+	}
+
+	s_SpinLock.Release ();
+}
+
+void CMetricsRegistry::Unregister (CMetric *pMetric)
+{
+	assert (pMetric != 0);
+
+	s_SpinLock.Acquire ();
+
+	CMetric **ppMetric = &s_pFirst;
+	while (*ppMetric != 0)
+	{
+		if (*ppMetric == pMetric)
+		{
+			*ppMetric = pMetric->m_pNext;
+
+			break;
+		}
+
+		ppMetric = &(*ppMetric)->m_pNext;
+	}
+
+	s_SpinLock.Release ();
+}
@@ -0,0 +1,92 @@
+//
+// metricsdaemon.cpp
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <circle/net/metricsdaemon.h>
+#include <circle/metrics.h>
+#include <circle/logger.h>
+#include <circle/string.h>
+#include <circle/util.h>
+#include <assert.h>
+
+static const char FromMetrics[] = "metrics";
+
+CMetricsDaemon::CMetricsDaemon (CNetSubSystem *pNetSubSystem, u16 nPort, boolean bAccessLog,
+				CSocket *pSocket)
+:	CHTTPDaemon (pNetSubSystem, pSocket, METRICS_MAX_CONTENT, nPort),
+	m_nPort (nPort),
+	m_bAccessLog (bAccessLog)
+{
+}
+
+CMetricsDaemon::~CMetricsDaemon (void)
+{
+}
+
+CHTTPDaemon *CMetricsDaemon::CreateWorker (CNetSubSystem *pNetSubSystem, CSocket *pSocket)
+{
+	return new CMetricsDaemon (pNetSubSystem, m_nPort, m_bAccessLog, pSocket);
+}
+
+THTTPStatus CMetricsDaemon::GetContent (const char  *pPath,
+					const char  *pParams,
+					const char  *pFormData,
+					u8	    *pBuffer,
+					unsigned    *pLength,
+					const char **ppContentType)
+{
+	assert (pPath != 0);
+	if (strcmp (pPath, "/metrics") != 0)
+	{
+		return HTTPNotFound;
+	}
+
+	CString Metrics;
+	CMetricsRegistry::Format (&Metrics);
+
+	unsigned nLength = Metrics.GetLength ();
+
+	assert (pLength != 0);
+	if (nLength > *pLength)
+	{
+		CLogger::Get ()->Write (FromMetrics, LogWarning,
+					"Metrics do not fit into buffer (%u bytes)", nLength);
+
+		return HTTPInternalServerError;
+	}
+
+	assert (pBuffer != 0);
+	memcpy (pBuffer, (const char *) Metrics, nLength);
+	*pLength = nLength;
+
+	assert (ppContentType != 0);
+	*ppContentType = "text/plain; version=0.0.4";
+
+	return HTTPOK;
+}
+
+void CMetricsDaemon::WriteAccessLog (const CIPAddress &rRemoteIP, THTTPRequestMethod RequestMethod,
+				     const char *pRequestURI, THTTPStatus Status,
+				     unsigned nContentLength)
+{
+	if (m_bAccessLog)
+	{
+		CHTTPDaemon::WriteAccessLog (rRemoteIP, RequestMethod, pRequestURI,
+					     Status, nContentLength);
+	}
+}
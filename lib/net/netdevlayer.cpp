@@ -20,6 +20,7 @@
 #include <circle/net/netdevlayer.h>
 #include <circle/net/phytask.h>
 #include <circle/logger.h>
+#include <circle/metrics.h>
 #include <circle/timer.h>
 #include <circle/synchronize.h>
 #include <circle/macros.h>
@@ -27,6 +28,13 @@
 
 const char FromNetDev[] = "netdev";
 
+static CMetricCounter s_RxFrames ("circle_net_rx_frames_total", "Received Ethernet frames");
+static CMetricCounter s_RxBytes ("circle_net_rx_bytes_total", "Received Ethernet bytes");
+static CMetricCounter s_TxFrames ("circle_net_tx_frames_total", "Sent Ethernet frames");
+static CMetricCounter s_TxBytes ("circle_net_tx_bytes_total", "Sent Ethernet bytes");
+static CMetricCounter s_TxDropped ("circle_net_tx_dropped_total",
+				   "Ethernet frames dropped by the net device");
+
 CNetDeviceLayer::CNetDeviceLayer (CNetConfig *pNetConfig, TNetDeviceType DeviceType)
 :	m_DeviceType (DeviceType),
 	m_pNetConfig (pNetConfig),
@@ -113,16 +121,24 @@ void CNetDeviceLayer::Process (void)
 	{
 		if (!m_pDevice->SendFrame (Buffer, nLength))
 		{
+			s_TxDropped.Add ();
+
 			CLogger::Get ()->Write (FromNetDev, LogWarning, "Frame dropped");
 
 			break;
 		}
+
+		s_TxFrames.Add ();
+		s_TxBytes.Add (nLength);
 	}
 
 	while (m_pDevice->ReceiveFrame (Buffer, &nLength))
 	{
 		assert (nLength > 0);
 		m_RxQueue.Enqueue (Buffer, nLength);
+
+		s_RxFrames.Add ();
+		s_RxBytes.Add (nLength);
 	}
 }
 
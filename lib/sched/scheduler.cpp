@@ -20,6 +20,7 @@
 #include <circle/sched/scheduler.h>
 #include <circle/timer.h>
 #include <circle/logger.h>
+#include <circle/metrics.h>
 #include <circle/string.h>
 #include <circle/util.h>
 #include <assert.h>
@@ -28,6 +29,9 @@ static const char FromScheduler[] = "sched";
 
 CScheduler *CScheduler::s_pThis = 0;
 
+static CMetricCounter s_TaskSwitches ("circle_sched_task_switches_total", "Task switches");
+static CMetricGauge s_Tasks ("circle_sched_tasks", "Tasks known to the scheduler");
+
 CScheduler::CScheduler (void)
 :	m_nTasks (0),
 	m_pCurrent (0),
@@ -76,6 +80,8 @@ void CScheduler::Yield (void)
 		(*m_pTaskSwitchHandler) (m_pCurrent);
 	}
 
+	s_TaskSwitches.Add ();
+
 	assert (pOldRegs != 0);
 	assert (pNewRegs != 0);
 	TaskSwitch (pOldRegs, pNewRegs);
@@ -268,6 +274,8 @@ void CScheduler::AddTask (CTask *pTask)
 		pTask->SetState(TaskStateNew);
 	}
 
+	s_Tasks.Add (1);
+
 	unsigned i;
 	for (i = 0; i < m_nTasks; i++)
 	{
@@ -295,6 +303,8 @@ void CScheduler::RemoveTask (CTask *pTask)
 		{
 			m_pTask[i] = 0;
 
+			s_Tasks.Sub (1);
+
 			if (i == m_nTasks-1)
 			{
 				m_nTasks--;
@@ -49,8 +49,14 @@ CScreenDevice::~CScreenDevice (void)
 
 boolean CScreenDevice::Initialize (void)
 {
+#if defined (SCREEN_HW_SCROLL) && RASPPI <= 4
+	// twice the screen height
+	m_pFrameBuffer = new CBcmFrameBuffer (m_nInitWidth, m_nInitHeight, DEPTH,
+					      0, 0, m_nDisplay, TRUE);
+#else
 	m_pFrameBuffer = new CBcmFrameBuffer (m_nInitWidth, m_nInitHeight, DEPTH,
 					      0, 0, m_nDisplay);
+#endif
 	if (!m_pFrameBuffer)
 	{
 		return FALSE;
@@ -91,6 +97,10 @@ boolean CScreenDevice::Initialize (void)
 		return FALSE;
 	}
 
+#if defined (SCREEN_HW_SCROLL) && RASPPI <= 4
+	m_pTerminal->EnableHardwareScroll (m_pFrameBuffer);
+#endif
+
 	if (!m_pTerminal->Initialize ())
 	{
 		return FALSE;
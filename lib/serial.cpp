@@ -24,6 +24,7 @@
 #include <circle/rp1int.h>
 #include <circle/machineinfo.h>
 #include <circle/synchronize.h>
+#include <circle/new.h>
 #include <assert.h>
 
 #ifndef USE_RPI_STUB_AT
@@ -48,6 +49,7 @@
 #define ARM_UART_RIS    	(m_nBaseAddress + 0x3C)
 #define ARM_UART_MIS    	(m_nBaseAddress + 0x40)
 #define ARM_UART_ICR    	(m_nBaseAddress + 0x44)
+#define ARM_UART_DMACR    	(m_nBaseAddress + 0x48)
 
 // Definitions from Raspberry PI Remote Serial Protocol.
 //     Copyright 2012 Jamie Iles, jamie@jamieiles.com.
@@ -56,6 +58,7 @@
 #define DR_BE_MASK		(1 << 10)
 #define DR_PE_MASK		(1 << 9)
 #define DR_FE_MASK		(1 << 8)
+#define DR_ERROR_MASK		(DR_OE_MASK | DR_BE_MASK | DR_PE_MASK | DR_FE_MASK)
 
 #define FR_TXFE_MASK		(1 << 7)
 #define FR_RXFF_MASK		(1 << 6)
@@ -106,6 +109,12 @@
 #define INT_DCDM		(1 << 2)
 #define INT_CTSM		(1 << 1)
 
+#define DMACR_DMAONERR		(1 << 2)
+#define DMACR_TXDMAE		(1 << 1)
+#define DMACR_RXDMAE		(1 << 0)
+
+#define IDLE_CHECK_TICKS	1
+
 #define ALT_FUNC(device, gpio)	((TGPIOMode) (  s_GPIOConfig[device][gpio][VALUE_ALT] \
 					      + GPIOModeAlternateFunction0))
 
@@ -221,6 +230,21 @@ CSerialDevice::CSerialDevice (CInterruptSystem *pInterruptSystem, boolean bUseFI
 	m_nOptions (SERIAL_OPTION_ONLCR),
 	m_pCharReceivedHandler (0),
 	m_pMagic (0),
+	m_bUseDMA (FALSE),
+	m_pRxDMA (0),
+	m_pTxDMA (0),
+	m_pRxDMABuffer (0),
+	m_nRxDMASize (0),
+	m_nRxDMAIn (0),
+	m_nRxDMAOut (0),
+	m_nRxDMALapBase (0),
+	m_pTxDMABuffer (0),
+	m_nTxDMACount (0),
+	m_pIdleHandler (0),
+	m_pIdleParam (0),
+	m_hIdleTimer (0),
+	m_nRxIdleIn (0),
+	m_bRxActive (FALSE),
 	m_SpinLock (bUseFIQ ? FIQ_LEVEL : IRQ_LEVEL)
 #ifdef REALTIME
 	, m_LineSpinLock (TASK_LEVEL)
@@ -287,11 +311,41 @@ CSerialDevice::~CSerialDevice (void)
 	s_nInterruptDeviceMask &= ~(1 << m_nDevice);
 	DataSyncBarrier ();
 
+	if (m_hIdleTimer != 0)
+	{
+		CTimer::Get ()->CancelKernelTimer (m_hIdleTimer);
+		m_hIdleTimer = 0;
+	}
+
 	PeripheralEntry ();
 	write32 (ARM_UART_IMSC, 0);
 	write32 (ARM_UART_CR, 0);
 	PeripheralExit ();
 
+	if (m_bUseDMA)
+	{
+		m_pRxDMA->Cancel ();
+		m_pTxDMA->Cancel ();
+
+		PeripheralEntry ();
+		write32 (ARM_UART_DMACR, 0);
+		PeripheralExit ();
+
+		delete m_pTxDMA;
+		m_pTxDMA = 0;
+
+		delete m_pRxDMA;
+		m_pRxDMA = 0;
+
+		delete [] m_pTxDMABuffer;
+		m_pTxDMABuffer = 0;
+
+		delete [] m_pRxDMABuffer;
+		m_pRxDMABuffer = 0;
+
+		m_bUseDMA = FALSE;
+	}
+
 #if RASPPI <= 4
 	// disconnect interrupt, if this is the last device, which uses interrupts
 	if (   m_pInterruptSystem != 0
@@ -477,7 +531,27 @@ boolean CSerialDevice::Initialize (unsigned nBaudrate,
 		break;
 	}
 
-	if (m_pInterruptSystem != 0)
+	if (m_bUseDMA)
+	{
+		// the DMA reads the DR register with the error flags, one word per character
+		assert (m_pRxDMA != 0);
+		m_pRxDMA->SetupCyclicIORead (m_pRxDMABuffer, ARM_UART_DR,
+					     m_nRxDMASize * sizeof (u32), DREQSourceUARTRX);
+		m_pRxDMA->SetCompletionRoutine (RxDMACompletionStub, this);
+		m_pRxDMA->Start ();
+
+		write32 (ARM_UART_IFLS,   IFLS_IFSEL_1_4 << IFLS_TXIFSEL_SHIFT
+					| IFLS_IFSEL_1_4 << IFLS_RXIFSEL_SHIFT);
+		write32 (ARM_UART_LCRH, nLCRH);
+		write32 (ARM_UART_DMACR, DMACR_TXDMAE | DMACR_RXDMAE);
+
+		// the receive timeout speeds up the idle detection, the FIFO is drained by DMA
+		write32 (ARM_UART_IMSC, INT_RT);
+
+		s_nInterruptDeviceMask |= 1 << m_nDevice;
+		DataSyncBarrier ();
+	}
+	else if (m_pInterruptSystem != 0)
 	{
 		write32 (ARM_UART_IFLS,   IFLS_IFSEL_1_4 << IFLS_TXIFSEL_SHIFT
 					| IFLS_IFSEL_1_4 << IFLS_RXIFSEL_SHIFT);
@@ -544,7 +618,15 @@ int CSerialDevice::Write (const void *pBuffer, size_t nCount)
 
 	m_LineSpinLock.Release ();
 
-	if (m_pInterruptSystem != 0)
+	if (m_bUseDMA)
+	{
+		m_SpinLock.Acquire ();
+
+		StartTxDMA ();
+
+		m_SpinLock.Release ();
+	}
+	else if (m_pInterruptSystem != 0)
 	{
 		m_SpinLock.Acquire ();
 
@@ -585,7 +667,51 @@ int CSerialDevice::Read (void *pBuffer, size_t nCount)
 
 	int nResult = 0;
 
-	if (m_pInterruptSystem != 0)
+	if (m_bUseDMA)
+	{
+		m_SpinLock.Acquire ();
+
+		unsigned nAvailable = GetRxDMAAvailable ();
+
+		if (m_nRxStatus < 0)
+		{
+			nResult = m_nRxStatus;
+			m_nRxStatus = 0;
+		}
+		else if (nAvailable > 0)
+		{
+			if (nCount > nAvailable)
+			{
+				nCount = nAvailable;
+			}
+
+			InvalidateRxDMA (nCount);
+
+			while (nCount > 0)
+			{
+				u32 nDR = m_pRxDMABuffer[m_nRxDMAOut++ & (m_nRxDMASize-1)];
+				if (nDR & DR_ERROR_MASK)
+				{
+					// report the error with the next call, like the interrupt driver
+					if (m_nRxStatus == 0)
+					{
+						m_nRxStatus =   nDR & DR_BE_MASK ? -SERIAL_ERROR_BREAK
+							      : nDR & DR_OE_MASK ? -SERIAL_ERROR_OVERRUN
+							      : nDR & DR_FE_MASK ? -SERIAL_ERROR_FRAMING
+										 : -SERIAL_ERROR_PARITY;
+					}
+				}
+
+				*pChar++ = nDR & 0xFF;
+
+				nCount--;
+				nResult++;
+			}
+		}
+
+		m_SpinLock.Release ();
+	}
+	else if (m_pInterruptSystem != 0)
 	{
 		m_SpinLock.Acquire ();
 
@@ -744,6 +870,7 @@ boolean CSerialDevice::IsTransmitting (void) const
 void CSerialDevice::RegisterCharReceivedHandler (TCharReceivedHandler *pHandler, void *pParam)
 {
 	assert (m_pInterruptSystem != 0);
+	assert (!m_bUseDMA);
 
 	m_pParam = pParam;
 	m_pCharReceivedHandler = pHandler;
@@ -752,6 +879,7 @@ void CSerialDevice::RegisterCharReceivedHandler (TCharReceivedHandler *pHandler,
 void CSerialDevice::RegisterMagicReceivedHandler (const char *pMagic, TMagicReceivedHandler *pHandler)
 {
 	assert (m_pInterruptSystem != 0);
+	assert (!m_bUseDMA);
 	assert (m_pMagic == 0);
 
 	assert (pMagic != 0);
@@ -764,6 +892,89 @@ void CSerialDevice::RegisterMagicReceivedHandler (const char *pMagic, TMagicRece
 	m_pMagic = pMagic;		// enables the scanner
 }
 
+boolean CSerialDevice::EnableDMA (unsigned nRxBufferSize)
+{
+#if RASPPI <= 4
+	if (   !m_bValid
+	    || m_nDevice != 0			// DREQ lines are available for UART0 only
+	    || m_pInterruptSystem == 0)
+	{
+		return FALSE;
+	}
+
+	assert (!m_bUseDMA);
+	assert (nRxBufferSize >= 64);
+	assert ((nRxBufferSize & (nRxBufferSize-1)) == 0);
+	m_nRxDMASize = nRxBufferSize;
+
+	m_pRxDMABuffer = new (HEAP_DMA30) u32[m_nRxDMASize];
+	m_pTxDMABuffer = new (HEAP_DMA30) u32[SERIAL_BUF_SIZE];
+	if (   m_pRxDMABuffer == 0
+	    || m_pTxDMABuffer == 0)
+	{
+		delete [] m_pTxDMABuffer;
+		m_pTxDMABuffer = 0;
+
+		delete [] m_pRxDMABuffer;
+		m_pRxDMABuffer = 0;
+
+		return FALSE;
+	}
+
+	// a lite channel cannot hold a ring buffer with more than 16K characters
+	m_pRxDMA = new CDMAChannel (DMA_CHANNEL_NORMAL, m_pInterruptSystem);
+	m_pTxDMA = new CDMAChannel (DMA_CHANNEL_LITE, m_pInterruptSystem);
+	assert (m_pRxDMA != 0);
+	assert (m_pTxDMA != 0);
+
+	m_bUseDMA = TRUE;
+
+	return TRUE;
+#else
+	// DREQ lines of the RP1 UARTs are not supported yet
+	return FALSE;
+#endif
+}
+
+void CSerialDevice::RegisterIdleHandler (TIdleHandler *pHandler, void *pParam)
+{
+	assert (m_bUseDMA);
+	assert (pHandler != 0);
+
+	m_SpinLock.Acquire ();
+
+	m_pIdleParam = pParam;
+	m_pIdleHandler = pHandler;
+
+	m_SpinLock.Release ();
+
+	if (m_hIdleTimer == 0)
+	{
+		m_hIdleTimer = CTimer::Get ()->StartKernelTimer (IDLE_CHECK_TICKS, IdleTimerStub,
+								 0, this);
+	}
+}
+
+void CSerialDevice::SetLoopback (boolean bEnable)
+{
+	assert (m_bValid);
+
+	PeripheralEntry ();
+
+	u32 nCR = read32 (ARM_UART_CR);
+	if (bEnable)
+	{
+		nCR |= CR_LBE_MASK;
+	}
+	else
+	{
+		nCR &= ~CR_LBE_MASK;
+	}
+	write32 (ARM_UART_CR, nCR);
+
+	PeripheralExit ();
+}
+
 unsigned CSerialDevice::AvailableForWrite (void)
 {
 	assert (m_bValid);
@@ -794,7 +1005,11 @@ unsigned CSerialDevice::AvailableForRead (void)
 	m_SpinLock.Acquire ();
 
 	unsigned nResult;
-	if (m_nRxInPtr < m_nRxOutPtr)
+	if (m_bUseDMA)
+	{
+		nResult = GetRxDMAAvailable ();
+	}
+	else if (m_nRxInPtr < m_nRxOutPtr)
 	{
 		nResult = SERIAL_BUF_SIZE+m_nRxInPtr-m_nRxOutPtr;
 	}
@@ -816,7 +1031,16 @@ int CSerialDevice::Peek (void)
 	m_SpinLock.Acquire ();
 
 	int nResult = -1;
-	if (m_nRxInPtr != m_nRxOutPtr)
+	if (m_bUseDMA)
+	{
+		if (GetRxDMAAvailable () > 0)
+		{
+			InvalidateRxDMA (1);
+
+			nResult = m_pRxDMABuffer[m_nRxDMAOut & (m_nRxDMASize-1)] & 0xFF;
+		}
+	}
+	else if (m_nRxInPtr != m_nRxOutPtr)
 	{
 		nResult = m_RxBuffer[m_nRxOutPtr];
 	}
@@ -877,6 +1101,39 @@ boolean CSerialDevice::Write (u8 uchChar)
 
 void CSerialDevice::InterruptHandler (void)
 {
+	if (m_bUseDMA)
+	{
+		m_SpinLock.Acquire ();
+
+		PeripheralEntry ();
+
+		u32 nMIS = read32 (ARM_UART_MIS);
+		write32 (ARM_UART_ICR, nMIS);
+
+		PeripheralExit ();
+
+		if (nMIS & INT_RT)
+		{
+			DrainRxFIFO ();
+		}
+
+		unsigned nAvailable;
+		boolean bIdle = CheckRxIdle (TRUE, &nAvailable);
+
+		TIdleHandler *pIdleHandler = m_pIdleHandler;
+		void *pIdleParam = m_pIdleParam;
+
+		m_SpinLock.Release ();
+
+		if (   bIdle
+		    && pIdleHandler != 0)
+		{
+			(*pIdleHandler) (nAvailable, pIdleParam);
+		}
+
+		return;
+	}
+
 	boolean bMagicReceived = FALSE;
 
 	boolean bCharReceived = FALSE;
@@ -991,6 +1248,269 @@ void CSerialDevice::InterruptHandler (void)
 	}
 }
 
+unsigned CSerialDevice::GetRxDMAAvailable (void)
+{
+	assert (m_bUseDMA);
+	assert (m_pRxDMA != 0);
+
+	unsigned nIn = m_nRxDMALapBase + m_pRxDMA->GetCyclicReadPosition () / sizeof (u32);
+
+	// the DMA has wrapped around, but the completion interrupt is not handled yet
+	if ((int) (nIn - m_nRxDMAIn) < 0)
+	{
+		nIn += m_nRxDMASize;
+	}
+
+	m_nRxDMAIn = nIn;
+
+	if (m_nRxDMAIn - m_nRxDMAOut > m_nRxDMASize)
+	{
+		// unread characters have been overwritten, drop the ring buffer contents
+		m_nRxDMAOut = m_nRxDMAIn;
+
+		if (m_nRxStatus == 0)
+		{
+			m_nRxStatus = -SERIAL_ERROR_OVERRUN;
+		}
+	}
+
+	return m_nRxDMAIn - m_nRxDMAOut;
+}
+
+void CSerialDevice::InvalidateRxDMA (unsigned nCount)
+{
+	assert (nCount > 0);
+	assert (nCount <= m_nRxDMASize);
+	assert (m_pRxDMABuffer != 0);
+
+	unsigned nStart = m_nRxDMAOut & (m_nRxDMASize-1);
+	unsigned nFirst = m_nRxDMASize - nStart;
+	if (nFirst > nCount)
+	{
+		nFirst = nCount;
+	}
+
+	// words written by the CPU have been cleaned before, so the clean does nothing
+	CleanAndInvalidateDataCacheRange ((uintptr) &m_pRxDMABuffer[nStart], nFirst * sizeof (u32));
+
+	if (nCount > nFirst)
+	{
+		CleanAndInvalidateDataCacheRange ((uintptr) m_pRxDMABuffer,
+						  (nCount - nFirst) * sizeof (u32));
+	}
+}
+
+void CSerialDevice::DrainRxFIFO (void)
+{
+	assert (m_bUseDMA);
+	assert (m_pRxDMA != 0);
+	assert (m_pRxDMABuffer != 0);
+
+	PeripheralEntry ();
+
+	if (read32 (ARM_UART_FR) & FR_RXFE_MASK)
+	{
+		PeripheralExit ();
+
+		return;
+	}
+
+	// the characters below the DMA request level remain in the FIFO on receive timeout,
+	// so stop the DMA and append them to the ring buffer with the CPU
+	write32 (ARM_UART_DMACR, DMACR_TXDMAE);
+
+	PeripheralExit ();
+
+	// resets the channel, so that it does not resume the old control block on restart
+	m_pRxDMA->Cancel ();
+
+	GetRxDMAAvailable ();			// update m_nRxDMAIn from the final DMA position
+
+	unsigned nStart = m_nRxDMAIn & (m_nRxDMASize-1);
+	unsigned nCount = 0;
+
+	PeripheralEntry ();
+
+	while (!(read32 (ARM_UART_FR) & FR_RXFE_MASK))
+	{
+		// same format as written by the DMA, one word per character with the error flags
+		m_pRxDMABuffer[m_nRxDMAIn++ & (m_nRxDMASize-1)] = read32 (ARM_UART_DR);
+
+		nCount++;
+	}
+
+	PeripheralExit ();
+
+	// the DMA writes the following words of the same cache lines
+	unsigned nFirst = m_nRxDMASize - nStart;
+	if (nFirst > nCount)
+	{
+		nFirst = nCount;
+	}
+
+	CleanAndInvalidateDataCacheRange ((uintptr) &m_pRxDMABuffer[nStart], nFirst * sizeof (u32));
+
+	if (nCount > nFirst)
+	{
+		CleanAndInvalidateDataCacheRange ((uintptr) m_pRxDMABuffer,
+						  (nCount - nFirst) * sizeof (u32));
+	}
+
+	// continue the current lap behind these characters
+	m_nRxDMALapBase = m_nRxDMAIn & ~(m_nRxDMASize-1);
+
+	m_pRxDMA->SetCompletionRoutine (RxDMACompletionStub, this);
+	m_pRxDMA->StartCyclicRead ((m_nRxDMAIn & (m_nRxDMASize-1)) * sizeof (u32));
+
+	PeripheralEntry ();
+
+	write32 (ARM_UART_DMACR, DMACR_TXDMAE | DMACR_RXDMAE);
+
+	PeripheralExit ();
+}
+
+void CSerialDevice::StartTxDMA (void)
+{
+	assert (m_bUseDMA);
+
+	if (   m_nTxDMACount > 0
+	    || m_nTxInPtr == m_nTxOutPtr)
+	{
+		return;
+	}
+
+	// m_nTxOutPtr is advanced, when the transfer has completed
+	unsigned nPtr = m_nTxOutPtr;
+	unsigned nCount = 0;
+	while (nPtr != m_nTxInPtr)
+	{
+		m_pTxDMABuffer[nCount++] = m_TxBuffer[nPtr++];
+		nPtr &= SERIAL_BUF_MASK;
+	}
+
+	assert (nCount <= SERIAL_BUF_SIZE);
+	m_nTxDMACount = nCount;
+
+	assert (m_pTxDMA != 0);
+	m_pTxDMA->SetupIOWrite (ARM_UART_DR, m_pTxDMABuffer, nCount * sizeof (u32),
+				DREQSourceUARTTX);
+	m_pTxDMA->SetCompletionRoutine (TxDMACompletionStub, this);
+	m_pTxDMA->Start ();
+}
+
+boolean CSerialDevice::CheckRxIdle (boolean bTimeout, unsigned *pBytesAvailable)
+{
+	assert (pBytesAvailable != 0);
+	*pBytesAvailable = GetRxDMAAvailable ();
+
+	if (m_nRxDMAIn != m_nRxIdleIn)
+	{
+		m_nRxIdleIn = m_nRxDMAIn;
+		m_bRxActive = TRUE;
+
+		// the receive timeout interrupt reports an idle line immediately
+		if (!bTimeout)
+		{
+			return FALSE;
+		}
+	}
+
+	if (!m_bRxActive)
+	{
+		return FALSE;
+	}
+
+	m_bRxActive = FALSE;
+
+	return TRUE;
+}
+
+void CSerialDevice::RxDMACompletionRoutine (boolean bStatus)
+{
+	m_SpinLock.Acquire ();
+
+	if (bStatus)
+	{
+		// the DMA has reached the end of the ring buffer
+		m_nRxDMALapBase += m_nRxDMASize;
+		if ((int) (m_nRxDMAIn - m_nRxDMALapBase) < 0)
+		{
+			m_nRxDMAIn = m_nRxDMALapBase;
+		}
+	}
+	else
+	{
+		// the DMA has stopped, there will be no more data
+		if (m_nRxStatus == 0)
+		{
+			m_nRxStatus = -SERIAL_ERROR_OVERRUN;
+		}
+	}
+
+	m_SpinLock.Release ();
+}
+
+void CSerialDevice::RxDMACompletionStub (unsigned nChannel, unsigned nBuffer,
+					 boolean bStatus, void *pParam)
+{
+	CSerialDevice *pThis = (CSerialDevice *) pParam;
+	assert (pThis != 0);
+
+	pThis->RxDMACompletionRoutine (bStatus);
+}
+
+void CSerialDevice::TxDMACompletionRoutine (boolean bStatus)
+{
+	m_SpinLock.Acquire ();
+
+	// on error the characters are dropped, like on a line without receiver
+	assert (m_nTxDMACount > 0);
+	m_nTxOutPtr = (m_nTxOutPtr + m_nTxDMACount) & SERIAL_BUF_MASK;
+	m_nTxDMACount = 0;
+
+	StartTxDMA ();
+
+	m_SpinLock.Release ();
+}
+
+void CSerialDevice::TxDMACompletionStub (unsigned nChannel, unsigned nBuffer,
+					 boolean bStatus, void *pParam)
+{
+	CSerialDevice *pThis = (CSerialDevice *) pParam;
+	assert (pThis != 0);
+
+	pThis->TxDMACompletionRoutine (bStatus);
+}
+
+void CSerialDevice::IdleTimerHandler (TKernelTimerHandle hTimer)
+{
+	m_SpinLock.Acquire ();
+
+	unsigned nAvailable;
+	boolean bIdle = CheckRxIdle (FALSE, &nAvailable);
+
+	TIdleHandler *pIdleHandler = m_pIdleHandler;
+	void *pIdleParam = m_pIdleParam;
+
+	m_SpinLock.Release ();
+
+	if (   bIdle
+	    && pIdleHandler != 0)
+	{
+		(*pIdleHandler) (nAvailable, pIdleParam);
+	}
+
+	m_hIdleTimer = CTimer::Get ()->StartKernelTimer (IDLE_CHECK_TICKS, IdleTimerStub, 0, this);
+}
+
+void CSerialDevice::IdleTimerStub (TKernelTimerHandle hTimer, void *pParam, void *pContext)
+{
+	CSerialDevice *pThis = (CSerialDevice *) pContext;
+	assert (pThis != 0);
+
+	pThis->IdleTimerHandler (hTimer);
+}
+
 void CSerialDevice::InterruptStub (void *pParam)
 {
 	DataMemBarrier ();
@@ -129,6 +129,13 @@
 #define DMA_REQUEST_THRESH  2
 #define DMA_PANIC_LEVEL		8
 
+#define DMC_VALUE	(  (DMA_REQUEST_THRESH << DMC_REQW__SHIFT) | (DMA_REQUEST_THRESH << DMC_REQR__SHIFT) \
+			 | (DMA_PANIC_LEVEL << DMC_PANICW__SHIFT) | (DMA_PANIC_LEVEL << DMC_PANICR__SHIFT) | DMC_DMAEN)
+
+// Streaming (the transfer counter is re-armed, when it has expired at a buffer boundary)
+#define STREAM_MAX_TRANSFERS	0xFFFFFFFFU
+#define STREAM_DONE_TIMEOUT_US	1000		// max. wait for the FIFO to drain on re-arm
+
 // Clock
 #define CM_SMICTL_FLIP (1 << 8)
 #define CM_SMICTL_BUSY (1 << 7)
@@ -145,11 +152,18 @@
 
 
 
-CSMIMaster::CSMIMaster(unsigned nSDLinesMask, boolean bUseAddressPins) :
+CSMIMaster::CSMIMaster(unsigned nSDLinesMask, boolean bUseAddressPins, CInterruptSystem *pInterruptSystem) :
 	m_nSDLinesMask (nSDLinesMask),
 	m_bUseAddressPins (bUseAddressPins),
-	m_txDMA (DMA_CHANNEL_LITE /*DMA_CHANNEL_NORMAL*/),
-	m_pDMABuffer (0)
+	m_txDMA (DMA_CHANNEL_LITE /*DMA_CHANNEL_NORMAL*/, pInterruptSystem),
+	m_pDMABuffer (0),
+	m_nWidth (SMI8Bits),
+	m_pStreamHandler (0),
+	m_pStreamParam (0),
+	m_bStreamActive (FALSE),
+	m_nStreamTransfers (0),
+	m_nStreamBuffers (0),
+	m_nStreamBuffersLeft (0)
 {
 	if (m_bUseAddressPins) {
 		for (unsigned i = 0 ; i < SMI_NUM_ADDRESS_LINES ; i++) {
@@ -167,6 +181,8 @@ CSMIMaster::CSMIMaster(unsigned nSDLinesMask, boolean bUseAddressPins) :
 
 CSMIMaster::~CSMIMaster (void)
 {
+	StopStream ();
+
 	if (m_bUseAddressPins) {
 		for (unsigned i = 0 ; i < SMI_NUM_ADDRESS_LINES ; i++) {
 			m_addressGpios[i].SetMode(GPIOModeInput);
@@ -221,6 +237,11 @@ void CSMIMaster::WriteDMA(boolean bWaitForCompletion)
 	if (bWaitForCompletion) m_txDMA.Wait();
 }
 
+void CSMIMaster::WaitDMA()
+{
+	m_txDMA.Wait();
+}
+
 void CSMIMaster::SetupTiming(TSMIDataWidth nWidth, unsigned nCycle_ns, unsigned nSetup, unsigned nStrobe, unsigned nHold, unsigned nPace, unsigned nDevice)
 {
 	uintptr readReg, writeReg;
@@ -247,6 +268,8 @@ void CSMIMaster::SetupTiming(TSMIDataWidth nWidth, unsigned nCycle_ns, unsigned
 		writeReg = ARM_SMI_DSW0;
 		break;
 	}
+	m_nWidth = nWidth;
+
 	PeripheralEntry ();
 
 	// Reset SMI regs
@@ -298,7 +321,7 @@ void CSMIMaster::SetupDMA(void *pDMABuffer, unsigned nLength)
 	m_nLength = nLength;
 
 	PeripheralEntry ();
-	write32(ARM_SMI_DMC, (DMA_REQUEST_THRESH << DMC_REQW__SHIFT) | (DMA_REQUEST_THRESH << DMC_REQR__SHIFT) | (DMA_PANIC_LEVEL << DMC_PANICW__SHIFT) | (DMA_PANIC_LEVEL << DMC_PANICR__SHIFT) | DMC_DMAEN);
+	write32(ARM_SMI_DMC, DMC_VALUE);
 	write32(ARM_SMI_CS, read32(ARM_SMI_CS) | CS_ENABLE | CS_CLEAR | CS_PXLDAT); // CS_PXLDAT packs the 8 or 16 bit data into 32-bit double-words
 	write32(ARM_SMI_L, nLength);
 	write32(ARM_SMI_CS, read32(ARM_SMI_CS) | CS_WRITE);
@@ -315,3 +338,147 @@ void CSMIMaster::SetDeviceAndAddress (unsigned nDevice, unsigned nAddr) {
 	write32(ARM_SMI_DCA, val);
 	PeripheralExit ();
 }
+
+void CSMIMaster::StartWriteStream (const void *ppBuffers[], unsigned nBuffers, unsigned nBufferLength,
+				   TStreamHandler *pHandler, void *pParam)
+{
+	assert (!m_bStreamActive);
+	assert (ppBuffers != 0);
+	assert (2 <= nBuffers && nBuffers <= MaxStreamBuffers);
+	assert (nBufferLength > 0 && nBufferLength % 4 == 0);
+
+	// the control blocks are chained, so that the next buffer follows without a gap
+	m_txDMA.SetupCyclicIOWrite (ARM_SMI_D, ppBuffers, nBuffers, nBufferLength, DREQSourceSMI);
+
+	StartStream (TRUE, nBufferLength, pHandler, pParam);
+}
+
+void CSMIMaster::StartReadStream (void *pBuffer, unsigned nBuffers, unsigned nBufferLength,
+				  TStreamHandler *pHandler, void *pParam)
+{
+	assert (!m_bStreamActive);
+	assert (pBuffer != 0);
+	assert (2 <= nBuffers && nBuffers <= MaxStreamBuffers);
+	assert (nBufferLength > 0 && nBufferLength % 4 == 0);
+
+	m_txDMA.SetupCyclicIORead (pBuffer, ARM_SMI_D, nBuffers * nBufferLength, DREQSourceSMI,
+				   nBuffers);
+
+	StartStream (FALSE, nBufferLength, pHandler, pParam);
+}
+
+void CSMIMaster::StopStream (void)
+{
+	if (!m_bStreamActive)
+	{
+		return;
+	}
+
+	m_bStreamActive = FALSE;
+
+	// stop the SMI first, so that no further DREQs are generated
+	PeripheralEntry ();
+	write32(ARM_SMI_CS, read32(ARM_SMI_CS) & ~(CS_ENABLE | CS_START | CS_WRITE));
+	PeripheralExit ();
+
+	// abort and reset the DMA channel, a paused channel would resume the old stream
+	m_txDMA.Cancel ();
+
+	PeripheralEntry ();
+	write32(ARM_SMI_CS, CS_CLEAR | CS_AFERR);	// clear FIFO and FIFO error flag
+	PeripheralExit ();
+}
+
+void CSMIMaster::StartStream (boolean bWrite, unsigned nBufferLength,
+			      TStreamHandler *pHandler, void *pParam)
+{
+	assert (pHandler != 0);
+	m_pStreamHandler = pHandler;
+	m_pStreamParam = pParam;
+
+	// the transfer counter has to expire at a buffer boundary, so that it can be
+	// re-armed from the completion routine, while the DMA waits for the next DREQ
+	unsigned nBytesPerTransfer = m_nWidth == SMI8Bits ? 1 : (m_nWidth == SMI18Bits ? 4 : 2);
+	assert (nBufferLength % nBytesPerTransfer == 0);
+	unsigned nTransfersPerBuffer = nBufferLength / nBytesPerTransfer;
+
+	m_nStreamBuffers = STREAM_MAX_TRANSFERS / nTransfersPerBuffer;
+	m_nStreamBuffersLeft = m_nStreamBuffers;
+	m_nStreamTransfers = m_nStreamBuffers * nTransfersPerBuffer;
+
+	m_bStreamActive = TRUE;
+
+	m_txDMA.SetCompletionRoutine (DMACompletionStub, this);
+
+	PeripheralEntry ();
+	write32(ARM_SMI_DMC, DMC_VALUE);
+	write32(ARM_SMI_CS, CS_ENABLE | CS_CLEAR | CS_AFERR | CS_PXLDAT | (bWrite ? CS_WRITE : 0));
+	write32(ARM_SMI_L, m_nStreamTransfers);
+	PeripheralExit ();
+
+	// the DMA waits for the DREQ, which is generated after the SMI has been started
+	m_txDMA.Start ();
+
+	PeripheralEntry ();
+	write32(ARM_SMI_CS, read32(ARM_SMI_CS) | CS_START);
+	PeripheralExit ();
+}
+
+void CSMIMaster::DMACompletionRoutine (unsigned nBuffer, boolean bStatus)
+{
+	if (!m_bStreamActive)
+	{
+		return;
+	}
+
+	if (   bStatus
+	    && --m_nStreamBuffersLeft == 0)
+	{
+		bStatus = RearmStream ();
+	}
+
+	if (!bStatus)
+	{
+		// resets the DMA channel too
+		StopStream ();
+	}
+
+	assert (m_pStreamHandler != 0);
+	(*m_pStreamHandler) (nBuffer, bStatus, m_pStreamParam);
+}
+
+boolean CSMIMaster::RearmStream (void)
+{
+	m_nStreamBuffersLeft = m_nStreamBuffers;
+
+	PeripheralEntry ();
+
+	// on write the FIFO may still be draining
+	unsigned nStartTicks = CTimer::GetClockTicks ();
+	u32 nCS;
+	while (!((nCS = read32(ARM_SMI_CS)) & CS_DONE))
+	{
+		if (CTimer::GetClockTicks () - nStartTicks >= STREAM_DONE_TIMEOUT_US * (CLOCKHZ / 1000000))
+		{
+			PeripheralExit ();
+
+			return FALSE;
+		}
+	}
+
+	// the FIFO is not cleared here, it may hold data of the next buffer already
+	write32(ARM_SMI_L, m_nStreamTransfers);
+	write32(ARM_SMI_CS, nCS | CS_START);		// also clears CS_DONE
+
+	PeripheralExit ();
+
+	return TRUE;
+}
+
+void CSMIMaster::DMACompletionStub (unsigned nChannel, unsigned nBuffer, boolean bStatus, void *pParam)
+{
+	CSMIMaster *pThis = (CSMIMaster *) pParam;
+	assert (pThis != 0);
+
+	pThis->DMACompletionRoutine (nBuffer, bStatus);
+}
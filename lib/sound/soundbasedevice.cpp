@@ -18,10 +18,26 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 #include <circle/sound/soundbasedevice.h>
+#include <circle/sound/soundmixer.h>
+#include <circle/timer.h>
 #include <circle/macros.h>
 #include <circle/util.h>
 #include <assert.h>
 
+// The queues are single producer / single consumer ring buffers. Each pointer is written
+// by one side only and is published with release semantics, after the data has been
+// copied, so that no lock is needed.
+
+static inline unsigned LoadAcquire (const volatile unsigned *pPtr)
+{
+	return __atomic_load_n (pPtr, __ATOMIC_ACQUIRE);
+}
+
+static inline void StoreRelease (volatile unsigned *pPtr, unsigned nValue)
+{
+	__atomic_store_n (pPtr, nValue, __ATOMIC_RELEASE);
+}
+
 CSoundBaseDevice::CSoundBaseDevice (void)
 :	m_HWFormat (SoundFormatUnknown),
 	m_nQueueSize (0),
@@ -32,6 +48,9 @@ CSoundBaseDevice::CSoundBaseDevice (void)
 	m_nInPtr (0),
 	m_nOutPtr (0),
 	m_pCallback (0),
+	m_pRenderCallback (0),
+	m_pRenderCallbackParam (0),
+	m_pMixer (0),
 	m_nReadQueueSize (0),
 	m_nHaveDataThreshold (0),
 	m_ReadFormat (SoundFormatUnknown),
@@ -42,6 +61,7 @@ CSoundBaseDevice::CSoundBaseDevice (void)
 	m_pReadCallback (0),
 	m_pReadCallbackParam (0)
 {
+	ResetStatistics ();
 }
 
 CSoundBaseDevice::CSoundBaseDevice (TSoundFormat HWFormat, u32 nRange32, unsigned nSampleRate,
@@ -55,6 +75,9 @@ CSoundBaseDevice::CSoundBaseDevice (TSoundFormat HWFormat, u32 nRange32, unsigne
 	m_nInPtr (0),
 	m_nOutPtr (0),
 	m_pCallback (0),
+	m_pRenderCallback (0),
+	m_pRenderCallbackParam (0),
+	m_pMixer (0),
 	m_nReadQueueSize (0),
 	m_nHaveDataThreshold (0),
 	m_ReadFormat (SoundFormatUnknown),
@@ -65,12 +88,15 @@ CSoundBaseDevice::CSoundBaseDevice (TSoundFormat HWFormat, u32 nRange32, unsigne
 	m_pReadCallback (0),
 	m_pReadCallbackParam (0)
 {
+	ResetStatistics ();
+
 	Setup (HWFormat, nRange32, nSampleRate, 2, 2, bSwapChannels);
 }
 
 CSoundBaseDevice::~CSoundBaseDevice (void)
 {
 	m_pCallback = 0;
+	m_pRenderCallback = 0;
 	m_pReadCallback = 0;
 
 	delete [] m_pQueue;
@@ -166,6 +192,11 @@ void CSoundBaseDevice::Setup (TSoundFormat HWFormat, u32 nRange32, unsigned nSam
 	}
 }
 
+TSoundFormat CSoundBaseDevice::GetHWFormat (void) const
+{
+	return m_HWFormat;
+}
+
 unsigned CSoundBaseDevice::GetHWTXChannels (void) const
 {
 	return m_nHWTXChannels;
@@ -269,8 +300,6 @@ int CSoundBaseDevice::Write (const void *pBuffer, size_t nCount)
 
 	int nResult = 0;
 
-	m_SpinLock.Acquire ();
-
 	if (   m_HWFormat == m_WriteFormat
 	    && m_nWriteChannels == m_nHWTXChannels
 	    && !m_bSwapChannels)
@@ -372,8 +401,6 @@ int CSoundBaseDevice::Write (const void *pBuffer, size_t nCount)
 		}
 	}
 
-	m_SpinLock.Release ();
-
 	return nResult;
 }
 
@@ -387,13 +414,7 @@ unsigned CSoundBaseDevice::GetQueueFramesAvail (void)
 {
 	assert (m_nQueueSize > 0);
 
-	m_SpinLock.Acquire ();
-
-	unsigned nQueueBytesAvail = GetQueueBytesAvail ();
-
-	m_SpinLock.Release ();
-
-	return nQueueBytesAvail / m_nHWTXFrameSize;
+	return GetQueueBytesAvail () / m_nHWTXFrameSize;
 }
 
 void CSoundBaseDevice::RegisterNeedDataCallback (TSoundDataCallback *pCallback, void *pParam)
@@ -410,6 +431,36 @@ boolean CSoundBaseDevice::AreChannelsSwapped (void) const
 	return m_bSwapChannels;
 }
 
+void CSoundBaseDevice::RegisterRenderCallback (TSoundRenderCallback *pCallback, void *pParam)
+{
+	assert (m_pRenderCallback == 0);
+	assert (m_pMixer == 0);
+
+	m_pRenderCallbackParam = pParam;
+	m_pRenderCallback = pCallback;
+	assert (m_pRenderCallback != 0);
+}
+
+void CSoundBaseDevice::GetStatistics (TSoundStatistics *pStatistics)
+{
+	assert (pStatistics != 0);
+	*pStatistics = m_Statistics;
+
+	pStatistics->nLatencyFrames = 2 * pStatistics->nChunkFrames;
+	if (   m_pQueue != 0
+	    && m_pRenderCallback == 0
+	    && m_pMixer == 0)
+	{
+		pStatistics->nLatencyFrames += GetQueueFramesAvail ();
+	}
+}
+
+void CSoundBaseDevice::ResetStatistics (void)
+{
+	memset (&m_Statistics, 0, sizeof m_Statistics);
+	m_Statistics.nQueueFramesMin = (unsigned) -1;
+}
+
 // Input //////////////////////////////////////////////////////////////
 
 boolean CSoundBaseDevice::AllocateReadQueue (unsigned nSizeMsecs)
@@ -495,8 +546,6 @@ int CSoundBaseDevice::Read (void *pBuffer, size_t nCount)
 
 	int nResult = 0;
 
-	m_ReadSpinLock.Acquire ();
-
 	if (   m_HWFormat == m_ReadFormat
 	    && m_nReadChannels == m_nHWRXChannels)
 	{
@@ -595,8 +644,6 @@ int CSoundBaseDevice::Read (void *pBuffer, size_t nCount)
 		}
 	}
 
-	m_ReadSpinLock.Release ();
-
 	return nResult;
 }
 
@@ -610,13 +657,7 @@ unsigned CSoundBaseDevice::GetReadQueueFramesAvail (void)
 {
 	assert (m_nReadQueueSize > 0);
 
-	m_ReadSpinLock.Acquire ();
-
-	unsigned nReadQueueBytesAvail = GetReadQueueBytesAvail ();
-
-	m_ReadSpinLock.Release ();
-
-	return nReadQueueBytesAvail / m_nHWRXFrameSize;
+	return GetReadQueueBytesAvail () / m_nHWRXFrameSize;
 }
 
 void CSoundBaseDevice::RegisterHaveDataCallback (TSoundDataCallback *pCallback, void *pParam)
@@ -760,24 +801,70 @@ unsigned CSoundBaseDevice::GetChunkInternal (void *pBuffer, unsigned nChunkSize)
 	assert (nChunkSize % m_nHWTXChannels == 0);
 	unsigned nChunkSizeBytes = nChunkSize * m_nHWSampleSize;
 
-	m_SpinLock.Acquire ();
+	unsigned nStartTicks = CTimer::GetClockTicks ();
 
-	unsigned nQueueBytesAvail = GetQueueBytesAvail ();
-	unsigned nBytes = nQueueBytesAvail;
-	if (nBytes > nChunkSizeBytes)
+	unsigned nBytes;
+	unsigned nQueueBytesAvail;
+	if (m_pRenderCallback != 0)
 	{
+		(*m_pRenderCallback) (pBuffer8, nChunkSize / m_nHWTXChannels, m_pRenderCallbackParam);
+
+		// convert 24-bit samples into IEC958 sub-frames without control bits
+		if (m_HWFormat == SoundFormatIEC958)
+		{
+			u32 *pBuffer32 = static_cast<u32 *> (pBuffer);
+			for (unsigned i = 0; i < nChunkSize; i++)
+			{
+				u32 nValue = (pBuffer32[i] & 0xFFFFFF) << 4;
+				if (parity32 (nValue))
+				{
+					nValue |= 0x80000000;
+				}
+
+				pBuffer32[i] = nValue;
+			}
+		}
+
 		nBytes = nChunkSizeBytes;
+		nQueueBytesAvail = m_nNeedDataThreshold;	// no need data callback
 	}
-
-	if (nBytes > 0)
+	else if (m_pMixer != 0)
 	{
-		Dequeue (pBuffer8, nBytes);
+		m_pMixer->Mix (pBuffer8, nChunkSize);
 
-		pBuffer8 += nBytes;
-		nQueueBytesAvail -= nBytes;
+		nBytes = nChunkSizeBytes;
+		nQueueBytesAvail = m_nNeedDataThreshold;
 	}
+	else
+	{
+		nQueueBytesAvail = m_pQueue != 0 ? GetQueueBytesAvail () : 0;
+
+		unsigned nQueueFrames = nQueueBytesAvail / m_nHWTXFrameSize;
+		if (nQueueFrames < m_Statistics.nQueueFramesMin)
+		{
+			m_Statistics.nQueueFramesMin = nQueueFrames;
+		}
+
+		nBytes = nQueueBytesAvail;
+		if (nBytes > nChunkSizeBytes)
+		{
+			nBytes = nChunkSizeBytes;
+		}
+
+		if (nBytes > 0)
+		{
+			Dequeue (pBuffer8, nBytes);
+
+			pBuffer8 += nBytes;
+			nQueueBytesAvail -= nBytes;
+		}
 
-	m_SpinLock.Release ();
+		if (nBytes < nChunkSizeBytes)
+		{
+			m_Statistics.nUnderruns++;
+			m_Statistics.nUnderrunFrames += (nChunkSizeBytes - nBytes) / m_nHWTXFrameSize;
+		}
+	}
 
 	while (nBytes < nChunkSizeBytes)
 	{
@@ -832,35 +919,50 @@ unsigned CSoundBaseDevice::GetChunkInternal (void *pBuffer, unsigned nChunkSize)
 		(*m_pCallback) (m_pCallbackParam);
 	}
 
+	unsigned nTicks = CTimer::GetClockTicks () - nStartTicks;
+	m_Statistics.nChunks++;
+	m_Statistics.nChunkFrames = nChunkSize / m_nHWTXChannels;
+	m_Statistics.nChunkTimeLast = nTicks;
+	if (nTicks > m_Statistics.nChunkTimeMax)
+	{
+		m_Statistics.nChunkTimeMax = nTicks;
+	}
+
 	return nChunkSize;
 }
 
 unsigned CSoundBaseDevice::GetQueueBytesFree (void)
 {
 	assert (m_nQueueSize > 1);
-	assert (m_nInPtr < m_nQueueSize);
-	assert (m_nOutPtr < m_nQueueSize);
 
-	if (m_nOutPtr <= m_nInPtr)
+	unsigned nInPtr = m_nInPtr;
+	unsigned nOutPtr = LoadAcquire (&m_nOutPtr);
+	assert (nInPtr < m_nQueueSize);
+	assert (nOutPtr < m_nQueueSize);
+
+	if (nOutPtr <= nInPtr)
 	{
-		return m_nQueueSize+m_nOutPtr-m_nInPtr-1;
+		return m_nQueueSize+nOutPtr-nInPtr-1;
 	}
 
-	return m_nOutPtr-m_nInPtr-1;
+	return nOutPtr-nInPtr-1;
 }
 
 unsigned CSoundBaseDevice::GetQueueBytesAvail (void)
 {
 	assert (m_nQueueSize > 1);
-	assert (m_nInPtr < m_nQueueSize);
-	assert (m_nOutPtr < m_nQueueSize);
 
-	if (m_nInPtr < m_nOutPtr)
+	unsigned nInPtr = LoadAcquire (&m_nInPtr);
+	unsigned nOutPtr = LoadAcquire (&m_nOutPtr);
+	assert (nInPtr < m_nQueueSize);
+	assert (nOutPtr < m_nQueueSize);
+
+	if (nInPtr < nOutPtr)
 	{
-		return m_nQueueSize+m_nInPtr-m_nOutPtr;
+		return m_nQueueSize+nInPtr-nOutPtr;
 	}
 
-	return m_nInPtr-m_nOutPtr;
+	return nInPtr-nOutPtr;
 }
 
 void CSoundBaseDevice::Enqueue (const void *pBuffer, unsigned nCount)
@@ -870,15 +972,23 @@ void CSoundBaseDevice::Enqueue (const void *pBuffer, unsigned nCount)
 	assert (m_pQueue != 0);
 
 	assert (nCount > 0);
-	while (nCount-- > 0)
+	unsigned nInPtr = m_nInPtr;
+	unsigned nFirst = m_nQueueSize - nInPtr;
+	if (nFirst > nCount)
 	{
-		m_pQueue[m_nInPtr] = *p++;
+		nFirst = nCount;
+	}
 
-		if (++m_nInPtr == m_nQueueSize)
-		{
-			m_nInPtr = 0;
-		}
+	memcpy (m_pQueue + nInPtr, p, nFirst);
+	memcpy (m_pQueue, p + nFirst, nCount - nFirst);
+
+	nInPtr += nCount;
+	if (nInPtr >= m_nQueueSize)
+	{
+		nInPtr -= m_nQueueSize;
 	}
+
+	StoreRelease (&m_nInPtr, nInPtr);
 }
 
 void CSoundBaseDevice::Dequeue (void *pBuffer, unsigned nCount)
@@ -888,15 +998,23 @@ void CSoundBaseDevice::Dequeue (void *pBuffer, unsigned nCount)
 	assert (m_pQueue != 0);
 
 	assert (nCount > 0);
-	while (nCount-- > 0)
+	unsigned nOutPtr = m_nOutPtr;
+	unsigned nFirst = m_nQueueSize - nOutPtr;
+	if (nFirst > nCount)
 	{
-		*p++ = m_pQueue[m_nOutPtr];
+		nFirst = nCount;
+	}
 
-		if (++m_nOutPtr == m_nQueueSize)
-		{
-			m_nOutPtr = 0;
-		}
+	memcpy (p, m_pQueue + nOutPtr, nFirst);
+	memcpy (p + nFirst, m_pQueue, nCount - nFirst);
+
+	nOutPtr += nCount;
+	if (nOutPtr >= m_nQueueSize)
+	{
+		nOutPtr -= m_nQueueSize;
 	}
+
+	StoreRelease (&m_nOutPtr, nOutPtr);
 }
 
 // Input //////////////////////////////////////////////////////////////
@@ -925,8 +1043,6 @@ void CSoundBaseDevice::PutChunkInternal (const void *pBuffer, unsigned nChunkSiz
 	assert (nChunkSize % m_nHWRXChannels == 0);
 	unsigned nChunkSizeBytes = nChunkSize * m_nHWSampleSize;
 
-	m_ReadSpinLock.Acquire ();
-
 	unsigned nReadQueueBytesFree = GetReadQueueBytesFree ();
 	unsigned nBytes = nReadQueueBytesFree;
 	if (nBytes > nChunkSizeBytes)
@@ -941,8 +1057,6 @@ void CSoundBaseDevice::PutChunkInternal (const void *pBuffer, unsigned nChunkSiz
 		nReadQueueBytesFree -= nBytes;
 	}
 
-	m_ReadSpinLock.Release ();
-
 	if (   m_pReadCallback != 0
 	    && nReadQueueBytesFree < m_nHaveDataThreshold)
 	{
@@ -1005,29 +1119,35 @@ void CSoundBaseDevice::ConvertReadSoundFormat (void *pTo, const void *pFrom)
 unsigned CSoundBaseDevice::GetReadQueueBytesFree (void)
 {
 	assert (m_nReadQueueSize > 1);
-	assert (m_nReadInPtr < m_nReadQueueSize);
-	assert (m_nReadOutPtr < m_nReadQueueSize);
 
-	if (m_nReadOutPtr <= m_nReadInPtr)
+	unsigned nInPtr = m_nReadInPtr;
+	unsigned nOutPtr = LoadAcquire (&m_nReadOutPtr);
+	assert (nInPtr < m_nReadQueueSize);
+	assert (nOutPtr < m_nReadQueueSize);
+
+	if (nOutPtr <= nInPtr)
 	{
-		return m_nReadQueueSize+m_nReadOutPtr-m_nReadInPtr-1;
+		return m_nReadQueueSize+nOutPtr-nInPtr-1;
 	}
 
-	return m_nReadOutPtr-m_nReadInPtr-1;
+	return nOutPtr-nInPtr-1;
 }
 
 unsigned CSoundBaseDevice::GetReadQueueBytesAvail (void)
 {
 	assert (m_nReadQueueSize > 1);
-	assert (m_nReadInPtr < m_nReadQueueSize);
-	assert (m_nReadOutPtr < m_nReadQueueSize);
 
-	if (m_nReadInPtr < m_nReadOutPtr)
+	unsigned nInPtr = LoadAcquire (&m_nReadInPtr);
+	unsigned nOutPtr = LoadAcquire (&m_nReadOutPtr);
+	assert (nInPtr < m_nReadQueueSize);
+	assert (nOutPtr < m_nReadQueueSize);
+
+	if (nInPtr < nOutPtr)
 	{
-		return m_nReadQueueSize+m_nReadInPtr-m_nReadOutPtr;
+		return m_nReadQueueSize+nInPtr-nOutPtr;
 	}
 
-	return m_nReadInPtr-m_nReadOutPtr;
+	return nInPtr-nOutPtr;
 }
 
 void CSoundBaseDevice::ReadEnqueue (const void *pBuffer, unsigned nCount)
@@ -1037,15 +1157,23 @@ void CSoundBaseDevice::ReadEnqueue (const void *pBuffer, unsigned nCount)
 	assert (m_pReadQueue != 0);
 
 	assert (nCount > 0);
-	while (nCount-- > 0)
+	unsigned nInPtr = m_nReadInPtr;
+	unsigned nFirst = m_nReadQueueSize - nInPtr;
+	if (nFirst > nCount)
 	{
-		m_pReadQueue[m_nReadInPtr] = *p++;
+		nFirst = nCount;
+	}
 
-		if (++m_nReadInPtr == m_nReadQueueSize)
-		{
-			m_nReadInPtr = 0;
-		}
+	memcpy (m_pReadQueue + nInPtr, p, nFirst);
+	memcpy (m_pReadQueue, p + nFirst, nCount - nFirst);
+
+	nInPtr += nCount;
+	if (nInPtr >= m_nReadQueueSize)
+	{
+		nInPtr -= m_nReadQueueSize;
 	}
+
+	StoreRelease (&m_nReadInPtr, nInPtr);
 }
 
 void CSoundBaseDevice::ReadDequeue (void *pBuffer, unsigned nCount)
@@ -1055,13 +1183,21 @@ void CSoundBaseDevice::ReadDequeue (void *pBuffer, unsigned nCount)
 	assert (m_pReadQueue != 0);
 
 	assert (nCount > 0);
-	while (nCount-- > 0)
+	unsigned nOutPtr = m_nReadOutPtr;
+	unsigned nFirst = m_nReadQueueSize - nOutPtr;
+	if (nFirst > nCount)
 	{
-		*p++ = m_pReadQueue[m_nReadOutPtr];
+		nFirst = nCount;
+	}
 
-		if (++m_nReadOutPtr == m_nReadQueueSize)
-		{
-			m_nReadOutPtr = 0;
-		}
+	memcpy (p, m_pReadQueue + nOutPtr, nFirst);
+	memcpy (p + nFirst, m_pReadQueue, nCount - nFirst);
+
+	nOutPtr += nCount;
+	if (nOutPtr >= m_nReadQueueSize)
+	{
+		nOutPtr -= m_nReadQueueSize;
 	}
+
+	StoreRelease (&m_nReadOutPtr, nOutPtr);
 }
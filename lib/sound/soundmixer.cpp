@@ -0,0 +1,738 @@
+//
+// soundmixer.cpp
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <circle/sound/soundmixer.h>
+#include <circle/util.h>
+#include <assert.h>
+
+// The mixer works on 24-bit signed stereo samples, which are summed up in a 32-bit
+// accumulator. Gains are Q15 values (0x8000 is unity). Vector types are handled by
+// the compiler (NEON on ARM), which must not assume alignment here.
+
+#define GAIN_UNITY	0x8000
+
+#define SAMPLE_MAX	((1 << 23) - 1)
+#define SAMPLE_MIN	(-(1 << 23) + 1)
+
+typedef s32 TVectorS32 __attribute__ ((vector_size (16), aligned (1), may_alias));
+typedef u32 TVectorU32 __attribute__ ((vector_size (16), aligned (1), may_alias));
+typedef s16 TVectorS16x4 __attribute__ ((vector_size (8), aligned (1), may_alias));
+
+static inline s32 ApplyGain (s32 nSample, s32 nGain)
+{
+	if (nGain == GAIN_UNITY)
+	{
+		return nSample;
+	}
+
+	// (nSample * nGain) >> 15 without overflowing 32 bits
+	return ((nSample >> 8) * nGain) >> 7;
+}
+
+static inline TVectorS32 Clamp (TVectorS32 Value, s32 nMin, s32 nMax)
+{
+	TVectorS32 Min = (TVectorS32) {} + nMin;
+	TVectorS32 Max = (TVectorS32) {} + nMax;
+
+	TVectorS32 Mask = Value < Min;
+	Value = (Value & ~Mask) | (Min & Mask);
+
+	Mask = Value > Max;
+	return (Value & ~Mask) | (Max & Mask);
+}
+
+static inline s32 Clamp (s32 nValue, s32 nMin, s32 nMax)
+{
+	return nValue < nMin ? nMin : (nValue > nMax ? nMax : nValue);
+}
+
+// returns a 24-bit signed sample
+static inline s32 GetSample (const u8 *pFrom, TSoundFormat Format)
+{
+	switch (Format)
+	{
+	case SoundFormatUnsigned8:
+		return ((s32) *pFrom - 128) << 16;
+
+	case SoundFormatSigned16:
+		return (s32) *(const s16 *) pFrom << 8;
+
+	case SoundFormatSigned24:
+		return (s32) ((u32) pFrom[0] << 8 | (u32) pFrom[1] << 16 | (u32) pFrom[2] << 24) >> 8;
+
+	case SoundFormatSigned24_32:
+		return (s32) (*(const u32 *) pFrom << 8) >> 8;
+
+	default:
+		assert (0);
+		return 0;
+	}
+}
+
+static unsigned GetSampleSize (TSoundFormat Format)
+{
+	switch (Format)
+	{
+	case SoundFormatUnsigned8:	return sizeof (u8);
+	case SoundFormatSigned16:	return sizeof (s16);
+	case SoundFormatSigned24:	return sizeof (u8)*3;
+	case SoundFormatSigned24_32:	return sizeof (u32);
+
+	default:
+		assert (0);
+		return 0;
+	}
+}
+
+//// CSoundMixerStream /////////////////////////////////////////////////////////
+
+CSoundMixerStream::CSoundMixerStream (CSoundMixer *pMixer, TSoundFormat Format,
+				      unsigned nChannels, unsigned nQueueSizeMsecs)
+:	m_pMixer (pMixer),
+	m_Format (Format),
+	m_nChannels (nChannels),
+	m_nVolume (SOUND_MIXER_VOLUME_MAX),
+	m_nPan (0),
+	m_nGainLeft (GAIN_UNITY),
+	m_nGainRight (GAIN_UNITY),
+	m_pQueue (nullptr),
+	m_nInPtr (0),
+	m_nOutPtr (0),
+	m_pCallback (nullptr),
+	m_pCallbackParam (nullptr),
+	m_pResampler (nullptr),
+	m_bDriftCompensation (FALSE)
+{
+	assert (m_pMixer);
+	assert (m_pMixer->m_nSampleRate);	// CSoundMixer::Initialize() has been called?
+	assert (m_nChannels == 1 || m_nChannels == 2);
+	assert (nQueueSizeMsecs > 0);
+
+	m_nFrameSize = GetSampleSize (m_Format) * m_nChannels;
+
+	unsigned nSizeFrames = m_pMixer->m_nSampleRate * nQueueSizeMsecs / 1000;
+	assert (nSizeFrames > 0);
+
+	m_nQueueSize = nSizeFrames * m_nFrameSize + 1;	// one byte is kept free
+	m_nNeedDataThreshold = m_nQueueSize / 2;
+
+	m_pQueue = new u8[m_nQueueSize];
+	assert (m_pQueue);
+
+	m_pMixer->AddStream (this);
+}
+
+CSoundMixerStream::~CSoundMixerStream (void)
+{
+	m_pMixer->RemoveStream (this);
+	m_pMixer = nullptr;
+
+	delete m_pResampler;
+	m_pResampler = nullptr;
+
+	delete [] m_pQueue;
+	m_pQueue = nullptr;
+}
+
+int CSoundMixerStream::Write (const void *pBuffer, size_t nCount)
+{
+	const u8 *pBuffer8 = static_cast<const u8 *> (pBuffer);
+	assert (pBuffer8);
+	assert (nCount % m_nFrameSize == 0);
+
+	m_SpinLock.Acquire ();
+
+	unsigned nFree = (m_nOutPtr + m_nQueueSize - m_nInPtr - 1) % m_nQueueSize;
+	nFree -= nFree % m_nFrameSize;
+	if (nCount > nFree)
+	{
+		nCount = nFree;
+	}
+
+	unsigned nFirst = m_nQueueSize - m_nInPtr;
+	if (nFirst > nCount)
+	{
+		nFirst = nCount;
+	}
+
+	memcpy (m_pQueue + m_nInPtr, pBuffer8, nFirst);
+	memcpy (m_pQueue, pBuffer8 + nFirst, nCount - nFirst);
+
+	m_nInPtr = (m_nInPtr + nCount) % m_nQueueSize;
+
+	m_SpinLock.Release ();
+
+	return nCount;
+}
+
+unsigned CSoundMixerStream::GetQueueSizeFrames (void) const
+{
+	return (m_nQueueSize - 1) / m_nFrameSize;
+}
+
+unsigned CSoundMixerStream::GetQueueFramesAvail (void)
+{
+	m_SpinLock.Acquire ();
+
+	unsigned nAvail = (m_nInPtr + m_nQueueSize - m_nOutPtr) % m_nQueueSize;
+
+	m_SpinLock.Release ();
+
+	return nAvail / m_nFrameSize;
+}
+
+void CSoundMixerStream::RegisterNeedDataCallback (TSoundDataCallback *pCallback, void *pParam)
+{
+	m_pCallbackParam = pParam;
+	m_pCallback = pCallback;
+}
+
+boolean CSoundMixerStream::SetSampleRate (unsigned nSampleRate, TSoundResamplerQuality Quality,
+					   boolean bDriftCompensation)
+{
+	assert (!m_pResampler);
+	assert (m_nInPtr == m_nOutPtr);		// no data written yet?
+
+	if (   nSampleRate == m_pMixer->m_nSampleRate
+	    && !bDriftCompensation)
+	{
+		return TRUE;
+	}
+
+	CSoundResampler *pResampler = new CSoundResampler (nSampleRate, m_pMixer->m_nSampleRate,
+							   m_nChannels, Quality);
+	if (   !pResampler
+	    || !pResampler->Initialize ())
+	{
+		delete pResampler;
+
+		return FALSE;
+	}
+
+	// the queue holds the same duration of the stream as before
+	unsigned nQueueSize = (u64) (m_nQueueSize - 1) / m_nFrameSize * nSampleRate
+						/ m_pMixer->m_nSampleRate * m_nFrameSize + 1;
+	u8 *pQueue = new u8[nQueueSize];
+	if (!pQueue)
+	{
+		delete pResampler;
+
+		return FALSE;
+	}
+
+	m_SpinLock.Acquire ();
+
+	delete [] m_pQueue;
+	m_pQueue = pQueue;
+	m_nQueueSize = nQueueSize;
+	m_nNeedDataThreshold = nQueueSize / 2;
+
+	m_bDriftCompensation = bDriftCompensation;
+	m_pResampler = pResampler;
+
+	m_SpinLock.Release ();
+
+	return TRUE;
+}
+
+void CSoundMixerStream::SetVolume (unsigned nVolume)
+{
+	assert (nVolume <= SOUND_MIXER_VOLUME_MAX);
+	m_nVolume = nVolume;
+
+	UpdateGain ();
+}
+
+void CSoundMixerStream::SetPan (int nPan)
+{
+	assert (-100 <= nPan && nPan <= 100);
+	m_nPan = nPan;
+
+	UpdateGain ();
+}
+
+unsigned CSoundMixerStream::Dequeue (void *pBuffer, unsigned nFrames, boolean *pNeedData)
+{
+	u8 *pBuffer8 = static_cast<u8 *> (pBuffer);
+	assert (pBuffer8);
+
+	m_SpinLock.Acquire ();
+
+	unsigned nAvail = (m_nInPtr + m_nQueueSize - m_nOutPtr) % m_nQueueSize;
+	unsigned nCount = nFrames * m_nFrameSize;
+	if (nCount > nAvail)
+	{
+		nCount = nAvail;
+	}
+
+	unsigned nFirst = m_nQueueSize - m_nOutPtr;
+	if (nFirst > nCount)
+	{
+		nFirst = nCount;
+	}
+
+	memcpy (pBuffer8, m_pQueue + m_nOutPtr, nFirst);
+	memcpy (pBuffer8 + nFirst, m_pQueue, nCount - nFirst);
+
+	m_nOutPtr = (m_nOutPtr + nCount) % m_nQueueSize;
+
+	assert (pNeedData);
+	if (nAvail - nCount < m_nNeedDataThreshold)
+	{
+		*pNeedData = TRUE;
+	}
+
+	m_SpinLock.Release ();
+
+	return nCount / m_nFrameSize;
+}
+
+void CSoundMixerStream::UpdateGain (void)
+{
+	s32 nGain = m_nVolume * GAIN_UNITY / SOUND_MIXER_VOLUME_MAX;
+
+	s32 nGainLeft = nGain;
+	s32 nGainRight = nGain;
+	if (m_nPan > 0)
+	{
+		nGainLeft = nGain * (100 - m_nPan) / 100;
+	}
+	else if (m_nPan < 0)
+	{
+		nGainRight = nGain * (100 + m_nPan) / 100;
+	}
+
+	m_SpinLock.Acquire ();
+
+	m_nGainLeft = nGainLeft;
+	m_nGainRight = nGainRight;
+
+	m_SpinLock.Release ();
+}
+
+//// CSoundMixer ///////////////////////////////////////////////////////////////
+
+CSoundMixer::CSoundMixer (CSoundBaseDevice *pDevice)
+:	m_pDevice (pDevice),
+	m_nSampleRate (0),
+	m_nMasterGain (GAIN_UNITY),
+	m_nStreams (0)
+{
+}
+
+CSoundMixer::~CSoundMixer (void)
+{
+	assert (!m_nStreams);
+
+	if (m_pDevice)
+	{
+		assert (!m_pDevice->IsActive ());
+		m_pDevice->m_pMixer = nullptr;
+		m_pDevice = nullptr;
+	}
+}
+
+boolean CSoundMixer::Initialize (void)
+{
+	assert (m_pDevice);
+
+	switch (m_pDevice->m_HWFormat)
+	{
+	case SoundFormatSigned16:
+	case SoundFormatSigned24:
+	case SoundFormatSigned24_32:
+	case SoundFormatUnsigned32:
+	case SoundFormatIEC958:
+		break;
+
+	default:
+		return FALSE;
+	}
+
+	assert (!m_pDevice->m_pRenderCallback);		// pull mode cannot be used together
+
+	m_nSampleRate = m_pDevice->m_nSampleRate;
+	assert (m_nSampleRate);
+
+	m_pDevice->m_pMixer = this;
+
+	return TRUE;
+}
+
+CSoundBaseDevice *CSoundMixer::GetDevice (void) const
+{
+	return m_pDevice;
+}
+
+void CSoundMixer::SetVolume (unsigned nVolume)
+{
+	assert (nVolume <= SOUND_MIXER_VOLUME_MAX);
+	m_nMasterGain = nVolume * GAIN_UNITY / SOUND_MIXER_VOLUME_MAX;
+}
+
+void CSoundMixer::AddStream (CSoundMixerStream *pStream)
+{
+	m_SpinLock.Acquire ();
+
+	assert (m_nStreams < SOUND_MIXER_MAX_STREAMS);
+	m_pStream[m_nStreams++] = pStream;
+
+	m_SpinLock.Release ();
+}
+
+void CSoundMixer::RemoveStream (CSoundMixerStream *pStream)
+{
+	m_SpinLock.Acquire ();
+
+	for (unsigned i = 0; i < m_nStreams; i++)
+	{
+		if (m_pStream[i] == pStream)
+		{
+			m_pStream[i] = m_pStream[--m_nStreams];
+
+			break;
+		}
+	}
+
+	m_SpinLock.Release ();
+}
+
+void CSoundMixer::Mix (void *pBuffer, unsigned nChunkSize)
+{
+	u8 *pBuffer8 = static_cast<u8 *> (pBuffer);
+	assert (pBuffer8);
+
+	unsigned nHWFrameSize = m_pDevice->m_nHWTXChannels * m_pDevice->m_nHWSampleSize;
+	assert (nChunkSize % m_pDevice->m_nHWTXChannels == 0);
+	unsigned nFrames = nChunkSize / m_pDevice->m_nHWTXChannels;
+
+	boolean bNeedData[SOUND_MIXER_MAX_STREAMS] = {FALSE};
+
+	m_SpinLock.Acquire ();
+
+	while (nFrames > 0)
+	{
+		unsigned nBlockFrames = nFrames;
+		if (nBlockFrames > SOUND_MIXER_BLOCK_FRAMES)
+		{
+			nBlockFrames = SOUND_MIXER_BLOCK_FRAMES;
+		}
+
+		memset (m_Accumulator, 0, nBlockFrames * 2 * sizeof (s32));
+
+		for (unsigned i = 0; i < m_nStreams; i++)
+		{
+			MixStream (m_pStream[i], nBlockFrames, &bNeedData[i]);
+		}
+
+		ConvertOutput (pBuffer8, nBlockFrames);
+
+		pBuffer8 += nBlockFrames * nHWFrameSize;
+		nFrames -= nBlockFrames;
+	}
+
+	// the callbacks may write to the streams, so they are called without the lock held
+	TSoundDataCallback *pCallback[SOUND_MIXER_MAX_STREAMS];
+	void *pCallbackParam[SOUND_MIXER_MAX_STREAMS];
+	unsigned nCallbacks = 0;
+
+	for (unsigned i = 0; i < m_nStreams; i++)
+	{
+		if (   bNeedData[i]
+		    && m_pStream[i]->m_pCallback)
+		{
+			pCallback[nCallbacks] = m_pStream[i]->m_pCallback;
+			pCallbackParam[nCallbacks] = m_pStream[i]->m_pCallbackParam;
+			nCallbacks++;
+		}
+	}
+
+	m_SpinLock.Release ();
+
+	for (unsigned i = 0; i < nCallbacks; i++)
+	{
+		(*pCallback[i]) (pCallbackParam[i]);
+	}
+}
+
+void CSoundMixer::MixStream (CSoundMixerStream *pStream, unsigned nFrames, boolean *pNeedData)
+{
+	assert (pStream);
+	assert (nFrames <= SOUND_MIXER_BLOCK_FRAMES);
+
+	s32 nGainLeft = pStream->m_nGainLeft * m_nMasterGain >> 15;
+	s32 nGainRight = pStream->m_nGainRight * m_nMasterGain >> 15;
+
+	CSoundResampler *pResampler = pStream->m_pResampler;
+	if (!pResampler)
+	{
+		nFrames = pStream->Dequeue (m_StreamBuffer, nFrames, pNeedData);
+
+		Accumulate (m_StreamBuffer, pStream->m_Format, pStream->m_nChannels, nFrames,
+			    m_Accumulator, nGainLeft, nGainRight);
+
+		return;
+	}
+
+	s32 *pTo = m_Accumulator;
+	while (nFrames > 0)
+	{
+		// the input of one pass must fit into m_StreamBuffer
+		unsigned nOutFrames = nFrames;
+		unsigned nInFrames;
+		while ((nInFrames = pResampler->GetInputFramesNeeded (nOutFrames))
+		       > SOUND_MIXER_BLOCK_FRAMES)
+		{
+			nOutFrames /= 2;
+		}
+
+		nInFrames = pStream->Dequeue (m_StreamBuffer, nInFrames, pNeedData);
+
+		unsigned nSampleSize = GetSampleSize (pStream->m_Format);
+		for (unsigned i = 0; i < nInFrames * pStream->m_nChannels; i++)
+		{
+			m_ResampleBuffer[i] = GetSample (m_StreamBuffer + i*nSampleSize,
+							 pStream->m_Format);
+		}
+
+		nOutFrames = pResampler->Process (m_ResampleBuffer, nInFrames,
+						  m_ResampleBuffer + SOUND_MIXER_BLOCK_FRAMES * 2,
+						  nOutFrames);
+
+		Accumulate (m_ResampleBuffer + SOUND_MIXER_BLOCK_FRAMES * 2, SoundFormatSigned24_32,
+			    pStream->m_nChannels, nOutFrames, pTo, nGainLeft, nGainRight);
+
+		if (!nOutFrames)
+		{
+			break;			// underrun
+		}
+
+		pTo += nOutFrames * 2;
+		nFrames -= nOutFrames;
+	}
+
+	if (pStream->m_bDriftCompensation)
+	{
+		pResampler->TrackFillLevel (pStream->GetQueueFramesAvail (),
+					    pStream->GetQueueSizeFrames () / 2);
+	}
+}
+
+void CSoundMixer::Accumulate (const void *pBuffer, TSoundFormat Format, unsigned nChannels,
+			      unsigned nFrames, s32 *pTo, s32 nGainLeft, s32 nGainRight)
+{
+	const u8 *pFrom = static_cast<const u8 *> (pBuffer);
+
+	if (   !nFrames
+	    || (!nGainLeft && !nGainRight))
+	{
+		return;
+	}
+
+	// fast path for 16-bit stereo streams, two frames at once
+	if (   Format == SoundFormatSigned16
+	    && nChannels == 2)
+	{
+		TVectorS32 Gain = {nGainLeft, nGainRight, nGainLeft, nGainRight};
+
+		for (; nFrames >= 2; nFrames -= 2)
+		{
+			TVectorS32 Value = __builtin_convertvector (*(const TVectorS16x4 *) pFrom,
+								    TVectorS32);
+
+			*(TVectorS32 *) pTo += (Value * Gain) >> 7;
+
+			pFrom += 2 * 2 * sizeof (s16);
+			pTo += 4;
+		}
+	}
+	else if (   Format == SoundFormatSigned24_32
+		 && nChannels == 2)
+	{
+		TVectorS32 Gain = {nGainLeft, nGainRight, nGainLeft, nGainRight};
+		boolean bUnity = nGainLeft == GAIN_UNITY && nGainRight == GAIN_UNITY;
+
+		for (; nFrames >= 2; nFrames -= 2)
+		{
+			TVectorS32 Value = (*(const TVectorS32 *) pFrom << 8) >> 8;
+
+			if (bUnity)
+			{
+				*(TVectorS32 *) pTo += Value;
+			}
+			else
+			{
+				*(TVectorS32 *) pTo += ((Value >> 8) * Gain) >> 7;
+			}
+
+			pFrom += 2 * 2 * sizeof (u32);
+			pTo += 4;
+		}
+	}
+
+	unsigned nSampleSize = GetSampleSize (Format);
+	for (; nFrames > 0; nFrames--)
+	{
+		s32 nLeft = GetSample (pFrom, Format);
+		pFrom += nSampleSize;
+
+		s32 nRight = nLeft;
+		if (nChannels == 2)
+		{
+			nRight = GetSample (pFrom, Format);
+			pFrom += nSampleSize;
+		}
+
+		*pTo++ += ApplyGain (nLeft, nGainLeft);
+		*pTo++ += ApplyGain (nRight, nGainRight);
+	}
+}
+
+void CSoundMixer::ConvertOutput (void *pBuffer, unsigned nFrames)
+{
+	CSoundBaseDevice *pDevice = m_pDevice;
+	unsigned nHWChannels = pDevice->m_nHWTXChannels;
+	const s32 *pFrom = m_Accumulator;
+
+	if (pDevice->m_bSwapChannels)
+	{
+		s32 *pAcc = m_Accumulator;
+		for (unsigned i = 0; i < nFrames; i++, pAcc += 2)
+		{
+			s32 nTemp = pAcc[0];
+			pAcc[0] = pAcc[1];
+			pAcc[1] = nTemp;
+		}
+	}
+
+	unsigned nSamples = 0;		// number of samples converted by the fast path
+
+	// fast path for stereo output, four samples at once
+	if (nHWChannels == 2)
+	{
+		unsigned nVectorSamples = nFrames * 2 & ~3;
+
+		switch (pDevice->m_HWFormat)
+		{
+		case SoundFormatSigned16: {
+			s16 *pTo = static_cast<s16 *> (pBuffer);
+			for (; nSamples < nVectorSamples; nSamples += 4)
+			{
+				TVectorS32 Value = *(const TVectorS32 *) &pFrom[nSamples] >> 8;
+				Value = Clamp (Value, -32768, 32767);
+
+				*(TVectorS16x4 *) &pTo[nSamples] =
+					__builtin_convertvector (Value, TVectorS16x4);
+			}
+			} break;
+
+		case SoundFormatSigned24_32: {
+			s32 *pTo = static_cast<s32 *> (pBuffer);
+			for (; nSamples < nVectorSamples; nSamples += 4)
+			{
+				*(TVectorS32 *) &pTo[nSamples] =
+					Clamp (*(const TVectorS32 *) &pFrom[nSamples],
+					       SAMPLE_MIN, SAMPLE_MAX);
+			}
+			} break;
+
+		case SoundFormatUnsigned32:
+			if ((u32) pDevice->m_nRangeMax < 0x10000)
+			{
+				u32 *pTo = static_cast<u32 *> (pBuffer);
+				TVectorU32 Range = (TVectorU32) {} + (u32) pDevice->m_nRangeMax;
+
+				for (; nSamples < nVectorSamples; nSamples += 4)
+				{
+					TVectorS32 Value = Clamp (*(const TVectorS32 *) &pFrom[nSamples],
+								  SAMPLE_MIN-1, SAMPLE_MAX);
+					TVectorU32 Unsigned = (TVectorU32) (Value + (1 << 23)) >> 8;
+
+					*(TVectorU32 *) &pTo[nSamples] = (Unsigned * Range) >> 16;
+				}
+			}
+			break;
+
+		default:
+			break;
+		}
+
+		pFrom += nSamples;
+		assert (nSamples % 2 == 0);
+		nFrames -= nSamples / 2;
+	}
+
+	u8 *pTo = static_cast<u8 *> (pBuffer) + nSamples * pDevice->m_nHWSampleSize;
+	unsigned nHWFrameSize = nHWChannels * pDevice->m_nHWSampleSize;
+
+	for (; nFrames > 0; nFrames--, pFrom += 2, pTo += nHWFrameSize)
+	{
+		memcpy (pTo, pDevice->m_NullFrame, nHWFrameSize);
+
+		s32 Value[2] = {pFrom[0], pFrom[1]};
+		if (nHWChannels == 1)
+		{
+			Value[0] = (pFrom[0] >> 1) + (pFrom[1] >> 1);
+		}
+
+		for (unsigned nChannel = 0; nChannel < 2 && nChannel < nHWChannels; nChannel++)
+		{
+			s32 nValue = Clamp (Value[nChannel], SAMPLE_MIN, SAMPLE_MAX);
+			u8 *pSample = pTo + nChannel * pDevice->m_nHWSampleSize;
+
+			switch (pDevice->m_HWFormat)
+			{
+			case SoundFormatSigned16:
+				*(s16 *) pSample = Clamp (Value[nChannel] >> 8, -32768, 32767);
+				break;
+
+			case SoundFormatSigned24:
+				pSample[0] = nValue & 0xFF;
+				pSample[1] = nValue >> 8 & 0xFF;
+				pSample[2] = nValue >> 16 & 0xFF;
+				break;
+
+			case SoundFormatSigned24_32:
+				*(s32 *) pSample = nValue;
+				break;
+
+			case SoundFormatUnsigned32: {
+				u64 ullValue = (u64) (nValue + (1 << 23));
+				ullValue *= pDevice->m_nRangeMax;
+				*(u32 *) pSample = (u32) (ullValue >> 24);
+				} break;
+
+			case SoundFormatIEC958: {
+				// control bits and preamble are inserted by GetChunkInternal()
+				u32 nSample = (nValue & 0xFFFFFF) << 4;
+				if (parity32 (nSample))
+				{
+					nSample |= 0x80000000;
+				}
+
+				*(u32 *) pSample = nSample;
+				} break;
+
+			default:
+				assert (0);
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,397 @@
+//
+// soundresampler.cpp
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <circle/sound/soundresampler.h>
+#include <circle/util.h>
+#include <assert.h>
+
+// The filter is a Blackman windowed sinc, stored as a table of (phases + 1) rows of
+// Q15 coefficients. The coefficients of the current phase are linearly interpolated
+// between two rows. The dot product is calculated with GCC vector extensions (NEON
+// on ARM) in 32-bit lanes. 24-bit samples are split into a high and a low part for
+// this, so that the sums cannot overflow.
+
+#define COEFF_SHIFT	15
+#define CUTOFF		0.95			// of the Nyquist frequency
+
+#define SAMPLE_MAX	((1 << 23) - 1)
+#define SAMPLE_MIN	(-(1 << 23) + 1)
+
+#define PI		3.14159265358979323846
+
+typedef s32 TVectorS32 __attribute__ ((vector_size (16), aligned (1), may_alias));
+typedef s16 TVectorS16x4 __attribute__ ((vector_size (8), aligned (1), may_alias));
+
+static const struct
+{
+	unsigned nTaps;
+	unsigned nPhaseShift;
+}
+s_QualityParams[SoundResamplerQualityUnknown] =
+{
+	{8, 6},
+	{16, 7},
+	{32, 8}
+};
+
+static double Sine (double x)
+{
+	// reduce to -PI..PI
+	int nPeriods = (int) (x / (2.0*PI));
+	x -= nPeriods * 2.0*PI;
+	if (x > PI)
+	{
+		x -= 2.0*PI;
+	}
+	else if (x < -PI)
+	{
+		x += 2.0*PI;
+	}
+
+	// Taylor series, error < 1e-7
+	double x2 = x * x;
+	double fTerm = x;
+	double fResult = x;
+	for (unsigned n = 3; n <= 19; n += 2)
+	{
+		fTerm *= -x2 / ((n-1) * n);
+		fResult += fTerm;
+	}
+
+	return fResult;
+}
+
+static double Cosine (double x)
+{
+	return Sine (x + PI/2.0);
+}
+
+// windowed sinc, nHalfWidth is the half length of the window in input frames
+static double Kernel (double x, double fCutoff, double fHalfWidth)
+{
+	if (x <= -fHalfWidth || x >= fHalfWidth)
+	{
+		return 0.0;
+	}
+
+	double u = x / fHalfWidth;
+	double fWindow = 0.42 + 0.5 * Cosine (PI*u) + 0.08 * Cosine (2.0*PI*u);
+
+	double y = PI * fCutoff * x;
+	double fSinc = y > -1e-9 && y < 1e-9 ? 1.0 : Sine (y) / y;
+
+	return fCutoff * fSinc * fWindow;
+}
+
+CSoundResampler::CSoundResampler (unsigned nInputRate, unsigned nOutputRate, unsigned nChannels,
+				  TSoundResamplerQuality Quality)
+:	m_nInputRate (nInputRate),
+	m_nOutputRate (nOutputRate),
+	m_nChannels (nChannels),
+	m_Quality (Quality),
+	m_nTaps (0),
+	m_pCoeffs (nullptr),
+	m_nHistoryPtr (0),
+	m_pPhaseCoeffs (nullptr),
+	m_nDriftPPM (0),
+	m_nFilteredError (0),
+	m_nIntegral (0)
+{
+	assert (m_nInputRate > 0);
+	assert (m_nOutputRate > 0);
+	assert (1 <= m_nChannels && m_nChannels <= SOUND_RESAMPLER_MAX_CHANNELS);
+	assert (m_Quality < SoundResamplerQualityUnknown);
+
+	for (unsigned i = 0; i < SOUND_RESAMPLER_MAX_CHANNELS; i++)
+	{
+		m_pHistory[i] = nullptr;
+	}
+}
+
+CSoundResampler::~CSoundResampler (void)
+{
+	for (unsigned i = 0; i < SOUND_RESAMPLER_MAX_CHANNELS; i++)
+	{
+		delete [] m_pHistory[i];
+		m_pHistory[i] = nullptr;
+	}
+
+	delete [] m_pPhaseCoeffs;
+	m_pPhaseCoeffs = nullptr;
+
+	delete [] m_pCoeffs;
+	m_pCoeffs = nullptr;
+}
+
+boolean CSoundResampler::Initialize (void)
+{
+	m_nTaps = s_QualityParams[m_Quality].nTaps;
+	m_nPhaseShift = s_QualityParams[m_Quality].nPhaseShift;
+
+	// on downsampling the filter has to be widened to keep its quality
+	double fCutoff = CUTOFF;
+	if (m_nOutputRate < m_nInputRate)
+	{
+		fCutoff = CUTOFF * m_nOutputRate / m_nInputRate;
+
+		m_nTaps = (unsigned) (m_nTaps * m_nInputRate / m_nOutputRate + 7) & ~7U;
+		if (m_nTaps > SOUND_RESAMPLER_MAX_TAPS)
+		{
+			m_nTaps = SOUND_RESAMPLER_MAX_TAPS;
+		}
+	}
+
+	unsigned nPhases = 1 << m_nPhaseShift;
+
+	m_pCoeffs = new s16[(nPhases + 1) * m_nTaps];
+	m_pPhaseCoeffs = new s32[m_nTaps];
+	if (   !m_pCoeffs
+	    || !m_pPhaseCoeffs)
+	{
+		return FALSE;
+	}
+
+	double fHalfWidth = m_nTaps / 2;
+	for (unsigned nPhase = 0; nPhase <= nPhases; nPhase++)
+	{
+		double fFraction = (double) nPhase / nPhases;
+		double Coeff[SOUND_RESAMPLER_MAX_TAPS];
+
+		// history[k] is (m_nTaps/2 - 1 - k + fFraction) input frames before the output
+		double fSum = 0.0;
+		for (unsigned k = 0; k < m_nTaps; k++)
+		{
+			Coeff[k] = Kernel (fHalfWidth - 1.0 - k + fFraction, fCutoff, fHalfWidth);
+			fSum += Coeff[k];
+		}
+
+		// normalize to unity gain at DC
+		for (unsigned k = 0; k < m_nTaps; k++)
+		{
+			double fValue = Coeff[k] / fSum * (1 << COEFF_SHIFT);
+			fValue = fValue < 0.0 ? fValue - 0.5 : fValue + 0.5;
+			m_pCoeffs[nPhase * m_nTaps + k] = fValue < 32767.0 ? (s16) fValue : 32767;
+		}
+	}
+
+	for (unsigned i = 0; i < m_nChannels; i++)
+	{
+		m_pHistory[i] = new s32[2 * m_nTaps];
+		if (!m_pHistory[i])
+		{
+			return FALSE;
+		}
+	}
+
+	m_ullNominalStep = ((u64) m_nInputRate << 32) / m_nOutputRate;
+	UpdateStep ();
+
+	Reset ();
+
+	return TRUE;
+}
+
+unsigned CSoundResampler::GetInputFramesNeeded (unsigned nOutputFrames) const
+{
+	if (!nOutputFrames)
+	{
+		return 0;
+	}
+
+	return (unsigned) ((m_ullPhase + (nOutputFrames - 1) * m_ullStep) >> 32);
+}
+
+unsigned CSoundResampler::Process (const s16 *pInput, unsigned nInputFrames,
+				   s16 *pOutput, unsigned nOutputFrames)
+{
+	return ProcessInternal (pInput, nInputFrames, pOutput, nOutputFrames);
+}
+
+unsigned CSoundResampler::Process (const s32 *pInput, unsigned nInputFrames,
+				   s32 *pOutput, unsigned nOutputFrames)
+{
+	return ProcessInternal (pInput, nInputFrames, pOutput, nOutputFrames);
+}
+
+void CSoundResampler::Reset (void)
+{
+	assert (m_nTaps);
+
+	for (unsigned i = 0; i < m_nChannels; i++)
+	{
+		memset (m_pHistory[i], 0, 2 * m_nTaps * sizeof (s32));
+	}
+
+	m_nHistoryPtr = 0;
+	m_ullPhase = 0;
+}
+
+void CSoundResampler::SetDrift (int nPPM)
+{
+	if (nPPM > SOUND_RESAMPLER_MAX_DRIFT_PPM)
+	{
+		nPPM = SOUND_RESAMPLER_MAX_DRIFT_PPM;
+	}
+	else if (nPPM < -SOUND_RESAMPLER_MAX_DRIFT_PPM)
+	{
+		nPPM = -SOUND_RESAMPLER_MAX_DRIFT_PPM;
+	}
+
+	m_nDriftPPM = nPPM;
+
+	UpdateStep ();
+}
+
+int CSoundResampler::GetDrift (void) const
+{
+	return m_nDriftPPM;
+}
+
+void CSoundResampler::TrackFillLevel (unsigned nFramesQueued, unsigned nTargetFrames)
+{
+	// low-pass filter the error, because the queue is filled in chunks
+	int nError = (int) nFramesQueued - (int) nTargetFrames;
+	m_nFilteredError += ((nError << 8) - m_nFilteredError) >> 5;
+
+	int nLimit = SOUND_RESAMPLER_MAX_DRIFT_PPM << 12;
+	m_nIntegral += m_nFilteredError >> 8;
+	if (m_nIntegral > nLimit)
+	{
+		m_nIntegral = nLimit;
+	}
+	else if (m_nIntegral < -nLimit)
+	{
+		m_nIntegral = -nLimit;
+	}
+
+	SetDrift ((m_nFilteredError >> 8) + (m_nIntegral >> 12));
+}
+
+void CSoundResampler::PushFrame (const s32 *pFrame)
+{
+	for (unsigned i = 0; i < m_nChannels; i++)
+	{
+		s32 *pHistory = m_pHistory[i];
+
+		pHistory[m_nHistoryPtr] = pFrame[i];
+		pHistory[m_nHistoryPtr + m_nTaps] = pFrame[i];
+	}
+
+	if (++m_nHistoryPtr == m_nTaps)
+	{
+		m_nHistoryPtr = 0;
+	}
+}
+
+s32 CSoundResampler::Filter (unsigned nChannel)
+{
+	// oldest frame first
+	const s32 *pHistory = m_pHistory[nChannel] + m_nHistoryPtr;
+	const s32 *pCoeffs = m_pPhaseCoeffs;
+
+	TVectorS32 SumHigh = {0, 0, 0, 0};
+	TVectorS32 SumLow = {0, 0, 0, 0};
+	for (unsigned k = 0; k < m_nTaps; k += 4)
+	{
+		TVectorS32 Value = *(const TVectorS32 *) &pHistory[k];
+		TVectorS32 Coeff = *(const TVectorS32 *) &pCoeffs[k];
+
+		SumHigh += (Value >> 8) * Coeff;
+		SumLow += (Value & 0xFF) * Coeff;
+	}
+
+	s32 nHigh = SumHigh[0] + SumHigh[1] + SumHigh[2] + SumHigh[3];
+	s32 nLow = SumLow[0] + SumLow[1] + SumLow[2] + SumLow[3];
+
+	// (nHigh << 8 + nLow) >> COEFF_SHIFT
+	s32 nResult =   (nHigh >> (COEFF_SHIFT - 8))
+		      + ((((nHigh & ((1 << (COEFF_SHIFT - 8)) - 1)) << 8) + nLow) >> COEFF_SHIFT);
+
+	return nResult < SAMPLE_MIN ? SAMPLE_MIN : (nResult > SAMPLE_MAX ? SAMPLE_MAX : nResult);
+}
+
+template <typename TSample>
+unsigned CSoundResampler::ProcessInternal (const TSample *pInput, unsigned nInputFrames,
+					   TSample *pOutput, unsigned nOutputFrames)
+{
+	assert (m_pCoeffs);
+	assert (pInput || !nInputFrames);
+	assert (pOutput);
+
+	// 24-bit samples are used internally
+	const unsigned nShift = sizeof (TSample) == sizeof (s16) ? 8 : 0;
+
+	unsigned nFrames;
+	for (nFrames = 0; nFrames < nOutputFrames; nFrames++)
+	{
+		while (m_ullPhase >= (1ULL << 32))
+		{
+			if (!nInputFrames)
+			{
+				return nFrames;
+			}
+
+			s32 Frame[SOUND_RESAMPLER_MAX_CHANNELS];
+			for (unsigned i = 0; i < m_nChannels; i++)
+			{
+				Frame[i] = (s32) *pInput++ << nShift;
+			}
+
+			PushFrame (Frame);
+
+			nInputFrames--;
+			m_ullPhase -= 1ULL << 32;
+		}
+
+		// interpolate the coefficients between two phases
+		u32 nFraction = (u32) m_ullPhase;
+		unsigned nPhase = nFraction >> (32 - m_nPhaseShift);
+		s32 nWeight = (nFraction << m_nPhaseShift) >> 17;	// Q15
+
+		const s16 *pCoeffs0 = &m_pCoeffs[nPhase * m_nTaps];
+		const s16 *pCoeffs1 = pCoeffs0 + m_nTaps;
+		for (unsigned k = 0; k < m_nTaps; k += 4)
+		{
+			TVectorS32 Coeff0 = __builtin_convertvector (*(const TVectorS16x4 *) &pCoeffs0[k],
+								     TVectorS32);
+			TVectorS32 Coeff1 = __builtin_convertvector (*(const TVectorS16x4 *) &pCoeffs1[k],
+								     TVectorS32);
+
+			*(TVectorS32 *) &m_pPhaseCoeffs[k] = Coeff0 + (((Coeff1 - Coeff0) * nWeight) >> 15);
+		}
+
+		for (unsigned i = 0; i < m_nChannels; i++)
+		{
+			*pOutput++ = (TSample) (Filter (i) >> nShift);
+		}
+
+		m_ullPhase += m_ullStep;
+	}
+
+	assert (!nInputFrames);		// more than GetInputFramesNeeded()?
+
+	return nFrames;
+}
+
+void CSoundResampler::UpdateStep (void)
+{
+	s64 llDelta = (s64) m_ullNominalStep * m_nDriftPPM / 1000000;
+
+	m_ullStep = m_ullNominalStep + llDelta;
+}
@@ -28,6 +28,14 @@
 #include <circle/timer.h>
 #include <assert.h>
 
+#if USB_AUDIO_URBS_IN_FLIGHT < 1 || USB_AUDIO_URBS_IN_FLIGHT > 6
+	#error USB_AUDIO_URBS_IN_FLIGHT must be 1 to 6!
+#endif
+
+#if RASPPI <= 3 && USB_AUDIO_URBS_IN_FLIGHT > 1
+	#error USB_AUDIO_URBS_IN_FLIGHT must be 1 on Raspberry Pi 1-3 and Zero!
+#endif
+
 LOGMODULE ("sndusb");
 static const char DeviceName[] = "sndusb";
 
@@ -42,8 +50,8 @@ CUSBSoundBaseDevice::CUSBSoundBaseDevice (unsigned nSampleRate, TDeviceMode Devi
 	m_State (StateCreated),
 	m_pTXUSBDevice (nullptr),
 	m_pRXUSBDevice (nullptr),
-	m_pTXBuffer {nullptr, nullptr},
-	m_pRXBuffer {nullptr, nullptr},
+	m_pTXBuffer {nullptr},
+	m_pRXBuffer {nullptr},
 	m_pSoundController (nullptr),
 	m_hRemoveRegistration (0)
 {
@@ -110,15 +118,7 @@ CUSBSoundBaseDevice::~CUSBSoundBaseDevice (void)
 	delete m_pSoundController;
 	m_pSoundController = nullptr;
 
-	delete [] m_pTXBuffer[0];
-	delete [] m_pTXBuffer[1];
-	m_pTXBuffer[0] = nullptr;
-	m_pTXBuffer[1] = nullptr;
-
-	delete [] m_pRXBuffer[0];
-	delete [] m_pRXBuffer[1];
-	m_pRXBuffer[0] = nullptr;
-	m_pRXBuffer[1] = nullptr;
+	FreeBuffers ();
 }
 
 boolean CUSBSoundBaseDevice::Start (void)
@@ -193,10 +193,11 @@ boolean CUSBSoundBaseDevice::Start (void)
 
 			// The actual chunk size varies in operation. A maximum of twice
 			// the initial size should not be exceeded.
-			assert (!m_pTXBuffer[0]);
-			assert (!m_pTXBuffer[1]);
-			m_pTXBuffer[0] = new u8[m_nTXChunkSizeBytes * 2];
-			m_pTXBuffer[1] = new u8[m_nTXChunkSizeBytes * 2];
+			for (unsigned i = 0; i < USB_AUDIO_URBS_IN_FLIGHT; i++)
+			{
+				assert (!m_pTXBuffer[i]);
+				m_pTXBuffer[i] = new u8[m_nTXChunkSizeBytes * 2];
+			}
 		}
 
 		if (m_DeviceMode != DeviceModeTXOnly)
@@ -205,10 +206,11 @@ boolean CUSBSoundBaseDevice::Start (void)
 
 			// The actual chunk size varies in operation. A maximum of twice
 			// the initial size should not be exceeded.
-			assert (!m_pRXBuffer[0]);
-			assert (!m_pRXBuffer[1]);
-			m_pRXBuffer[0] = new u8[m_nRXChunkSizeBytes * 2];
-			m_pRXBuffer[1] = new u8[m_nRXChunkSizeBytes * 2];
+			for (unsigned i = 0; i < USB_AUDIO_URBS_IN_FLIGHT; i++)
+			{
+				assert (!m_pRXBuffer[i]);
+				m_pRXBuffer[i] = new u8[m_nRXChunkSizeBytes * 2];
+			}
 		}
 
 		assert (!m_hRemoveRegistration);
@@ -229,31 +231,46 @@ boolean CUSBSoundBaseDevice::Start (void)
 	{
 		m_nTXCurrentBuffer = 0;
 
-		// Two pending transfers on Raspberry Pi 4,
-		// RPi 1-3 and Zero cannot handle this yet.
-		if (   !SendChunk ()
-#if RASPPI >= 4
-		    || !SendChunk ()
-#endif
-		   )
+		// Fill the pipeline. RPi 1-3 and Zero can handle one pending transfer only.
+		for (unsigned i = 0; i < USB_AUDIO_URBS_IN_FLIGHT; i++)
 		{
-			LOGWARN ("Cannot send chunk");
+			if (!SendChunk ())
+			{
+				LOGWARN ("Cannot send chunk");
 
-			m_State = StateIdle;
+				if (!i)
+				{
+					m_State = StateIdle;
 
-			return FALSE;
+					return FALSE;
+				}
+
+				Cancel ();
+
+				while (IsActive ())
+				{
+#ifdef NO_BUSY_WAIT
+					CScheduler::Get ()->Yield ();
+#endif
+				}
+
+				return FALSE;
+			}
 		}
 	}
 
 	if (m_DeviceMode != DeviceModeTXOnly)
 	{
 		m_nRXCurrentBuffer = 0;
+		m_nRXCompletedBuffer = 0;
 
-		if (   !ReceiveChunk ()
-#if RASPPI >= 4
-		    || !ReceiveChunk ()
-#endif
-		   )
+		boolean bOK = TRUE;
+		for (unsigned i = 0; bOK && i < USB_AUDIO_URBS_IN_FLIGHT; i++)
+		{
+			bOK = ReceiveChunk ();
+		}
+
+		if (!bOK)
 		{
 			LOGWARN ("Cannot receive chunk");
 
@@ -296,6 +313,22 @@ CSoundController *CUSBSoundBaseDevice::GetController (void)
 	return m_pSoundController;
 }
 
+boolean CUSBSoundBaseDevice::GetStreamStatistics (boolean bTX,
+						  CUSBAudioStreamingDevice::TStatistics *pStatistics) const
+{
+	assert (pStatistics);
+
+	CUSBAudioStreamingDevice *pUSBDevice = bTX ? m_pTXUSBDevice : m_pRXUSBDevice;
+	if (!pUSBDevice)
+	{
+		return FALSE;
+	}
+
+	*pStatistics = pUSBDevice->GetStatistics ();
+
+	return TRUE;
+}
+
 CUSBAudioStreamingDevice *CUSBSoundBaseDevice::GetStreamingDevice (boolean bTX, unsigned nIndex)
 {
 	for (unsigned nInterface = 0; TRUE; nInterface++)
@@ -335,7 +368,7 @@ boolean CUSBSoundBaseDevice::SendChunk (void)
 	assert (nChunkSizeBytes % m_nSubframeSize == 0);
 	assert (nChunkSizeBytes <= m_nTXChunkSizeBytes * 2);
 
-	assert (m_nTXCurrentBuffer < 2);
+	assert (m_nTXCurrentBuffer < USB_AUDIO_URBS_IN_FLIGHT);
 	assert (m_pTXBuffer[m_nTXCurrentBuffer]);
 	unsigned nChunkSize;
 	if (m_nSubframeSize == 2)
@@ -365,7 +398,10 @@ boolean CUSBSoundBaseDevice::SendChunk (void)
 		return FALSE;
 	}
 
-	m_nTXCurrentBuffer ^= 1;
+	if (++m_nTXCurrentBuffer == USB_AUDIO_URBS_IN_FLIGHT)
+	{
+		m_nTXCurrentBuffer = 0;
+	}
 
 	return TRUE;
 }
@@ -380,7 +416,7 @@ boolean CUSBSoundBaseDevice::ReceiveChunk (void)
 
 	AtomicIncrement (&m_nOutstanding);
 
-	assert (m_nRXCurrentBuffer < 2);
+	assert (m_nRXCurrentBuffer < USB_AUDIO_URBS_IN_FLIGHT);
 	assert (m_pRXBuffer[m_nRXCurrentBuffer]);
 	if (!m_pRXUSBDevice->ReceiveChunk (m_pRXBuffer[m_nRXCurrentBuffer], nChunkSizeBytes,
 					   RXCompletionStub, this))
@@ -390,7 +426,10 @@ boolean CUSBSoundBaseDevice::ReceiveChunk (void)
 		return FALSE;
 	}
 
-	m_nRXCurrentBuffer ^= 1;
+	if (++m_nRXCurrentBuffer == USB_AUDIO_URBS_IN_FLIGHT)
+	{
+		m_nRXCurrentBuffer = 0;
+	}
 
 	return TRUE;
 }
@@ -480,6 +519,13 @@ void CUSBSoundBaseDevice::RXCompletionRoutine (unsigned nBytesTransferred)
 
 	m_SpinLock.Release ();
 
+	// transfers complete in the order of submission
+	unsigned nRXCompletedBuffer = m_nRXCompletedBuffer;
+	if (++m_nRXCompletedBuffer == USB_AUDIO_URBS_IN_FLIGHT)
+	{
+		m_nRXCompletedBuffer = 0;
+	}
+
 	if (!bContinue)
 	{
 		return;
@@ -490,27 +536,18 @@ void CUSBSoundBaseDevice::RXCompletionRoutine (unsigned nBytesTransferred)
 		assert (nBytesTransferred % m_nSubframeSize == 0);
 		assert (nBytesTransferred <= m_nRXChunkSizeBytes * 2);
 
-#if RASPPI >= 4
-		// on the Raspberry Pi 4 we maintain two outstanding transfers,
-		// so m_nRXCurrentBuffer points to the buffer, which has been recently filled
-		unsigned nRXCurrentBuffer = m_nRXCurrentBuffer;
-#else
-		// on earlier models (if supported at all) there is only one
-		// outstanding transfer, so we have to access the other buffer here
-		unsigned nRXCurrentBuffer = m_nRXCurrentBuffer ^ 1;
-#endif
-		assert (nRXCurrentBuffer < 2);
-		assert (m_pRXBuffer[nRXCurrentBuffer]);
+		assert (nRXCompletedBuffer < USB_AUDIO_URBS_IN_FLIGHT);
+		assert (m_pRXBuffer[nRXCompletedBuffer]);
 
 		if (m_nSubframeSize == 2)
 		{
-			PutChunk (reinterpret_cast<s16 *> (m_pRXBuffer[nRXCurrentBuffer]),
+			PutChunk (reinterpret_cast<s16 *> (m_pRXBuffer[nRXCompletedBuffer]),
 							   nBytesTransferred / m_nSubframeSize);
 		}
 		else
 		{
 			assert (m_nSubframeSize == 3);
-			PutChunk (reinterpret_cast<u32 *> (m_pRXBuffer[nRXCurrentBuffer]),
+			PutChunk (reinterpret_cast<u32 *> (m_pRXBuffer[nRXCompletedBuffer]),
 							   nBytesTransferred / m_nSubframeSize);
 		}
 	}
@@ -560,15 +597,7 @@ void CUSBSoundBaseDevice::DeviceRemovedHandler (CDevice *pDevice)
 	delete m_pSoundController;
 	m_pSoundController = nullptr;
 
-	delete [] m_pTXBuffer[0];
-	delete [] m_pTXBuffer[1];
-	m_pTXBuffer[0] = nullptr;
-	m_pTXBuffer[1] = nullptr;
-
-	delete [] m_pRXBuffer[0];
-	delete [] m_pRXBuffer[1];
-	m_pRXBuffer[0] = nullptr;
-	m_pRXBuffer[1] = nullptr;
+	FreeBuffers ();
 
 	m_pTXUSBDevice = nullptr;
 	m_pRXUSBDevice = nullptr;
@@ -582,6 +611,18 @@ void CUSBSoundBaseDevice::DeviceRemovedStub (CDevice *pDevice, void *pContext)
 	pThis->DeviceRemovedHandler (pDevice);
 }
 
+void CUSBSoundBaseDevice::FreeBuffers (void)
+{
+	for (unsigned i = 0; i < USB_AUDIO_URBS_IN_FLIGHT; i++)
+	{
+		delete [] m_pTXBuffer[i];
+		m_pTXBuffer[i] = nullptr;
+
+		delete [] m_pRXBuffer[i];
+		m_pRXBuffer[i] = nullptr;
+	}
+}
+
 boolean CUSBSoundBaseDevice::SetTXInterface (unsigned nInterface)
 {
 	boolean bWasActive = IsActive ();
@@ -605,15 +646,7 @@ boolean CUSBSoundBaseDevice::SetTXInterface (unsigned nInterface)
 		UnregisterRemovedHandler (m_hRemoveRegistration);
 	m_hRemoveRegistration = 0;
 
-	delete [] m_pTXBuffer[0];
-	delete [] m_pTXBuffer[1];
-	m_pTXBuffer[0] = nullptr;
-	m_pTXBuffer[1] = nullptr;
-
-	delete [] m_pRXBuffer[0];
-	delete [] m_pRXBuffer[1];
-	m_pRXBuffer[0] = nullptr;
-	m_pRXBuffer[1] = nullptr;
+	FreeBuffers ();
 
 	m_pTXUSBDevice = nullptr;
 	m_pRXUSBDevice = nullptr;
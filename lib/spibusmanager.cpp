@@ -0,0 +1,87 @@
+//
+// spibusmanager.cpp
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <circle/spibusmanager.h>
+#include <assert.h>
+
+CSPIBusManager::CSPIBusManager (CSPIMasterDMA *pSPIMaster)
+:	m_pSPIMaster (pSPIMaster),
+	m_nClockSpeed (0),
+	m_CPOL (0),
+	m_CPHA (0)
+{
+	assert (m_pSPIMaster != 0);
+}
+
+CSPIBusManager::~CSPIBusManager (void)
+{
+	m_pSPIMaster = 0;
+}
+
+int CSPIBusManager::StartTransaction (TBusTransaction *pTransaction,
+				      unsigned *pBytesWritten, unsigned *pBytesRead)
+{
+	TSPITransaction *pSPI = static_cast<TSPITransaction *> (pTransaction);
+	assert (pSPI != 0);
+	assert (pBytesWritten != 0);
+	assert (pBytesRead != 0);
+
+	if (   pSPI->pWriteBuffer == 0
+	    || pSPI->pReadBuffer == 0
+	    || pSPI->nCount == 0
+	    || ((uintptr) pSPI->pWriteBuffer & 3)
+	    || ((uintptr) pSPI->pReadBuffer & 3))
+	{
+		return SPI_BUS_ERROR;
+	}
+
+	*pBytesWritten = pSPI->nCount;
+	*pBytesRead = pSPI->nCount;
+
+	assert (m_pSPIMaster != 0);
+
+	if (   pSPI->nClockSpeed != 0
+	    && (   pSPI->nClockSpeed != m_nClockSpeed
+		|| pSPI->CPOL != m_CPOL
+		|| pSPI->CPHA != m_CPHA))
+	{
+		m_nClockSpeed = pSPI->nClockSpeed;
+		m_CPOL = pSPI->CPOL;
+		m_CPHA = pSPI->CPHA;
+
+		m_pSPIMaster->SetClock (m_nClockSpeed);
+		m_pSPIMaster->SetMode (m_CPOL, m_CPHA);
+	}
+
+	// the completion routine is reset by the SPI master after each transfer
+	m_pSPIMaster->SetCompletionRoutine (CompletionStub, this);
+
+	m_pSPIMaster->StartWriteRead (pSPI->nChipSelect, pSPI->pWriteBuffer,
+				      pSPI->pReadBuffer, pSPI->nCount);
+
+	return BUS_STATUS_SUCCESS;
+}
+
+void CSPIBusManager::CompletionStub (boolean bStatus, void *pParam)
+{
+	CSPIBusManager *pThis = (CSPIBusManager *) pParam;
+	assert (pThis != 0);
+
+	pThis->TransactionCompleted (bStatus ? BUS_STATUS_SUCCESS : SPI_BUS_ERROR);
+}
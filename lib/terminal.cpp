@@ -18,11 +18,13 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 #include <circle/terminal.h>
+#include <circle/bcmframebuffer.h>
 #include <circle/devicenameservice.h>
 #include <circle/synchronize.h>
 #include <circle/sysconfig.h>
 #include <circle/timer.h>
 #include <circle/util.h>
+#include <assert.h>
 
 static const char DevicePrefix[] = "tty";
 
@@ -33,6 +35,14 @@ CTerminalDevice::CTerminalDevice (CDisplay *pDisplay, unsigned nDeviceIndex,
 	m_CharGen (rFont, FontFlags),
 	m_pCursorPixels (nullptr),
 	m_pBuffer8 (nullptr),
+	m_pBufferBase (nullptr),
+	m_nBufferLines (0),
+	m_nBaseY (0),
+	m_nDisplayBaseY (0),
+	m_pFrameBuffer (nullptr),
+	m_pGlyphCache (nullptr),
+	m_GlyphCacheColor (0),
+	m_GlyphCacheBackground (0),
 	m_nSize (0),
 	m_nPitch (0),
 	m_nWidth (0),
@@ -64,9 +74,13 @@ CTerminalDevice::~CTerminalDevice (void)
 {
 	CDeviceNameService::Get ()->RemoveDevice (DevicePrefix, m_nDeviceIndex+1, FALSE);
 
-	delete [] m_pBuffer8;
+	delete [] m_pBufferBase;
+	m_pBufferBase = nullptr;
 	m_pBuffer8 = nullptr;
 
+	delete [] m_pGlyphCache;
+	m_pGlyphCache = nullptr;
+
 	delete [] m_pCursorPixels;
 	m_pCursorPixels = nullptr;
 
@@ -87,12 +101,41 @@ boolean CTerminalDevice::Initialize (void)
 		return FALSE;
 	}
 
-	m_pBuffer8 = new u8[m_nSize];
-	if (!m_pBuffer8)
+	m_nBufferLines = m_nHeight;
+	if (m_pFrameBuffer)
+	{
+		if (m_pFrameBuffer->GetVirtHeight () >= 2*m_nHeight)
+		{
+			m_nBufferLines = 2*m_nHeight;
+		}
+		else
+		{
+			m_pFrameBuffer = nullptr;
+		}
+	}
+
+	m_pBufferBase = new u8[m_nBufferLines * m_nPitch];
+	if (!m_pBufferBase)
 	{
 		return FALSE;
 	}
 
+	m_pBuffer8 = m_pBufferBase;
+	m_nBaseY = 0;
+	m_nDisplayBaseY = 0;
+
+	if (m_nDepth != 1)
+	{
+		m_pGlyphCache = new u8[256 * m_CharGen.GetCharWidth () * m_CharGen.GetCharHeight ()
+				       * m_nDepth/8];
+		if (!m_pGlyphCache)
+		{
+			return FALSE;
+		}
+
+		memset (m_GlyphCacheValid, 0, sizeof m_GlyphCacheValid);
+	}
+
 	m_pCursorPixels = new CDisplay::TRawColor[  m_CharGen.GetCharWidth ()
 						  * m_CharGen.GetCharHeight ()];
 	if (!m_pCursorPixels)
@@ -121,6 +164,13 @@ boolean CTerminalDevice::Initialize (void)
 	m_UpdateArea.y1 = m_nHeight;
 	m_UpdateArea.y2 = 0;
 
+#if RASPPI <= 4
+	if (m_pFrameBuffer)
+	{
+		m_pFrameBuffer->SetVirtualOffset (0, 0);
+	}
+#endif
+
 	if (!CDeviceNameService::Get ()->GetDevice (DevicePrefix, m_nDeviceIndex+1, FALSE))
 	{
 		CDeviceNameService::Get ()->AddDevice (DevicePrefix, m_nDeviceIndex+1, this, FALSE);
@@ -129,6 +179,17 @@ boolean CTerminalDevice::Initialize (void)
 	return TRUE;
 }
 
+void CTerminalDevice::EnableHardwareScroll (CBcmFrameBuffer *pFrameBuffer)
+{
+	assert (pFrameBuffer);
+	assert (pFrameBuffer == m_pDisplay);
+	assert (!m_pBufferBase);
+
+#if RASPPI <= 4
+	m_pFrameBuffer = pFrameBuffer;
+#endif
+}
+
 unsigned CTerminalDevice::GetWidth (void) const
 {
 	return m_nWidth;
@@ -181,13 +242,9 @@ int CTerminalDevice::Write (const void *pBuffer, size_t nCount)
 	InvertCursor ();
 
 	// Update display
-	if (   !m_bDelayedUpdate
-	    && m_UpdateArea.y1 <= m_UpdateArea.y2)
+	if (!m_bDelayedUpdate)
 	{
-		m_pDisplay->SetArea (m_UpdateArea, m_pBuffer8 + m_UpdateArea.y1 * m_nPitch);
-
-		m_UpdateArea.y1 = m_nHeight;
-		m_UpdateArea.y2 = 0;
+		UpdateDisplay ();
 	}
 
 	m_SpinLock.Release ();
@@ -207,7 +264,7 @@ void CTerminalDevice::SetPixel (unsigned nPosX, unsigned nPosY, TTerminalColor C
 
 	SetRawPixel (nPosX, nPosY, nColor);
 
-	m_pDisplay->SetPixel (nPosX, nPosY, nColor);
+	m_pDisplay->SetPixel (nPosX, m_nBaseY + nPosY, nColor);
 }
 
 void CTerminalDevice::SetPixel (unsigned nPosX, unsigned nPosY, CDisplay::TRawColor nColor)
@@ -220,7 +277,7 @@ void CTerminalDevice::SetPixel (unsigned nPosX, unsigned nPosY, CDisplay::TRawCo
 
 	SetRawPixel (nPosX, nPosY, nColor);
 
-	m_pDisplay->SetPixel (nPosX, nPosY, nColor);
+	m_pDisplay->SetPixel (nPosX, m_nBaseY + nPosY, nColor);
 }
 
 TTerminalColor CTerminalDevice::GetPixel (unsigned nPosX, unsigned nPosY)
@@ -258,10 +315,7 @@ void CTerminalDevice::Update (unsigned nMillis)
 	    && (   !nMillis
 		|| nTicks - m_nLastUpdateTicks >= nMillis * CLOCKHZ / 1000))
 	{
-		m_pDisplay->SetArea (m_UpdateArea, m_pBuffer8 + m_UpdateArea.y1 * m_nPitch);
-
-		m_UpdateArea.y1 = m_nHeight;
-		m_UpdateArea.y2 = 0;
+		UpdateDisplay ();
 
 		m_nLastUpdateTicks = nTicks;
 	}
@@ -577,42 +631,9 @@ void CTerminalDevice::ClearDisplayEnd (void)
 	ClearLineEnd ();
 
 	unsigned nPosY = m_nCursorY + m_CharGen.GetCharHeight ();
-	unsigned nOffset = nPosY * m_nWidth;
-
-	switch (m_nDepth)
+	if (nPosY < m_nHeight)
 	{
-	case 1: {
-			nOffset /= 8;
-			unsigned nSize = m_nSize - nOffset;
-			for (u8 *pBuffer = m_pBuffer8 + nOffset; nSize--;)
-			{
-				*pBuffer++ = m_BackgroundColor ? 0xFF : 0;
-			}
-		} break;
-
-	case 8: {
-			unsigned nSize = m_nSize - nOffset;
-			for (u8 *pBuffer = m_pBuffer8 + nOffset; nSize--;)
-			{
-				*pBuffer++ = (u8) m_BackgroundColor;
-			}
-		} break;
-
-	case 16: {
-			unsigned nSize = m_nSize / 2 - nOffset;
-			for (u16 *pBuffer = m_pBuffer16 + nOffset; nSize--;)
-			{
-				*pBuffer++ = (u16) m_BackgroundColor;
-			}
-		} break;
-
-	case 32: {
-			unsigned nSize = m_nSize / 4 - nOffset;
-			for (u32 *pBuffer = m_pBuffer32 + nOffset; nSize--;)
-			{
-				*pBuffer++ = (u32) m_BackgroundColor;
-			}
-		} break;
+		ClearLines (nPosY, m_nHeight - nPosY);
 	}
 
 	SetUpdateArea (m_nCursorY, m_nHeight-1);
@@ -953,6 +974,15 @@ void CTerminalDevice::Scroll (void)
 {
 	unsigned nLines = m_CharGen.GetCharHeight ();
 
+	if (   m_pFrameBuffer
+	    && m_nScrollStart == 0
+	    && m_nScrollEnd == m_nUsedHeight)
+	{
+		HardwareScroll (nLines);
+
+		return;
+	}
+
 	u8 *pTo = m_pBuffer8 + m_nScrollStart * m_nPitch;
 	u8 *pFrom = m_pBuffer8 + (m_nScrollStart + nLines) * m_nPitch;
 
@@ -960,59 +990,170 @@ void CTerminalDevice::Scroll (void)
 	if (nSize)
 	{
 		memcpy (pTo, pFrom, nSize);
-
-		pTo += nSize;
 	}
 
-	nSize = m_nWidth * nLines;
-	switch (m_nDepth)
+	ClearLines (m_nScrollEnd - nLines, nLines);
+
+	SetUpdateArea (m_nScrollStart, m_nScrollEnd-1);
+}
+
+// The buffer and the frame buffer have twice the screen height. The visible
+// window is moved down line by line. When it reaches the end of the buffer,
+// its contents is copied back to the top. This happens once per screen height,
+// so that the average time needed for scrolling does not depend on it.
+void CTerminalDevice::HardwareScroll (unsigned nLines)
+{
+	assert (m_pFrameBuffer);
+
+	if (m_nBaseY + nLines + m_nHeight > m_nBufferLines)
+	{
+		// does not overlap, because the window is in the lower half
+		memcpy (m_pBufferBase, m_pBuffer8 + nLines * m_nPitch, (m_nHeight - nLines) * m_nPitch);
+
+		m_pBuffer8 = m_pBufferBase;
+		m_nBaseY = 0;
+
+		SetUpdateArea (0, m_nHeight-1);
+	}
+	else
 	{
-	case 1: {
-			nSize /= 8;
-			for (u8 *p = (u8 *) pTo; nSize--;)
+		m_pBuffer8 += nLines * m_nPitch;
+		m_nBaseY += nLines;
+
+		// the pending update area moves up with the contents
+		if (m_UpdateArea.y1 <= m_UpdateArea.y2)
+		{
+			if (m_UpdateArea.y2 < nLines)
 			{
-				*p++ = m_BackgroundColor ? 0xFF : 0;
+				m_UpdateArea.y1 = m_nHeight;
+				m_UpdateArea.y2 = 0;
 			}
-		}
-		break;
-
-	case 8: {
-			for (u8 *p = (u8 *) pTo; nSize--;)
+			else
 			{
-				*p++ = (u8) m_BackgroundColor;
+				m_UpdateArea.y1 = m_UpdateArea.y1 > nLines ? m_UpdateArea.y1 - nLines : 0;
+				m_UpdateArea.y2 -= nLines;
 			}
-		} break;
+		}
+	}
+
+	// the lines below the used height have not been in the window before
+	unsigned nPosY = m_nUsedHeight - nLines;
+	ClearLines (nPosY, m_nHeight - nPosY);
+
+	SetUpdateArea (nPosY, m_nHeight-1);
+}
+
+void CTerminalDevice::ClearLines (unsigned nPosY, unsigned nLines)
+{
+	assert (nPosY + nLines <= m_nHeight);
+	if (!nLines)
+	{
+		return;
+	}
+
+	u8 *pLine = m_pBuffer8 + nPosY * m_nPitch;
+
+	switch (m_nDepth)
+	{
+	case 1:
+		memset (pLine, m_BackgroundColor ? 0xFF : 0, nLines * m_nPitch);
+		return;
+
+	case 8:
+		memset (pLine, (u8) m_BackgroundColor, nLines * m_nPitch);
+		return;
 
 	case 16: {
-			for (u16 *p = (u16 *) pTo; nSize--;)
+			u16 *p = (u16 *) pLine;
+			for (unsigned i = 0; i < m_nWidth; i++)
 			{
 				*p++ = (u16) m_BackgroundColor;
 			}
 		} break;
 
 	case 32: {
-			for (u32 *p = (u32 *) pTo; nSize--;)
+			u32 *p = (u32 *) pLine;
+			for (unsigned i = 0; i < m_nWidth; i++)
 			{
 				*p++ = (u32) m_BackgroundColor;
 			}
 		} break;
 	}
 
-	SetUpdateArea (0, m_nHeight-1);
+	// replicate the first line, memcpy() is faster than the loop above
+	for (unsigned i = 1; i < nLines; i++)
+	{
+		memcpy (pLine + i * m_nPitch, pLine, m_nPitch);
+	}
 }
 
 void CTerminalDevice::DisplayChar (char chChar, unsigned nPosX, unsigned nPosY,
 				   CDisplay::TRawColor nColor)
 {
-	for (unsigned y = 0; y < m_CharGen.GetCharHeight (); y++)
+	CDisplay::TRawColor nBackgroundColor = GetTextBackgroundColor ();
+
+	if (!m_pGlyphCache)
 	{
-		CCharGenerator::TPixelLine Line = m_CharGen.GetPixelLine (chChar, y);
+		for (unsigned y = 0; y < m_CharGen.GetCharHeight (); y++)
+		{
+			CCharGenerator::TPixelLine Line = m_CharGen.GetPixelLine (chChar, y);
 
-		for (unsigned x = 0; x < m_CharGen.GetCharWidth (); x++)
+			for (unsigned x = 0; x < m_CharGen.GetCharWidth (); x++)
+			{
+				SetRawPixel (nPosX + x, nPosY + y,   m_CharGen.GetPixel (x, Line)
+								   ? nColor : nBackgroundColor);
+			}
+		}
+
+		SetUpdateArea (nPosY, nPosY + m_CharGen.GetCharHeight ()-1);
+
+		return;
+	}
+
+	// the glyph cache holds the glyphs for one color combination
+	if (   nColor != m_GlyphCacheColor
+	    || nBackgroundColor != m_GlyphCacheBackground)
+	{
+		memset (m_GlyphCacheValid, 0, sizeof m_GlyphCacheValid);
+
+		m_GlyphCacheColor = nColor;
+		m_GlyphCacheBackground = nBackgroundColor;
+	}
+
+	unsigned nLineSize = m_CharGen.GetCharWidth () * m_nDepth/8;
+	unsigned nChar = (u8) chChar;
+	u8 *pGlyph = m_pGlyphCache + nChar * nLineSize * m_CharGen.GetCharHeight ();
+
+	if (!(m_GlyphCacheValid[nChar / 32] & (1U << (nChar % 32))))
+	{
+		u8 *p = pGlyph;
+		for (unsigned y = 0; y < m_CharGen.GetCharHeight (); y++)
 		{
-			SetRawPixel (nPosX + x, nPosY + y,   m_CharGen.GetPixel (x, Line)
-							   ? nColor : GetTextBackgroundColor ());
+			CCharGenerator::TPixelLine Line = m_CharGen.GetPixelLine (chChar, y);
+
+			for (unsigned x = 0; x < m_CharGen.GetCharWidth (); x++)
+			{
+				CDisplay::TRawColor nPixel =   m_CharGen.GetPixel (x, Line)
+							     ? nColor : nBackgroundColor;
+				switch (m_nDepth)
+				{
+				case 8:		*p++ = (u8) nPixel;					break;
+				case 16:	*(u16 *) p = (u16) nPixel;	p += 2;			break;
+				case 32:	*(u32 *) p = nPixel;		p += 4;			break;
+				}
+			}
 		}
+
+		m_GlyphCacheValid[nChar / 32] |= 1U << (nChar % 32);
+	}
+
+	u8 *pTo = m_pBuffer8 + nPosY * m_nPitch + nPosX * m_nDepth/8;
+	for (unsigned y = 0; y < m_CharGen.GetCharHeight (); y++)
+	{
+		memcpy (pTo, pGlyph, nLineSize);
+
+		pTo += m_nPitch;
+		pGlyph += nLineSize;
 	}
 
 	SetUpdateArea (nPosY, nPosY + m_CharGen.GetCharHeight ()-1);
@@ -1064,3 +1205,29 @@ void CTerminalDevice::InvertCursor (void)
 
 	SetUpdateArea (m_nCursorY + y0, m_nCursorY + m_CharGen.GetCharHeight ()-1);
 }
+
+void CTerminalDevice::UpdateDisplay (void)
+{
+	if (m_UpdateArea.y1 <= m_UpdateArea.y2)
+	{
+		CDisplay::TArea Area = m_UpdateArea;
+		Area.y1 += m_nBaseY;
+		Area.y2 += m_nBaseY;
+
+		m_pDisplay->SetArea (Area, m_pBuffer8 + m_UpdateArea.y1 * m_nPitch);
+
+		m_UpdateArea.y1 = m_nHeight;
+		m_UpdateArea.y2 = 0;
+	}
+
+#if RASPPI <= 4
+	// show the new window after its contents has been written
+	if (m_nDisplayBaseY != m_nBaseY)
+	{
+		assert (m_pFrameBuffer);
+		m_pFrameBuffer->SetVirtualOffset (0, m_nBaseY);
+
+		m_nDisplayBaseY = m_nBaseY;
+	}
+#endif
+}
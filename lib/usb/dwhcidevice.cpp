@@ -819,7 +819,7 @@ void CDWHCIDevice::QueueTransaction (CDWHCITransferStageData *pStageData)
 		usFrameNumber = (usFrameNumber+1) & DWHCI_MAX_FRAME_NUMBER;
 	}
 
-	m_TransactionQueue.Enqueue (pStageData, usFrameNumber);
+	EnqueueTransaction (pStageData, usFrameNumber);
 }
 
 void CDWHCIDevice::QueueDelayedTransaction (CDWHCITransferStageData *pStageData)
@@ -858,7 +858,22 @@ void CDWHCIDevice::QueueDelayedTransaction (CDWHCITransferStageData *pStageData)
 		pStageData->SetState (StageStateNoSplitTransfer);
 	}
 
+	EnqueueTransaction (pStageData, usFrameNumber);
+}
+
+void CDWHCIDevice::EnqueueTransaction (CDWHCITransferStageData *pStageData, u16 usFrameNumber)
+{
+	CDWHCIRegister IntMask (DWHCI_CORE_INT_MASK);
+
+	m_IntMaskSpinLock.Acquire ();
+
 	m_TransactionQueue.Enqueue (pStageData, usFrameNumber);
+
+	IntMask.Read ();
+	IntMask.Or (DWHCI_CORE_INT_MASK_SOF_INTR);
+	IntMask.Write ();
+
+	m_IntMaskSpinLock.Release ();
 }
 
 #endif
@@ -1418,6 +1433,22 @@ void CDWHCIDevice::SOFInterruptHandler (void)
 
 		StartTransaction (pStageData);
 	}
+
+	// The SOF interrupt is only needed, while transactions are waiting in the queue.
+	// Otherwise it would trigger 8000 IRQs per second, even if the bus is idle or
+	// only has long running (e.g. bulk) transfers active.
+	CDWHCIRegister IntMask (DWHCI_CORE_INT_MASK);
+
+	m_IntMaskSpinLock.Acquire ();
+
+	if (m_TransactionQueue.IsEmpty ())
+	{
+		IntMask.Read ();
+		IntMask.And (~DWHCI_CORE_INT_MASK_SOF_INTR);
+		IntMask.Write ();
+	}
+
+	m_IntMaskSpinLock.Release ();
 }
 
 #endif
@@ -98,6 +98,9 @@ CUSBMSDGadget::CUSBMSDGadget (CInterruptSystem *pInterruptSystem, CDevice *pDevi
 	m_pDevice (pDevice),
 	m_pEP {nullptr, nullptr, nullptr}
 {
+	BeginDataTransfer();
+	memset(&m_Statistics,0,sizeof m_Statistics);
+
 	if(pDevice)SetDevice(pDevice);
 }
 
@@ -267,25 +270,25 @@ void CUSBMSDGadget::OnTransferComplete (boolean bIn, size_t nLength)
 				                            m_OutBuffer,SIZE_CBW);
 				break;
 			}
-		case TMSDState::DataIn:
+		case TMSDState::DataIn:	//done sending reply to host
+			{
+				SendCSW();
+				break;
+			}
+		case TMSDState::DataInRead:
 			{
-				if(m_nnumber_blocks>0)
+				assert(m_BufferState[m_nUSBBuffer]==BufferBusy);
+				m_BufferState[m_nUSBBuffer]=BufferFree;
+				m_nUSBBuffer ^= 1;
+				if(m_bIOError)
 				{
-					if(m_MSDReady)
-					{
-						m_nState=TMSDState::DataInRead; //see Update function
-					}
-					else
-					{
-						MLOGERR("onXferCmplt DataIn","failed, %s",
-						        m_MSDReady?"ready":"not ready");
-						m_CSW.bmCSWStatus=MSD_CSW_STATUS_FAIL;
-						m_ReqSenseReply.bSenseKey = 2;
-						m_ReqSenseReply.bAddlSenseCode = 1;
-						SendCSW();
-					}
+					SendCSW();
+					break;
 				}
-				else     //done sending data to host
+				StartDataIn();
+				if(   m_nnumber_blocks==0
+				   && m_BufferState[0]==BufferFree
+				   && m_BufferState[1]==BufferFree)  //done sending data to host
 				{
 					SendCSW();
 				}
@@ -332,23 +335,29 @@ void CUSBMSDGadget::OnTransferComplete (boolean bIn, size_t nLength)
 				} // TODO: response for not meaningful CBW
 				break;
 			}
-		case TMSDState::DataOut:
+		case TMSDState::DataOutWrite:
 			{
-				//process block from host
-				assert(m_nnumber_blocks>0);
-				if(m_MSDReady)
-				{
-					m_nState=TMSDState::DataOutWrite; //see Update function
-				}
-				else
+				//blocks from host are available in the data buffer
+				assert(m_BufferState[m_nUSBBuffer]==BufferBusy);
+				if(nLength != m_nBufferBlocks[m_nUSBBuffer]*BLOCK_SIZE)
 				{
-					MLOGERR("onXferCmplt DataOut","failed, %s",
-					        m_MSDReady?"ready":"not ready");
+					//the host has ended the data phase, fail the command
+					//and do not write the incomplete buffer to the media
+					MLOGERR("onXferCmplt DataOut","Short transfer len = %i",nLength);
 					m_CSW.bmCSWStatus=MSD_CSW_STATUS_FAIL;
-					m_ReqSenseReply.bSenseKey = 2;
-					m_ReqSenseReply.bAddlSenseCode = 1;
-					SendCSW();
+					m_ReqSenseReply.bSenseKey = 0xB;	// Aborted command
+					m_ReqSenseReply.bAddlSenseCode = 0x4B;	// Data phase error
+					m_bIOError=TRUE;
+
+					//no more blocks are requested, the CSW is sent from
+					//UpdateWrite(), when the filled buffers have been released
+					assert(m_nnumber_blocks>=m_nTransferBlocks);
+					m_nnumber_blocks-=m_nTransferBlocks;
+					m_nTransferBlocks=0;
 				}
+				m_BufferState[m_nUSBBuffer]=BufferFilled; //see Update function
+				m_nUSBBuffer ^= 1;
+				StartDataOut();
 				break;
 			}
 
@@ -498,6 +507,8 @@ void CUSBMSDGadget::HandleSCSICommand()
 				}
 				MLOGDEBUG("Read(10)","addr = %u len = %u",
 					  m_nblock_address,m_nnumber_blocks);
+				m_Statistics.ReadCommands++;
+				BeginDataTransfer();
 				m_nState=TMSDState::DataInRead; //see Update() function
 			}
 			else
@@ -521,12 +532,19 @@ void CUSBMSDGadget::HandleSCSICommand()
 				m_nblock_address = (u32)(m_CBW.CBWCB[2] << 24) | (u32)(m_CBW.CBWCB[3] << 16)
 				                   |(u32)(m_CBW.CBWCB[4] << 8) | m_CBW.CBWCB[5];
 				MLOGDEBUG("Write(10)","addr = %u len = %u",m_nblock_address,m_nnumber_blocks);
-				m_pEP[EPOut]->BeginTransfer(CUSBMSDGadgetEndpoint::TransferDataOut,
-				                            m_OutBuffer,512);
-				m_nState=TMSDState::DataOut;
 				m_CSW.bmCSWStatus=MSD_CSW_STATUS_OK;	   //will be updated if write fails
 				m_ReqSenseReply.bSenseKey = 0;
 				m_ReqSenseReply.bAddlSenseCode = 0;
+				if(m_nnumber_blocks==0)
+				{
+					SendCSW();
+					break;
+				}
+				m_Statistics.WriteCommands++;
+				BeginDataTransfer();
+				m_nTransferBlocks=m_nnumber_blocks;
+				m_nState=TMSDState::DataOutWrite;
+				StartDataOut();
 			}
 			else
 			{
@@ -568,100 +586,199 @@ void CUSBMSDGadget::Update()
 	switch(m_nState)
 	{
 	case TMSDState::DataInRead:
+		UpdateRead();
+		break;
+
+	case TMSDState::DataOutWrite:
+		UpdateWrite();
+		break;
+
+	default:
+		break;
+	}
+}
+
+void CUSBMSDGadget::GetStatistics (TStatistics *pStatistics) const
+{
+	assert (pStatistics);
+	EnterCritical ();
+	*pStatistics = m_Statistics;
+	LeaveCritical ();
+}
+
+void CUSBMSDGadget::BeginDataTransfer (void)
+{
+	m_BufferState[0]=BufferFree;
+	m_BufferState[1]=BufferFree;
+	m_nBufferBlocks[0]=0;
+	m_nBufferBlocks[1]=0;
+	m_nIOBuffer=0;
+	m_nUSBBuffer=0;
+	m_nTransferBlocks=0;
+	m_bIOError=FALSE;
+}
+
+//sends the next buffer to the host, if it has been filled from the device
+void CUSBMSDGadget::StartDataIn (void)
+{
+	if(m_BufferState[m_nUSBBuffer]!=BufferFilled)
+	{
+		return;
+	}
+
+	m_BufferState[m_nUSBBuffer]=BufferBusy;
+	m_pEP[EPIn]->BeginTransfer(CUSBMSDGadgetEndpoint::TransferDataIn,
+	                           GetDataBuffer(m_nUSBBuffer),
+	                           m_nBufferBlocks[m_nUSBBuffer]*BLOCK_SIZE);
+}
+
+//requests the next blocks from the host, if a buffer is free
+void CUSBMSDGadget::StartDataOut (void)
+{
+	if(   m_nTransferBlocks==0
+	   || m_BufferState[m_nUSBBuffer]!=BufferFree)
+	{
+		return;
+	}
+
+	u32 nBlocks=m_nTransferBlocks;
+	if(nBlocks>MSD_CHUNK_BLOCKS)
+	{
+		nBlocks=MSD_CHUNK_BLOCKS;
+	}
+	m_nTransferBlocks-=nBlocks;
+
+	m_nBufferBlocks[m_nUSBBuffer]=nBlocks;
+	m_BufferState[m_nUSBBuffer]=BufferBusy;
+	m_pEP[EPOut]->BeginTransfer(CUSBMSDGadgetEndpoint::TransferDataOut,
+	                            GetDataBuffer(m_nUSBBuffer),nBlocks*BLOCK_SIZE);
+}
+
+//reads the next chunk from the device into a free buffer,
+//while the other buffer may be sent to the host
+void CUSBMSDGadget::UpdateRead (void)
+{
+	if(   m_nnumber_blocks==0
+	   || m_bIOError
+	   || m_BufferState[m_nIOBuffer]!=BufferFree)
+	{
+		return;
+	}
+
+	u32 nBlocks=m_nnumber_blocks;
+	if(nBlocks>MSD_CHUNK_BLOCKS)
+	{
+		nBlocks=MSD_CHUNK_BLOCKS;
+	}
+
+	u64 offset=0;
+	int readCount=0;
+	if(m_MSDReady)
+	{
+		offset=m_pDevice->Seek((u64)BLOCK_SIZE*m_nblock_address);
+		MLOGDEBUG("UpdateRead","offset = %u ",offset);
+		if(offset!=(u64)(-1))
 		{
-			u64 offset=0;
-			int readCount=0;
-			if(m_MSDReady)
-			{
-				offset=m_pDevice->Seek(BLOCK_SIZE*m_nblock_address);
-				MLOGDEBUG("UpdateRead","offset = %u ",offset);
-				if(offset!=(u64)(-1))
-				{
-					readCount=m_pDevice->Read(m_InBuffer,BLOCK_SIZE);
-					if(readCount < BLOCK_SIZE)
-					{
-						MLOGERR("UpdateRead","readCount = %u ",readCount);
-						m_CSW.bmCSWStatus=MSD_CSW_STATUS_FAIL;
-						m_ReqSenseReply.bSenseKey = 2;
-						m_ReqSenseReply.bAddlSenseCode = 1;
-						SendCSW();
-						break;
-					}
-					m_pEP[EPIn]->BeginTransfer(CUSBMSDGadgetEndpoint::TransferDataIn,
-					                           m_InBuffer,readCount);
-					m_nnumber_blocks--;
-					m_nblock_address++;
-					m_nbyteCount-=readCount;
-					m_nState=TMSDState::DataIn;
-				}
-			}
-			if(!m_MSDReady || offset==(u64)(-1))
-			{
-				MLOGERR("UpdateRead","failed, %s, offset=%i",
-				        m_MSDReady?"ready":"not ready",offset);
-				m_CSW.bmCSWStatus=MSD_CSW_STATUS_FAIL;
-				m_ReqSenseReply.bSenseKey = 2;
-				m_ReqSenseReply.bAddlSenseCode = 1;
-				SendCSW();
-			}
-			break;
+			readCount=m_pDevice->Read(GetDataBuffer(m_nIOBuffer),nBlocks*BLOCK_SIZE);
 		}
-	case TMSDState::DataOutWrite:
+	}
+	if(!m_MSDReady || offset==(u64)(-1) || readCount<(int)(nBlocks*BLOCK_SIZE))
+	{
+		MLOGERR("UpdateRead","failed, %s, offset=%i, readCount=%i",
+		        m_MSDReady?"ready":"not ready",offset,readCount);
+		IOError();
+		return;
+	}
+
+	EnterCritical();
+
+	m_nBufferBlocks[m_nIOBuffer]=nBlocks;
+	m_BufferState[m_nIOBuffer]=BufferFilled;
+	m_nIOBuffer ^= 1;
+
+	m_nnumber_blocks-=nBlocks;
+	m_nblock_address+=nBlocks;
+	m_nbyteCount-=readCount;
+	m_Statistics.BytesRead+=readCount;
+
+	StartDataIn();
+
+	LeaveCritical();
+}
+
+//writes a buffer received from the host to the device,
+//while the next blocks may be received into the other buffer
+void CUSBMSDGadget::UpdateWrite (void)
+{
+	if(m_BufferState[m_nIOBuffer]!=BufferFilled)
+	{
+		return;
+	}
+
+	u32 nBlocks=m_nBufferBlocks[m_nIOBuffer];
+	assert(nBlocks>0);
+	assert(m_nnumber_blocks>=nBlocks);
+
+	//after an error the remaining data from host is received, but discarded
+	if(!m_bIOError)
+	{
+		u64 offset=0;
+		int writeCount=0;
+		if(m_MSDReady)
 		{
-			//process block from host
-			assert(m_nnumber_blocks>0);
-			u64 offset=0;
-			int writeCount=0;
-			if(m_MSDReady)
+			offset=m_pDevice->Seek((u64)BLOCK_SIZE*m_nblock_address);
+			if(offset!=(u64)(-1))
 			{
-				offset=m_pDevice->Seek(BLOCK_SIZE*m_nblock_address);
-				if(offset!=(u64)(-1))
-				{
-					writeCount=m_pDevice->Write(m_OutBuffer,BLOCK_SIZE);
-				}
-				if(writeCount>0)
-				{
-					if(writeCount<BLOCK_SIZE)
-					{
-						MLOGERR("UpdateWrite","writeCount = %u ",writeCount);
-						m_CSW.bmCSWStatus=MSD_CSW_STATUS_FAIL;
-						m_ReqSenseReply.bSenseKey = 0x2;
-						m_ReqSenseReply.bAddlSenseCode = 0x1;
-						SendCSW();
-						break;
-					}
-					m_nnumber_blocks--;
-					m_nblock_address++;
-					if(m_nnumber_blocks==0)  //done receiving data from host
-					{
-						SendCSW();
-						break;
-					}
-				}
+				writeCount=m_pDevice->Write(GetDataBuffer(m_nIOBuffer),
+							    nBlocks*BLOCK_SIZE);
 			}
-			if(!m_MSDReady || offset==(u64)(-1) || writeCount<=0)
-			{
-				MLOGERR("UpdateWrite","failed, %s, offset=%i, writeCount=%i",
-				        m_MSDReady?"ready":"not ready",offset,writeCount);
-				m_CSW.bmCSWStatus=MSD_CSW_STATUS_FAIL;
-				m_ReqSenseReply.bSenseKey = 2;
-				m_ReqSenseReply.bAddlSenseCode = 1;
-				SendCSW();
-				break;
-			}
-			else
-			{
-				if(m_nnumber_blocks>0)  //get next block
-				{
-					m_pEP[EPOut]->BeginTransfer(
-						CUSBMSDGadgetEndpoint::TransferDataOut,
-					        m_OutBuffer,512);
-					m_nState=TMSDState::DataOut;
-				}
-			}
-			break;
 		}
-	default:
-		break;
+		if(!m_MSDReady || offset==(u64)(-1) || writeCount<(int)(nBlocks*BLOCK_SIZE))
+		{
+			MLOGERR("UpdateWrite","failed, %s, offset=%i, writeCount=%i",
+			        m_MSDReady?"ready":"not ready",offset,writeCount);
+			IOError();
+		}
+		else
+		{
+			m_Statistics.BytesWritten+=writeCount;
+		}
+	}
+
+	EnterCritical();
+
+	m_BufferState[m_nIOBuffer]=BufferFree;
+	m_nIOBuffer ^= 1;
+
+	m_nnumber_blocks-=nBlocks;
+	m_nblock_address+=nBlocks;
+	if(m_nnumber_blocks==0)  //done receiving data from host
+	{
+		SendCSW();
 	}
+	else
+	{
+		StartDataOut();
+	}
+
+	LeaveCritical();
+}
+
+void CUSBMSDGadget::IOError (void)
+{
+	EnterCritical();
+
+	m_CSW.bmCSWStatus=MSD_CSW_STATUS_FAIL;
+	m_ReqSenseReply.bSenseKey = 2;
+	m_ReqSenseReply.bAddlSenseCode = 1;
+	m_bIOError=TRUE;
+
+	//on read, the CSW is sent on completion of an active transfer
+	if(   m_nState==TMSDState::DataInRead
+	   && m_BufferState[m_nUSBBuffer]!=BufferBusy)
+	{
+		SendCSW();
+	}
+
+	LeaveCritical();
 }
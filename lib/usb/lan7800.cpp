@@ -39,8 +39,12 @@
 #define DEFAULT_BULK_IN_DELAY		0x800
 
 #define RX_HEADER_SIZE			(4 + 4 + 2)
+#define RX_PADDING			(RX_HEADER_SIZE % 4)
 #define TX_HEADER_SIZE			(4 + 4)
 
+#define RX_BUFFER_SIZE			DEFAULT_BURST_CAP_SIZE
+#define TX_BUFFER_SIZE			(FRAME_BUFFER_SIZE + TX_HEADER_SIZE)
+
 #define MAX_RX_FRAME_SIZE		(2*6 + 2 + 1500 + 4)
 
 // USB vendor requests
@@ -232,12 +236,16 @@ static const char FromLAN7800[] = "lan7800";
 CLAN7800Device::CLAN7800Device (CUSBFunction *pFunction)
 :	CUSBFunction (pFunction),
 	m_pEndpointBulkIn (0),
-	m_pEndpointBulkOut (0)
+	m_pEndpointBulkOut (0),
+	m_pPipeline (0)
 {
 }
 
 CLAN7800Device::~CLAN7800Device (void)
 {
+	delete m_pPipeline;
+	m_pPipeline = 0;
+
 	delete m_pEndpointBulkOut;
 	m_pEndpointBulkOut = 0;
 
@@ -331,14 +339,15 @@ boolean CLAN7800Device::Configure (void)
 		return FALSE;
 	}
 
-	if (   !WriteReg (BURST_CAP, DEFAULT_BURST_CAP_SIZE / HS_USB_PKT_SIZE)	// for USB high speed
+	// a bulk-in transfer must fit into the receive buffer
+	if (   !WriteReg (BURST_CAP, RX_BUFFER_SIZE / m_pEndpointBulkIn->GetMaxPacketSize ())
 	    || !WriteReg (BULK_IN_DLY, DEFAULT_BULK_IN_DELAY))
 	{
 		return FALSE;
 	}
 
-	// enable the LEDs and SEF mode
-	if (!ReadWriteReg (HW_CFG, HW_CFG_LED0_EN | HW_CFG_LED1_EN, ~HW_CFG_MEF))
+	// enable the LEDs and MEF mode (multiple frames per bulk-in transfer)
+	if (!ReadWriteReg (HW_CFG, HW_CFG_LED0_EN | HW_CFG_LED1_EN | HW_CFG_MEF))
 	{
 		return FALSE;
 	}
@@ -414,6 +423,17 @@ boolean CLAN7800Device::Configure (void)
 		return FALSE;
 	}
 
+	assert (m_pPipeline == 0);
+	m_pPipeline = new CUSBNetPipeline (GetHost (), m_pEndpointBulkIn, m_pEndpointBulkOut,
+					   RX_BUFFER_SIZE, TX_BUFFER_SIZE);
+	assert (m_pPipeline != 0);
+	if (!m_pPipeline->Initialize ())
+	{
+		CLogger::Get ()->Write (FromLAN7800, LogError, "Cannot start bulk transfers");
+
+		return FALSE;
+	}
+
 	AddNetDevice ();
 
 	return TRUE;
@@ -424,6 +444,12 @@ const CMACAddress *CLAN7800Device::GetMACAddress (void) const
 	return &m_MACAddress;
 }
 
+boolean CLAN7800Device::IsSendFrameAdvisable (void)
+{
+	assert (m_pPipeline != 0);
+	return m_pPipeline->IsTxBufferAvailable ();
+}
+
 boolean CLAN7800Device::SendFrame (const void *pBuffer, unsigned nLength)
 {
 	if (nLength > FRAME_BUFFER_SIZE)
@@ -431,60 +457,80 @@ boolean CLAN7800Device::SendFrame (const void *pBuffer, unsigned nLength)
 		return FALSE;
 	}
 
-	DMA_BUFFER (u8, TxBuffer, FRAME_BUFFER_SIZE+TX_HEADER_SIZE);
+	assert (m_pPipeline != 0);
+	u8 *pTxBuffer = m_pPipeline->GetTxBuffer ();
+	if (pTxBuffer == 0)
+	{
+		return FALSE;
+	}
+
 	assert (pBuffer != 0);
-	memcpy (TxBuffer+TX_HEADER_SIZE, pBuffer, nLength);
+	memcpy (pTxBuffer+TX_HEADER_SIZE, pBuffer, nLength);
 
-	u32 *pTxHeader = (u32 *) TxBuffer;
+	u32 *pTxHeader = (u32 *) pTxBuffer;
 	pTxHeader[0] = (nLength & TX_CMD_A_LEN_MASK) | TX_CMD_A_FCS;
 	pTxHeader[1] = 0;
 	
-	assert (m_pEndpointBulkOut != 0);
-	return GetHost ()->Transfer (m_pEndpointBulkOut, TxBuffer, nLength+TX_HEADER_SIZE) >= 0;
+	m_pPipeline->SendTxBuffer (nLength+TX_HEADER_SIZE);
+
+	return TRUE;
 }
 
 boolean CLAN7800Device::ReceiveFrame (void *pBuffer, unsigned *pResultLength)
 {
-	assert (m_pEndpointBulkIn != 0);
+	assert (m_pPipeline != 0);
 	assert (pBuffer != 0);
-	CUSBRequest URB (m_pEndpointBulkIn, pBuffer, FRAME_BUFFER_SIZE);
 
-	if (!GetHost ()->SubmitBlockingRequest (&URB))
+	// A bulk-in transfer can contain multiple frames. Each frame is preceded
+	// by RX command A..C and padded, so that the next command is 32-bit aligned.
+	const u8 *pData;
+	unsigned nLength;
+	while ((pData = m_pPipeline->GetRxData (&nLength)) != 0)
 	{
-		return FALSE;
-	}
+		if (nLength < RX_HEADER_SIZE)
+		{
+			m_pPipeline->ConsumeRxData (nLength);
+			m_pPipeline->CountRxFrame (TRUE);
 
-	u32 nResultLength = URB.GetResultLength ();
-	if (nResultLength < RX_HEADER_SIZE)
-	{
-		return FALSE;
-	}
+			continue;
+		}
 
-	u32 nRxStatus = *(u32 *) pBuffer;	// RX command A
-	if (nRxStatus & RX_CMD_A_RED)
-	{
-		CLogger::Get ()->Write (FromLAN7800, LogWarning, "RX error (status 0x%X)", nRxStatus);
+		u32 nRxStatus = *(const u32 *) pData;	// RX command A
+		u32 nFrameLength = nRxStatus & RX_CMD_A_LEN_MASK;
+		u32 nTotalLength = RX_HEADER_SIZE + nFrameLength + (4 - (nFrameLength + RX_PADDING) % 4) % 4;
 
-		return FALSE;
-	}
-	
-	u32 nFrameLength = nRxStatus & RX_CMD_A_LEN_MASK;
-	assert (nFrameLength == nResultLength-RX_HEADER_SIZE);
-	assert (nFrameLength > 4);
-	if (nFrameLength <= 4)
-	{
-		return FALSE;
-	}
-	nFrameLength -= 4;	// ignore FCS
+		if (nRxStatus & RX_CMD_A_RED)
+		{
+			CLogger::Get ()->Write (FromLAN7800, LogWarning, "RX error (status 0x%X)", nRxStatus);
+		}
 
-	//CLogger::Get ()->Write (FromLAN7800, LogDebug, "Frame received (status 0x%X)", nRxStatus);
+		if (   (nRxStatus & RX_CMD_A_RED)
+		    || nFrameLength <= 4
+		    || nFrameLength-4 > FRAME_BUFFER_SIZE
+		    || RX_HEADER_SIZE+nFrameLength > nLength)	// invalid command drops the rest
+		{
+			m_pPipeline->ConsumeRxData (nTotalLength);
+			m_pPipeline->CountRxFrame (TRUE);
 
-	memcpy (pBuffer, (u8 *) pBuffer + RX_HEADER_SIZE, nFrameLength); // overwrite RX command A..C
+			continue;
+		}
 
-	assert (pResultLength != 0);
-	*pResultLength = nFrameLength;
-	
-	return TRUE;
+		nFrameLength -= 4;	// ignore FCS
+
+		//CLogger::Get ()->Write (FromLAN7800, LogDebug, "Frame received (status 0x%X)", nRxStatus);
+
+		memcpy (pBuffer, pData + RX_HEADER_SIZE, nFrameLength);	// skip RX command A..C
+
+		m_pPipeline->ConsumeRxData (nTotalLength);
+		m_pPipeline->CountRxFrame ();
+
+		assert (pResultLength != 0);
+		*pResultLength = nFrameLength;
+
+		return TRUE;
+	}
+
+	return FALSE;
 }
 
 boolean CLAN7800Device::IsLinkUp (void)
@@ -569,6 +615,20 @@ boolean CLAN7800Device::SetMulticastFilter (const u8 Groups[][MAC_ADDRESS_SIZE])
 	return WriteReg (RFE_CTL, rfe_ctl);
 }
 
+void CLAN7800Device::GetStatistics (CUSBNetPipeline::TStatistics *pStatistics) const
+{
+	assert (pStatistics != 0);
+
+	if (m_pPipeline == 0)
+	{
+		memset (pStatistics, 0, sizeof *pStatistics);
+
+		return;
+	}
+
+	m_pPipeline->GetStatistics (pStatistics);
+}
+
 void CLAN7800Device::SetAddressFilter (int index, const u8 addr[MAC_ADDRESS_SIZE])
 {
 	assert (0 < index && index < NUM_OF_MAF);
@@ -35,6 +35,17 @@
 #include <circle/debug.h>
 #include <assert.h>
 
+// Sizes
+#define HS_USB_PKT_SIZE			512
+#define FS_USB_PKT_SIZE			64
+
+#define DEFAULT_HS_BURST_CAP_SIZE	(16 * 1024 + 5 * HS_USB_PKT_SIZE)
+#define DEFAULT_FS_BURST_CAP_SIZE	(6 * 1024 + 33 * FS_USB_PKT_SIZE)
+#define DEFAULT_BULK_IN_DELAY		0x2000
+
+#define RX_BUFFER_SIZE			DEFAULT_HS_BURST_CAP_SIZE
+#define TX_BUFFER_SIZE			(FRAME_BUFFER_SIZE + 8)
+
 // USB vendor requests
 #define WRITE_REGISTER			0xA0
 #define READ_REGISTER			0xA1
@@ -47,6 +58,9 @@
 	#define TX_CFG_ON			0x00000004
 #define HW_CFG				0x14
 	#define HW_CFG_BIR			0x00001000
+	#define HW_CFG_RXDOFF			0x00000600
+	#define HW_CFG_MEF			0x00000020
+	#define HW_CFG_BCE			0x00000002
 #define RX_FIFO_INF			0x18
 #define PM_CTRL				0x20
 #define LED_GPIO_CFG			0x24
@@ -130,12 +144,16 @@ static const char FromSMSC951x[] = "smsc951x";
 CSMSC951xDevice::CSMSC951xDevice (CUSBFunction *pFunction)
 :	CUSBFunction (pFunction),
 	m_pEndpointBulkIn (0),
-	m_pEndpointBulkOut (0)
+	m_pEndpointBulkOut (0),
+	m_pPipeline (0)
 {
 }
 
 CSMSC951xDevice::~CSMSC951xDevice (void)
 {
+	delete m_pPipeline;
+	m_pPipeline = 0;
+
 	delete m_pEndpointBulkOut;
 	m_pEndpointBulkOut = 0;
 
@@ -229,6 +247,22 @@ boolean CSMSC951xDevice::Configure (void)
 		return FALSE;
 	}
 
+	// pack multiple frames into one bulk-in transfer, NAK on empty RX FIFO
+	u32 nBurstCap =   GetDevice ()->GetSpeed () == USBSpeedHigh
+			? DEFAULT_HS_BURST_CAP_SIZE / HS_USB_PKT_SIZE
+			: DEFAULT_FS_BURST_CAP_SIZE / FS_USB_PKT_SIZE;
+	u32 nHWConfig;
+	if (   !WriteReg (BURST_CAP, nBurstCap)
+	    || !WriteReg (BULK_IN_DLY, DEFAULT_BULK_IN_DELAY)
+	    || !ReadReg (HW_CFG, &nHWConfig)
+	    || !WriteReg (HW_CFG,   (nHWConfig & ~HW_CFG_RXDOFF)
+				  | HW_CFG_BIR | HW_CFG_MEF | HW_CFG_BCE))
+	{
+		CLogger::Get ()->Write (FromSMSC951x, LogError, "Cannot configure bulk-in");
+
+		return FALSE;
+	}
+
 	if (   !WriteReg (LED_GPIO_CFG,   LED_GPIO_CFG_SPD_LED
 					| LED_GPIO_CFG_LNK_LED
 					| LED_GPIO_CFG_FDX_LED)
@@ -243,6 +277,17 @@ boolean CSMSC951xDevice::Configure (void)
 		return FALSE;
 	}
 
+	assert (m_pPipeline == 0);
+	m_pPipeline = new CUSBNetPipeline (GetHost (), m_pEndpointBulkIn, m_pEndpointBulkOut,
+					   RX_BUFFER_SIZE, TX_BUFFER_SIZE);
+	assert (m_pPipeline != 0);
+	if (!m_pPipeline->Initialize ())
+	{
+		CLogger::Get ()->Write (FromSMSC951x, LogError, "Cannot start bulk transfers");
+
+		return FALSE;
+	}
+
 	AddNetDevice ();
 
 	return TRUE;
@@ -253,6 +298,12 @@ const CMACAddress *CSMSC951xDevice::GetMACAddress (void) const
 	return &m_MACAddress;
 }
 
+boolean CSMSC951xDevice::IsSendFrameAdvisable (void)
+{
+	assert (m_pPipeline != 0);
+	return m_pPipeline->IsTxBufferAvailable ();
+}
+
 boolean CSMSC951xDevice::SendFrame (const void *pBuffer, unsigned nLength)
 {
 	if (nLength > FRAME_BUFFER_SIZE)
@@ -260,60 +311,80 @@ boolean CSMSC951xDevice::SendFrame (const void *pBuffer, unsigned nLength)
 		return FALSE;
 	}
 
-	DMA_BUFFER (u8, TxBuffer, FRAME_BUFFER_SIZE+8);
+	assert (m_pPipeline != 0);
+	u8 *pTxBuffer = m_pPipeline->GetTxBuffer ();
+	if (pTxBuffer == 0)
+	{
+		return FALSE;
+	}
+
 	assert (pBuffer != 0);
-	memcpy (TxBuffer+8, pBuffer, nLength);
+	memcpy (pTxBuffer+8, pBuffer, nLength);
 
-	u32 *pTxHeader = (u32 *) TxBuffer;
+	u32 *pTxHeader = (u32 *) pTxBuffer;
 	pTxHeader[0] = TX_CMD_A_FIRST_SEG | TX_CMD_A_LAST_SEG | nLength;
 	pTxHeader[1] = nLength;
 	
-	assert (m_pEndpointBulkOut != 0);
-	return GetHost ()->Transfer (m_pEndpointBulkOut, TxBuffer, nLength+8) >= 0;
+	m_pPipeline->SendTxBuffer (nLength+8);
+
+	return TRUE;
 }
 
 boolean CSMSC951xDevice::ReceiveFrame (void *pBuffer, unsigned *pResultLength)
 {
-	assert (m_pEndpointBulkIn != 0);
+	assert (m_pPipeline != 0);
 	assert (pBuffer != 0);
-	CUSBRequest URB (m_pEndpointBulkIn, pBuffer, FRAME_BUFFER_SIZE);
 
-	if (!GetHost ()->SubmitBlockingRequest (&URB))
+	// A bulk-in transfer can contain multiple frames. Each frame is preceded
+	// by the RX status and padded to a multiple of 4 bytes.
+	const u8 *pData;
+	unsigned nLength;
+	while ((pData = m_pPipeline->GetRxData (&nLength)) != 0)
 	{
-		return FALSE;
-	}
+		if (nLength < 4)
+		{
+			m_pPipeline->ConsumeRxData (nLength);
+			m_pPipeline->CountRxFrame (TRUE);
 
-	u32 nResultLength = URB.GetResultLength ();
-	if (nResultLength < 4)				// should not happen with HW_CFG_BIR set
-	{
-		return FALSE;
-	}
+			continue;
+		}
 
-	u32 nRxStatus = *(u32 *) pBuffer;
-	if (nRxStatus & RX_STS_ERROR)
-	{
-		CLogger::Get ()->Write (FromSMSC951x, LogWarning, "RX error (status 0x%X)", nRxStatus);
+		u32 nRxStatus = *(const u32 *) pData;
+		u32 nFrameLength = RX_STS_FRAMELEN (nRxStatus);
+		u32 nTotalLength = (4 + nFrameLength + 3) & ~3;
 
-		return FALSE;
-	}
-	
-	u32 nFrameLength = RX_STS_FRAMELEN (nRxStatus);
-	assert (nFrameLength == nResultLength-4);
-	assert (nFrameLength > 4);
-	if (nFrameLength <= 4)
-	{
-		return FALSE;
-	}
-	nFrameLength -= 4;	// ignore CRC
+		if (nRxStatus & RX_STS_ERROR)
+		{
+			CLogger::Get ()->Write (FromSMSC951x, LogWarning, "RX error (status 0x%X)", nRxStatus);
+		}
 
-	//CLogger::Get ()->Write (FromSMSC951x, LogDebug, "Frame received (status 0x%X)", nRxStatus);
+		if (   (nRxStatus & RX_STS_ERROR)
+		    || nFrameLength <= 4
+		    || nFrameLength-4 > FRAME_BUFFER_SIZE
+		    || 4+nFrameLength > nLength)	// invalid status drops the rest of the transfer
+		{
+			m_pPipeline->ConsumeRxData (nTotalLength);
+			m_pPipeline->CountRxFrame (TRUE);
 
-	memcpy (pBuffer, (u8 *) pBuffer + 4, nFrameLength);	// overwrite RX status
+			continue;
+		}
 
-	assert (pResultLength != 0);
-	*pResultLength = nFrameLength;
-	
-	return TRUE;
+		nFrameLength -= 4;	// ignore CRC
+
+		//CLogger::Get ()->Write (FromSMSC951x, LogDebug, "Frame received (status 0x%X)", nRxStatus);
+
+		memcpy (pBuffer, pData + 4, nFrameLength);	// skip RX status
+
+		m_pPipeline->ConsumeRxData (nTotalLength);
+		m_pPipeline->CountRxFrame ();
+
+		assert (pResultLength != 0);
+		*pResultLength = nFrameLength;
+
+		return TRUE;
+	}
+
+	return FALSE;
 }
 
 boolean CSMSC951xDevice::IsLinkUp (void)
@@ -374,6 +445,20 @@ boolean CSMSC951xDevice::SetMulticastFilter (const u8 Groups[][MAC_ADDRESS_SIZE]
 	       && WriteReg (MAC_CR, mac_cr);
 }
 
+void CSMSC951xDevice::GetStatistics (CUSBNetPipeline::TStatistics *pStatistics) const
+{
+	assert (pStatistics != 0);
+
+	if (m_pPipeline == 0)
+	{
+		memset (pStatistics, 0, sizeof *pStatistics);
+
+		return;
+	}
+
+	m_pPipeline->GetStatistics (pStatistics);
+}
+
 u32 CSMSC951xDevice::Hash (const u8 Address[MAC_ADDRESS_SIZE])
 {
 	return (ether_crc (MAC_ADDRESS_SIZE, Address) >> 26) & 0x3F;
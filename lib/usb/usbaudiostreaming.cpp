@@ -102,6 +102,8 @@ Release 1.0 and 2.0, https://usb.org/documents
 #include <circle/usb/usbhostcontroller.h>
 #include <circle/devicenameservice.h>
 #include <circle/koptions.h>
+#include <circle/sysconfig.h>
+#include <circle/atomic.h>
 #include <circle/debug.h>
 #include <circle/util.h>
 #include <assert.h>
@@ -119,6 +121,7 @@ CUSBAudioStreamingDevice::CUSBAudioStreamingDevice (CUSBFunction *pFunction)
 	m_nSubframeSize (m_nBitResolution / 8),
 	m_pEndpointData (nullptr),
 	m_pEndpointSync (nullptr),
+	m_nPacketRate (0),
 	m_nChannels (0),
 	m_nTerminals (1),
 	m_nActiveTerminal (0),
@@ -127,6 +130,10 @@ CUSBAudioStreamingDevice::CUSBAudioStreamingDevice (CUSBFunction *pFunction)
 	m_nPacketsPerChunk (0),
 	m_bSyncEPActive (FALSE),
 	m_nSyncAccu (0),
+	m_nFeedbackNominal (0),
+	m_nFeedbackValue (0),
+	m_nFeedbackAccu (0),
+	m_nURBsInFlight (0),
 	m_uchClockSourceID (USB_AUDIO_UNDEFINED_UNIT_ID),
 	m_uchSelectorUnitID (USB_AUDIO_UNDEFINED_UNIT_ID),
 	From ("uaudio")
@@ -137,6 +144,7 @@ CUSBAudioStreamingDevice::CUSBAudioStreamingDevice (CUSBFunction *pFunction)
 	}
 
 	memset (&m_DeviceInfo, 0, sizeof m_DeviceInfo);
+	memset (&m_Statistics, 0, sizeof m_Statistics);
 }
 
 CUSBAudioStreamingDevice::~CUSBAudioStreamingDevice (void)
@@ -706,30 +714,33 @@ boolean CUSBAudioStreamingDevice::Setup (unsigned nSampleRate)
 
 	m_nSampleRate = nSampleRate;
 
-	if (m_bSynchronousSync)
+	m_nPacketRate =   (GetDevice ()->GetSpeed () == USBSpeedFull ? 1000 : 8000)
+			/ m_nDataIntervalFactor;
+
+	// A chunk covers one millisecond (or one packet, if the interval is longer).
+	m_nPacketsPerChunk = m_nPacketRate / 1000;
+	if (!m_nPacketsPerChunk)
+	{
+		m_nPacketsPerChunk = 1;
+	}
+	assert (m_nPacketsPerChunk <= CUSBRequest::MaxIsoPackets);
+
+	m_nSyncAccu = 0;
+	m_nFeedbackNominal = ((u64) nSampleRate << 16) / m_nPacketRate;
+	m_nFeedbackValue = 0;
+	m_nFeedbackAccu = 0;
+
+	if (   m_bIsOutput
+	    || m_bSynchronousSync)
 	{
 		UpdateChunkSize ();
 	}
 	else
 	{
-		if (m_bIsOutput)
-		{
-			unsigned nUSBFrameRate = (  GetDevice ()->GetSpeed () == USBSpeedFull
-						  ? 1000 : 8000) / m_nDataIntervalFactor;
-			unsigned nFrameSize = m_nChannels * m_nSubframeSize;
-
-			m_nChunkSizeBytes = nSampleRate * nFrameSize / nUSBFrameRate;
-
-			// round up to a multiple of frame size
-			m_nChunkSizeBytes += nFrameSize-1;
-			m_nChunkSizeBytes /= nFrameSize;
-			m_nChunkSizeBytes *= nFrameSize;
-		}
-		else
-		{
-			m_nChunkSizeBytes =   m_pEndpointData->GetMaxPacketSize ()
-					    - m_pEndpointData->GetMaxPacketSize () % m_nSubframeSize;
-		}
+		// The amount of received data is determined by the device.
+		// Only one packet per chunk, because the packets may be short.
+		m_nChunkSizeBytes =   m_pEndpointData->GetMaxPacketSize ()
+				    - m_pEndpointData->GetMaxPacketSize () % m_nSubframeSize;
 	}
 
 	return TRUE;
@@ -745,30 +756,43 @@ boolean CUSBAudioStreamingDevice::SendChunk (const void *pBuffer, unsigned nChun
 					     TCompletionRoutine *pCompletionRoutine, void *pParam)
 {
 	assert (pBuffer);
+	assert (m_bIsOutput);
 
 	assert (m_pEndpointData);
 	CUSBRequest *pURB = new CUSBRequest (m_pEndpointData, (void *) pBuffer, nChunkSizeBytes);
 	assert (pURB);
 
-	if (m_bSynchronousSync)
+	AddIsoPackets (pURB, nChunkSizeBytes);
+
+	TCompletionInfo *pInfo = new TCompletionInfo;
+	assert (pInfo);
+	pInfo->pRoutine = pCompletionRoutine;
+	pInfo->pParam = pParam;
+
+	pURB->SetCompletionRoutine (CompletionHandler, pInfo, this);
+
+	unsigned nURBsInFlight = AtomicIncrement (&m_nURBsInFlight);
+
+	boolean bOK = GetHost ()->SubmitAsyncRequest (pURB);
+	if (!bOK)
 	{
-		assert (m_nPacketsPerChunk > 0);
-		for (unsigned i = 0; i < m_nPacketsPerChunk; i++)
-		{
-			pURB->AddIsoPacket (m_usPacketSizeBytes[i]);
-		}
+		AtomicDecrement (&m_nURBsInFlight);
+
+		delete pInfo;
+
+		return FALSE;
 	}
-	else
+
+	m_Statistics.URBsSubmitted++;
+	if (m_Statistics.MaxURBsInFlight < nURBsInFlight)
 	{
-		pURB->AddIsoPacket (nChunkSizeBytes);
+		m_Statistics.MaxURBsInFlight = nURBsInFlight;
 	}
 
-	pURB->SetCompletionRoutine (CompletionHandler, pParam, (void *) pCompletionRoutine);
-
-	boolean bOK = GetHost ()->SubmitAsyncRequest (pURB);
+	// calculate the packet sizes of the next chunk
+	UpdateChunkSize ();
 
-	if (   bOK
-	    && m_pEndpointSync
+	if (   m_pEndpointSync
 	    && !m_bSyncEPActive)
 	{
 		m_bSyncEPActive = TRUE;
@@ -785,11 +809,10 @@ boolean CUSBAudioStreamingDevice::SendChunk (const void *pBuffer, unsigned nChun
 		pURBSync->SetCompletionRoutine (SyncCompletionHandler, nullptr, this);
 
 		bOK = GetHost ()->SubmitAsyncRequest (pURBSync);
-	}
-	else if (   bOK
-		 && m_bSynchronousSync)
-	{
-		UpdateChunkSize ();
+		if (!bOK)
+		{
+			m_bSyncEPActive = FALSE;
+		}
 	}
 
 	return bOK;
@@ -799,6 +822,7 @@ boolean CUSBAudioStreamingDevice::ReceiveChunk (void *pBuffer, unsigned nChunkSi
 					        TCompletionRoutine *pCompletionRoutine, void *pParam)
 {
 	assert (pBuffer);
+	assert (!m_bIsOutput);
 
 	assert (m_pEndpointData);
 	CUSBRequest *pURB = new CUSBRequest (m_pEndpointData, pBuffer, nChunkSizeBytes);
@@ -807,28 +831,62 @@ boolean CUSBAudioStreamingDevice::ReceiveChunk (void *pBuffer, unsigned nChunkSi
 	assert (!m_pEndpointSync);
 	if (m_bSynchronousSync)
 	{
-		assert (m_nPacketsPerChunk > 0);
-		for (unsigned i = 0; i < m_nPacketsPerChunk; i++)
-		{
-			pURB->AddIsoPacket (m_usPacketSizeBytes[i]);
-		}
+		AddIsoPackets (pURB, nChunkSizeBytes);
 	}
 	else
 	{
 		pURB->AddIsoPacket (nChunkSizeBytes);
 	}
 
-	pURB->SetCompletionRoutine (CompletionHandler, pParam, (void *) pCompletionRoutine);
+	TCompletionInfo *pInfo = new TCompletionInfo;
+	assert (pInfo);
+	pInfo->pRoutine = pCompletionRoutine;
+	pInfo->pParam = pParam;
 
-	boolean bOK = GetHost ()->SubmitAsyncRequest (pURB);
+	pURB->SetCompletionRoutine (CompletionHandler, pInfo, this);
+
+	unsigned nURBsInFlight = AtomicIncrement (&m_nURBsInFlight);
+
+	if (!GetHost ()->SubmitAsyncRequest (pURB))
+	{
+		AtomicDecrement (&m_nURBsInFlight);
+
+		delete pInfo;
+
+		return FALSE;
+	}
+
+	m_Statistics.URBsSubmitted++;
+	if (m_Statistics.MaxURBsInFlight < nURBsInFlight)
+	{
+		m_Statistics.MaxURBsInFlight = nURBsInFlight;
+	}
 
-	if (   bOK
-	    && m_bSynchronousSync)
+	if (m_bSynchronousSync)
 	{
 		UpdateChunkSize ();
 	}
 
-	return bOK;
+	return TRUE;
+}
+
+unsigned CUSBAudioStreamingDevice::GetURBsInFlight (void) const
+{
+	return m_nURBsInFlight;
+}
+
+CUSBAudioStreamingDevice::TStatistics CUSBAudioStreamingDevice::GetStatistics (void) const
+{
+	return m_Statistics;
+}
+
+void CUSBAudioStreamingDevice::ResetStatistics (void)
+{
+	u32 nFeedbackRate = m_Statistics.FeedbackRate;
+
+	memset (&m_Statistics, 0, sizeof m_Statistics);
+
+	m_Statistics.FeedbackRate = nFeedbackRate;
 }
 
 boolean CUSBAudioStreamingDevice::SelectInputTerminal (unsigned nIndex)
@@ -1037,17 +1095,79 @@ boolean CUSBAudioStreamingDevice::InitTerminalControlInfo (CUSBAudioControlDevic
 	return TRUE;
 }
 
+void CUSBAudioStreamingDevice::AddIsoPackets (CUSBRequest *pURB, unsigned nChunkSizeBytes)
+{
+	assert (pURB);
+	assert (m_nPacketsPerChunk > 0);
+
+	m_SpinLock.Acquire ();
+
+	for (unsigned i = 0; i < m_nPacketsPerChunk && nChunkSizeBytes > 0; i++)
+	{
+		unsigned nPacketSizeBytes = m_usPacketSizeBytes[i];
+		if (   nPacketSizeBytes > nChunkSizeBytes
+		    || i == m_nPacketsPerChunk-1)
+		{
+			nPacketSizeBytes = nChunkSizeBytes;
+		}
+
+		pURB->AddIsoPacket (nPacketSizeBytes);
+
+		nChunkSizeBytes -= nPacketSizeBytes;
+	}
+
+	m_SpinLock.Release ();
+}
+
 void CUSBAudioStreamingDevice::CompletionHandler (CUSBRequest *pURB, void *pParam, void *pContext)
 {
+	CUSBAudioStreamingDevice *pThis = (CUSBAudioStreamingDevice *) pContext;
+	assert (pThis);
+
+	TCompletionInfo *pInfo = (TCompletionInfo *) pParam;
+	assert (pInfo);
+	TCompletionRoutine *pCompletionRoutine = pInfo->pRoutine;
+	void *pCompletionParam = pInfo->pParam;
+	delete pInfo;
+
 	assert (pURB);
-	u32 nBytesTransferred = pURB->GetStatus () ? pURB->GetResultLength () : 0;
+	u32 nBytesTransferred = 0;
+	if (pURB->GetStatus ())
+	{
+		nBytesTransferred = pURB->GetResultLength ();
+	}
+	else
+	{
+		pThis->m_Statistics.URBsFailed++;
+	}
+
 	delete pURB;
 
-	TCompletionRoutine *pCompletionRoutine = (TCompletionRoutine *) pContext;
+	boolean bEmpty = !AtomicDecrement (&pThis->m_nURBsInFlight);
+
 	if (pCompletionRoutine)
 	{
-		(*pCompletionRoutine) (nBytesTransferred, pParam);
+		(*pCompletionRoutine) (nBytesTransferred, pCompletionParam);
+	}
+
+#if USB_AUDIO_URBS_IN_FLIGHT > 1
+	// The pipeline has run empty, before the next transfer has been queued
+	// by the completion routine. There was a gap in the stream then.
+	if (   bEmpty
+	    && pThis->m_nURBsInFlight > 0)
+	{
+		if (pThis->m_bIsOutput)
+		{
+			pThis->m_Statistics.Underruns++;
+		}
+		else
+		{
+			pThis->m_Statistics.Overruns++;
+		}
 	}
+#else
+	(void) bEmpty;
+#endif
 }
 
 void CUSBAudioStreamingDevice::SyncCompletionHandler (CUSBRequest *pURB, void *pParam,
@@ -1068,49 +1188,93 @@ void CUSBAudioStreamingDevice::SyncCompletionHandler (CUSBRequest *pURB, void *p
 
 	if (bOK)
 	{
-		if (bFormat10_14)
+		u32 nValue = pThis->ConvertFeedback (pThis->m_SyncEPBuffer[0], bFormat10_14);
+		if (nValue)
 		{
-			// Q10.14 format (FS)
-			pThis->m_nSyncAccu += pThis->m_SyncEPBuffer[0] & 0xFFFFFF;
-			pThis->m_nChunkSizeBytes =   (pThis->m_nSyncAccu >> 14)
-						   * pThis->m_nChannels * pThis->m_nSubframeSize;
-			pThis->m_nSyncAccu &= 0x3FFF;
+			// takes effect with the next call of UpdateChunkSize()
+			pThis->m_nFeedbackValue = nValue;
+
+			pThis->m_Statistics.FeedbackRate =
+				((u64) nValue * pThis->m_nPacketRate * 1000) >> 16;
 		}
 		else
 		{
-			// Q16.16 format (HS)
-			pThis->m_nSyncAccu += pThis->m_SyncEPBuffer[0];
-			pThis->m_nChunkSizeBytes =   (pThis->m_nSyncAccu >> 16)
-						   * pThis->m_nChannels * pThis->m_nSubframeSize;
-			pThis->m_nSyncAccu &= 0xFFFF;
+			pThis->m_Statistics.FeedbackErrors++;
 		}
 	}
 
 	pThis->m_bSyncEPActive = FALSE;
 }
 
+u32 CUSBAudioStreamingDevice::ConvertFeedback (u32 nRawValue, boolean bFormat10_14) const
+{
+	u32 nValue;
+	if (bFormat10_14)
+	{
+		nValue = (nRawValue & 0xFFFFFF) << 2;	// Q10.14 format (FS)
+	}
+	else
+	{
+		nValue = nRawValue;			// Q16.16 format (HS)
+	}
+
+	// the value is given in frames per (micro)frame, not per data packet
+	nValue *= m_nDataIntervalFactor;
+
+	// a device must not request more than +/- 1/8 of the nominal rate
+	assert (m_nFeedbackNominal);
+	u32 nTolerance = m_nFeedbackNominal / 8;
+	if (   nValue < m_nFeedbackNominal - nTolerance
+	    || nValue > m_nFeedbackNominal + nTolerance)
+	{
+		return 0;
+	}
+
+	return nValue;
+}
+
 void CUSBAudioStreamingDevice::UpdateChunkSize (void)
 {
-	assert (m_bSynchronousSync);
 	assert (m_nSampleRate > 0);
+	assert (m_nPacketRate > 0);
+	assert (m_nPacketsPerChunk > 0);
 
-	unsigned nUSBFrameRate =   (GetDevice ()->GetSpeed () == USBSpeedFull ? 1000 : 8000)
-				 / m_nDataIntervalFactor;
+	unsigned nFrameSize = m_nChannels * m_nSubframeSize;
+	unsigned nMaxPacketSize = m_pEndpointData->GetMaxPacketSize ();
+	nMaxPacketSize -= nMaxPacketSize % nFrameSize;
 
 	m_SpinLock.Acquire ();
 
-	m_nPacketsPerChunk = nUSBFrameRate / 1000;
+	u32 nFeedbackValue = m_nFeedbackValue;
 
 	unsigned nChunkSizeBytes = 0;
 	for (unsigned i = 0; i < m_nPacketsPerChunk; i++)
 	{
-		m_nSyncAccu += m_nSampleRate;
-		unsigned nFrames = m_nSyncAccu / nUSBFrameRate;
-		m_nSyncAccu %= nUSBFrameRate;
+		unsigned nFrames;
+		if (nFeedbackValue)
+		{
+			// rate requested by the device via the feedback EP
+			m_nFeedbackAccu += nFeedbackValue;
+			nFrames = m_nFeedbackAccu >> 16;
+			m_nFeedbackAccu &= 0xFFFF;
+		}
+		else
+		{
+			// nominal rate
+			m_nSyncAccu += m_nSampleRate;
+			nFrames = m_nSyncAccu / m_nPacketRate;
+			m_nSyncAccu %= m_nPacketRate;
+		}
+
+		unsigned nPacketSizeBytes = nFrames * nFrameSize;
+		if (nPacketSizeBytes > nMaxPacketSize)
+		{
+			nPacketSizeBytes = nMaxPacketSize;
+		}
 
-		m_usPacketSizeBytes[i] = nFrames * m_nChannels * m_nSubframeSize;
+		m_usPacketSizeBytes[i] = nPacketSizeBytes;
 
-		nChunkSizeBytes += m_usPacketSizeBytes[i];
+		nChunkSizeBytes += nPacketSizeBytes;
 	}
 
 	m_nChunkSizeBytes = nChunkSizeBytes;
@@ -23,6 +23,7 @@
 #include <circle/usb/usb.h>
 #include <circle/logger.h>
 #include <circle/macros.h>
+#include <circle/util.h>
 #include <assert.h>
 
 #define SET_ETHERNET_PACKET_FILTER		0x43
@@ -44,6 +45,9 @@ struct TEthernetNetworkingFunctionalDescriptor
 }
 PACKED;
 
+// one frame per bulk transfer, multiple of the max. packet size
+#define RX_BUFFER_SIZE		2048
+
 static const char FromCDCEthernet[] = "ucdceth";
 
 CUSBCDCEthernetDevice::CUSBCDCEthernetDevice (CUSBFunction *pFunction)
@@ -52,12 +56,16 @@ CUSBCDCEthernetDevice::CUSBCDCEthernetDevice (CUSBFunction *pFunction)
 	m_iMACAddress (GetMACAddressStringIndex ()),
 	m_bInterfaceOK (SelectInterfaceByClass (10, 0, 0, 2)),
 	m_pEndpointBulkIn (0),
-	m_pEndpointBulkOut (0)
+	m_pEndpointBulkOut (0),
+	m_pPipeline (0)
 {
 }
 
 CUSBCDCEthernetDevice::~CUSBCDCEthernetDevice (void)
 {
+	delete m_pPipeline;
+	m_pPipeline = 0;
+
 	delete m_pEndpointBulkOut;
 	m_pEndpointBulkOut = 0;
 
@@ -133,6 +141,19 @@ boolean CUSBCDCEthernetDevice::Configure (void)
 		return FALSE;
 	}
 
+	// complete bulk-in transfers on NAK on the Raspberry Pi 1-3 and Zero,
+	// the xHCI controller of the Raspberry Pi 4 handles NAKs itself
+	assert (m_pPipeline == 0);
+	m_pPipeline = new CUSBNetPipeline (GetHost (), m_pEndpointBulkIn, m_pEndpointBulkOut,
+					   RX_BUFFER_SIZE, FRAME_BUFFER_SIZE, RASPPI <= 3);
+	assert (m_pPipeline != 0);
+	if (!m_pPipeline->Initialize ())
+	{
+		CLogger::Get ()->Write (FromCDCEthernet, LogError, "Cannot start bulk transfers");
+
+		return FALSE;
+	}
+
 	AddNetDevice ();
 
 	return TRUE;
@@ -143,35 +164,59 @@ const CMACAddress *CUSBCDCEthernetDevice::GetMACAddress (void) const
 	return &m_MACAddress;
 }
 
+boolean CUSBCDCEthernetDevice::IsSendFrameAdvisable (void)
+{
+	assert (m_pPipeline != 0);
+	return m_pPipeline->IsTxBufferAvailable ();
+}
+
 boolean CUSBCDCEthernetDevice::SendFrame (const void *pBuffer, unsigned nLength)
 {
-	assert (m_pEndpointBulkOut != 0);
+	assert (m_pPipeline != 0);
 	assert (pBuffer != 0);
 	assert (nLength <= FRAME_BUFFER_SIZE);
-	return GetHost ()->Transfer (m_pEndpointBulkOut, (void *) pBuffer, nLength) >= 0;
+
+	u8 *pTxBuffer = m_pPipeline->GetTxBuffer ();
+	if (pTxBuffer == 0)
+	{
+		return FALSE;
+	}
+
+	memcpy (pTxBuffer, pBuffer, nLength);
+
+	m_pPipeline->SendTxBuffer (nLength);
+
+	return TRUE;
 }
 
 boolean CUSBCDCEthernetDevice::ReceiveFrame (void *pBuffer, unsigned *pResultLength)
 {
-	assert (m_pEndpointBulkIn != 0);
+	assert (m_pPipeline != 0);
 	assert (pBuffer != 0);
-	CUSBRequest URB (m_pEndpointBulkIn, pBuffer, FRAME_BUFFER_SIZE);
-
-	URB.SetCompleteOnNAK ();
 
-	if (!GetHost ()->SubmitBlockingRequest (&URB))
+	const u8 *pData;
+	unsigned nLength;
+	if ((pData = m_pPipeline->GetRxData (&nLength)) == 0)
 	{
 		return FALSE;
 	}
 
-	u32 nResultLength = URB.GetResultLength ();
-	if (nResultLength == 0)
+	// each bulk-in transfer contains one frame
+	if (nLength > FRAME_BUFFER_SIZE)
 	{
+		m_pPipeline->ConsumeRxData (nLength);
+		m_pPipeline->CountRxFrame (TRUE);
+
 		return FALSE;
 	}
 
+	memcpy (pBuffer, pData, nLength);
+
+	m_pPipeline->ConsumeRxData (nLength);
+	m_pPipeline->CountRxFrame ();
+
 	assert (pResultLength != 0);
-	*pResultLength = nResultLength;
+	*pResultLength = nLength;
 
 	return TRUE;
 }
@@ -193,6 +238,20 @@ boolean CUSBCDCEthernetDevice::SetMulticastFilter (const u8 Groups[][MAC_ADDRESS
 					   m_uchControlInterface, 0, 0) >= 0;
 }
 
+void CUSBCDCEthernetDevice::GetStatistics (CUSBNetPipeline::TStatistics *pStatistics) const
+{
+	assert (pStatistics != 0);
+
+	if (m_pPipeline == 0)
+	{
+		memset (pStatistics, 0, sizeof *pStatistics);
+
+		return;
+	}
+
+	m_pPipeline->GetStatistics (pStatistics);
+}
+
 u8 CUSBCDCEthernetDevice::GetMACAddressStringIndex (void)
 {
 	// find Ethernet Networking Functional Descriptor
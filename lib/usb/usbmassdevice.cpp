@@ -21,6 +21,7 @@
 #include <circle/usb/usbhostcontroller.h>
 #include <circle/devicenameservice.h>
 #include <circle/logger.h>
+#include <circle/metrics.h>
 #include <circle/timer.h>
 #include <circle/util.h>
 #include <circle/synchronize.h>
@@ -199,6 +200,21 @@ CNumberPool CUSBBulkOnlyMassStorageDevice::s_DeviceNumberPool (1);
 
 static const char FromUmsd[] = "umsd";
 
+static const u64 s_LatencyBounds[] =	// microseconds
+	{100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000};
+
+static CMetricCounter s_ReadBytes ("circle_storage_bytes_total", "Bytes transferred by block devices",
+				   "device=\"umsd\",op=\"read\"");
+static CMetricCounter s_WriteBytes ("circle_storage_bytes_total", "Bytes transferred by block devices",
+				    "device=\"umsd\",op=\"write\"");
+static CMetricCounter s_ReadErrors ("circle_storage_errors_total", "Failed block device operations",
+				    "device=\"umsd\",op=\"read\"");
+static CMetricCounter s_WriteErrors ("circle_storage_errors_total", "Failed block device operations",
+				     "device=\"umsd\",op=\"write\"");
+static CMetricHistogram s_Latency ("circle_storage_latency_us", "Latency of block device operations",
+				   "device=\"umsd\"", s_LatencyBounds,
+				   sizeof s_LatencyBounds / sizeof s_LatencyBounds[0]);
+
 CUSBBulkOnlyMassStorageDevice::CUSBBulkOnlyMassStorageDevice (CUSBFunction *pFunction)
 :	CUSBFunction (pFunction),
 	m_pEndpointIn (0),
@@ -428,6 +444,8 @@ int CUSBBulkOnlyMassStorageDevice::Read (void *pBuffer, size_t nCount)
 
 	int nResult;
 
+	unsigned nStartTicks = CTimer::GetClockTicks ();
+
 	do
 	{
 		nResult = TryRead (pBuffer, nCount);
@@ -437,6 +455,8 @@ int CUSBBulkOnlyMassStorageDevice::Read (void *pBuffer, size_t nCount)
 			int nStatus = Reset ();
 			if (nStatus != 0)
 			{
+				s_ReadErrors.Add ();
+
 				return nStatus;
 			}
 		}
@@ -444,6 +464,16 @@ int CUSBBulkOnlyMassStorageDevice::Read (void *pBuffer, size_t nCount)
 	while (   nResult != (int) nCount
 	       && --nTries > 0);
 
+	if (nResult == (int) nCount)
+	{
+		s_Latency.Observe (CTimer::GetClockTicks () - nStartTicks);
+		s_ReadBytes.Add (nCount);
+	}
+	else
+	{
+		s_ReadErrors.Add ();
+	}
+
 	return nResult;
 }
 
@@ -453,6 +483,8 @@ int CUSBBulkOnlyMassStorageDevice::Write (const void *pBuffer, size_t nCount)
 
 	int nResult;
 
+	unsigned nStartTicks = CTimer::GetClockTicks ();
+
 	do
 	{
 		nResult = TryWrite (pBuffer, nCount);
@@ -462,6 +494,8 @@ int CUSBBulkOnlyMassStorageDevice::Write (const void *pBuffer, size_t nCount)
 			int nStatus = Reset ();
 			if (nStatus != 0)
 			{
+				s_WriteErrors.Add ();
+
 				return nStatus;
 			}
 		}
@@ -469,6 +503,16 @@ int CUSBBulkOnlyMassStorageDevice::Write (const void *pBuffer, size_t nCount)
 	while (   nResult != (int) nCount
 	       && --nTries > 0);
 
+	if (nResult == (int) nCount)
+	{
+		s_Latency.Observe (CTimer::GetClockTicks () - nStartTicks);
+		s_WriteBytes.Add (nCount);
+	}
+	else
+	{
+		s_WriteErrors.Add ();
+	}
+
 	return nResult;
 }
 
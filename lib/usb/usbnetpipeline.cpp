@@ -0,0 +1,400 @@
+//
+// usbnetpipeline.cpp
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <circle/usb/usbnetpipeline.h>
+#include <circle/util.h>
+#include <assert.h>
+
+#if USB_NET_URBS_IN_FLIGHT < 1 || USB_NET_URBS_IN_FLIGHT > 8
+	#error USB_NET_URBS_IN_FLIGHT must be 1 to 8!
+#endif
+
+#if RASPPI <= 3 && USB_NET_URBS_IN_FLIGHT > 1
+	#error USB_NET_URBS_IN_FLIGHT must be 1 on Raspberry Pi 1-3 and Zero!
+#endif
+
+#if USB_NET_BUFFERS < USB_NET_URBS_IN_FLIGHT
+	#error USB_NET_BUFFERS must not be smaller than USB_NET_URBS_IN_FLIGHT!
+#endif
+
+CUSBNetPipeline::CUSBNetPipeline (CUSBHostController *pHost,
+				  CUSBEndpoint *pEndpointIn, CUSBEndpoint *pEndpointOut,
+				  unsigned nRxBufferSize, unsigned nTxBufferSize,
+				  boolean bCompleteOnNAK)
+:	m_pHost (pHost),
+	m_pEndpointIn (pEndpointIn),
+	m_pEndpointOut (pEndpointOut),
+	m_nRxBufferSize (nRxBufferSize),
+	m_nTxBufferSize (nTxBufferSize),
+	m_bCompleteOnNAK (bCompleteOnNAK),
+	m_nRxSubmit (0),
+	m_nRxConsume (0),
+	m_nRxOffset (0),
+	m_nRxFilled (0),
+	m_nRxInFlight (0),
+	m_nTxFill (0),
+	m_nTxSubmit (0),
+	m_nTxQueued (0),
+	m_nTxInFlight (0)
+{
+	for (unsigned i = 0; i < USB_NET_BUFFERS; i++)
+	{
+		m_pRxBuffer[i] = nullptr;
+		m_nRxLength[i] = 0;
+
+		m_pTxBuffer[i] = nullptr;
+		m_nTxLength[i] = 0;
+	}
+
+	memset (&m_Statistics, 0, sizeof m_Statistics);
+}
+
+CUSBNetPipeline::~CUSBNetPipeline (void)
+{
+	for (unsigned i = 0; i < USB_NET_BUFFERS; i++)
+	{
+		delete [] m_pTxBuffer[i];
+		m_pTxBuffer[i] = nullptr;
+
+		delete [] m_pRxBuffer[i];
+		m_pRxBuffer[i] = nullptr;
+	}
+
+	m_pEndpointOut = nullptr;
+	m_pEndpointIn = nullptr;
+	m_pHost = nullptr;
+}
+
+boolean CUSBNetPipeline::Initialize (void)
+{
+	assert (m_pHost);
+	assert (m_pEndpointIn);
+	assert (m_pEndpointOut);
+	assert (m_nRxBufferSize > 0);
+	assert (m_nRxBufferSize % m_pEndpointIn->GetMaxPacketSize () == 0);
+	assert (m_nTxBufferSize > 0);
+
+	for (unsigned i = 0; i < USB_NET_BUFFERS; i++)
+	{
+		assert (!m_pRxBuffer[i]);
+		m_pRxBuffer[i] = new u8[m_nRxBufferSize];
+
+		assert (!m_pTxBuffer[i]);
+		m_pTxBuffer[i] = new u8[m_nTxBufferSize];
+
+		if (   !m_pRxBuffer[i]
+		    || !m_pTxBuffer[i])
+		{
+			return FALSE;
+		}
+	}
+
+	m_SpinLock.Acquire ();
+
+	StartRx ();
+
+	boolean bOK = m_nRxInFlight > 0;
+
+	m_SpinLock.Release ();
+
+	return bOK;
+}
+
+const u8 *CUSBNetPipeline::GetRxData (unsigned *pLength)
+{
+	assert (pLength);
+
+	m_SpinLock.Acquire ();
+
+	// re-arm the endpoint, if it went idle
+	StartRx ();
+
+	while (m_nRxFilled > 0)
+	{
+		unsigned nLength = m_nRxLength[m_nRxConsume];
+		if (m_nRxOffset < nLength)
+		{
+			const u8 *pData = m_pRxBuffer[m_nRxConsume] + m_nRxOffset;
+			*pLength = nLength - m_nRxOffset;
+
+			m_SpinLock.Release ();
+
+			return pData;
+		}
+
+		// skip empty or failed transfers
+		ReleaseRxBuffer ();
+	}
+
+	m_SpinLock.Release ();
+
+	return nullptr;
+}
+
+void CUSBNetPipeline::ConsumeRxData (unsigned nBytes)
+{
+	m_SpinLock.Acquire ();
+
+	assert (m_nRxFilled > 0);
+	m_nRxOffset += nBytes;
+	if (m_nRxOffset >= m_nRxLength[m_nRxConsume])
+	{
+		ReleaseRxBuffer ();
+	}
+
+	m_SpinLock.Release ();
+}
+
+void CUSBNetPipeline::CountRxFrame (boolean bError)
+{
+	m_SpinLock.Acquire ();
+
+	if (!bError)
+	{
+		m_Statistics.RxFrames++;
+	}
+	else
+	{
+		m_Statistics.RxFrameErrors++;
+	}
+
+	m_SpinLock.Release ();
+}
+
+boolean CUSBNetPipeline::IsTxBufferAvailable (void)
+{
+	m_SpinLock.Acquire ();
+
+	boolean bResult = m_nTxQueued + m_nTxInFlight < USB_NET_BUFFERS;
+
+	m_SpinLock.Release ();
+
+	return bResult;
+}
+
+u8 *CUSBNetPipeline::GetTxBuffer (void)
+{
+	m_SpinLock.Acquire ();
+
+	if (m_nTxQueued + m_nTxInFlight >= USB_NET_BUFFERS)
+	{
+		m_Statistics.TxDropped++;
+
+		m_SpinLock.Release ();
+
+		return nullptr;
+	}
+
+	u8 *pBuffer = m_pTxBuffer[m_nTxFill];
+
+	m_SpinLock.Release ();
+
+	assert (pBuffer);
+	return pBuffer;
+}
+
+void CUSBNetPipeline::SendTxBuffer (unsigned nLength)
+{
+	assert (nLength > 0);
+	assert (nLength <= m_nTxBufferSize);
+
+	m_SpinLock.Acquire ();
+
+	assert (m_nTxQueued + m_nTxInFlight < USB_NET_BUFFERS);
+	m_nTxLength[m_nTxFill] = nLength;
+	m_nTxFill = (m_nTxFill + 1) % USB_NET_BUFFERS;
+	m_nTxQueued++;
+
+	StartTx ();
+
+	m_SpinLock.Release ();
+}
+
+void CUSBNetPipeline::GetStatistics (TStatistics *pStatistics) const
+{
+	assert (pStatistics);
+
+	EnterCritical ();
+
+	*pStatistics = m_Statistics;
+
+	LeaveCritical ();
+}
+
+void CUSBNetPipeline::StartRx (void)
+{
+	while (   m_nRxInFlight < USB_NET_URBS_IN_FLIGHT
+	       && m_nRxInFlight + m_nRxFilled < USB_NET_BUFFERS)
+	{
+		unsigned nBuffer = m_nRxSubmit;
+
+		CUSBRequest *pURB = new CUSBRequest (m_pEndpointIn, m_pRxBuffer[nBuffer],
+						     m_nRxBufferSize);
+		assert (pURB);
+		pURB->SetCompletionRoutine (RxCompletionStub, (void *) (uintptr) nBuffer, this);
+
+		if (m_bCompleteOnNAK)
+		{
+			pURB->SetCompleteOnNAK ();	// do not retry if request cannot be served immediately
+		}
+
+		// submitting with the spin lock acquired keeps the buffers in ring order
+		assert (m_pHost);
+		if (!m_pHost->SubmitAsyncRequest (pURB))
+		{
+			delete pURB;
+
+			m_Statistics.RxErrors++;
+
+			break;
+		}
+
+		m_nRxSubmit = (m_nRxSubmit + 1) % USB_NET_BUFFERS;
+		m_nRxInFlight++;
+	}
+}
+
+void CUSBNetPipeline::ReleaseRxBuffer (void)
+{
+	assert (m_nRxFilled > 0);
+	m_nRxFilled--;
+
+	m_nRxConsume = (m_nRxConsume + 1) % USB_NET_BUFFERS;
+	m_nRxOffset = 0;
+
+	StartRx ();
+}
+
+void CUSBNetPipeline::StartTx (void)
+{
+	while (   m_nTxQueued > 0
+	       && m_nTxInFlight < USB_NET_URBS_IN_FLIGHT)
+	{
+		unsigned nBuffer = m_nTxSubmit;
+		m_nTxSubmit = (m_nTxSubmit + 1) % USB_NET_BUFFERS;
+		m_nTxQueued--;
+
+		CUSBRequest *pURB = new CUSBRequest (m_pEndpointOut, m_pTxBuffer[nBuffer],
+						     m_nTxLength[nBuffer]);
+		assert (pURB);
+		pURB->SetCompletionRoutine (TxCompletionStub, (void *) (uintptr) nBuffer, this);
+
+		assert (m_pHost);
+		if (!m_pHost->SubmitAsyncRequest (pURB))
+		{
+			delete pURB;
+
+			m_Statistics.TxErrors++;
+
+			continue;
+		}
+
+		m_nTxInFlight++;
+	}
+}
+
+void CUSBNetPipeline::RxCompletionRoutine (CUSBRequest *pURB, unsigned nBuffer)
+{
+	assert (pURB);
+
+	m_SpinLock.Acquire ();
+
+	// bulk transfers complete in the order, in which they have been submitted
+	assert (m_nRxInFlight > 0);
+	assert (nBuffer == (m_nRxConsume + m_nRxFilled) % USB_NET_BUFFERS);
+	m_nRxInFlight--;
+	m_nRxFilled++;
+
+	boolean bOK = !!pURB->GetStatus ();
+	if (bOK)
+	{
+		m_nRxLength[nBuffer] = pURB->GetResultLength ();
+		if (m_nRxLength[nBuffer] > 0)
+		{
+			m_Statistics.RxTransfers++;
+		}
+	}
+	else
+	{
+		m_nRxLength[nBuffer] = 0;
+
+		m_Statistics.RxErrors++;
+	}
+
+	delete pURB;
+
+	// after an error the endpoint is re-armed from GetRxData() only,
+	// which prevents an interrupt storm, if the device has gone.
+	// This is also the case with complete on NAK, because each
+	// transfer would complete immediately, if no data is available.
+	if (   bOK
+	    && !m_bCompleteOnNAK)
+	{
+		StartRx ();
+
+		if (   m_nRxInFlight == 0
+		    && m_nRxFilled == USB_NET_BUFFERS)
+		{
+			m_Statistics.RxOverruns++;
+		}
+	}
+
+	m_SpinLock.Release ();
+}
+
+void CUSBNetPipeline::RxCompletionStub (CUSBRequest *pURB, void *pParam, void *pContext)
+{
+	CUSBNetPipeline *pThis = (CUSBNetPipeline *) pContext;
+	assert (pThis);
+
+	pThis->RxCompletionRoutine (pURB, (unsigned) (uintptr) pParam);
+}
+
+void CUSBNetPipeline::TxCompletionRoutine (CUSBRequest *pURB, unsigned nBuffer)
+{
+	assert (pURB);
+
+	m_SpinLock.Acquire ();
+
+	assert (m_nTxInFlight > 0);
+	m_nTxInFlight--;
+
+	if (pURB->GetStatus ())
+	{
+		m_Statistics.TxFrames++;
+	}
+	else
+	{
+		m_Statistics.TxErrors++;
+	}
+
+	delete pURB;
+
+	StartTx ();
+
+	m_SpinLock.Release ();
+}
+
+void CUSBNetPipeline::TxCompletionStub (CUSBRequest *pURB, void *pParam, void *pContext)
+{
+	CUSBNetPipeline *pThis = (CUSBNetPipeline *) pContext;
+	assert (pThis);
+
+	pThis->TxCompletionRoutine (pURB, (unsigned) (uintptr) pParam);
+}
@@ -18,8 +18,38 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 #include <circle/usb/usbrequest.h>
+#include <circle/metrics.h>
 #include <assert.h>
 
+static CMetricCounter s_Completed ("circle_usb_requests_total", "Completed USB requests",
+				   "status=\"ok\"");
+static CMetricCounter s_Failed ("circle_usb_requests_total", "Completed USB requests",
+				"status=\"failed\"");
+static CMetricCounter s_Bytes ("circle_usb_transfer_bytes_total",
+			       "Bytes transferred by successful USB requests");
+
+#define USB_ERROR_COUNTER(name, label)	\
+	static CMetricCounter name ("circle_usb_errors_total", "USB transfer errors by type", \
+				    "error=\"" label "\"")
+
+USB_ERROR_COUNTER (s_ErrorStall, "stall");
+USB_ERROR_COUNTER (s_ErrorTransaction, "transaction");
+USB_ERROR_COUNTER (s_ErrorBabble, "babble");
+USB_ERROR_COUNTER (s_ErrorFrameOverrun, "frame_overrun");
+USB_ERROR_COUNTER (s_ErrorDataToggle, "data_toggle");
+USB_ERROR_COUNTER (s_ErrorHostBus, "host_bus");
+USB_ERROR_COUNTER (s_ErrorSplit, "split");
+USB_ERROR_COUNTER (s_ErrorTimeout, "timeout");
+USB_ERROR_COUNTER (s_ErrorAborted, "aborted");
+USB_ERROR_COUNTER (s_ErrorUnknown, "unknown");
+
+static CMetricCounter * const s_pErrorCounter[] =	// indexed by TUSBError
+{
+	&s_ErrorStall, &s_ErrorTransaction, &s_ErrorBabble, &s_ErrorFrameOverrun,
+	&s_ErrorDataToggle, &s_ErrorHostBus, &s_ErrorSplit, &s_ErrorTimeout,
+	&s_ErrorAborted, &s_ErrorUnknown
+};
+
 CUSBRequest::CUSBRequest (CUSBEndpoint *pEndpoint, void *pBuffer, u32 nBufLen, TSetupData *pSetupData)
 :	m_pEndpoint (pEndpoint),
 	m_pSetupData (pSetupData),
@@ -65,6 +95,9 @@ void CUSBRequest::SetResultLen (u32 nLength)
 void CUSBRequest::SetUSBError (TUSBError Error)
 {
 	m_USBError = Error;
+
+	assert (Error < sizeof s_pErrorCounter / sizeof s_pErrorCounter[0]);
+	s_pErrorCounter[Error]->Add ();
 }
 
 int CUSBRequest::GetStatus (void) const
@@ -142,7 +175,17 @@ void CUSBRequest::SetCompletionRoutine (TURBCompletionRoutine *pRoutine, void *p
 void CUSBRequest::CallCompletionRoutine (void)
 {
 	assert (m_pCompletionRoutine != 0);
-	
+
+	if (m_bStatus)
+	{
+		s_Completed.Add ();
+		s_Bytes.Add (m_nResultLen);
+	}
+	else
+	{
+		s_Failed.Add ();
+	}
+
 	(*m_pCompletionRoutine) (this, m_pCompletionParam, m_pCompletionContext);
 }
 
@@ -22,6 +22,7 @@
 #include <circle/memio.h>
 #include <circle/logger.h>
 #include <circle/memory.h>
+#include <circle/synchronize.h>
 #include <circle/util.h>
 #include <circle/bcmpropertytags.h>
 #include <circle/machineinfo.h>
@@ -60,6 +61,8 @@ CXHCIDevice::CXHCIDevice (CInterruptSystem *pInterruptSystem, CTimer *pTimer, bo
 	m_pRootHub (0),
 	m_bShutdown (FALSE)
 {
+	memset (&m_Statistics, 0, sizeof m_Statistics);
+
 	if (m_pSharedMemAllocator == 0)
 	{
 		m_bOwnSharedMemAllocator = TRUE;
@@ -373,6 +376,40 @@ void CXHCIDevice::FreeSharedMem (void *pBlock)
 	m_pSharedMemAllocator->Free (pBlock);
 }
 
+void CXHCIDevice::SetInterruptModeration (unsigned nIntervalNs)
+{
+	unsigned nInterval = nIntervalNs / 250;
+	if (nInterval > XHCI_REG_RT_IR_IMOD_IMODI__MASK)
+	{
+		nInterval = XHCI_REG_RT_IR_IMOD_IMODI__MASK;
+	}
+
+	assert (m_pEventManager != 0);
+	m_pEventManager->SetModerationInterval ((u16) nInterval);
+}
+
+void CXHCIDevice::GetStatistics (TStatistics *pStatistics) const
+{
+	assert (pStatistics != 0);
+
+	EnterCritical ();
+	*pStatistics = m_Statistics;
+	LeaveCritical ();
+}
+
+void CXHCIDevice::CountTransfer (u32 nBytes, boolean bOK)
+{
+	if (bOK)
+	{
+		m_Statistics.BytesTransferred += nBytes;
+		m_Statistics.Transfers++;
+	}
+	else
+	{
+		m_Statistics.TransferErrors++;
+	}
+}
+
 void CXHCIDevice::InterruptHandler (void)
 {
 #ifdef XHCI_DEBUG2
@@ -398,14 +435,29 @@ void CXHCIDevice::InterruptHandler (void)
 		return;
 	}
 
+	m_Statistics.Interrupts++;
+
+	// Drain the event ring. The dequeue pointer is updated in between, so that the xHC
+	// can continue to post events, while many events are handled in one interrupt.
 	TXHCITRB *pEventTRB = 0;
 	TXHCITRB *pNextEventTRB;
 	assert (m_pEventManager != 0);
-	unsigned nTries = XHCI_CONFIG_MAX_EVENTS_PER_INTR;
-	while (   nTries-- != 0
+	unsigned nEvents = 0;
+	while (   nEvents < XHCI_CONFIG_EVENT_RING_SIZE
 	       && (pNextEventTRB = m_pEventManager->HandleEvents ()) != 0)
 	{
 		pEventTRB = pNextEventTRB;
+
+		if (++nEvents % XHCI_CONFIG_ERDP_UPDATE_EVENTS == 0)
+		{
+			m_pMMIO->rt_write64 (0, XHCI_REG_RT_IR_ERDP_LO, XHCI_TO_DMA (pEventTRB));
+		}
+	}
+
+	m_Statistics.Events += nEvents;
+	if (nEvents > m_Statistics.MaxEventsPerInterrupt)
+	{
+		m_Statistics.MaxEventsPerInterrupt = nEvents;
 	}
 
 	if (pEventTRB != 0)
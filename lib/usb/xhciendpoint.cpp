@@ -41,12 +41,17 @@ CXHCIEndpoint::CXHCIEndpoint (CXHCIUSBDevice *pDevice, CXHCIDevice *pXHCIDevice)
 	m_pTransferRing (0),
 	m_uchEndpointID (1),
 	m_uchEndpointType (XHCI_EP_CONTEXT_EP_TYPE_CONTROL),
-	m_pURB {0, 0},
+	m_pURB {0},
+	m_nURBTRBs {0},
+	m_nURBs (0),
 	m_bTransferCompleted (TRUE),
+	m_nEnqueuedTRBs (0),
+	m_nFirstTRBControl (0),
+	m_nSkippedTRBs (0),
 	m_pInputContextBuffer (0)
 {
 	m_pTransferRing = new CXHCIRing (XHCIRingTypeTransfer,
-					 XHCI_CONFIG_TRANSFER_RING_SIZE, pXHCIDevice);
+					 XHCI_CONFIG_TRANSFER_RING_SIZE_SMALL, pXHCIDevice);
 	if (   m_pTransferRing == 0
 	    || !m_pTransferRing->IsValid ())
 	{
@@ -67,20 +72,15 @@ CXHCIEndpoint::CXHCIEndpoint (CXHCIUSBDevice *pDevice, const TUSBEndpointDescrip
 	m_pTransferRing (0),
 	m_uchEndpointID (0),
 	m_uchEndpointType (0),
-	m_pURB {0, 0},
+	m_pURB {0},
+	m_nURBTRBs {0},
+	m_nURBs (0),
 	m_bTransferCompleted (TRUE),
+	m_nEnqueuedTRBs (0),
+	m_nFirstTRBControl (0),
+	m_nSkippedTRBs (0),
 	m_pInputContextBuffer (0)
 {
-	m_pTransferRing = new CXHCIRing (XHCIRingTypeTransfer,
-					 XHCI_CONFIG_TRANSFER_RING_SIZE, pXHCIDevice);
-	if (   m_pTransferRing == 0
-	    || !m_pTransferRing->IsValid ())
-	{
-		m_bValid = FALSE;
-
-		return;
-	}
-
 	// copy endpoint descriptor
 	assert (pDesc != 0);
 	assert (pDesc->bLength >= sizeof *pDesc);	// may have class-specific trailer
@@ -131,6 +131,21 @@ CXHCIEndpoint::CXHCIEndpoint (CXHCIUSBDevice *pDevice, const TUSBEndpointDescrip
 		m_uchEndpointType += 4;
 	}
 
+	// bulk and isochronous endpoints may have many TRBs pending,
+	// the ring grows anyway if required
+	m_pTransferRing = new CXHCIRing (XHCIRingTypeTransfer,
+					   (m_uchEndpointType & 3) == 2
+					|| (m_uchEndpointType & 3) == 1
+					 ? XHCI_CONFIG_TRANSFER_RING_SIZE
+					 : XHCI_CONFIG_TRANSFER_RING_SIZE_SMALL, pXHCIDevice);
+	if (   m_pTransferRing == 0
+	    || !m_pTransferRing->IsValid ())
+	{
+		m_bValid = FALSE;
+
+		return;
+	}
+
 	// configure endpoint on HC
 	TXHCIInputContext *pInputContext = GetInputContextConfigureEndpoint ();
 	assert (pInputContext != 0);
@@ -230,8 +245,7 @@ boolean CXHCIEndpoint::Transfer (CUSBRequest *pURB, unsigned nTimeoutMs)
 #endif
 
 			m_SpinLock.Acquire ();
-			m_pURB[0] = m_pURB[1];
-			m_pURB[1] = 0;
+			RemoveFirstURB ();
 			m_SpinLock.Release ();
 			m_bTransferCompleted = TRUE;
 
@@ -260,19 +274,24 @@ boolean CXHCIEndpoint::TransferAsync (CUSBRequest *pURB, unsigned nTimeoutMs)
 
 	void *pBuffer = pURB->GetBuffer ();
 	u32 nBufLen = pURB->GetBufLen ();
+	unsigned nTRBs = GetTRBCount (pURB);
 
 	m_SpinLock.Acquire ();
-	if (m_pURB[0] == 0)
-	{
-		m_pURB[0] = pURB;
-	}
-	else
+	assert (m_pTransferRing != 0);
+	if (   m_nURBs >= XHCI_CONFIG_MAX_PENDING_URBS
+	    || !m_pTransferRing->ReserveTRBs (nTRBs))
 	{
-		assert (m_pURB[1] == 0);
-		m_pURB[1] = pURB;
+		m_SpinLock.Release ();
+
+		return FALSE;
 	}
+	m_nURBTRBs[m_nURBs] = nTRBs + m_nSkippedTRBs;
+	m_nSkippedTRBs = 0;
+	m_pURB[m_nURBs++] = pURB;
 	m_SpinLock.Release ();
 
+	m_nEnqueuedTRBs = 0;
+
 	if (   (m_uchEndpointType & 3) == 2		// bulk EP
 	    || (m_uchEndpointType & 3) == 3)		// interrupt EP
 	{
@@ -386,6 +405,11 @@ boolean CXHCIEndpoint::TransferAsync (CUSBRequest *pURB, unsigned nTimeoutMs)
 		}
 	}
 
+	// the TD is handed over to the xHC with the cycle bit of its first TRB
+	DataSyncBarrier ();
+	assert (m_nEnqueuedTRBs > 0);
+	assert (m_pEnqueuedTRB[0] != 0);
+	m_pEnqueuedTRB[0]->Control = m_nFirstTRBControl;
 	DataSyncBarrier ();
 
 	assert (m_pDevice != 0);
@@ -395,15 +419,36 @@ boolean CXHCIEndpoint::TransferAsync (CUSBRequest *pURB, unsigned nTimeoutMs)
 	return TRUE;
 
 EnqueueError:
-	m_SpinLock.Acquire ();
-	if (m_pURB[1] != 0)
+	// the xHC passes the TRBs, which have already been enqueued, without any action,
+	// they are released together with the next TD, which follows them on the ring.
+	// The xHC does not see them before, because the first TRB is not handed over yet.
+	for (unsigned i = 1; i < m_nEnqueuedTRBs; i++)
 	{
-		m_pURB[1] = 0;
+		assert (m_pEnqueuedTRB[i] != 0);
+		m_pEnqueuedTRB[i]->Control =   XHCI_TRB_TYPE_NO_OP << XHCI_TRB_CONTROL_TRB_TYPE__SHIFT
+					     | (m_pEnqueuedTRB[i]->Control & XHCI_TRB_CONTROL_C);
 	}
-	else
+
+	DataSyncBarrier ();
+
+	if (m_nEnqueuedTRBs > 0)
 	{
-		m_pURB[0] = 0;
+		assert (m_pEnqueuedTRB[0] != 0);
+		m_pEnqueuedTRB[0]->Control =   XHCI_TRB_TYPE_NO_OP << XHCI_TRB_CONTROL_TRB_TYPE__SHIFT
+					     | (m_nFirstTRBControl & XHCI_TRB_CONTROL_C);
+
+		DataSyncBarrier ();
 	}
+
+	m_SpinLock.Acquire ();
+	assert (m_nURBs > 0);
+	m_pURB[--m_nURBs] = 0;
+	assert (m_nURBTRBs[m_nURBs] >= nTRBs);
+	m_nSkippedTRBs = m_nURBTRBs[m_nURBs] - nTRBs + m_nEnqueuedTRBs;
+	m_nURBTRBs[m_nURBs] = 0;
+
+	assert (m_pTransferRing != 0);
+	m_pTransferRing->UnreserveTRBs (nTRBs - m_nEnqueuedTRBs);
 	m_SpinLock.Release ();
 
 	return FALSE;
@@ -441,6 +486,8 @@ void CXHCIEndpoint::TransferEvent (u8 uchCompletionCode, u32 nTransferLength)
 		pURB->SetResultLen (nBufLen - nTransferLength);
 
 		pURB->SetStatus (1);
+
+		m_pXHCIDevice->CountTransfer (nBufLen - nTransferLength, TRUE);
 	}
 	else if (   uchCompletionCode == XHCI_TRB_COMPLETION_CODE_RING_UNDERRUN
 		 || uchCompletionCode == XHCI_TRB_COMPLETION_CODE_RING_OVERRUN)
@@ -448,20 +495,62 @@ void CXHCIEndpoint::TransferEvent (u8 uchCompletionCode, u32 nTransferLength)
 		// these events are not URB related, so just ignore them
 		return;
 	}
-	else if (pURB->GetEndpoint ()->GetType () != EndpointTypeIsochronous)
+	else
 	{
-		CLogger::Get ()->Write (From, LogWarning, "Transfer error %u on endpoint %u",
-					(unsigned) uchCompletionCode, (unsigned) m_uchEndpointID);
+		if (pURB->GetEndpoint ()->GetType () != EndpointTypeIsochronous)
+		{
+			CLogger::Get ()->Write (From, LogWarning, "Transfer error %u on endpoint %u",
+						(unsigned) uchCompletionCode,
+						(unsigned) m_uchEndpointID);
+		}
+
+		m_pXHCIDevice->CountTransfer (0, FALSE);
 	}
 
 	m_SpinLock.Acquire ();
-	m_pURB[0] = m_pURB[1];
-	m_pURB[1] = 0;
+	RemoveFirstURB ();
 	m_SpinLock.Release ();
 
 	pURB->CallCompletionRoutine ();
 }
 
+void CXHCIEndpoint::RemoveFirstURB (void)
+{
+	if (!m_nURBs)
+	{
+		return;
+	}
+
+	assert (m_pTransferRing != 0);
+	m_pTransferRing->ReleaseTRBs (m_nURBTRBs[0]);
+
+	for (unsigned i = 1; i < m_nURBs; i++)
+	{
+		m_pURB[i-1] = m_pURB[i];
+		m_nURBTRBs[i-1] = m_nURBTRBs[i];
+	}
+
+	m_pURB[--m_nURBs] = 0;
+	m_nURBTRBs[m_nURBs] = 0;
+}
+
+unsigned CXHCIEndpoint::GetTRBCount (CUSBRequest *pURB) const
+{
+	assert (pURB != 0);
+
+	switch (m_uchEndpointType & 3)
+	{
+	case 0:					// control EP
+		return pURB->GetBufLen () > 0 ? 3 : 2;
+
+	case 1:					// isochronous EP
+		return pURB->GetNumIsoPackets ();
+
+	default:				// bulk or interrupt EP
+		return 1;
+	}
+}
+
 boolean CXHCIEndpoint::ResetFromHalted (void)
 {
 	assert (m_pXHCIDevice);
@@ -475,11 +564,26 @@ boolean CXHCIEndpoint::ResetFromHalted (void)
 	}
 
 	assert (m_pTransferRing);
-	return m_pXHCIDevice->GetCommandManager ()->SetTRDequeuePointer (
+	if (!m_pXHCIDevice->GetCommandManager ()->SetTRDequeuePointer (
 								m_pDevice->GetSlotID (),
 								m_uchEndpointID,
 								m_pTransferRing->GetEnqueueTRB (),
-								!!m_pTransferRing->GetCycleState ());
+								!!m_pTransferRing->GetCycleState ()))
+	{
+		return FALSE;
+	}
+
+	// all pending TRBs have been skipped
+	m_SpinLock.Acquire ();
+	m_pTransferRing->ReleaseAllTRBs ();
+	for (unsigned i = 0; i < m_nURBs; i++)
+	{
+		m_nURBTRBs[i] = 0;
+	}
+	m_nSkippedTRBs = 0;
+	m_SpinLock.Release ();
+
+	return TRUE;
 }
 
 #ifndef NDEBUG
@@ -525,7 +629,7 @@ boolean CXHCIEndpoint::EnqueueTRB (u32 nControl, u32 nStatus, u32 nParameter1, u
 	TXHCITRB *pTransferTRB = m_pTransferRing->GetEnqueueTRB ();
 	if (pTransferTRB == 0)
 	{
-		return 0;
+		return FALSE;
 	}
 
 	pTransferTRB->Parameter1 = nParameter1;
@@ -535,11 +639,26 @@ boolean CXHCIEndpoint::EnqueueTRB (u32 nControl, u32 nStatus, u32 nParameter1, u
 			       |    XHCI_INTERRUPTER_TARGET_DEFAULT
 			         << XHCI_TRANSFER_TRB_STATUS_INTERRUPTER_TARGET__SHIFT;
 
-	pTransferTRB->Control = nControl | m_pTransferRing->GetCycleState ();
+	nControl |= m_pTransferRing->GetCycleState ();
+
+	// the first TRB of a TD is owned by software, until the whole TD has been written
+	boolean bFirstTRB = m_nEnqueuedTRBs == 0;
+	if (bFirstTRB)
+	{
+		m_nFirstTRBControl = nControl;
+
+		nControl ^= XHCI_TRB_CONTROL_C;
+	}
+
+	pTransferTRB->Control = nControl;
+
+	m_pTransferRing->IncrementEnqueue (bFirstTRB);
 
-	m_pTransferRing->IncrementEnqueue ();
+	assert (MaxTRBsPerTD >= CUSBRequest::MaxIsoPackets);
+	assert (m_nEnqueuedTRBs < MaxTRBsPerTD);
+	m_pEnqueuedTRB[m_nEnqueuedTRBs++] = pTransferTRB;
 
-	return pTransferTRB;
+	return pTransferTRB != 0;
 }
 
 TXHCIInputContext *CXHCIEndpoint::GetInputContextSetMaxPacketSize (void)
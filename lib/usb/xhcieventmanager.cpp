@@ -141,6 +141,15 @@ TXHCITRB *CXHCIEventManager::HandleEvents (void)
 	return pEventTRB;
 }
 
+void CXHCIEventManager::SetModerationInterval (u16 nInterval)
+{
+	assert (m_pMMIO != 0);
+	m_pMMIO->rt_write32 (0, XHCI_REG_RT_IR_IMOD,
+			       (  m_pMMIO->rt_read32 (0, XHCI_REG_RT_IR_IMOD)
+			        & ~XHCI_REG_RT_IR_IMOD_IMODI__MASK)
+			     | nInterval);
+}
+
 #ifndef NDEBUG
 
 void CXHCIEventManager::DumpStatus (void)
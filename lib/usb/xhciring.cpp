@@ -32,19 +32,24 @@ CXHCIRing::CXHCIRing (TXHCIRingType Type, unsigned nTRBCount, CXHCIDevice *pAllo
 	m_pFirstTRB (0),
 	m_nEnqueueIndex (0),
 	m_nDequeueIndex (0),
-	m_nCycleState (XHCI_TRB_CONTROL_C)
+	m_nCycleState (XHCI_TRB_CONTROL_C),
+	m_nSegments (0),
+	m_nEnqueueSegment (0),
+	m_nDequeueSegment (0),
+	m_nUsedTRBs (0)
 {
 	assert (m_nTRBCount >= 16);
 	assert (m_nTRBCount % 4 == 0);
 
-	assert (m_pAllocator != 0);
-	m_pFirstTRB = (TXHCITRB *) m_pAllocator->AllocateSharedMem (m_nTRBCount * sizeof (TXHCITRB),
-								    64, 0x10000);
+	m_pFirstTRB = AllocateSegment ();
 	if (m_pFirstTRB == 0)
 	{
 		return;
 	}
 
+	m_pSegment[0] = m_pFirstTRB;
+	m_nSegments = 1;
+
 	if (m_Type != XHCIRingTypeEvent)
 	{
 		TXHCITRB *pLinkTRB = &m_pFirstTRB[m_nTRBCount - 1];
@@ -58,12 +63,12 @@ CXHCIRing::CXHCIRing (TXHCIRingType Type, unsigned nTRBCount, CXHCIDevice *pAllo
 
 CXHCIRing::~CXHCIRing (void)
 {
-	if (m_pFirstTRB != 0)
+	while (m_nSegments > 0)
 	{
-		m_pAllocator->FreeSharedMem (m_pFirstTRB);
-
-		m_pFirstTRB = 0;
+		m_pAllocator->FreeSharedMem (m_pSegment[--m_nSegments]);
 	}
+
+	m_pFirstTRB = 0;
 }
 
 boolean CXHCIRing::IsValid (void) const
@@ -78,6 +83,60 @@ unsigned CXHCIRing::GetTRBCount (void) const
 	return m_nTRBCount;
 }
 
+unsigned CXHCIRing::GetSegmentCount (void) const
+{
+	return m_nSegments;
+}
+
+boolean CXHCIRing::ReserveTRBs (unsigned nTRBs)
+{
+	assert (m_pFirstTRB != 0);
+	assert (m_Type == XHCIRingTypeTransfer);
+
+	// one TRB per segment is used for the Link TRB
+	while (m_nUsedTRBs + nTRBs > m_nSegments * (m_nTRBCount-1))
+	{
+		if (!Expand ())
+		{
+			return FALSE;
+		}
+	}
+
+	m_nUsedTRBs += nTRBs;
+
+	return TRUE;
+}
+
+void CXHCIRing::ReleaseTRBs (unsigned nTRBs)
+{
+	assert (m_pFirstTRB != 0);
+	assert (m_Type == XHCIRingTypeTransfer);
+	assert (nTRBs <= m_nUsedTRBs);
+	m_nUsedTRBs -= nTRBs;
+
+	// advance our copy of the dequeue pointer of the xHC
+	m_nDequeueIndex += nTRBs;
+	while (m_nDequeueIndex >= m_nTRBCount-1)
+	{
+		m_nDequeueIndex -= m_nTRBCount-1;
+
+		if (++m_nDequeueSegment == m_nSegments)
+		{
+			m_nDequeueSegment = 0;
+		}
+	}
+}
+
+void CXHCIRing::ReleaseAllTRBs (void)
+{
+	assert (m_pFirstTRB != 0);
+	assert (m_Type == XHCIRingTypeTransfer);
+
+	m_nUsedTRBs = 0;
+	m_nDequeueSegment = m_nEnqueueSegment;
+	m_nDequeueIndex = m_nEnqueueIndex;
+}
+
 TXHCITRB *CXHCIRing::GetFirstTRB (void)
 {
 	assert (m_pFirstTRB != 0);
@@ -98,17 +157,26 @@ TXHCITRB *CXHCIRing::GetDequeueTRB (void)
 	return &m_pFirstTRB[m_nDequeueIndex];
 }
 
+void CXHCIRing::UnreserveTRBs (unsigned nTRBs)
+{
+	assert (m_pFirstTRB != 0);
+	assert (m_Type == XHCIRingTypeTransfer);
+	assert (nTRBs <= m_nUsedTRBs);
+	m_nUsedTRBs -= nTRBs;
+}
+
 TXHCITRB *CXHCIRing::GetEnqueueTRB (void)
 {
 	assert (m_pFirstTRB != 0);
 	assert (m_nEnqueueIndex < m_nTRBCount);
 
-	if ((m_pFirstTRB[m_nEnqueueIndex].Control & XHCI_TRB_CONTROL_C) == m_nCycleState)
+	TXHCITRB *pSegment = m_pSegment[m_nEnqueueSegment];
+	if ((pSegment[m_nEnqueueIndex].Control & XHCI_TRB_CONTROL_C) == m_nCycleState)
 	{
 		return 0;		// ring is full
 	}
 
-	return &m_pFirstTRB[m_nEnqueueIndex];
+	return &pSegment[m_nEnqueueIndex];
 }
 
 TXHCITRB *CXHCIRing::IncrementDequeue (void)
@@ -130,18 +198,20 @@ TXHCITRB *CXHCIRing::IncrementDequeue (void)
 	return &m_pFirstTRB[m_nDequeueIndex];
 }
 
-void CXHCIRing::IncrementEnqueue (void)
+void CXHCIRing::IncrementEnqueue (boolean bCycleSetLater)
 {
 	assert (m_pFirstTRB != 0);
 	assert (m_Type != XHCIRingTypeEvent);
 	assert (m_nEnqueueIndex < m_nTRBCount);
 
-	assert (   (m_pFirstTRB[m_nEnqueueIndex].Control & XHCI_TRB_CONTROL_C)
-		== m_nCycleState);	// Cycle state must be already set
+	TXHCITRB *pSegment = m_pSegment[m_nEnqueueSegment];
+	assert (   bCycleSetLater
+		||    (pSegment[m_nEnqueueIndex].Control & XHCI_TRB_CONTROL_C)
+		   == m_nCycleState);	// Cycle state must be already set
 
 	if (++m_nEnqueueIndex == m_nTRBCount-1)		// last index is used for Link TRB
 	{
-		TXHCITRB *pLinkTRB = &m_pFirstTRB[m_nEnqueueIndex];
+		TXHCITRB *pLinkTRB = &pSegment[m_nEnqueueIndex];
 
 		pLinkTRB->Control ^= XHCI_TRB_CONTROL_C;
 
@@ -151,6 +221,11 @@ void CXHCIRing::IncrementEnqueue (void)
 		}
 
 		m_nEnqueueIndex = 0;
+
+		if (++m_nEnqueueSegment == m_nSegments)
+		{
+			m_nEnqueueSegment = 0;
+		}
 	}
 }
 
@@ -161,19 +236,93 @@ u32 CXHCIRing::GetCycleState (void) const
 	return m_nCycleState;
 }
 
+TXHCITRB *CXHCIRing::AllocateSegment (void)
+{
+	assert (m_pAllocator != 0);
+	return (TXHCITRB *) m_pAllocator->AllocateSharedMem (m_nTRBCount * sizeof (TXHCITRB),
+							     64, 0x10000);
+}
+
+boolean CXHCIRing::Expand (void)
+{
+	assert (m_Type == XHCIRingTypeTransfer);
+
+	if (m_nSegments >= XHCI_CONFIG_MAX_RING_SEGMENTS)
+	{
+		return FALSE;
+	}
+
+	// The new segment is linked in after the enqueue segment. This helps only, if the
+	// TRBs from the enqueue TRB up to the end of this segment are free. This is not the
+	// case, when the oldest pending TRB lies in the same segment behind the enqueue TRB.
+	if (   m_nUsedTRBs > 0
+	    && m_nDequeueSegment == m_nEnqueueSegment
+	    && m_nDequeueIndex >= m_nEnqueueIndex)
+	{
+		return FALSE;
+	}
+
+	TXHCITRB *pNewSegment = AllocateSegment ();
+	if (pNewSegment == 0)
+	{
+		return FALSE;
+	}
+
+	// the TRBs of the new segment are not owned by the xHC yet (inverse cycle bit)
+	u32 nNotOwned = m_nCycleState ^ XHCI_TRB_CONTROL_C;
+	for (unsigned i = 0; i < m_nTRBCount; i++)
+	{
+		pNewSegment[i].Control = nNotOwned;
+	}
+
+	TXHCITRB *pEnqueueLinkTRB = &m_pSegment[m_nEnqueueSegment][m_nTRBCount - 1];
+	TXHCITRB *pNewLinkTRB = &pNewSegment[m_nTRBCount - 1];
+
+	pNewLinkTRB->Parameter = pEnqueueLinkTRB->Parameter;
+	pNewLinkTRB->Status = 0;
+	pNewLinkTRB->Control |= XHCI_TRB_TYPE_LINK << XHCI_TRB_CONTROL_TRB_TYPE__SHIFT;
+
+	// the Toggle Cycle flag moves to the new segment, if it becomes the last one
+	if (pEnqueueLinkTRB->Control & XHCI_LINK_TRB_CONTROL_TC)
+	{
+		pNewLinkTRB->Control |= XHCI_LINK_TRB_CONTROL_TC;
+		pEnqueueLinkTRB->Control &= ~XHCI_LINK_TRB_CONTROL_TC;
+	}
+
+	// the enqueue Link TRB is not owned by the xHC yet, so it can be modified
+	pEnqueueLinkTRB->Parameter = XHCI_TO_DMA (pNewSegment);
+
+	for (unsigned i = m_nSegments; i > m_nEnqueueSegment+1; i--)
+	{
+		m_pSegment[i] = m_pSegment[i-1];
+	}
+	m_pSegment[m_nEnqueueSegment+1] = pNewSegment;
+	m_nSegments++;
+
+	if (   m_nUsedTRBs > 0
+	    && m_nDequeueSegment > m_nEnqueueSegment)
+	{
+		m_nDequeueSegment++;
+	}
+
+	return TRUE;
+}
+
 #ifndef NDEBUG
 
 void CXHCIRing::DumpStatus (const char *pFrom)
 {
-	CLogger::Get ()->Write (pFrom != 0 ? pFrom : From, LogDebug, "Count %u, %s %u, Cycle %u",
-				m_nTRBCount,
+	CLogger::Get ()->Write (pFrom != 0 ? pFrom : From, LogDebug,
+				"Count %u, Segments %u, %s %u/%u, Cycle %u",
+				m_nTRBCount, m_nSegments,
 				m_Type == XHCIRingTypeEvent ? "Dequeue" : "Enqueue",
+				m_Type == XHCIRingTypeEvent ? 0 : m_nEnqueueSegment,
 				m_Type == XHCIRingTypeEvent ? m_nDequeueIndex : m_nEnqueueIndex,
 				m_nCycleState);
 
-	if (m_pFirstTRB != 0)
+	for (unsigned i = 0; i < m_nSegments; i++)
 	{
-		debug_hexdump (m_pFirstTRB, m_nTRBCount * sizeof (TXHCITRB),
+		debug_hexdump (m_pSegment[i], m_nTRBCount * sizeof (TXHCITRB),
 			       pFrom != 0 ? pFrom : From);
 	}
 }
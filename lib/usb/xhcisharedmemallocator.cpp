@@ -46,6 +46,17 @@ size_t CXHCISharedMemAllocator::GetFreeSpace (void) const
 }
 
 void *CXHCISharedMemAllocator::Allocate (size_t nSize, size_t nAlign, size_t nBoundary)
+{
+	m_SpinLock.Acquire ();
+
+	void *pResult = AllocateBlock (nSize, nAlign, nBoundary);
+
+	m_SpinLock.Release ();
+
+	return pResult;
+}
+
+void *CXHCISharedMemAllocator::AllocateBlock (size_t nSize, size_t nAlign, size_t nBoundary)
 {
 	assert (nSize > 0);
 	assert (nAlign != 0);
@@ -130,8 +141,12 @@ void CXHCISharedMemAllocator::Free (void *pBlock)
 	    && pBlockHeader->nAlign == XHCI_BLOCK_ALIGN
 	    && pBlockHeader->nBoundary == XHCI_BLOCK_BOUNDARY)
 	{
+		m_SpinLock.Acquire ();
+
 		pBlockHeader->pNext = m_pFreeList;
 		m_pFreeList = pBlockHeader;
+
+		m_SpinLock.Release ();
 	}
 	else
 	{
@@ -18,6 +18,8 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 #include <circle/util.h>
+#include <circle/checksum.h>
+#include <circle/sysconfig.h>
 
 void *memmove (void *pDest, const void *pSrc, size_t nLength)
 {
@@ -43,6 +45,8 @@ void *memmove (void *pDest, const void *pSrc, size_t nLength)
 
 #if STDLIB_SUPPORT <= 1
 
+#if AARCH == 32 || !defined (USE_NEON_UTIL)	// NEON versions are in util_fast.S
+
 int memcmp (const void *pBuffer1, const void *pBuffer2, size_t nLength)
 {
 	const unsigned char *p1 = (const unsigned char *) pBuffer1;
@@ -78,6 +82,8 @@ size_t strlen (const char *pString)
 	return nResult;
 }
 
+#endif
+
 int strcmp (const char *pString1, const char *pString2)
 {
 	while (   *pString1 != '\0'
@@ -728,25 +734,19 @@ int parity32 (unsigned nValue)
 
 u32 ether_crc (size_t ulLength, const u8 *pData)
 {
-	u32 nCRC = ~0;
-	while (ulLength--)
-	{
-		nCRC ^= *pData++;
-
-		for (unsigned i = 0; i < 8; i++)
-		{
-			nCRC = (nCRC >> 1) ^ ((nCRC & 1) ? 0xEDB88320 : 0);
-		}
-	}
+	u32 nCRC = ~CCRC32::Calculate (pData, ulLength);
 
 	// reverse bits
-	u32 nCRC_BE = 0;
-	unsigned i;
-	for (i = 0; nCRC; i++, nCRC >>= 1)
-	{
-		nCRC_BE <<= 1;
-		nCRC_BE |= nCRC & 1;
-	}
+#if AARCH == 64
+	asm ("rbit %w0, %w0" : "+r" (nCRC));
+#elif RASPPI >= 2
+	asm ("rbit %0, %0" : "+r" (nCRC));
+#else
+	nCRC = (nCRC >> 1 & 0x55555555) | (nCRC & 0x55555555) << 1;
+	nCRC = (nCRC >> 2 & 0x33333333) | (nCRC & 0x33333333) << 2;
+	nCRC = (nCRC >> 4 & 0x0F0F0F0F) | (nCRC & 0x0F0F0F0F) << 4;
+	nCRC = bswap32 (nCRC);
+#endif
 
-	return nCRC_BE << (32 - i);
+	return nCRC;
 }
@@ -0,0 +1,608 @@
+//
+// windowmanager.cpp
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <circle/windowmanager.h>
+#include <circle/util.h>
+#include <assert.h>
+
+// fills nLines packed lines of nWidth pixels with a raw color
+static void FillPixels (u8 *pTo, unsigned nWidth, unsigned nLines, CDisplay::TRawColor nColor,
+			unsigned nBytesPerPixel)
+{
+	size_t nLineSize = nWidth * nBytesPerPixel;
+
+	switch (nBytesPerPixel)
+	{
+	case 1:
+		memset (pTo, (u8) nColor, nLineSize * nLines);
+		return;
+
+	case 2:
+		for (unsigned i = 0; i < nWidth; i++)
+		{
+			((u16 *) pTo)[i] = (u16) nColor;
+		}
+		break;
+
+	case 4:
+		for (unsigned i = 0; i < nWidth; i++)
+		{
+			((u32 *) pTo)[i] = nColor;
+		}
+		break;
+
+	default:
+		assert (0);
+		break;
+	}
+
+	for (unsigned i = 1; i < nLines; i++)
+	{
+		memcpy (pTo + i * nLineSize, pTo, nLineSize);
+	}
+}
+
+// returns FALSE, if the areas do not intersect
+static boolean Intersect (const CDisplay::TArea &rArea1, const CDisplay::TArea &rArea2,
+			  CDisplay::TArea *pResult)
+{
+	pResult->x1 = rArea1.x1 > rArea2.x1 ? rArea1.x1 : rArea2.x1;
+	pResult->x2 = rArea1.x2 < rArea2.x2 ? rArea1.x2 : rArea2.x2;
+	pResult->y1 = rArea1.y1 > rArea2.y1 ? rArea1.y1 : rArea2.y1;
+	pResult->y2 = rArea1.y2 < rArea2.y2 ? rArea1.y2 : rArea2.y2;
+
+	return pResult->x1 <= pResult->x2 && pResult->y1 <= pResult->y2;
+}
+
+static void Merge (CDisplay::TArea *pArea, const CDisplay::TArea &rArea)
+{
+	if (rArea.x1 < pArea->x1)	pArea->x1 = rArea.x1;
+	if (rArea.x2 > pArea->x2)	pArea->x2 = rArea.x2;
+	if (rArea.y1 < pArea->y1)	pArea->y1 = rArea.y1;
+	if (rArea.y2 > pArea->y2)	pArea->y2 = rArea.y2;
+}
+
+//// CManagedWindow ////////////////////////////////////////////////////////////
+
+CManagedWindow::CManagedWindow (CWindowManager *pManager, const TArea &rArea)
+:	CDisplay (pManager->GetDisplay ()->GetColorModel ()),
+	m_pManager (pManager),
+	m_Area (rArea),
+	m_bVisible (TRUE),
+	m_nBytesPerPixel (pManager->m_nBytesPerPixel),
+	m_pBuffer (nullptr),
+	m_bDamaged (FALSE),
+	m_SpinLock (TASK_LEVEL)
+{
+	assert (m_nBytesPerPixel);		// CWindowManager::Initialize() has been called?
+	assert (m_Area.x1 <= m_Area.x2 && m_Area.x2 < m_pManager->GetDisplay ()->GetWidth ());
+	assert (m_Area.y1 <= m_Area.y2 && m_Area.y2 < m_pManager->GetDisplay ()->GetHeight ());
+
+	m_nPitch = GetWidth () * m_nBytesPerPixel;
+
+	m_pBuffer = new u8[m_nPitch * GetHeight ()];
+	assert (m_pBuffer);
+
+	FillPixels (m_pBuffer, GetWidth (), GetHeight (), GetColor (Black), m_nBytesPerPixel);
+
+	m_pManager->AddWindow (this);
+}
+
+CManagedWindow::~CManagedWindow (void)
+{
+	m_pManager->RemoveWindow (this);
+	m_pManager = nullptr;
+
+	delete [] m_pBuffer;
+	m_pBuffer = nullptr;
+}
+
+unsigned CManagedWindow::GetWidth (void) const
+{
+	return m_Area.x2 - m_Area.x1 + 1;
+}
+
+unsigned CManagedWindow::GetHeight (void) const
+{
+	return m_Area.y2 - m_Area.y1 + 1;
+}
+
+unsigned CManagedWindow::GetDepth (void) const
+{
+	return m_nBytesPerPixel * 8;
+}
+
+void CManagedWindow::SetPixel (unsigned nPosX, unsigned nPosY, TRawColor nColor)
+{
+	if (   nPosX >= GetWidth ()
+	    || nPosY >= GetHeight ())
+	{
+		return;
+	}
+
+	u8 *pTo = m_pBuffer + nPosY * m_nPitch + nPosX * m_nBytesPerPixel;
+
+	m_SpinLock.Acquire ();
+
+	switch (m_nBytesPerPixel)
+	{
+	case 1:	*pTo = (u8) nColor;		break;
+	case 2:	*(u16 *) pTo = (u16) nColor;	break;
+	case 4:	*(u32 *) pTo = nColor;		break;
+	}
+
+	TArea Area {nPosX, nPosX, nPosY, nPosY};
+	if (m_bDamaged)
+	{
+		Merge (&m_Damage, Area);
+	}
+	else
+	{
+		m_Damage = Area;
+		m_bDamaged = TRUE;
+	}
+
+	m_SpinLock.Release ();
+}
+
+void CManagedWindow::SetArea (const TArea &rArea, const void *pPixels,
+			      TAreaCompletionRoutine *pRoutine, void *pParam)
+{
+	assert (pPixels);
+
+	if (   rArea.x1 <= rArea.x2 && rArea.x2 < GetWidth ()
+	    && rArea.y1 <= rArea.y2 && rArea.y2 < GetHeight ())
+	{
+		size_t nLineSize = (rArea.x2 - rArea.x1 + 1) * m_nBytesPerPixel;
+		const u8 *pFrom = (const u8 *) pPixels;
+		u8 *pTo = m_pBuffer + rArea.y1 * m_nPitch + rArea.x1 * m_nBytesPerPixel;
+
+		m_SpinLock.Acquire ();
+
+		for (unsigned y = rArea.y1; y <= rArea.y2; y++)
+		{
+			memcpy (pTo, pFrom, nLineSize);
+
+			pTo += m_nPitch;
+			pFrom += nLineSize;
+		}
+
+		if (m_bDamaged)
+		{
+			Merge (&m_Damage, rArea);
+		}
+		else
+		{
+			m_Damage = rArea;
+			m_bDamaged = TRUE;
+		}
+
+		m_SpinLock.Release ();
+	}
+
+	if (pRoutine)
+	{
+		(*pRoutine) (pParam);
+	}
+}
+
+CDisplay *CManagedWindow::GetParent (void) const
+{
+	return m_pManager->GetDisplay ();
+}
+
+unsigned CManagedWindow::GetOffsetX (void) const
+{
+	return m_Area.x1;
+}
+
+unsigned CManagedWindow::GetOffsetY (void) const
+{
+	return m_Area.y1;
+}
+
+void CManagedWindow::Move (unsigned nPosX, unsigned nPosY)
+{
+	TArea Area;
+	Area.x1 = nPosX;
+	Area.x2 = nPosX + GetWidth () - 1;
+	Area.y1 = nPosY;
+	Area.y2 = nPosY + GetHeight () - 1;
+
+	CDisplay *pDisplay = m_pManager->GetDisplay ();
+	if (   Area.x2 >= pDisplay->GetWidth ()
+	    || Area.y2 >= pDisplay->GetHeight ())
+	{
+		return;
+	}
+
+	m_pManager->m_SpinLock.Acquire ();
+
+	if (m_bVisible)
+	{
+		m_pManager->AddDamage (m_Area);
+		m_pManager->AddDamage (Area);
+	}
+
+	m_Area = Area;
+
+	m_pManager->m_SpinLock.Release ();
+}
+
+void CManagedWindow::Raise (void)
+{
+	m_pManager->Restack (this, TRUE);
+}
+
+void CManagedWindow::Lower (void)
+{
+	m_pManager->Restack (this, FALSE);
+}
+
+void CManagedWindow::Show (boolean bVisible)
+{
+	m_pManager->m_SpinLock.Acquire ();
+
+	if (m_bVisible != bVisible)
+	{
+		m_bVisible = bVisible;
+
+		m_pManager->AddDamage (m_Area);
+	}
+
+	m_pManager->m_SpinLock.Release ();
+}
+
+boolean CManagedWindow::IsVisible (void) const
+{
+	return m_bVisible;
+}
+
+void CManagedWindow::Read (const TArea &rArea, u8 *pTo, size_t nPitch)
+{
+	size_t nLineSize = (rArea.x2 - rArea.x1 + 1) * m_nBytesPerPixel;
+	const u8 *pFrom = m_pBuffer + rArea.y1 * m_nPitch + rArea.x1 * m_nBytesPerPixel;
+
+	m_SpinLock.Acquire ();
+
+	for (unsigned y = rArea.y1; y <= rArea.y2; y++)
+	{
+		memcpy (pTo, pFrom, nLineSize);
+
+		pTo += nPitch;
+		pFrom += m_nPitch;
+	}
+
+	m_SpinLock.Release ();
+}
+
+boolean CManagedWindow::GetDamage (TArea *pDamage)
+{
+	m_SpinLock.Acquire ();
+
+	boolean bResult = m_bDamaged;
+	if (bResult)
+	{
+		*pDamage = m_Damage;
+		m_bDamaged = FALSE;
+	}
+
+	m_SpinLock.Release ();
+
+	return bResult;
+}
+
+//// CWindowManager ////////////////////////////////////////////////////////////
+
+CWindowManager::CWindowManager (CDisplay *pDisplay)
+:	m_pDisplay (pDisplay),
+	m_pFrameBuffer (nullptr),
+	m_nBytesPerPixel (0),
+	m_nBackground (0),
+	m_nWindows (0),
+	m_nDamages (0),
+	m_pComposeBuffer (nullptr),
+	m_SpinLock (TASK_LEVEL)
+{
+	assert (m_pDisplay);
+}
+
+CWindowManager::CWindowManager (CBcmFrameBuffer *pFrameBuffer, boolean bVSync)
+:	m_pDisplay (pFrameBuffer),
+	m_pFrameBuffer (bVSync ? pFrameBuffer : nullptr),
+	m_nBytesPerPixel (0),
+	m_nBackground (0),
+	m_nWindows (0),
+	m_nDamages (0),
+	m_pComposeBuffer (nullptr),
+	m_SpinLock (TASK_LEVEL)
+{
+	assert (m_pDisplay);
+}
+
+CWindowManager::~CWindowManager (void)
+{
+	assert (!m_nWindows);
+
+	delete [] m_pComposeBuffer;
+	m_pComposeBuffer = nullptr;
+
+	m_pDisplay = nullptr;
+	m_pFrameBuffer = nullptr;
+}
+
+boolean CWindowManager::Initialize (void)
+{
+	assert (m_pDisplay);
+	unsigned nDepth = m_pDisplay->GetDepth ();
+	if (   nDepth != 8
+	    && nDepth != 16
+	    && nDepth != 32)
+	{
+		return FALSE;
+	}
+
+	m_nBytesPerPixel = nDepth / 8;
+
+	m_pComposeBuffer = new u8[  m_pDisplay->GetWidth () * m_pDisplay->GetHeight ()
+				  * m_nBytesPerPixel];
+	if (!m_pComposeBuffer)
+	{
+		return FALSE;
+	}
+
+	m_nBackground = m_pDisplay->GetColor (CDisplay::Black);
+
+	// the display content is undefined yet
+	CDisplay::TArea Area {0, m_pDisplay->GetWidth ()-1, 0, m_pDisplay->GetHeight ()-1};
+	m_SpinLock.Acquire ();
+	AddDamage (Area);
+	m_SpinLock.Release ();
+
+	return TRUE;
+}
+
+CDisplay *CWindowManager::GetDisplay (void) const
+{
+	return m_pDisplay;
+}
+
+void CWindowManager::SetBackground (CDisplay::TColor Color)
+{
+	m_SpinLock.Acquire ();
+
+	m_nBackground = m_pDisplay->GetColor (Color);
+
+	CDisplay::TArea Area {0, m_pDisplay->GetWidth ()-1, 0, m_pDisplay->GetHeight ()-1};
+	AddDamage (Area);
+
+	m_SpinLock.Release ();
+}
+
+size_t CWindowManager::Update (void)
+{
+	assert (m_pComposeBuffer);
+
+	m_SpinLock.Acquire ();
+
+	for (unsigned i = 0; i < m_nWindows; i++)
+	{
+		CManagedWindow *pWindow = m_pWindow[i];
+
+		CDisplay::TArea Damage;
+		if (   pWindow->GetDamage (&Damage)
+		    && pWindow->m_bVisible)
+		{
+			Damage.x1 += pWindow->m_Area.x1;
+			Damage.x2 += pWindow->m_Area.x1;
+			Damage.y1 += pWindow->m_Area.y1;
+			Damage.y2 += pWindow->m_Area.y1;
+
+			AddDamage (Damage);
+		}
+	}
+
+	unsigned nDamages = m_nDamages;
+	CDisplay::TArea Damage[WINDOW_MANAGER_MAX_DAMAGE];
+	memcpy (Damage, m_Damage, sizeof Damage);
+	m_nDamages = 0;
+
+	m_SpinLock.Release ();
+
+	if (!nDamages)
+	{
+		return 0;
+	}
+
+	if (m_pFrameBuffer)
+	{
+		m_pFrameBuffer->WaitForVerticalSync ();
+	}
+
+	size_t nResult = 0;
+	for (unsigned i = 0; i < nDamages; i++)
+	{
+		m_SpinLock.Acquire ();
+
+		Compose (Damage[i]);
+
+		m_SpinLock.Release ();
+
+		m_pDisplay->SetArea (Damage[i], m_pComposeBuffer);
+
+		nResult +=   (Damage[i].x2 - Damage[i].x1 + 1) * (Damage[i].y2 - Damage[i].y1 + 1)
+			   * m_nBytesPerPixel;
+	}
+
+	return nResult;
+}
+
+void CWindowManager::AddWindow (CManagedWindow *pWindow)
+{
+	m_SpinLock.Acquire ();
+
+	assert (m_nWindows < WINDOW_MANAGER_MAX_WINDOWS);
+	m_pWindow[m_nWindows++] = pWindow;
+
+	AddDamage (pWindow->m_Area);
+
+	m_SpinLock.Release ();
+}
+
+void CWindowManager::RemoveWindow (CManagedWindow *pWindow)
+{
+	m_SpinLock.Acquire ();
+
+	for (unsigned i = 0; i < m_nWindows; i++)
+	{
+		if (m_pWindow[i] == pWindow)
+		{
+			memmove (&m_pWindow[i], &m_pWindow[i+1],
+				 (m_nWindows - i - 1) * sizeof m_pWindow[0]);
+			m_nWindows--;
+
+			if (pWindow->m_bVisible)
+			{
+				AddDamage (pWindow->m_Area);
+			}
+
+			break;
+		}
+	}
+
+	m_SpinLock.Release ();
+}
+
+void CWindowManager::Restack (CManagedWindow *pWindow, boolean bTop)
+{
+	m_SpinLock.Acquire ();
+
+	unsigned i;
+	for (i = 0; i < m_nWindows; i++)
+	{
+		if (m_pWindow[i] == pWindow)
+		{
+			break;
+		}
+	}
+
+	assert (i < m_nWindows);
+	if (bTop)
+	{
+		memmove (&m_pWindow[i], &m_pWindow[i+1], (m_nWindows - i - 1) * sizeof m_pWindow[0]);
+		m_pWindow[m_nWindows-1] = pWindow;
+	}
+	else
+	{
+		memmove (&m_pWindow[1], &m_pWindow[0], i * sizeof m_pWindow[0]);
+		m_pWindow[0] = pWindow;
+	}
+
+	if (pWindow->m_bVisible)
+	{
+		AddDamage (pWindow->m_Area);
+	}
+
+	m_SpinLock.Release ();
+}
+
+void CWindowManager::AddDamage (const CDisplay::TArea &rArea)
+{
+	CDisplay::TArea Area = rArea;
+
+	// merge with overlapping areas, so that no pixel is sent twice
+	unsigned i = 0;
+	while (i < m_nDamages)
+	{
+		CDisplay::TArea Dummy;
+		if (Intersect (Area, m_Damage[i], &Dummy))
+		{
+			Merge (&Area, m_Damage[i]);
+
+			m_Damage[i] = m_Damage[--m_nDamages];
+			i = 0;		// the merged area may overlap others now
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	if (m_nDamages == WINDOW_MANAGER_MAX_DAMAGE)
+	{
+		// no free slot, merge all areas
+		for (i = 0; i < m_nDamages; i++)
+		{
+			Merge (&Area, m_Damage[i]);
+		}
+
+		m_nDamages = 0;
+	}
+
+	m_Damage[m_nDamages++] = Area;
+}
+
+void CWindowManager::Compose (const CDisplay::TArea &rArea)
+{
+	unsigned nWidth = rArea.x2 - rArea.x1 + 1;
+	size_t nPitch = nWidth * m_nBytesPerPixel;
+
+	// windows below a window, which covers the whole area, are not visible
+	int nFirst = m_nWindows - 1;
+	for (; nFirst >= 0; nFirst--)
+	{
+		const CManagedWindow *pWindow = m_pWindow[nFirst];
+		if (   pWindow->m_bVisible
+		    && pWindow->m_Area.x1 <= rArea.x1 && rArea.x2 <= pWindow->m_Area.x2
+		    && pWindow->m_Area.y1 <= rArea.y1 && rArea.y2 <= pWindow->m_Area.y2)
+		{
+			break;
+		}
+	}
+
+	if (nFirst < 0)
+	{
+		FillPixels (m_pComposeBuffer, nWidth, rArea.y2 - rArea.y1 + 1, m_nBackground,
+			    m_nBytesPerPixel);
+
+		nFirst = 0;
+	}
+
+	for (unsigned i = nFirst; i < m_nWindows; i++)
+	{
+		CManagedWindow *pWindow = m_pWindow[i];
+
+		CDisplay::TArea Area;
+		if (   !pWindow->m_bVisible
+		    || !Intersect (rArea, pWindow->m_Area, &Area))
+		{
+			continue;
+		}
+
+		u8 *pTo =   m_pComposeBuffer + (Area.y1 - rArea.y1) * nPitch
+			  + (Area.x1 - rArea.x1) * m_nBytesPerPixel;
+
+		Area.x1 -= pWindow->m_Area.x1;
+		Area.x2 -= pWindow->m_Area.x1;
+		Area.y1 -= pWindow->m_Area.y1;
+		Area.y2 -= pWindow->m_Area.y1;
+
+		pWindow->Read (Area, pTo, nPitch);
+	}
+}
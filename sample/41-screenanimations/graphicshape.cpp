@@ -129,26 +129,44 @@ void CGraphicShape::Draw (void)
 	
 	
 	
+	Paint (m_Color);
+}
+
+void CGraphicShape::Erase (void)
+{
+	if (m_nType == GRAPHICSHAPE_SPRITE_TRANSPARENTCOLOR)
+	{
+		m_p2DGraphics->DrawRect(m_nPosX, m_nPosY,
+				       m_Sprite.GetWidth (), m_Sprite.GetHeight (), Black);
+	}
+	else
+	{
+		Paint (Black);
+	}
+}
+
+void CGraphicShape::Paint (T2DColor Color)
+{
 	switch(m_nType)
 	{
 		case GRAPHICSHAPE_RECT:
-			m_p2DGraphics->DrawRect(m_nPosX, m_nPosY, m_nParam1, m_nParam2, m_Color);
+			m_p2DGraphics->DrawRect(m_nPosX, m_nPosY, m_nParam1, m_nParam2, Color);
 			break;
 			
 		case GRAPHICSHAPE_OUTLINE:
-			m_p2DGraphics->DrawRectOutline(m_nPosX, m_nPosY, m_nParam1, m_nParam2, m_Color);
+			m_p2DGraphics->DrawRectOutline(m_nPosX, m_nPosY, m_nParam1, m_nParam2, Color);
 			break;
 			
 		case GRAPHICSHAPE_LINE:
-			m_p2DGraphics->DrawLine(m_nPosX, m_nPosY, m_nPosX+m_nParam1, m_nPosY+m_nParam2, m_Color);
+			m_p2DGraphics->DrawLine(m_nPosX, m_nPosY, m_nPosX+m_nParam1, m_nPosY+m_nParam2, Color);
 			break;
 			
 		case GRAPHICSHAPE_CIRCLE:
-			m_p2DGraphics->DrawCircle(m_nPosX, m_nPosY, m_nParam1, m_Color);
+			m_p2DGraphics->DrawCircle(m_nPosX, m_nPosY, m_nParam1, Color);
 			break;
 			
 		case GRAPHICSHAPE_CIRCLEOUTLINE:
-			m_p2DGraphics->DrawCircleOutline(m_nPosX, m_nPosY, m_nParam1, m_Color);
+			m_p2DGraphics->DrawCircleOutline(m_nPosX, m_nPosY, m_nParam1, Color);
 			break;
 			
 		case GRAPHICSHAPE_SPRITE_TRANSPARENTCOLOR:
@@ -158,7 +176,7 @@ void CGraphicShape::Draw (void)
 			break;
 
 		case GRAPHICSHAPE_TEXT:
-			m_p2DGraphics->DrawText(m_nPosX, m_nPosY, m_Color, "Hello Circle!", C2DGraphics::AlignCenter);
+			m_p2DGraphics->DrawText(m_nPosX, m_nPosY, Color, "Hello Circle!", C2DGraphics::AlignCenter);
 			break;
 	}
 	
@@ -45,6 +45,12 @@ public:
 
 	void Draw (void);
 
+	// draws the shape at its current position in black
+	void Erase (void);
+
+private:
+	void Paint (T2DColor Color);
+
 private:
 	C2DGraphics *m_p2DGraphics;
 	unsigned m_nDisplayWidth;
@@ -24,14 +24,17 @@ CKernel::CKernel (void)
 #ifdef SPI_DISPLAY
 	m_SPIMaster (SPI_CLOCK_SPEED, SPI_CPOL, SPI_CPHA, SPI_MASTER_DEVICE),
 	m_SPIDisplay (&m_SPIMaster, DISPLAY_PARAMETERS),
-	m_2DGraphics (&m_SPIDisplay)
+	m_2DGraphics (&m_SPIDisplay),
 #elif defined (I2C_DISPLAY)
 	m_I2CMaster (I2C_MASTER_DEVICE, TRUE),			// TRUE: I2C fast mode
 	m_I2CDisplay (&m_I2CMaster, DISPLAY_PARAMETERS),
-	m_2DGraphics (&m_I2CDisplay)
+	m_2DGraphics (&m_I2CDisplay),
 #else
-	m_2DGraphics (m_Options.GetWidth (), m_Options.GetHeight (), TRUE)
+	m_2DGraphics (m_Options.GetWidth (), m_Options.GetHeight (), TRUE),
 #endif
+	m_nFrames (0),
+	m_nBytes (0),
+	m_nStartTicks (0)
 {
 	m_ActLED.Blink (5);
 }
@@ -83,17 +86,56 @@ TShutdownMode CKernel::Run (void)
 		m_pShape[i] = new CGraphicShape (&m_2DGraphics);
 	}
 
+	m_2DGraphics.ClearScreen(CDisplay::Black);
+
+	m_nStartTicks = CTimer::GetClockTicks ();
+
 	while (1)
 	{
+#ifdef CLEAR_SCREEN
 		m_2DGraphics.ClearScreen(CDisplay::Black);
+#else
+		// only the modified areas will be sent to the display
+		for(unsigned i=0; i<nShapes; i++)
+		{
+			m_pShape[i]->Erase();
+		}
+#endif
 		
 		for(unsigned i=0; i<nShapes; i++)
 		{
 			m_pShape[i]->Draw();
 		}
+
+		DrawStatistics ();
 		
 		m_2DGraphics.UpdateDisplay();
+
+		m_nFrames++;
+		m_nBytes += m_2DGraphics.GetUpdateSize ();
 	}
 
 	return ShutdownHalt;
 }
+
+void CKernel::DrawStatistics (void)
+{
+	unsigned nTicks = CTimer::GetClockTicks () - m_nStartTicks;
+	if (nTicks >= CLOCKHZ)
+	{
+		// frame rate and bytes sent to the display per frame
+		m_Statistics.Format ("%u fps %u B",
+				     (unsigned) ((u64) m_nFrames * CLOCKHZ / nTicks),
+				     (unsigned) (m_nBytes / m_nFrames));
+
+		m_nFrames = 0;
+		m_nBytes = 0;
+		m_nStartTicks += nTicks;
+	}
+
+	// the shapes may have overwritten the statistics
+	CCharGenerator Font;
+	m_2DGraphics.DrawRect (0, 0, m_Statistics.GetLength () * Font.GetCharWidth (),
+			       Font.GetCharHeight (), CDisplay::Black);
+	m_2DGraphics.DrawText (0, 0, CDisplay::White, m_Statistics);
+}
@@ -23,6 +23,8 @@
 #include <circle/actled.h>
 #include <circle/koptions.h>
 #include <circle/2dgraphics.h>
+#include <circle/timer.h>
+#include <circle/string.h>
 #include <circle/types.h>
 #include "graphicshape.h"
 
@@ -34,6 +36,10 @@
 	#include <display/sampleconfig.h>
 #endif
 
+// Define this to clear the whole screen in each frame, instead of erasing the
+// shapes only. The whole screen has to be sent to the display then.
+//#define CLEAR_SCREEN
+
 enum TShutdownMode
 {
 	ShutdownNone,
@@ -54,6 +60,9 @@ public:
 
 	TShutdownMode Run (void);
 
+private:
+	void DrawStatistics (void);
+
 private:
 	// do not change this order
 	CActLED			m_ActLED;
@@ -67,6 +76,11 @@ private:
 #endif
 	C2DGraphics		m_2DGraphics;
 	CGraphicShape		*m_pShape[nShapes];
+
+	unsigned m_nFrames;
+	u64 m_nBytes;
+	unsigned m_nStartTicks;
+	CString m_Statistics;
 };
 
 #endif
@@ -26,6 +26,7 @@ LOGMODULE ("kernel");
 
 CKernel::CKernel (void)
 :	m_FrameBuffer (m_Options.GetWidth (), m_Options.GetHeight (), DEPTH),
+	m_WindowManager (&m_FrameBuffer),
 	m_Timer (&m_Interrupt),
 	m_Logger (m_Options.GetLogLevel (), &m_Timer),
 	m_USBHCI (&m_Interrupt, &m_Timer, TRUE)
@@ -46,7 +47,12 @@ boolean CKernel::Initialize (void)
 		bOK = m_FrameBuffer.Initialize ();
 	}
 
-	for (unsigned i = 0; i < NUM_WINDOWS; i++)
+	if (bOK)
+	{
+		bOK = m_WindowManager.Initialize ();
+	}
+
+	for (unsigned i = 0; bOK && i < NUM_WINDOWS; i++)
 	{
 		unsigned nHeight = m_FrameBuffer.GetHeight () / 2;
 		unsigned nWidth = m_FrameBuffer.GetWidth () / 2;
@@ -57,7 +63,7 @@ boolean CKernel::Initialize (void)
 		Area.y1 = nHeight * ((i >> 1) % 2);
 		Area.y2 = Area.y1 + nHeight - 1;
 
-		m_pWindow[i] = new CWindowDisplay (&m_FrameBuffer, Area);
+		m_pWindow[i] = new CManagedWindow (&m_WindowManager, Area);
 		assert (m_pWindow[i]);
 	}
 
@@ -136,6 +142,9 @@ TShutdownMode CKernel::Run (void)
 
 		assert (m_pGUI);
 		m_pGUI->Update (bUpdated);
+
+		// composites the windows, which have been drawn by all cores
+		m_WindowManager.Update ();
 	}
 
 	return ShutdownHalt;
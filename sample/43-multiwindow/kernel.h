@@ -24,7 +24,7 @@
 #include <circle/koptions.h>
 #include <circle/devicenameservice.h>
 #include <circle/bcmframebuffer.h>
-#include <circle/windowdisplay.h>
+#include <circle/windowmanager.h>
 #include <circle/terminal.h>
 #include <circle/serial.h>
 #include <circle/exceptionhandler.h>
@@ -60,6 +60,7 @@ private:
 	CKernelOptions		m_Options;
 	CDeviceNameService	m_DeviceNameService;
 	CBcmFrameBuffer		m_FrameBuffer;
+	CWindowManager		m_WindowManager;
 	CDisplay		*m_pWindow[NUM_WINDOWS];
 	CTerminalDevice		*m_pTerminal;
 	CSerialDevice		m_Serial;
@@ -0,0 +1,435 @@
+//
+// kernel.cpp
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include "kernel.h"
+#include <circle/net/checksumcalculator.h>
+#include <circle/checksum.h>
+#include <circle/synchronize.h>
+#include <circle/sysconfig.h>
+#include <circle/string.h>
+#include <circle/util.h>
+#include <assert.h>
+
+#define MAX_SIZE	0x100000
+#define GUARD_SIZE	64
+#define BUFFER_SIZE	(MAX_SIZE + 2*GUARD_SIZE)
+
+#define BYTES_PER_TEST	(16 * MEGABYTE)
+
+static const char FromKernel[] = "kernel";
+
+static const size_t s_Sizes[] = {64, 256, 1024, 4096, 65536, MAX_SIZE};
+
+static const struct
+{
+	unsigned nDest;
+	unsigned nSrc;
+}
+s_Alignments[] = {{0, 0}, {0, 3}, {5, 0}, {7, 13}};
+
+static const char *s_pName[] = {"memcpy", "memset", "memcmp", "strlen", "checksum",
+				 "crc32", "crc32c", "adler32"};
+
+static volatile unsigned s_nResult;		// prevents optimizing the calls away
+
+static unsigned s_nRandom = 1;
+
+static u8 Random (void)
+{
+	s_nRandom = s_nRandom * 1103515245 + 12345;
+
+	return (u8) (s_nRandom >> 16);
+}
+
+static int RefCompare (const u8 *p1, const u8 *p2, size_t nLength)
+{
+	for (size_t i = 0; i < nLength; i++)
+	{
+		if (p1[i] != p2[i])
+		{
+			return p1[i] > p2[i] ? 1 : -1;
+		}
+	}
+
+	return 0;
+}
+
+static u16 RefChecksum (const u8 *pBuffer, size_t nLength)
+{
+	u32 nSum = 0;
+	for (size_t i = 0; i+1 < nLength; i += 2)
+	{
+		nSum += pBuffer[i] | pBuffer[i+1] << 8;
+	}
+
+	if (nLength & 1)
+	{
+		nSum += pBuffer[nLength-1];
+	}
+
+	while (nSum >> 16)
+	{
+		nSum = (nSum & 0xFFFF) + (nSum >> 16);
+	}
+
+	return ~nSum;
+}
+
+static u32 RefCRC32 (const u8 *pBuffer, size_t nLength, u32 nPolynomial)
+{
+	u32 nCRC = ~0U;
+	while (nLength--)
+	{
+		nCRC ^= *pBuffer++;
+
+		for (unsigned i = 0; i < 8; i++)
+		{
+			nCRC = (nCRC >> 1) ^ ((nCRC & 1) ? nPolynomial : 0);
+		}
+	}
+
+	return ~nCRC;
+}
+
+CKernel::CKernel (void)
+:	m_Screen (m_Options.GetWidth (), m_Options.GetHeight ()),
+	m_Timer (&m_Interrupt),
+	m_Logger (m_Options.GetLogLevel (), &m_Timer),
+	m_pBuffer1 (0),
+	m_pBuffer2 (0)
+{
+	m_ActLED.Blink (5);	// show we are alive
+}
+
+CKernel::~CKernel (void)
+{
+	delete [] m_pBuffer1;
+	delete [] m_pBuffer2;
+}
+
+boolean CKernel::Initialize (void)
+{
+	boolean bOK = TRUE;
+
+	if (bOK)
+	{
+		bOK = m_Screen.Initialize ();
+	}
+
+	if (bOK)
+	{
+		bOK = m_Serial.Initialize (115200);
+	}
+
+	if (bOK)
+	{
+		CDevice *pTarget = m_DeviceNameService.GetDevice (m_Options.GetLogDevice (), FALSE);
+		if (pTarget == 0)
+		{
+			pTarget = &m_Screen;
+		}
+
+		bOK = m_Logger.Initialize (pTarget);
+	}
+
+	if (bOK)
+	{
+		bOK = m_Interrupt.Initialize ();
+	}
+
+	if (bOK)
+	{
+		bOK = m_Timer.Initialize ();
+	}
+
+	if (bOK)
+	{
+		m_pBuffer1 = new u8[BUFFER_SIZE];
+		m_pBuffer2 = new u8[BUFFER_SIZE];
+
+		bOK = m_pBuffer1 != 0 && m_pBuffer2 != 0;
+	}
+
+	return bOK;
+}
+
+TShutdownMode CKernel::Run (void)
+{
+	m_Logger.Write (FromKernel, LogNotice, "Compile time: " __DATE__ " " __TIME__);
+
+#ifdef USE_NEON_UTIL
+	m_Logger.Write (FromKernel, LogNotice, "Using NEON implementation");
+#else
+	m_Logger.Write (FromKernel, LogNotice, "Using non-NEON implementation");
+#endif
+
+	m_Logger.Write (FromKernel, LogNotice, "Checking functions ...");
+
+	unsigned nErrors = Check ();
+	if (nErrors != 0)
+	{
+		m_Logger.Write (FromKernel, LogError, "%u error(s) found", nErrors);
+
+		return ShutdownHalt;
+	}
+
+	m_Logger.Write (FromKernel, LogNotice, "All checks passed");
+
+	CString Header ("Function     Size");
+	for (unsigned i = 0; i < sizeof s_Alignments / sizeof s_Alignments[0]; i++)
+	{
+		CString Column;
+		Column.Format ("   d%u/s%-2u", s_Alignments[i].nDest, s_Alignments[i].nSrc);
+		Header.Append (Column);
+	}
+	Header.Append ("  (GB/s)");
+	m_Logger.Write (FromKernel, LogNotice, Header);
+
+	for (unsigned nBenchmark = 0; nBenchmark < BenchmarkUnknown; nBenchmark++)
+	{
+		for (unsigned nSize = 0; nSize < sizeof s_Sizes / sizeof s_Sizes[0]; nSize++)
+		{
+			CString Line;
+			Line.Format ("%-8s %8u", s_pName[nBenchmark], (unsigned) s_Sizes[nSize]);
+
+			for (unsigned i = 0; i < sizeof s_Alignments / sizeof s_Alignments[0]; i++)
+			{
+				double fGBps = Measure ((TBenchmark) nBenchmark, s_Sizes[nSize],
+							s_Alignments[i].nDest, s_Alignments[i].nSrc);
+
+				CString Column;
+				Column.Format (" %8.3f", fGBps);
+				Line.Append (Column);
+			}
+
+			m_Logger.Write (FromKernel, LogNotice, Line);
+		}
+	}
+
+	m_Logger.Write (FromKernel, LogNotice, "Test finished");
+
+	return ShutdownHalt;
+}
+
+unsigned CKernel::Check (void)
+{
+	unsigned nErrors = 0;
+
+	// check values
+	static const char CheckData[] = "123456789";
+	if (   CCRC32::Calculate (CheckData, 9) != 0xCBF43926
+	    || CCRC32::Calculate (CheckData, 9, CRC32PolynomialCastagnoli) != 0xE3069283
+	    || CAdler32::Calculate (CheckData, 9) != 0x091E01DE
+	    || CFletcher32::Calculate ("abcde", 5) != 0xF04FC729)
+	{
+		m_Logger.Write (FromKernel, LogError, "Check values do not match");
+		nErrors++;
+	}
+
+	for (size_t nLength = 0; nLength <= 302; nLength++)
+	{
+		// check two larger, odd sizes too
+		size_t nSize = nLength <= 300 ? nLength : 65536 + 7 + (nLength-301) * 4093;
+
+		for (unsigned nDest = 0; nDest < 8; nDest++)
+		{
+			for (unsigned nSrc = 0; nSrc < 8; nSrc++)
+			{
+				u8 *pDest = m_pBuffer1 + GUARD_SIZE + nDest;
+				u8 *pSrc = m_pBuffer2 + GUARD_SIZE + nSrc;
+
+				// memcpy()
+				for (size_t i = 0; i < nSize; i++)
+				{
+					pSrc[i] = Random () | 1;	// no zero bytes for strlen()
+				}
+				for (size_t i = 0; i < nSize + 2*GUARD_SIZE; i++)
+				{
+					m_pBuffer1[i] = 0xAA;
+				}
+
+				if (   memcpy (pDest, pSrc, nSize) != pDest
+				    || RefCompare (pDest, pSrc, nSize) != 0
+				    || pDest[-1] != 0xAA
+				    || pDest[nSize] != 0xAA)
+				{
+					m_Logger.Write (FromKernel, LogError, "memcpy (%u, d%u, s%u) failed",
+							(unsigned) nSize, nDest, nSrc);
+					nErrors++;
+				}
+
+				// memcmp()
+				if (memcmp (pDest, pSrc, nSize) != 0)
+				{
+					m_Logger.Write (FromKernel, LogError, "memcmp (%u, d%u, s%u) failed",
+							(unsigned) nSize, nDest, nSrc);
+					nErrors++;
+				}
+
+				if (nSize > 0)
+				{
+					size_t nPos = (nSize-1) * Random () / 255;
+					pDest[nPos] ^= 0x80;
+
+					int nResult = memcmp (pDest, pSrc, nSize);
+					if (   nResult == 0
+					    || (nResult > 0) != (pDest[nPos] > pSrc[nPos]))
+					{
+						m_Logger.Write (FromKernel, LogError,
+								"memcmp (%u, d%u, s%u, pos %u) failed",
+								(unsigned) nSize, nDest, nSrc, (unsigned) nPos);
+						nErrors++;
+					}
+				}
+
+				// strlen()
+				pSrc[nSize] = '\0';
+				if (strlen ((const char *) pSrc) != nSize)
+				{
+					m_Logger.Write (FromKernel, LogError, "strlen (%u, s%u) failed",
+							(unsigned) nSize, nSrc);
+					nErrors++;
+				}
+
+				// checksum
+				if (   nSize > 0
+				    && CChecksumCalculator::SimpleCalculate (pSrc, nSize)
+				       != RefChecksum (pSrc, nSize))
+				{
+					m_Logger.Write (FromKernel, LogError, "checksum (%u, s%u) failed",
+							(unsigned) nSize, nSrc);
+					nErrors++;
+				}
+
+				// CRC-32 and CRC-32C
+				if (   CCRC32::Calculate (pSrc, nSize) != RefCRC32 (pSrc, nSize, 0xEDB88320)
+				    || CCRC32::Calculate (pSrc, nSize, CRC32PolynomialCastagnoli)
+				       != RefCRC32 (pSrc, nSize, 0x82F63B78))
+				{
+					m_Logger.Write (FromKernel, LogError, "crc32 (%u, s%u) failed",
+							(unsigned) nSize, nSrc);
+					nErrors++;
+				}
+
+				// memset()
+				u8 uchValue = Random ();
+				if (memset (pDest, uchValue, nSize) != pDest)
+				{
+					nErrors++;
+				}
+				for (size_t i = 0; i < nSize; i++)
+				{
+					if (pDest[i] != uchValue)
+					{
+						nErrors++;
+						break;
+					}
+				}
+				if (   pDest[-1] != 0xAA
+				    || pDest[nSize] != 0xAA)
+				{
+					m_Logger.Write (FromKernel, LogError, "memset (%u, d%u) failed",
+							(unsigned) nSize, nDest);
+					nErrors++;
+				}
+
+				if (nErrors >= 10)
+				{
+					return nErrors;
+				}
+			}
+		}
+	}
+
+	return nErrors;
+}
+
+double CKernel::Measure (TBenchmark Benchmark, size_t nSize, unsigned nDestAlign,
+			 unsigned nSrcAlign)
+{
+	u8 *pDest = m_pBuffer1 + GUARD_SIZE + nDestAlign;
+	u8 *pSrc = m_pBuffer2 + GUARD_SIZE + nSrcAlign;
+
+	memset (pSrc, 'A', nSize);
+	pSrc[nSize-1] = '\0';
+	memcpy (pDest, pSrc, nSize);
+
+	unsigned nIterations = BYTES_PER_TEST / nSize;
+	unsigned nResult = 0;
+
+	DisableIRQs ();
+
+	u64 nStartTicks = CTimer::GetClockTicks64 ();
+
+	for (unsigned i = 0; i < nIterations; i++)
+	{
+		switch (Benchmark)
+		{
+		case BenchmarkMemcpy:
+			memcpy (pDest, pSrc, nSize);
+			break;
+
+		case BenchmarkMemset:
+			memset (pDest, i, nSize);
+			break;
+
+		case BenchmarkMemcmp:
+			nResult += memcmp (pDest, pSrc, nSize);
+			break;
+
+		case BenchmarkStrlen:
+			nResult += strlen ((const char *) pSrc);
+			break;
+
+		case BenchmarkChecksum:
+			nResult += CChecksumCalculator::SimpleCalculate (pSrc, nSize);
+			break;
+
+		case BenchmarkCRC32:
+			nResult += CCRC32::Calculate (pSrc, nSize);
+			break;
+
+		case BenchmarkCRC32C:
+			nResult += CCRC32::Calculate (pSrc, nSize, CRC32PolynomialCastagnoli);
+			break;
+
+		case BenchmarkAdler32:
+			nResult += CAdler32::Calculate (pSrc, nSize);
+			break;
+
+		default:
+			assert (0);
+			break;
+		}
+	}
+
+	u64 nTicks = CTimer::GetClockTicks64 () - nStartTicks;
+
+	EnableIRQs ();
+
+	s_nResult = nResult;
+
+	if (nTicks == 0)
+	{
+		nTicks = 1;
+	}
+
+	// bytes per microsecond / 1000 = GB/s
+	return (double) nSize * nIterations / nTicks / 1000.0;
+}
@@ -0,0 +1,228 @@
+//
+// kernel.cpp
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2026  R. Stange <rsta2@gmx.net>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include "kernel.h"
+#include <circle/util.h>
+#include <assert.h>
+
+#define BAUDRATE	3000000
+#define MAX_BLOCK_SIZE	4096
+#define BLOCKS		1000
+#define TIMEOUT_US	1000000
+
+static const char FromKernel[] = "kernel";
+
+static unsigned s_nRandom = 1;
+
+static u8 Random (void)
+{
+	s_nRandom = s_nRandom * 1103515245 + 12345;
+
+	return (u8) (s_nRandom >> 16);
+}
+
+CKernel::CKernel (void)
+:	m_Screen (m_Options.GetWidth (), m_Options.GetHeight ()),
+	m_Serial (&m_Interrupt),
+	m_Timer (&m_Interrupt),
+	m_Logger (m_Options.GetLogLevel (), &m_Timer),
+	m_bUseDMA (FALSE),
+	m_pTxBuffer (0),
+	m_pRxBuffer (0),
+	m_nIdleCount (0)
+{
+	m_ActLED.Blink (5);	// show we are alive
+}
+
+CKernel::~CKernel (void)
+{
+	delete [] m_pRxBuffer;
+	delete [] m_pTxBuffer;
+}
+
+boolean CKernel::Initialize (void)
+{
+	boolean bOK = TRUE;
+
+	if (bOK)
+	{
+		bOK = m_Screen.Initialize ();
+	}
+
+	if (bOK)
+	{
+		// the serial device is under test, so the log goes to the screen
+		bOK = m_Logger.Initialize (&m_Screen);
+	}
+
+	if (bOK)
+	{
+		bOK = m_Interrupt.Initialize ();
+	}
+
+	if (bOK)
+	{
+		bOK = m_Timer.Initialize ();
+	}
+
+	if (bOK)
+	{
+		if (m_Options.GetAppOptionDecimal ("dma", 1) != 0)
+		{
+			m_bUseDMA = m_Serial.EnableDMA ();
+			if (!m_bUseDMA)
+			{
+				m_Logger.Write (FromKernel, LogWarning, "DMA mode is not supported");
+			}
+		}
+
+		bOK = m_Serial.Initialize (m_Options.GetAppOptionDecimal ("baudrate", BAUDRATE));
+	}
+
+	if (bOK)
+	{
+		m_pTxBuffer = new u8[MAX_BLOCK_SIZE];
+		m_pRxBuffer = new u8[MAX_BLOCK_SIZE];
+
+		bOK = m_pTxBuffer != 0 && m_pRxBuffer != 0;
+	}
+
+	return bOK;
+}
+
+TShutdownMode CKernel::Run (void)
+{
+	m_Logger.Write (FromKernel, LogNotice, "Compile time: " __DATE__ " " __TIME__);
+
+	m_Logger.Write (FromKernel, LogNotice, "Testing %s driver",
+			m_bUseDMA ? "DMA" : "interrupt");
+
+	// transfer the data unmodified
+	m_Serial.SetOptions (0);
+	m_Serial.SetLoopback (TRUE);
+
+	if (m_bUseDMA)
+	{
+		m_Serial.RegisterIdleHandler (IdleHandler, this);
+	}
+
+	unsigned nErrors = 0;
+	u64 nBytes = 0;
+
+	unsigned nStartTicks = CTimer::GetClockTicks ();
+
+	for (unsigned nBlock = 0; nBlock < BLOCKS; nBlock++)
+	{
+		unsigned nLength = 1 + (Random () << 8 | Random ()) % MAX_BLOCK_SIZE;
+
+		nErrors += TransferBlock (nLength);
+		nBytes += nLength;
+	}
+
+	unsigned nTicks = CTimer::GetClockTicks () - nStartTicks;
+	assert (nTicks > 0);
+
+	m_Serial.SetLoopback (FALSE);
+
+	m_Logger.Write (FromKernel, LogNotice, "%llu bytes transferred with %u KByte/s",
+			nBytes, (unsigned) (nBytes * CLOCKHZ / 1024 / nTicks));
+
+	if (m_bUseDMA)
+	{
+		m_Logger.Write (FromKernel, LogNotice, "Idle handler called %u times",
+				m_nIdleCount);
+	}
+
+	if (nErrors != 0)
+	{
+		m_Logger.Write (FromKernel, LogError, "%u error(s) found", nErrors);
+	}
+	else
+	{
+		m_Logger.Write (FromKernel, LogNotice, "Test passed");
+	}
+
+	return ShutdownHalt;
+}
+
+unsigned CKernel::TransferBlock (unsigned nLength)
+{
+	assert (m_pTxBuffer != 0);
+	assert (m_pRxBuffer != 0);
+	assert (nLength <= MAX_BLOCK_SIZE);
+
+	for (unsigned i = 0; i < nLength; i++)
+	{
+		m_pTxBuffer[i] = Random ();
+	}
+
+	unsigned nErrors = 0;
+	unsigned nWritten = 0;
+	unsigned nRead = 0;
+
+	unsigned nStartTicks = CTimer::GetClockTicks ();
+	while (nRead < nLength)
+	{
+		if (nWritten < nLength)
+		{
+			int nResult = m_Serial.Write (m_pTxBuffer + nWritten, nLength - nWritten);
+			if (nResult > 0)
+			{
+				nWritten += nResult;
+			}
+		}
+
+		int nResult = m_Serial.Read (m_pRxBuffer + nRead, nLength - nRead);
+		if (nResult < 0)
+		{
+			m_Logger.Write (FromKernel, LogWarning, "Read error %d", nResult);
+
+			nErrors++;
+		}
+		else if (nResult > 0)
+		{
+			nRead += nResult;
+		}
+
+		if (CTimer::GetClockTicks () - nStartTicks > TIMEOUT_US)
+		{
+			m_Logger.Write (FromKernel, LogWarning, "Timeout (%u of %u bytes received)",
+					nRead, nLength);
+
+			return nErrors + 1;
+		}
+	}
+
+	if (memcmp (m_pTxBuffer, m_pRxBuffer, nLength) != 0)
+	{
+		m_Logger.Write (FromKernel, LogWarning, "Data mismatch (%u bytes)", nLength);
+
+		nErrors++;
+	}
+
+	return nErrors;
+}
+
+void CKernel::IdleHandler (unsigned nBytesAvailable, void *pParam)
+{
+	CKernel *pThis = (CKernel *) pParam;
+	assert (pThis != 0);
+
+	pThis->m_nIdleCount++;
+}
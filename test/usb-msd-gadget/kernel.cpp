@@ -21,6 +21,8 @@
 //
 #include "kernel.h"
 
+#define STAT_INTERVAL_SECS	5
+
 LOGMODULE ("kernel");
 
 CKernel::CKernel (void)
@@ -91,6 +93,10 @@ TShutdownMode CKernel::Run (void)
 
 	m_MSDGadget.SetDevice (&m_EMMC);
 
+	CUSBMSDGadget::TStatistics LastStat;
+	m_MSDGadget.GetStatistics (&LastStat);
+	unsigned nLastTicks = m_Timer.GetTicks ();
+
 	for (unsigned nCount = 0; 1; nCount++)
 	{
 		m_MSDGadget.UpdatePlugAndPlay ();
@@ -99,6 +105,30 @@ TShutdownMode CKernel::Run (void)
 		m_MSDGadget.Update ();
 
 		m_Screen.Rotor (0, nCount);
+
+		unsigned nTicks = m_Timer.GetTicks ();
+		if (nTicks - nLastTicks >= STAT_INTERVAL_SECS * HZ)
+		{
+			CUSBMSDGadget::TStatistics Stat;
+			m_MSDGadget.GetStatistics (&Stat);
+
+			// show throughput, if there was activity in the last interval
+			u64 nRead = Stat.BytesRead - LastStat.BytesRead;
+			u64 nWritten = Stat.BytesWritten - LastStat.BytesWritten;
+			if (nRead || nWritten)
+			{
+				unsigned nMsecs = (nTicks - nLastTicks) * 1000 / HZ;
+
+				LOGNOTE ("Read %u KB/s (%u cmds), write %u KB/s (%u cmds)",
+					 (unsigned) (nRead / nMsecs),
+					 Stat.ReadCommands - LastStat.ReadCommands,
+					 (unsigned) (nWritten / nMsecs),
+					 Stat.WriteCommands - LastStat.WriteCommands);
+			}
+
+			LastStat = Stat;
+			nLastTicks = nTicks;
+		}
 	}
 
 	return ShutdownHalt;